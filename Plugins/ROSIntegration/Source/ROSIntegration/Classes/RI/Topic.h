@@ -50,6 +50,11 @@ public:
 
 	bool Publish(TSharedPtr<FROSBaseMsg> msg);
 
+	// Sends sensor_msgs/Image and sensor_msgs/PointCloud2 payloads through a POSIX shared memory ring
+	// instead of rosbridge, only a small descriptor is published on <topic>/shm. Linux only,
+	// see Public/SharedMemory/SharedMemoryReader.h for the reading side.
+	bool EnableSharedMemoryTransport(int32 SlotCount = 4);
+
 	void BeginDestroy() override;
 
 	void Init(UROSIntegrationCore *Ric, FString Topic, FString MessageType, int32 QueueSize = 10);
@@ -49,10 +49,10 @@ public:
 
 	static void _bson_append_camera_info(bson_t *b, const ROSMessages::sensor_msgs::CameraInfo *msg)
 	{
-		// assert(CastMsg->D.Num() == 5); // TODO: use Unreal assertions
-		assert(CastMsg->K.Num() == 9); // TODO: use Unreal assertions
-		assert(CastMsg->R.Num() == 9);
-		assert(CastMsg->P.Num() == 12);
+		// assert(msg->D.Num() == 5); // TODO: use Unreal assertions
+		assert(msg->K.Num() == 9); // TODO: use Unreal assertions
+		assert(msg->R.Num() == 9);
+		assert(msg->P.Num() == 12);
 		
 		UStdMsgsHeaderConverter::_bson_append_child_header(b, "header", &msg->header);
 		BSON_APPEND_INT32(b, "height", msg->height);
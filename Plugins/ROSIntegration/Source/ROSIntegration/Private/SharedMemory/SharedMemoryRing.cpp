@@ -0,0 +1,127 @@
+#include "SharedMemory/SharedMemoryRing.h"
+#include "ROSIntegrationCore.h"
+
+#if PLATFORM_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FSharedMemoryRing::~FSharedMemoryRing()
+{
+	Destroy();
+}
+
+FString FSharedMemoryRing::MakeSegmentName(const FString& Topic)
+{
+	FString Sanitized = Topic;
+	Sanitized.RemoveFromStart(TEXT("/"));
+	Sanitized.ReplaceInline(TEXT("/"), TEXT("_"));
+	return TEXT("/ros_integration_") + Sanitized;
+}
+
+bool FSharedMemoryRing::Create(const FString& SegmentName, uint32 InSlotCount, uint64 InPayloadCapacity)
+{
+	Destroy();
+
+#if PLATFORM_LINUX
+	if (InSlotCount < 2 || InPayloadCapacity == 0)
+	{
+		UE_LOG(LogROS, Error, TEXT("Shared memory segment %s needs at least two slots and a payload size."), *SegmentName);
+		return false;
+	}
+
+	const uint64 Size = rosintegration_shm::segment_size(InSlotCount, InPayloadCapacity);
+	const FTCHARToUTF8 NameUtf8(*SegmentName);
+
+	// A segment left behind by a crashed run would have a stale layout
+	shm_unlink(NameUtf8.Get());
+	const int FileDescriptor = shm_open(NameUtf8.Get(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (FileDescriptor < 0)
+	{
+		UE_LOG(LogROS, Error, TEXT("shm_open failed for %s (errno %d)."), *SegmentName, errno);
+		return false;
+	}
+
+	if (ftruncate(FileDescriptor, Size) != 0)
+	{
+		UE_LOG(LogROS, Error, TEXT("Could not resize shared memory segment %s to %llu bytes (errno %d)."), *SegmentName, Size, errno);
+		close(FileDescriptor);
+		shm_unlink(NameUtf8.Get());
+		return false;
+	}
+
+	void* NewMapping = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, 0);
+	close(FileDescriptor);
+	if (NewMapping == MAP_FAILED)
+	{
+		UE_LOG(LogROS, Error, TEXT("mmap failed for %s (errno %d)."), *SegmentName, errno);
+		shm_unlink(NameUtf8.Get());
+		return false;
+	}
+
+	// ftruncate zero fills, so every slot starts with sequence 0 which no reader accepts
+	rosintegration_shm::segment_header* Header = static_cast<rosintegration_shm::segment_header*>(NewMapping);
+	Header->magic = rosintegration_shm::kMagic;
+	Header->version = rosintegration_shm::kVersion;
+	Header->slot_count = InSlotCount;
+	Header->slot_stride = rosintegration_shm::slot_stride(InPayloadCapacity);
+	Header->payload_capacity = InPayloadCapacity;
+	Header->latest_sequence.store(0, std::memory_order_release);
+
+	Name = SegmentName;
+	Mapping = NewMapping;
+	MappingSize = Size;
+	SlotCount = InSlotCount;
+	PayloadCapacity = InPayloadCapacity;
+	NextSequence = 1;
+
+	UE_LOG(LogROS, Display, TEXT("Created shared memory segment %s with %u slots of %llu bytes."), *Name, SlotCount, PayloadCapacity);
+	return true;
+#else
+	UE_LOG(LogROS, Warning, TEXT("Shared memory transport is only supported on Linux, %s keeps using rosbridge."), *SegmentName);
+	return false;
+#endif
+}
+
+void FSharedMemoryRing::Destroy()
+{
+#if PLATFORM_LINUX
+	if (Mapping)
+	{
+		munmap(Mapping, MappingSize);
+		shm_unlink(TCHAR_TO_UTF8(*Name));
+	}
+#endif
+	Mapping = nullptr;
+	MappingSize = 0;
+	SlotCount = 0;
+	PayloadCapacity = 0;
+}
+
+uint64 FSharedMemoryRing::Write(const rosintegration_shm::slot_metadata& Metadata, const uint8* Payload, uint64 PayloadSize)
+{
+	if (!Mapping || PayloadSize > PayloadCapacity || (PayloadSize > 0 && !Payload))
+	{
+		return 0;
+	}
+
+	const uint64 Sequence = NextSequence++;
+	rosintegration_shm::slot_header* Slot = rosintegration_shm::slot_at(Mapping, (uint32)(Sequence % SlotCount));
+
+	// Odd sequence marks the slot as being written
+	Slot->sequence.store(2 * Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FMemory::Memcpy(&Slot->metadata, &Metadata, sizeof(Metadata));
+	Slot->metadata.payload_size = PayloadSize;
+	if (PayloadSize > 0)
+	{
+		FMemory::Memcpy(rosintegration_shm::payload_of(Slot), Payload, PayloadSize);
+	}
+
+	Slot->sequence.store(2 * Sequence, std::memory_order_release);
+	static_cast<rosintegration_shm::segment_header*>(Mapping)->latest_sequence.store(Sequence, std::memory_order_release);
+	return Sequence;
+}
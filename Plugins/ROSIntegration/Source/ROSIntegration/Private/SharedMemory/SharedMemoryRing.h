@@ -0,0 +1,37 @@
+#pragma once
+
+#include <CoreMinimal.h>
+#include "SharedMemory/SharedMemoryProtocol.h"
+
+// Writer side of the same-host shared memory transport, see SharedMemoryProtocol.h for the layout.
+// Only available on Linux, Create() fails everywhere else.
+class FSharedMemoryRing
+{
+public:
+	FSharedMemoryRing() {}
+	~FSharedMemoryRing();
+
+	FSharedMemoryRing(const FSharedMemoryRing&) = delete;
+	FSharedMemoryRing& operator=(const FSharedMemoryRing&) = delete;
+
+	// POSIX shm names need a leading slash and no other slashes
+	static FString MakeSegmentName(const FString& Topic);
+
+	bool Create(const FString& SegmentName, uint32 SlotCount, uint64 PayloadCapacity);
+	void Destroy();
+
+	bool IsValid() const { return Mapping != nullptr; }
+	const FString& GetName() const { return Name; }
+	uint64 GetPayloadCapacity() const { return PayloadCapacity; }
+
+	// Copies one message into the next slot and returns its sequence number, 0 on failure
+	uint64 Write(const rosintegration_shm::slot_metadata& Metadata, const uint8* Payload, uint64 PayloadSize);
+
+private:
+	FString Name;
+	void* Mapping = nullptr;
+	uint64 MappingSize = 0;
+	uint32 SlotCount = 0;
+	uint64 PayloadCapacity = 0;
+	uint64 NextSequence = 1;
+};
@@ -0,0 +1,167 @@
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "SharedMemory/SharedMemoryRing.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && PLATFORM_LINUX
+
+#include "SharedMemory/SharedMemoryReader.h"
+#include "Async/Async.h"
+
+namespace
+{
+	const uint32 LoopbackSlotCount = 4;
+	const uint64 LoopbackPayloadCapacity = 64 * 48 * 3;
+
+	// Payload and metadata of frame n are derived from n, so a reader can check any frame it got on its own
+	void MakeFrame(uint64 Sequence, rosintegration_shm::slot_metadata& Metadata, TArray<uint8>& Payload)
+	{
+		FMemory::Memzero(Metadata);
+		Metadata.kind = rosintegration_shm::kImage;
+		Metadata.header_seq = (uint32)Sequence;
+		Metadata.stamp_sec = (uint32)(Sequence / 10);
+		Metadata.stamp_nsec = (uint32)(Sequence % 10) * 100000000u;
+		Metadata.width = 64;
+		Metadata.height = 48;
+		Metadata.step = 64 * 3;
+		FCStringAnsi::Strncpy(Metadata.frame_id, "loopback", sizeof(Metadata.frame_id));
+		FCStringAnsi::Strncpy(Metadata.encoding, "rgb8", sizeof(Metadata.encoding));
+
+		// Frames differ in size so a reader mixing two slots would also get the length wrong
+		Payload.SetNumUninitialized((int32)(LoopbackPayloadCapacity - (Sequence % 7) * 3));
+		for (int32 Index = 0; Index < Payload.Num(); Index++)
+		{
+			Payload[Index] = (uint8)((Sequence * 31 + Index) & 0xff);
+		}
+	}
+
+	bool IsFrame(uint64 Sequence, const rosintegration_shm::slot_metadata& Metadata, const std::vector<uint8_t>& Data)
+	{
+		rosintegration_shm::slot_metadata ExpectedMetadata;
+		TArray<uint8> ExpectedPayload;
+		MakeFrame(Sequence, ExpectedMetadata, ExpectedPayload);
+		ExpectedMetadata.payload_size = ExpectedPayload.Num();
+		return FMemory::Memcmp(&Metadata, &ExpectedMetadata, sizeof(Metadata)) == 0
+			&& Data.size() == (size_t)ExpectedPayload.Num()
+			&& FMemory::Memcmp(Data.data(), ExpectedPayload.GetData(), ExpectedPayload.Num()) == 0;
+	}
+
+	FString MakeLoopbackSegmentName(const TCHAR* Suffix)
+	{
+		return FSharedMemoryRing::MakeSegmentName(FString::Printf(TEXT("/automation/%s_%u"), Suffix, FPlatformProcess::GetCurrentProcessId()));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSharedMemoryLoopbackTest, "ROSIntegration.SharedMemory.Loopback",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Writes frames through the ring and reads them back with the reference reader of SharedMemoryReader.h
+bool FSharedMemoryLoopbackTest::RunTest(const FString& Parameters)
+{
+	FSharedMemoryRing Ring;
+	const FString SegmentName = MakeLoopbackSegmentName(TEXT("loopback"));
+	if (!TestTrue(TEXT("Segment is created"), Ring.Create(SegmentName, LoopbackSlotCount, LoopbackPayloadCapacity)))
+	{
+		return false;
+	}
+
+	rosintegration_shm::reader Reader;
+	if (!TestTrue(TEXT("Reader opens the segment"), Reader.open(TCHAR_TO_UTF8(*SegmentName))))
+	{
+		return false;
+	}
+
+	rosintegration_shm::slot_metadata Metadata;
+	std::vector<uint8_t> Data;
+	TestFalse(TEXT("Nothing to read before the first frame"), Reader.read_latest(Metadata, Data));
+
+	rosintegration_shm::slot_metadata WriteMetadata;
+	TArray<uint8> Payload;
+	for (uint64 Expected = 1; Expected <= 3 * LoopbackSlotCount; Expected++)
+	{
+		MakeFrame(Expected, WriteMetadata, Payload);
+		const uint64 Sequence = Ring.Write(WriteMetadata, Payload.GetData(), Payload.Num());
+		TestEqual(TEXT("Frames are numbered from 1"), (int64)Sequence, (int64)Expected);
+		TestTrue(FString::Printf(TEXT("Frame %llu is read back"), Expected), Reader.read_latest(Metadata, Data) && IsFrame(Expected, Metadata, Data));
+		TestFalse(TEXT("A frame is returned only once"), Reader.read_latest(Metadata, Data));
+	}
+
+	// A reader that falls behind gets the newest frame, frames whose slot was reused are gone
+	const uint64 FirstSkipped = 3 * LoopbackSlotCount + 1;
+	const uint64 Newest = FirstSkipped + LoopbackSlotCount;
+	for (uint64 Sequence = FirstSkipped; Sequence <= Newest; Sequence++)
+	{
+		MakeFrame(Sequence, WriteMetadata, Payload);
+		Ring.Write(WriteMetadata, Payload.GetData(), Payload.Num());
+	}
+	TestFalse(TEXT("Overwritten frame can not be read"), Reader.read_sequence(FirstSkipped, Metadata, Data));
+	TestTrue(TEXT("Frame still in its slot can be read"), Reader.read_sequence(Newest - 1, Metadata, Data) && IsFrame(Newest - 1, Metadata, Data));
+	TestTrue(TEXT("Slow reader gets the newest frame"), Reader.read_latest(Metadata, Data) && IsFrame(Newest, Metadata, Data));
+
+	TArray<uint8> Oversized;
+	Oversized.SetNumZeroed((int32)LoopbackPayloadCapacity + 1);
+	TestEqual(TEXT("Frames larger than a slot are refused"), (int64)Ring.Write(WriteMetadata, Oversized.GetData(), Oversized.Num()), (int64)0);
+
+	Reader.close();
+	Ring.Destroy();
+	TestFalse(TEXT("Segment is removed when the ring is destroyed"), Reader.open(TCHAR_TO_UTF8(*SegmentName)));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSharedMemoryConcurrentReadTest, "ROSIntegration.SharedMemory.ConcurrentRead",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// A writer thread laps the ring as fast as it can while the reader polls, every frame the seqlock lets through must be intact
+bool FSharedMemoryConcurrentReadTest::RunTest(const FString& Parameters)
+{
+	FSharedMemoryRing Ring;
+	const FString SegmentName = MakeLoopbackSegmentName(TEXT("concurrent"));
+	if (!TestTrue(TEXT("Segment is created"), Ring.Create(SegmentName, LoopbackSlotCount, LoopbackPayloadCapacity)))
+	{
+		return false;
+	}
+	rosintegration_shm::reader Reader;
+	if (!TestTrue(TEXT("Reader opens the segment"), Reader.open(TCHAR_TO_UTF8(*SegmentName))))
+	{
+		return false;
+	}
+
+	const uint64 FrameCount = 20000;
+	TFuture<void> Writer = Async(EAsyncExecution::Thread, [&Ring, FrameCount]()
+	{
+		rosintegration_shm::slot_metadata Metadata;
+		TArray<uint8> Payload;
+		for (uint64 Sequence = 1; Sequence <= FrameCount; Sequence++)
+		{
+			MakeFrame(Sequence, Metadata, Payload);
+			Ring.Write(Metadata, Payload.GetData(), Payload.Num());
+		}
+	});
+
+	rosintegration_shm::slot_metadata Metadata;
+	std::vector<uint8_t> Data;
+	uint64 LastSequence = 0;
+	int32 ReadCount = 0;
+	int32 CorruptCount = 0;
+	int32 OutOfOrderCount = 0;
+	while (!Writer.IsReady() || Reader.latest_sequence() != LastSequence)
+	{
+		if (!Reader.read_latest(Metadata, Data))
+		{
+			continue;
+		}
+		const uint64 Sequence = Metadata.header_seq;
+		ReadCount++;
+		CorruptCount += IsFrame(Sequence, Metadata, Data) ? 0 : 1;
+		OutOfOrderCount += Sequence > LastSequence ? 0 : 1;
+		LastSequence = Sequence;
+	}
+	Writer.Wait();
+
+	AddInfo(FString::Printf(TEXT("Read %d of %llu frames while the writer was running."), ReadCount, FrameCount));
+	TestEqual(TEXT("Torn frames returned"), CorruptCount, 0);
+	TestEqual(TEXT("Frames returned out of order"), OutOfOrderCount, 0);
+	TestEqual(TEXT("Last frame read"), (int64)LastSequence, (int64)FrameCount);
+	return true;
+}
+
+#endif
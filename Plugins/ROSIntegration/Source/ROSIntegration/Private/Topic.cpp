@@ -8,6 +8,10 @@
 #include "Conversion/Messages/geometry_msgs/GeometryMsgsVector3Converter.h"
 #include "Conversion/Messages/geometry_msgs/GeometryMsgsPointConverter.h"
 #include "Conversion/Messages/geometry_msgs/GeometryMsgsPoseConverter.h"
+#include "SharedMemory/SharedMemoryRing.h"
+#include "sensor_msgs/Image.h"
+#include "sensor_msgs/PointCloud2.h"
+#include "std_msgs/String.h"
 
 
 
@@ -34,6 +38,7 @@ public:
 		}
 
 		if(_ROSTopic) delete _ROSTopic;
+		if (_DescriptorTopic) delete _DescriptorTopic;
 	}
 
 	UROSIntegrationCore* _Ric = nullptr;
@@ -46,6 +51,11 @@ public:
 
 	std::function<void(TSharedPtr<FROSBaseMsg>)> _Callback;
 
+	// Optional same-host transport, payloads go through shared memory and only a descriptor through rosbridge
+	TUniquePtr<FSharedMemoryRing> _SharedMemory;
+	uint32 _SharedMemorySlotCount = 0;
+	rosbridge2cpp::ROSTopic* _DescriptorTopic = nullptr;
+
 	bool ConvertMessage(TSharedPtr<FROSBaseMsg> BaseMsg, bson_t** message)
 	{
 		return _Converter->ConvertOutgoingMessage(BaseMsg, message);
@@ -92,6 +102,7 @@ public:
 	bool Advertise()
 	{
 		if (!_ROSTopic) UE_LOG(LogROS, Warning, TEXT("Trying to advertise on an un-initialized topic."))
+		if (_DescriptorTopic) _DescriptorTopic->Advertise();
 		return _ROSTopic && _ROSTopic->Advertise();
 	}
 
@@ -99,12 +110,17 @@ public:
 	bool Unadvertise()
 	{
 		if (!_ROSTopic) UE_LOG(LogROS, Warning, TEXT("Trying to unadvertise on an un-initialized topic."))
+		if (_DescriptorTopic) _DescriptorTopic->Unadvertise();
 		return _ROSTopic && _ROSTopic->Unadvertise();
 	}
 
 
 	bool Publish(TSharedPtr<FROSBaseMsg> msg)
 	{
+		if (_SharedMemorySlotCount > 0 && PublishSharedMemory(msg)) {
+			return true;
+		}
+
 		bson_t *bson_message = nullptr;
 
 		if (ConvertMessage(msg, &bson_message)) {
@@ -116,6 +132,113 @@ public:
 		}
 	}
 
+	bool EnableSharedMemory(uint32 SlotCount)
+	{
+#if PLATFORM_LINUX
+		if (_MessageType != TEXT("sensor_msgs/Image") && _MessageType != TEXT("sensor_msgs/PointCloud2")) {
+			UE_LOG(LogROS, Warning, TEXT("Shared memory transport only supports sensor_msgs/Image and sensor_msgs/PointCloud2, not %s."), *_MessageType);
+			return false;
+		}
+		if (!_Ric || !_ROSTopic) {
+			UE_LOG(LogROS, Error, TEXT("Topic has to be initialized before enabling the shared memory transport."));
+			return false;
+		}
+
+		_SharedMemorySlotCount = FMath::Max(SlotCount, 2u);
+		if (!_DescriptorTopic) {
+			_DescriptorTopic = new rosbridge2cpp::ROSTopic(_Ric->_Implementation->Get()->_Ros, TCHAR_TO_UTF8(*(_Topic + TEXT("/shm"))), "std_msgs/String", 1);
+			_DescriptorTopic->Advertise();
+		}
+		return true;
+#else
+		UE_LOG(LogROS, Warning, TEXT("Shared memory transport is only supported on Linux, %s keeps using rosbridge."), *_Topic);
+		return false;
+#endif
+	}
+
+	// Returns false if the message has to go through rosbridge instead
+	bool PublishSharedMemory(TSharedPtr<FROSBaseMsg> msg)
+	{
+		rosintegration_shm::slot_metadata Metadata;
+		FMemory::Memzero(Metadata);
+		const uint8* Payload = nullptr;
+		uint64 PayloadSize = 0;
+
+		auto CopyHeader = [&Metadata](const ROSMessages::std_msgs::Header& Header) {
+			Metadata.header_seq = Header.seq;
+			Metadata.stamp_sec = Header.time._Sec;
+			Metadata.stamp_nsec = Header.time._NSec;
+			FCStringAnsi::Strncpy(Metadata.frame_id, TCHAR_TO_UTF8(*Header.frame_id), sizeof(Metadata.frame_id));
+		};
+
+		if (_MessageType == TEXT("sensor_msgs/Image")) {
+			auto Image = StaticCastSharedPtr<ROSMessages::sensor_msgs::Image>(msg);
+			CopyHeader(Image->header);
+			Metadata.kind = rosintegration_shm::kImage;
+			Metadata.height = Image->height;
+			Metadata.width = Image->width;
+			Metadata.step = Image->step;
+			Metadata.is_bigendian = Image->is_bigendian;
+			FCStringAnsi::Strncpy(Metadata.encoding, TCHAR_TO_UTF8(*Image->encoding), sizeof(Metadata.encoding));
+			Payload = Image->data;
+			PayloadSize = (uint64)Image->step * Image->height;
+		}
+		else {
+			auto PointCloud = StaticCastSharedPtr<ROSMessages::sensor_msgs::PointCloud2>(msg);
+			if (PointCloud->fields.Num() > (int32)rosintegration_shm::kMaxFields) {
+				return false;
+			}
+			CopyHeader(PointCloud->header);
+			Metadata.kind = rosintegration_shm::kPointCloud2;
+			Metadata.height = PointCloud->height;
+			Metadata.width = PointCloud->width;
+			Metadata.step = PointCloud->point_step;
+			Metadata.row_step = PointCloud->row_step;
+			Metadata.is_bigendian = PointCloud->is_bigendian;
+			Metadata.is_dense = PointCloud->is_dense;
+			Metadata.field_count = PointCloud->fields.Num();
+			for (int32 i = 0; i < PointCloud->fields.Num(); i++) {
+				const auto& Field = PointCloud->fields[i];
+				FCStringAnsi::Strncpy(Metadata.fields[i].name, TCHAR_TO_UTF8(*Field.name), sizeof(Metadata.fields[i].name));
+				Metadata.fields[i].offset = Field.offset;
+				Metadata.fields[i].datatype = Field.datatype;
+				Metadata.fields[i].count = Field.count;
+			}
+			Payload = PointCloud->data_ptr;
+			PayloadSize = (uint64)PointCloud->row_step * PointCloud->height;
+		}
+
+		// The ring is sized by the first message, sensors publish fixed size frames
+		if (!_SharedMemory) {
+			_SharedMemory = MakeUnique<FSharedMemoryRing>();
+			if (!_SharedMemory->Create(FSharedMemoryRing::MakeSegmentName(_Topic), _SharedMemorySlotCount, FMath::Max<uint64>(PayloadSize, 1))) {
+				_SharedMemorySlotCount = 0;
+				_SharedMemory.Reset();
+				return false;
+			}
+		}
+		if (PayloadSize > _SharedMemory->GetPayloadCapacity()) {
+			UE_LOG(LogROS, Warning, TEXT("Message on %s is larger than its shared memory slots, sending it through rosbridge."), *_Topic);
+			return false;
+		}
+
+		const uint64 Sequence = _SharedMemory->Write(Metadata, Payload, PayloadSize);
+		if (Sequence == 0) {
+			return false;
+		}
+
+		UBaseMessageConverter** StringConverter = TypeConverterMap.Find(TEXT("std_msgs/String"));
+		if (_DescriptorTopic && StringConverter) {
+			TSharedPtr<ROSMessages::std_msgs::String> Descriptor = MakeShareable(new ROSMessages::std_msgs::String(FString::Printf(
+				TEXT("{\"segment\":\"%s\",\"sequence\":%llu,\"type\":\"%s\"}"), *_SharedMemory->GetName(), Sequence, *_MessageType)));
+			bson_t *bson_message = nullptr;
+			if ((*StringConverter)->ConvertOutgoingMessage(Descriptor, &bson_message)) {
+				_DescriptorTopic->Publish(bson_message);
+			}
+		}
+		return true;
+	}
+
 	void Init(UROSIntegrationCore *Ric, const FString& Topic, const FString& MessageType, int32 QueueSize)
 	{
 		// Construct static ConverterMap
@@ -213,6 +336,11 @@ void UTopic::BeginDestroy() {
 		// prevent any interaction with ROS during destruction
 		_Implementation->_Ric = nullptr;
 	}
+	else if (_Implementation && _Implementation->_DescriptorTopic)
+	{
+		// Readers waiting on the descriptor must see the topic go away with the segment, only possible while connected
+		_Implementation->_DescriptorTopic->Unadvertise();
+	}
 	_State.Connected = false;
 
 	if(_Implementation) delete _Implementation;
@@ -252,6 +380,11 @@ bool UTopic::Publish(TSharedPtr<FROSBaseMsg> msg)
 	return _State.Connected && _Implementation->Publish(msg);
 }
 
+bool UTopic::EnableSharedMemoryTransport(int32 SlotCount)
+{
+	return _State.Connected && _Implementation->EnableSharedMemory(FMath::Max(SlotCount, 2));
+}
+
 void UTopic::Init(UROSIntegrationCore *Ric, FString Topic, FString MessageType, int32 QueueSize)
 {
 	_ROSIntegrationCore = Ric;
@@ -272,6 +405,13 @@ bool UTopic::Reconnect(UROSIntegrationCore* ROSIntegrationCore)
 	_Implementation = new UTopic::Impl();
 	_Implementation->Init(ROSIntegrationCore, oldImplementation->_Topic, oldImplementation->_MessageType, oldImplementation->_QueueSize);
 
+	// Keep the shared memory segment so same-host readers do not have to reopen it
+	if (oldImplementation->_SharedMemorySlotCount > 0)
+	{
+		_Implementation->_SharedMemory = MoveTemp(oldImplementation->_SharedMemory);
+		_Implementation->EnableSharedMemory(oldImplementation->_SharedMemorySlotCount);
+	}
+
 	_State.Connected = true;
 	if (_State.Subscribed)
 	{
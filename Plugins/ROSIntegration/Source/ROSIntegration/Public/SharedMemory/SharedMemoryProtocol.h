@@ -0,0 +1,104 @@
+#pragma once
+
+// Layout of the shared memory segments used by the same-host transport of UTopic.
+// This header is plain C++11 without Unreal types so ROS side readers can include it directly.
+//
+// Segment layout:
+//   segment_header
+//   slot_count x { slot_header, payload[payload_capacity] }   (every part 64 byte aligned)
+//
+// Writer protocol for message number n (n starts at 1):
+//   slot = n % slot_count
+//   slot.sequence = 2n + 1          (odd, slot is being written)
+//   write metadata and payload
+//   slot.sequence = 2n              (release)
+//   header.latest_sequence = n      (release)
+//
+// A reader loads latest_sequence, checks that the slot sequence is 2n before and after copying
+// the data and retries otherwise. The writer never blocks on readers, slow readers skip frames.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace rosintegration_shm {
+
+	static const uint32_t kMagic = 0x48534952; // "RISH"
+	static const uint32_t kVersion = 1;
+	static const uint32_t kAlignment = 64;
+	static const uint32_t kMaxFields = 8;
+
+	enum message_kind : uint32_t {
+		kImage = 1,        // sensor_msgs/Image
+		kPointCloud2 = 2,  // sensor_msgs/PointCloud2
+	};
+
+	struct point_field {
+		char name[16];
+		uint32_t offset;
+		uint32_t datatype;  // sensor_msgs/PointField constants
+		uint32_t count;
+	};
+
+	struct slot_metadata {
+		uint32_t kind;
+		uint32_t header_seq;
+		uint32_t stamp_sec;
+		uint32_t stamp_nsec;
+		uint64_t payload_size;
+		char frame_id[64];
+
+		uint32_t height;
+		uint32_t width;
+		uint32_t step;       // Image: row length in bytes, PointCloud2: point_step
+		uint32_t row_step;   // PointCloud2 only
+		uint8_t is_bigendian;
+		uint8_t is_dense;    // PointCloud2 only
+		uint8_t field_count; // PointCloud2 only
+		uint8_t reserved;
+		char encoding[32];   // Image only
+		point_field fields[kMaxFields];
+	};
+
+	struct segment_header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slot_count;
+		uint32_t reserved;
+		uint64_t slot_stride;
+		uint64_t payload_capacity;
+		std::atomic<uint64_t> latest_sequence;
+	};
+
+	struct slot_header {
+		std::atomic<uint64_t> sequence;
+		slot_metadata metadata;
+	};
+
+	static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "atomics must have the plain layout in shared memory");
+
+	inline uint64_t align_up(uint64_t value) {
+		return (value + kAlignment - 1) & ~(uint64_t)(kAlignment - 1);
+	}
+
+	inline uint64_t header_size() {
+		return align_up(sizeof(segment_header));
+	}
+
+	inline uint64_t slot_stride(uint64_t payload_capacity) {
+		return align_up(sizeof(slot_header)) + align_up(payload_capacity);
+	}
+
+	inline uint64_t segment_size(uint32_t slot_count, uint64_t payload_capacity) {
+		return header_size() + slot_count * slot_stride(payload_capacity);
+	}
+
+	inline slot_header* slot_at(void* segment, uint32_t slot_index) {
+		segment_header* header = static_cast<segment_header*>(segment);
+		return reinterpret_cast<slot_header*>(static_cast<uint8_t*>(segment) + header_size() + slot_index * header->slot_stride);
+	}
+
+	inline uint8_t* payload_of(slot_header* slot) {
+		return reinterpret_cast<uint8_t*>(slot) + align_up(sizeof(slot_header));
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+// Reference reader for the shared memory transport, header only and without Unreal dependencies.
+// Typical use on the ROS side:
+//
+//   rosintegration_shm::reader reader;
+//   reader.open("/ros_integration_camera_image");   // segment name from the descriptor topic
+//   std::vector<uint8_t> data;
+//   rosintegration_shm::slot_metadata meta;
+//   if (reader.read_latest(meta, data)) { ... }
+//
+// The descriptor topic (<topic>/shm, std_msgs/String) carries the segment name and sequence of
+// every frame, readers that do not want to use rosbridge can poll read_latest() instead.
+
+#include "SharedMemoryProtocol.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rosintegration_shm {
+
+	class reader {
+	public:
+		reader() {}
+		~reader() { close(); }
+
+		reader(const reader&) = delete;
+		reader& operator=(const reader&) = delete;
+
+		bool open(const std::string& segment_name) {
+			close();
+
+			int fd = shm_open(segment_name.c_str(), O_RDONLY, 0);
+			if (fd < 0) return false;
+
+			struct stat info;
+			if (fstat(fd, &info) != 0 || (uint64_t)info.st_size < header_size()) {
+				::close(fd);
+				return false;
+			}
+
+			void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (mapping == MAP_FAILED) return false;
+
+			const segment_header* header = static_cast<const segment_header*>(mapping);
+			if (header->magic != kMagic || header->version != kVersion ||
+				segment_size(header->slot_count, header->payload_capacity) > (uint64_t)info.st_size) {
+				munmap(mapping, info.st_size);
+				return false;
+			}
+
+			mapping_ = mapping;
+			mapping_size_ = info.st_size;
+			return true;
+		}
+
+		void close() {
+			if (mapping_) munmap(mapping_, mapping_size_);
+			mapping_ = nullptr;
+			mapping_size_ = 0;
+			last_sequence_ = 0;
+		}
+
+		bool is_open() const { return mapping_ != nullptr; }
+
+		// Sequence of the newest complete message, 0 if nothing was written yet
+		uint64_t latest_sequence() const {
+			return mapping_ ? header()->latest_sequence.load(std::memory_order_acquire) : 0;
+		}
+
+		// Copies the newest message if it is newer than the last one returned.
+		// Returns false if there is nothing new or the writer kept overwriting the slot.
+		bool read_latest(slot_metadata& metadata, std::vector<uint8_t>& data, int max_attempts = 8) {
+			for (int attempt = 0; mapping_ && attempt < max_attempts; attempt++) {
+				const uint64_t sequence = latest_sequence();
+				if (sequence == 0 || sequence == last_sequence_) return false;
+				if (read_sequence(sequence, metadata, data)) {
+					last_sequence_ = sequence;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Copies one specific message, e.g. the one named by a descriptor.
+		// Fails if it has already been overwritten or is being written.
+		bool read_sequence(uint64_t sequence, slot_metadata& metadata, std::vector<uint8_t>& data) {
+			if (!mapping_ || sequence == 0) return false;
+
+			slot_header* slot = slot_at(mapping_, (uint32_t)(sequence % header()->slot_count));
+			const uint64_t expected = 2 * sequence;
+			if (slot->sequence.load(std::memory_order_acquire) != expected) return false;
+
+			std::memcpy(&metadata, &slot->metadata, sizeof(slot_metadata));
+			if (metadata.payload_size > header()->payload_capacity) return false;
+			data.resize(metadata.payload_size);
+			std::memcpy(data.data(), payload_of(slot), metadata.payload_size);
+
+			// The copy is only valid if the writer did not touch the slot meanwhile
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return slot->sequence.load(std::memory_order_relaxed) == expected;
+		}
+
+	private:
+		const segment_header* header() const { return static_cast<const segment_header*>(mapping_); }
+
+		void* mapping_ = nullptr;
+		size_t mapping_size_ = 0;
+		uint64_t last_sequence_ = 0;
+	};
+}
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BakedCurve.h"
+#include "Curves/CurveFloat.h"
+
+void FBakedCurve::Bake(const UCurveFloat* Curve, float MaxError, int32 MaxSamples)
+{
+	if (!IsValid(Curve)) {
+		Reset();
+		return;
+	}
+	const uint32 Hash = GetCurveHash(Curve, MaxError, MaxSamples);
+	if (IsBaked() && Hash == CurveHash) {
+		return;
+	}
+	TRACE_CPUPROFILER_EVENT_SCOPE(FBakedCurve::Bake);
+
+	const FRichCurve& Rich = Curve->FloatCurve;
+	float KeyMin = 0.0f;
+	float KeyMax = 1.0f;
+	if (Rich.GetNumKeys() > 0) {
+		Rich.GetTimeRange(KeyMin, KeyMax);
+	}
+	MinTime = FMath::Min(KeyMin, 0.0f);
+	MaxTime = FMath::Max(KeyMax, 1.0f);
+
+	// Double the samples until the curve between them is close enough to a line. Every interval is
+	// checked at a quarter, half and three quarters of the way, which catches the overshoot of cubic keys
+	const int32 SampleLimit = FMath::Max(MaxSamples, 2);
+	NumIntervals = 16;
+	while (true) {
+		const float Step = (MaxTime - MinTime) / (float)NumIntervals;
+		Values.SetNumUninitialized(NumIntervals + 2);
+		for (int32 Index = 0; Index <= NumIntervals; Index++) {
+			Values[Index] = Curve->GetFloatValue(MinTime + Step * (float)Index);
+		}
+		Values[NumIntervals + 1] = Values[NumIntervals];
+
+		MeasuredError = 0.0f;
+		for (int32 Index = 0; Index < NumIntervals; Index++) {
+			for (float Alpha : { 0.25f, 0.5f, 0.75f }) {
+				const float Exact = Curve->GetFloatValue(MinTime + Step * ((float)Index + Alpha));
+				MeasuredError = FMath::Max(MeasuredError, FMath::Abs(Exact - FMath::Lerp(Values[Index], Values[Index + 1], Alpha)));
+			}
+		}
+		if (MeasuredError <= MaxError || NumIntervals * 2 + 1 > SampleLimit) {
+			break;
+		}
+		NumIntervals *= 2;
+	}
+	TimeToPosition = (float)NumIntervals / (MaxTime - MinTime);
+
+	bExtrapolate = Rich.PreInfinityExtrap != RCCE_Constant || Rich.PostInfinityExtrap != RCCE_Constant;
+	if (bExtrapolate) {
+		Source = Rich;
+	}
+	else {
+		Source.Reset();
+	}
+	CurveHash = Hash;
+}
+
+void FBakedCurve::Reset()
+{
+	Values.Empty();
+	MinTime = 0.0f;
+	MaxTime = 0.0f;
+	TimeToPosition = 0.0f;
+	NumIntervals = 0;
+	MeasuredError = 0.0f;
+	bExtrapolate = false;
+	Source.Reset();
+	CurveHash = 0;
+}
+
+void FBakedCurve::EvalBatch(TArrayView<const float> Times, TArrayView<float> OutValues) const
+{
+	check(Times.Num() == OutValues.Num());
+	const int32 Count = Times.Num();
+	if (!IsBaked()) {
+		FMemory::Memzero(OutValues.GetData(), Count * sizeof(float));
+		return;
+	}
+	if (bExtrapolate) {
+		for (int32 Index = 0; Index < Count; Index++) {
+			OutValues[Index] = Eval(Times[Index]);
+		}
+		return;
+	}
+
+	const float* RESTRICT In = Times.GetData();
+	float* RESTRICT Out = OutValues.GetData();
+	for (int32 Index = 0; Index < Count; Index++) {
+		Out[Index] = EvalInRange(In[Index]);
+	}
+}
+
+// Everything the table is made from. Editing a curve asset changes its keys in place, so the pointer alone is not enough
+uint32 FBakedCurve::GetCurveHash(const UCurveFloat* Curve, float MaxError, int32 MaxSamples)
+{
+	const FRichCurve& Rich = Curve->FloatCurve;
+	uint32 Hash = PointerHash(Curve);
+	Hash = HashCombine(Hash, GetTypeHash(MaxError));
+	Hash = HashCombine(Hash, GetTypeHash(MaxSamples));
+	Hash = HashCombine(Hash, GetTypeHash(Rich.DefaultValue));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)Rich.PreInfinityExtrap.GetValue()));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)Rich.PostInfinityExtrap.GetValue()));
+	for (const FRichCurveKey& Key : Rich.GetConstRefOfKeys()) {
+		Hash = HashCombine(Hash, GetTypeHash(Key.Time));
+		Hash = HashCombine(Hash, GetTypeHash(Key.Value));
+		Hash = HashCombine(Hash, GetTypeHash(Key.ArriveTangent));
+		Hash = HashCombine(Hash, GetTypeHash(Key.LeaveTangent));
+		Hash = HashCombine(Hash, GetTypeHash((uint8)Key.InterpMode.GetValue()));
+		Hash = HashCombine(Hash, GetTypeHash((uint8)Key.TangentMode.GetValue()));
+	}
+	return Hash;
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Curves/RichCurve.h"
+
+class UCurveFloat;
+
+// Float curve sampled into an evenly spaced table for evaluating in hot loops. UCurveFloat::GetFloatValue
+// searches the keys and interpolates between them on every call, a baked curve is an index computation and
+// one lerp. The table covers the keys and at least [0, 1] and is made dense enough that linear interpolation
+// between samples stays within the error given to Bake. Outside the table the curve's own extrapolation is used.
+//
+// Bake on the game thread before generation, evaluating only reads the table so any thread can do it.
+struct CHARMTUNNELSIM_API FBakedCurve
+{
+	static constexpr float DefaultMaxError = 0.0005f;
+	static constexpr int32 DefaultMaxSamples = 4096;
+
+	// Samples the curve again if it changed since the last bake. Curves with steps never reach the error,
+	// they stop at MaxSamples
+	void Bake(const UCurveFloat* Curve, float MaxError = DefaultMaxError, int32 MaxSamples = DefaultMaxSamples);
+	void Reset();
+
+	bool IsBaked() const { return NumIntervals > 0; }
+	int32 GetNumSamples() const { return NumIntervals + 1; }
+	// Largest difference to the curve found between samples when baking
+	float GetMeasuredError() const { return MeasuredError; }
+
+	// Curve value at Time, 0 if nothing was baked
+	FORCEINLINE float Eval(float Time) const
+	{
+		if (!IsBaked()) {
+			return 0.0f;
+		}
+		if (bExtrapolate && (Time < MinTime || Time > MaxTime)) {
+			return Source.Eval(Time);
+		}
+		return EvalInRange(Time);
+	}
+
+	// Evaluates every time of the batch. Without extrapolation the loop has no branches and the compiler vectorizes it
+	void EvalBatch(TArrayView<const float> Times, TArrayView<float> OutValues) const;
+
+private:
+	FORCEINLINE float EvalInRange(float Time) const
+	{
+		const float Position = FMath::Clamp((Time - MinTime) * TimeToPosition, 0.0f, (float)NumIntervals);
+		const int32 Index = (int32)Position;
+		const float Alpha = Position - (float)Index;
+		// Values has a copy of the last sample at the end, so the last sample also has a next one
+		return FMath::Lerp(Values[Index], Values[Index + 1], Alpha);
+	}
+
+	static uint32 GetCurveHash(const UCurveFloat* Curve, float MaxError, int32 MaxSamples);
+
+	TArray<float> Values;
+	float MinTime = 0.0f;
+	float MaxTime = 0.0f;
+	float TimeToPosition = 0.0f;
+	int32 NumIntervals = 0;
+	float MeasuredError = 0.0f;
+	// Copy of the curve for times outside the table when it does not extrapolate with a constant
+	bool bExtrapolate = false;
+	FRichCurve Source;
+	uint32 CurveHash = 0;
+};
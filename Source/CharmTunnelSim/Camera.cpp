@@ -1,12 +1,39 @@
 #include "Camera.h"
+#include "ImagePyramid.h"
 #include "Math/UnrealMathUtility.h"
 #include "RHI.h"
 #include "RenderingThread.h"
+#include "EngineUtils.h"
+#include "Misc/FileHelper.h"
 #include "RHIResources.h"
 
 constexpr float FRAME_RATE = 24.0f;
 constexpr float FRAME_INTERVAL = 1.0f / FRAME_RATE;
 
+// Prints the frame pacing of every camera in the world, optionally also as CSV into the given file
+static FAutoConsoleCommandWithWorldAndArgs PrintCameraStatsCommand(
+	TEXT("camera.PrintStats"),
+	TEXT("Prints capture to publish latency, dropped frames and throughput of all cameras. Usage: camera.PrintStats [CsvFile]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World) {
+			return;
+		}
+
+		TArray<FString> CsvLines;
+		CsvLines.Add(FCameraFrameStats::GetCsvHeader());
+		for (TActorIterator<ACamera> It(World); It; ++It) {
+			const ACamera* Camera = *It;
+			const double Elapsed = World->GetTimeSeconds() - Camera->GetStatsStartTime();
+			UE_LOG(LogTemp, Log, TEXT("%s: %s"), *Camera->GetName(), *Camera->GetFrameStats().ToString(Elapsed));
+			CsvLines.Add(Camera->GetFrameStats().ToCsvRow(Camera->GetName(), Camera->GetDescription().resolutionX, Camera->GetDescription().resolutionY, Elapsed));
+		}
+
+		if (Args.Num() > 0) {
+			FFileHelper::SaveStringArrayToFile(CsvLines, *Args[0]);
+		}
+	}));
+
 // Sets default values
 ACamera::ACamera()
 {
@@ -58,7 +85,23 @@ void ACamera::BeginPlay()
 	output_image->is_bigendian = false;
 	output_image->step = 3 * Description.resolutionX; //Full row length in bytes
 
+	InitCameraInfo();
+	InitDerivedStreams();
+	InitEventOutput();
+
 	deltaCount = 0;
+	StatsStartTime = GetWorld()->GetTimeSeconds();
+}
+
+void ACamera::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The render thread may still be writing into ReadBufferData
+	if (bCaptureInFlight) {
+		RenderFence.Wait();
+		bCaptureInFlight = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -66,16 +109,64 @@ void ACamera::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	// Check if enough time has passed since the last frame
+	// Publish the capture requested on an earlier tick once the render thread has filled the buffer
+	if (bCaptureInFlight && RenderFence.IsFenceComplete()) {
+		bCaptureInFlight = false;
+		const double ProcessStartSeconds = FPlatformTime::Seconds();
+		PublishedBytes = 0;
+		if (ReadBufferData.Num() > 0) {
+			if (bMainImagePending) {
+				ProcessAndPublishImage();
+			}
+			PublishDerivedStreams();
+			if (bEventsPending) {
+				PublishEvents();
+			}
+		}
+		bMainImagePending = false;
+		bEventsPending = false;
+
+		const double ProcessEndSeconds = FPlatformTime::Seconds();
+		FrameStats.AddFrame(ReadbackEndSeconds - CaptureStartSeconds, ProcessEndSeconds - CaptureStartSeconds, ProcessEndSeconds - ProcessStartSeconds, ReadbackSeconds, PublishedBytes);
+	}
+
 	deltaCount += DeltaTime;
-	if (deltaCount < FRAME_INTERVAL) {
+	eventDeltaCount += DeltaTime;
+	for (FCameraStreamState& Stream : Streams) {
+		Stream.TimeSinceLastPublish += DeltaTime;
+	}
+
+	// Only one readback at a time, streams that become due meanwhile wait for the next one
+	if (bCaptureInFlight) {
+		FrameStats.StalledTicks++;
 		return;
 	}
-	else {
+
+	// Check if enough time has passed since the last frame
+	bool bAnyDue = false;
+	if (deltaCount >= FRAME_INTERVAL && Description.outputMode != CameraOutputMode::EventOutput) {
+		// Whole intervals that passed without a capture are frames the camera could not deliver
+		FrameStats.AddDropped(FMath::Max(FMath::FloorToInt(deltaCount / FRAME_INTERVAL) - 1, 0));
 		deltaCount = 0;
+		bMainImagePending = true;
+		bAnyDue = true;
+	}
+	if (EventKernel.IsInitialized() && eventDeltaCount >= 1.0f / Description.eventFrameRate) {
+		eventDeltaCount = 0;
+		bEventsPending = true;
+		bAnyDue = true;
+	}
+	for (FCameraStreamState& Stream : Streams) {
+		if (Stream.Interval > 0.0f && Stream.TimeSinceLastPublish >= Stream.Interval) {
+			Stream.TimeSinceLastPublish = 0.0f;
+			Stream.bPending = true;
+			bAnyDue = true;
+		}
 	}
 
-	CaptureAndPublishImage();
+	if (bAnyDue) {
+		CaptureAndPublishImage();
+	}
 }
 
 void ACamera::InitRosTopic()
@@ -86,6 +177,259 @@ void ACamera::InitRosTopic()
 
 	// Advertise the topic
 	CameraDataTopic->Advertise();
+
+	// Same-host consumers can read the image from shared memory instead of rosbridge
+	if (Description.useSharedMemoryTransport) {
+		CameraDataTopic->EnableSharedMemoryTransport();
+	}
+
+	if (Description.publishCameraInfo) {
+		CameraInfoTopic = NewObject<UTopic>(UTopic::StaticClass());
+		CameraInfoTopic->Init(rosInstance->ROSIntegrationCore, GetCameraInfoTopicName(), TEXT("sensor_msgs/CameraInfo"), 0);
+		CameraInfoTopic->Advertise();
+	}
+
+	// Every derived stream gets its own image and camera_info topic
+	for (const FCameraStreamDescription& StreamDescription : Description.derivedStreams) {
+		UTopic* StreamTopic = NewObject<UTopic>(UTopic::StaticClass());
+		StreamTopic->Init(rosInstance->ROSIntegrationCore, StreamDescription.topicName, TEXT("sensor_msgs/Image"), 0);
+		StreamTopic->Advertise();
+		StreamTopics.Add(StreamTopic);
+
+		UTopic* StreamInfoTopic = nullptr;
+		if (Description.publishCameraInfo) {
+			StreamInfoTopic = NewObject<UTopic>(UTopic::StaticClass());
+			StreamInfoTopic->Init(rosInstance->ROSIntegrationCore, MakeCameraInfoTopicName(StreamDescription.topicName), TEXT("sensor_msgs/CameraInfo"), 0);
+			StreamInfoTopic->Advertise();
+		}
+		StreamInfoTopics.Add(StreamInfoTopic);
+	}
+
+	if (Description.outputMode != CameraOutputMode::FrameOutput) {
+		const FString EventTopicName = Description.eventTopicName.IsEmpty() ? Description.topicName + TEXT("/events") : Description.eventTopicName;
+		EventTopic = NewObject<UTopic>(UTopic::StaticClass());
+		EventTopic->Init(rosInstance->ROSIntegrationCore, EventTopicName, TEXT("sensor_msgs/PointCloud2"), 0);
+		EventTopic->Advertise();
+	}
+}
+
+FString ACamera::GetCameraInfoTopicName() const
+{
+	if (!Description.cameraInfoTopicName.IsEmpty()) {
+		return Description.cameraInfoTopicName;
+	}
+	return MakeCameraInfoTopicName(Description.topicName);
+}
+
+FString ACamera::MakeCameraInfoTopicName(const FString& ImageTopicName)
+{
+	// Same namespace as the image, e.g. /camera/image_raw -> /camera/camera_info
+	int32 SlashIndex;
+	if (ImageTopicName.FindLastChar(TEXT('/'), SlashIndex) && SlashIndex > 0) {
+		return ImageTopicName.Left(SlashIndex) + TEXT("/camera_info");
+	}
+	return ImageTopicName + TEXT("/camera_info");
+}
+
+void ACamera::InitDerivedStreams()
+{
+	const FIntRect Frame(0, 0, Description.resolutionX, Description.resolutionY);
+
+	Streams.Reset();
+	Streams.SetNum(Description.derivedStreams.Num());
+	for (int32 i = 0; i < Streams.Num(); i++) {
+		const FCameraStreamDescription& StreamDescription = Description.derivedStreams[i];
+		FCameraStreamState& Stream = Streams[i];
+
+		Stream.Region = Frame;
+		if (StreamDescription.useRegionOfInterest) {
+			Stream.Region = FIntRect(StreamDescription.roiX, StreamDescription.roiY, StreamDescription.roiX + StreamDescription.roiWidth, StreamDescription.roiY + StreamDescription.roiHeight);
+			Stream.Region.Clip(Frame);
+		}
+		Stream.Levels = StreamDescription.scale == CameraStreamScale::QuarterResolution ? 2 : (StreamDescription.scale == CameraStreamScale::HalfResolution ? 1 : 0);
+
+		const int32 Width = Stream.Region.Width() >> Stream.Levels;
+		const int32 Height = Stream.Region.Height() >> Stream.Levels;
+		if (Width <= 0 || Height <= 0 || StreamDescription.frameRate <= 0.0f) {
+			UE_LOG(LogTemp, Warning, TEXT("Camera stream %s has an empty region or no frame rate and is disabled."), *StreamDescription.topicName);
+			Stream.Interval = 0.0f;
+			continue;
+		}
+		Stream.Interval = 1.0f / StreamDescription.frameRate;
+
+		Stream.Image = MakeShareable(new ROSMessages::sensor_msgs::Image);
+		Stream.Image->header.seq = 1;
+		Stream.Image->header.frame_id = output_image->header.frame_id;
+		Stream.Image->height = Height;
+		Stream.Image->width = Width;
+		Stream.Image->encoding = "rgb8";
+		Stream.Image->is_bigendian = false;
+		Stream.Image->step = 3 * Width;
+		Stream.Data.SetNumUninitialized(Width * Height * 3);
+
+		// ROS describes crops and downscales with roi and binning on top of the full resolution
+		// intrinsics, streams are cut before distortion so their model is undistorted.
+		Stream.Info = MakeShareable(new ROSMessages::sensor_msgs::CameraInfo(*camera_info));
+		Stream.Info->height = Height;
+		Stream.Info->width = Width;
+		Stream.Info->D = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+		Stream.Info->binning_x = 1 << Stream.Levels;
+		Stream.Info->binning_y = 1 << Stream.Levels;
+		if (StreamDescription.useRegionOfInterest) {
+			Stream.Info->roi.x_offset = Stream.Region.Min.X;
+			Stream.Info->roi.y_offset = Stream.Region.Min.Y;
+			Stream.Info->roi.width = Stream.Region.Width();
+			Stream.Info->roi.height = Stream.Region.Height();
+		}
+	}
+}
+
+void ACamera::PublishDerivedStreams()
+{
+	const int32 FrameWidth = Description.resolutionX;
+	if (ReadBufferData.Num() != FrameWidth * Description.resolutionY) {
+		return;
+	}
+
+	for (int32 i = 0; i < Streams.Num(); i++) {
+		FCameraStreamState& Stream = Streams[i];
+		if (!Stream.bPending) {
+			continue;
+		}
+		Stream.bPending = false;
+
+		// The crop is only an offset into the readback, the pyramid reads it in place
+		const FColor* Source = ReadBufferData.GetData() + Stream.Region.Min.Y * FrameWidth + Stream.Region.Min.X;
+		int32 Width, Height, Stride;
+		Source = FImagePyramid::Downscale(Source, Stream.Region.Width(), Stream.Region.Height(), FrameWidth, Stream.Levels, Stream.Scratch, Width, Height, Stride);
+		FImagePyramid::ConvertToRGB8(Source, Width, Height, Stride, Stream.Data.GetData());
+
+		UTopic* StreamTopic = StreamTopics.IsValidIndex(i) ? StreamTopics[i] : nullptr;
+		if (rosInstance->bIsConnected && IsValid(StreamTopic)) {
+			Stream.Image->header.time = CaptureTime;
+			Stream.Image->data = Stream.Data.GetData();
+			StreamTopic->Publish(Stream.Image);
+			PublishedBytes += Stream.Data.Num();
+
+			UTopic* StreamInfoTopic = StreamInfoTopics.IsValidIndex(i) ? StreamInfoTopics[i] : nullptr;
+			if (IsValid(StreamInfoTopic)) {
+				Stream.Info->header.time = CaptureTime;
+				StreamInfoTopic->Publish(Stream.Info);
+			}
+		}
+	}
+}
+
+void ACamera::InitCameraInfo()
+{
+	const int32 Width = Description.resolutionX;
+	const int32 Height = Description.resolutionY;
+	const FCameraIntrinsics Intrinsics = FCameraIntrinsics::FromFieldOfView(Width, Height, Description.field_of_view);
+
+	FBrownConradyCoefficients Coefficients;
+	if (Description.applyDistortion) {
+		Coefficients.k1 = Description.k1;
+		Coefficients.k2 = Description.k2;
+		Coefficients.p1 = Description.p1;
+		Coefficients.p2 = Description.p2;
+		Coefficients.k3 = Description.k3;
+	}
+
+	camera_info->header.seq = 1;
+	camera_info->header.frame_id = output_image->header.frame_id;
+	camera_info->height = Height;
+	camera_info->width = Width;
+	camera_info->distortion_model = "plumb_bob";
+	camera_info->D = { Coefficients.k1, Coefficients.k2, Coefficients.p1, Coefficients.p2, Coefficients.k3 };
+	camera_info->K = {
+		Intrinsics.fx, 0.0, Intrinsics.cx,
+		0.0, Intrinsics.fy, Intrinsics.cy,
+		0.0, 0.0, 1.0 };
+	camera_info->R = {
+		1.0, 0.0, 0.0,
+		0.0, 1.0, 0.0,
+		0.0, 0.0, 1.0 };
+	camera_info->P = {
+		Intrinsics.fx, 0.0, Intrinsics.cx, 0.0,
+		0.0, Intrinsics.fy, Intrinsics.cy, 0.0,
+		0.0, 0.0, 1.0, 0.0 };
+	camera_info->binning_x = 0;
+	camera_info->binning_y = 0;
+	camera_info->roi.x_offset = 0;
+	camera_info->roi.y_offset = 0;
+	camera_info->roi.height = 0;
+	camera_info->roi.width = 0;
+	camera_info->roi.do_rectify = false;
+
+	// The remap is only worth building when it actually moves pixels
+	DistortionRemap.Reset();
+	if (Description.applyDistortion && !Coefficients.IsZero()) {
+		DistortionRemap.Build(Width, Height, Intrinsics, Coefficients);
+	}
+}
+
+void ACamera::InitEventOutput()
+{
+	EventKernel.Reset();
+	if (Description.outputMode == CameraOutputMode::FrameOutput || Description.eventFrameRate <= 0.0f) {
+		return;
+	}
+	EventKernel.Init(Description.resolutionX, Description.resolutionY, Description.eventContrastThreshold);
+
+	// Packed events, t is nanoseconds after header.time which is the previous compared frame
+	event_cloud->header.seq = 1;
+	event_cloud->header.frame_id = output_image->header.frame_id;
+	event_cloud->height = 1;
+	event_cloud->is_bigendian = false;
+	event_cloud->is_dense = true;
+	event_cloud->point_step = FEventCameraKernel::EventSize;
+	event_cloud->fields.SetNum(4);
+
+	event_cloud->fields[0].name = "x";
+	event_cloud->fields[0].offset = 0;
+	event_cloud->fields[0].datatype = ROSMessages::sensor_msgs::PointCloud2::PointField::EType::UINT16;
+	event_cloud->fields[0].count = 1;
+
+	event_cloud->fields[1].name = "y";
+	event_cloud->fields[1].offset = 2;
+	event_cloud->fields[1].datatype = ROSMessages::sensor_msgs::PointCloud2::PointField::EType::UINT16;
+	event_cloud->fields[1].count = 1;
+
+	event_cloud->fields[2].name = "t";
+	event_cloud->fields[2].offset = 4;
+	event_cloud->fields[2].datatype = ROSMessages::sensor_msgs::PointCloud2::PointField::EType::UINT32;
+	event_cloud->fields[2].count = 1;
+
+	event_cloud->fields[3].name = "polarity";
+	event_cloud->fields[3].offset = 8;
+	event_cloud->fields[3].datatype = ROSMessages::sensor_msgs::PointCloud2::PointField::EType::INT8;
+	event_cloud->fields[3].count = 1;
+}
+
+void ACamera::PublishEvents()
+{
+	if (ReadBufferData.Num() != EventKernel.GetWidth() * EventKernel.GetHeight()) {
+		return;
+	}
+
+	EventData.Reset();
+	const uint64 FrameTimeNs = (uint64)CaptureTime._Sec * 1000000000ull + CaptureTime._NSec;
+	const int32 EventCount = EventKernel.ProcessFrame(ReadBufferData.GetData(), FrameTimeNs, EventData);
+
+	const FROSTime WindowStart = PreviousEventFrameTime;
+	PreviousEventFrameTime = CaptureTime;
+
+	// Output size follows scene activity, nothing is sent for a static scene
+	if (EventCount == 0 || !rosInstance->bIsConnected || !IsValid(EventTopic)) {
+		return;
+	}
+
+	event_cloud->header.time = WindowStart;
+	event_cloud->width = EventCount;
+	event_cloud->row_step = EventCount * FEventCameraKernel::EventSize;
+	event_cloud->data_ptr = EventData.GetData();
+	EventTopic->Publish(event_cloud);
+	PublishedBytes += EventData.Num();
 }
 
 void ACamera::CaptureAndPublishImage()
@@ -109,10 +453,17 @@ void ACamera::CaptureAndPublishImage()
 		}
 		// Define the rectangle to capture the entire render target
 		FIntRect Rect(0, 0, SrcRenderTarget->GetSizeX(), SrcRenderTarget->GetSizeY());
-		// Capture the render target
+		// Capture the render target, ReadSurfaceData blocks the render thread until the GPU is done
+		const double ReadbackStartSeconds = FPlatformTime::Seconds();
 		CaptureRenderTarget(RHICmdList, SrcRenderTarget, Rect, ReadBufferData);
+		ReadbackEndSeconds = FPlatformTime::Seconds();
+		ReadbackSeconds = ReadbackEndSeconds - ReadbackStartSeconds;
 	};
 
+	// Set before enqueueing, the render thread may run the command right away
+	CaptureTime = FROSTime::Now();
+	CaptureStartSeconds = FPlatformTime::Seconds();
+
 	// Enqueue the render command to capture the render target on the render thread
 	ENQUEUE_RENDER_COMMAND(CaptureCommand)(
 		[CaptureLambda](FRHICommandListImmediate& RHICmdList)
@@ -120,40 +471,41 @@ void ACamera::CaptureAndPublishImage()
 			CaptureLambda(RHICmdList);
 		});
 
-	if (ReadBufferData.Num() > 0) {
-		// Process and publish the image
-		ProcessAndPublishImage();
-	}
+	// The image is processed and published from Tick once the fence has passed
+	RenderFence.BeginFence();
+	bCaptureInFlight = true;
 }
 
 void ACamera::ProcessAndPublishImage()
 {
-	// Set the current timestamp for the output_image header
-	output_image->header.time = FROSTime::Now();
+	// Stamp with the time the capture was requested
+	output_image->header.time = CaptureTime;
 
-	// Create a new array to store the RGB values of each pixel
-	uint8* uArray = new uint8[ReadBufferData.Num() * 3];
+	const int32 PixelCount = ReadBufferData.Num();
+	ImageData.SetNumUninitialized(PixelCount * 3);
 
-	// Iterate through the captured image data and extract RGB values
-	for (int i = 0; i < ReadBufferData.Num(); i++)
-	{
-		if (i > ReadBufferData.Num()) {
-			return;
-		}
-		uArray[i + i * 2] = ReadBufferData[i].R;
-		uArray[i + 1 + i * 2] = ReadBufferData[i].G;
-		uArray[i + 2 + i * 2] = ReadBufferData[i].B;
+	// Distortion is applied while packing to rgb8 so it costs no extra frame copy
+	if (DistortionRemap.Matches(Description.resolutionX, Description.resolutionY) && PixelCount == Description.resolutionX * Description.resolutionY) {
+		DistortionRemap.RemapToRGB8(ReadBufferData.GetData(), ImageData.GetData());
 	}
+	else {
+		ConvertBGRAToRGB8(ReadBufferData.GetData(), ImageData.GetData(), PixelCount);
+	}
+
 	// Set the output_image data to the processed RGB array
-	output_image->data = uArray;
+	output_image->data = ImageData.GetData();
 	// Check if ROS is connected and the CameraDataTopic is valid
-	if (rosInstance->bIsConnected && IsValid(CameraDataTopic) && (ReadBufferData.Num() * 3) > 0) {
+	if (rosInstance->bIsConnected && IsValid(CameraDataTopic) && ImageData.Num() > 0) {
 		// Publish the output_image to the ROS topic
 		bool didPub = CameraDataTopic->Publish(output_image);
-	}
+		PublishedBytes += ImageData.Num();
 
-	// Cleanup: delete the allocated RGB array
-	delete[] uArray;
+		// Camera info shares the image stamp so consumers can pair them
+		if (IsValid(CameraInfoTopic)) {
+			camera_info->header.time = output_image->header.time;
+			CameraInfoTopic->Publish(camera_info);
+		}
+	}
 }
 
 void ACamera::CaptureRenderTarget(FRHICommandListImmediate& RHICmdList, FRHITexture2D* RenderTargetTexture, FIntRect Rect, TArray<FColor>& ReadBuffer)
@@ -10,10 +10,33 @@
 #include "ROSIntegration/Classes/RI/Topic.h"
 #include "ROSIntegration/Classes/ROSIntegrationGameInstance.h"
 #include "ROSIntegration/Public/sensor_msgs/Image.h"
+#include "ROSIntegration/Public/sensor_msgs/CameraInfo.h"
 #include "Async/Async.h"
 #include "EnumContainer.h"
+#include "LensDistortion.h"
+#include "EventCamera.h"
+#include "CameraFrameStats.h"
+#include "ROSIntegration/Public/sensor_msgs/PointCloud2.h"
 #include "Camera.generated.h"
 
+// Runtime state of one FCameraStreamDescription
+struct FCameraStreamState
+{
+	TSharedPtr<ROSMessages::sensor_msgs::Image> Image;
+	TSharedPtr<ROSMessages::sensor_msgs::CameraInfo> Info;
+
+	// Crop in full resolution pixels and the number of halvings applied after it
+	FIntRect Region;
+	int32 Levels = 0;
+
+	float Interval = 0.0f;
+	float TimeSinceLastPublish = 0.0f;
+	bool bPending = false;
+
+	TArray<FColor> Scratch;
+	TArray<uint8> Data;
+};
+
 UCLASS()
 class CHARMTUNNELSIM_API ACamera : public AActor
 {
@@ -26,17 +49,31 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// Functions to capture and publish image
 	void CaptureAndPublishImage();
 	void ProcessAndPublishImage();
 
+	// Derived streams cut from the same readback
+	void InitDerivedStreams();
+	void PublishDerivedStreams();
+
+	// Event output built from consecutive readbacks
+	void InitEventOutput();
+	void PublishEvents();
+	static FString MakeCameraInfoTopicName(const FString& ImageTopicName);
+
 	// Function to capture render target
 	void CaptureRenderTarget(FRHICommandListImmediate& RHICmdList, FRHITexture2D* RenderTargetTexture, FIntRect Rect, TArray<FColor>& ReadBuffer);
 
 	// Function to initialize ROS topic
 	void InitRosTopic();
 
+	// Fills camera info from the description and builds the distortion remap if it is used
+	void InitCameraInfo();
+	FString GetCameraInfoTopicName() const;
+
 	float deltaCount;
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Parameters", meta = (ExposeOnSpawn = "true"))
@@ -45,22 +82,66 @@ protected:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Parameters", meta = (ExposeOnSpawn = "true"))
 	FCameraDescription Description;
 
-	// Render Command Fence and BufferData
+	// Render Command Fence and BufferData. ReadBufferData belongs to the render thread while a
+	// capture is in flight, it is only read after RenderFence has passed.
 	FRenderCommandFence RenderFence;
 	UPROPERTY()
 	TArray<FColor> ReadBufferData;
+	bool bCaptureInFlight = false;
+	bool bMainImagePending = false;
+	FROSTime CaptureTime;
 
 	// ROS topic for the camera data
 	UPROPERTY()
 	UTopic* CameraDataTopic;
 
+	// ROS topic for the camera intrinsics
+	UPROPERTY()
+	UTopic* CameraInfoTopic;
+
 	// Output image from ROS messages
 	TSharedPtr<ROSMessages::sensor_msgs::Image> output_image = MakeShareable(new ROSMessages::sensor_msgs::Image);
+	TSharedPtr<ROSMessages::sensor_msgs::CameraInfo> camera_info = MakeShareable(new ROSMessages::sensor_msgs::CameraInfo);
+
+	// Packed rgb8 data of output_image, kept between frames to avoid reallocating
+	TArray<uint8> ImageData;
+
+	// Precomputed lens distortion, only valid when Description.applyDistortion is set
+	FLensDistortionRemap DistortionRemap;
+
+	// Topics of Description.derivedStreams, same order as Streams
+	UPROPERTY()
+	TArray<UTopic*> StreamTopics;
+	UPROPERTY()
+	TArray<UTopic*> StreamInfoTopics;
+	TArray<FCameraStreamState> Streams;
+
+	// Event output
+	UPROPERTY()
+	UTopic* EventTopic;
+	TSharedPtr<ROSMessages::sensor_msgs::PointCloud2> event_cloud = MakeShareable(new ROSMessages::sensor_msgs::PointCloud2);
+	FEventCameraKernel EventKernel;
+	TArray<uint8> EventData;
+	float eventDeltaCount = 0.0f;
+	bool bEventsPending = false;
+	FROSTime PreviousEventFrameTime;
+
+	// Frame pacing instrumentation, ReadbackSeconds and ReadbackEndSeconds are written on the render thread before the fence
+	FCameraFrameStats FrameStats;
+	double CaptureStartSeconds = 0.0;
+	double ReadbackSeconds = 0.0;
+	double ReadbackEndSeconds = 0.0;
+	int64 PublishedBytes = 0;
+	double StatsStartTime = 0.0;
 
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	const FCameraFrameStats& GetFrameStats() const { return FrameStats; }
+	double GetStatsStartTime() const { return StatsStartTime; }
+	const FCameraDescription& GetDescription() const { return Description; }
+
 	// ROS Instance
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "ROSS")
 	UROSIntegrationGameInstance* rosInstance;
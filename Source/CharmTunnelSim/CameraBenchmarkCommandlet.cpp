@@ -0,0 +1,516 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CameraBenchmarkCommandlet.h"
+#include "CameraFrameStats.h"
+#include "EventCamera.h"
+#include "ImagePyramid.h"
+#include "LensDistortion.h"
+#include "ROSIntegration/Classes/RI/Topic.h"
+#include "ROSIntegration/Classes/ROSIntegrationCore.h"
+#include "ROSIntegration/Public/sensor_msgs/Image.h"
+#include "ROSIntegration/Public/sensor_msgs/PointCloud2.h"
+#include "Common/TcpSocketBuilder.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderingThread.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+namespace
+{
+	// Stands in for rosbridge: accepts connections on localhost and drains everything it receives
+	class FMockRosbridgeServer : public FRunnable
+	{
+	public:
+		~FMockRosbridgeServer()
+		{
+			Shutdown();
+		}
+
+		bool Start(int32 Port)
+		{
+			ListenSocket = FTcpSocketBuilder(TEXT("MockRosbridge"))
+				.AsReusable()
+				.BoundToEndpoint(FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), Port))
+				.Listening(8)
+				.Build();
+			if (!ListenSocket) {
+				return false;
+			}
+			Thread = FRunnableThread::Create(this, TEXT("MockRosbridge"));
+			return Thread != nullptr;
+		}
+
+		void Shutdown()
+		{
+			if (Thread) {
+				bStopping = true;
+				Thread->WaitForCompletion();
+				delete Thread;
+				Thread = nullptr;
+			}
+
+			ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+			for (FSocket* Client : Clients) {
+				Client->Close();
+				SocketSubsystem->DestroySocket(Client);
+			}
+			Clients.Reset();
+			if (ListenSocket) {
+				ListenSocket->Close();
+				SocketSubsystem->DestroySocket(ListenSocket);
+				ListenSocket = nullptr;
+			}
+		}
+
+		virtual uint32 Run() override
+		{
+			TArray<uint8> Buffer;
+			Buffer.SetNumUninitialized(1 << 20);
+
+			while (!bStopping) {
+				bool bHasConnection = false;
+				if (ListenSocket->HasPendingConnection(bHasConnection) && bHasConnection) {
+					if (FSocket* Client = ListenSocket->Accept(TEXT("MockRosbridgeClient"))) {
+						Clients.Add(Client);
+					}
+				}
+
+				bool bReceived = false;
+				for (FSocket* Client : Clients) {
+					uint32 PendingSize = 0;
+					while (Client->HasPendingData(PendingSize) && PendingSize > 0) {
+						int32 BytesRead = 0;
+						if (!Client->Recv(Buffer.GetData(), Buffer.Num(), BytesRead) || BytesRead <= 0) {
+							break;
+						}
+						ReceivedBytes.Add(BytesRead);
+						bReceived = true;
+					}
+				}
+
+				if (!bReceived) {
+					FPlatformProcess::Sleep(0.0005f);
+				}
+			}
+			return 0;
+		}
+
+		FThreadSafeCounter64 ReceivedBytes;
+
+	private:
+		FSocket* ListenSocket = nullptr;
+		TArray<FSocket*> Clients;
+		FRunnableThread* Thread = nullptr;
+		TAtomic<bool> bStopping { false };
+	};
+
+	// CPU side of one ACamera working on a synthetic frame
+	struct FBenchmarkCamera
+	{
+		FString Name;
+		int32 Width = 0;
+		int32 Height = 0;
+		int32 FrameNumber = 0;
+		// Simulated seconds since the last capture, like ACamera::deltaCount
+		double DeltaCount = 0.0;
+
+		// The frame is rendered on the game thread and read back into ReadbackFrame on the render thread
+		TArray<FColor> Frame;
+		TArray<FColor> ReadbackFrame;
+		FRenderCommandFence ReadbackFence;
+		bool bCaptureInFlight = false;
+		FROSTime CaptureTime;
+		double CaptureStartSeconds = 0.0;
+		// Written on the render thread before the fence
+		double ReadbackSeconds = 0.0;
+		double ReadbackEndSeconds = 0.0;
+
+		TArray<uint8> ImageData;
+		TArray<FColor> PreviewScratch;
+		TArray<uint8> PreviewData;
+		TArray<uint8> EventData;
+		FLensDistortionRemap DistortionRemap;
+		FEventCameraKernel EventKernel;
+
+		UTopic* ImageTopic = nullptr;
+		UTopic* PreviewTopic = nullptr;
+		UTopic* EventTopic = nullptr;
+		TSharedPtr<ROSMessages::sensor_msgs::Image> Image;
+		TSharedPtr<ROSMessages::sensor_msgs::Image> Preview;
+		TSharedPtr<ROSMessages::sensor_msgs::PointCloud2> EventCloud;
+
+		FCameraFrameStats Stats;
+	};
+
+	constexpr int32 MovingBandWidth = 32;
+	constexpr int32 PreviewLevels = 2;
+	// Kernel only measurement of -events, one core has to keep up with this
+	constexpr int32 EventKernelWidth = 1024;
+	constexpr int32 EventKernelHeight = 1024;
+	constexpr double EventKernelTargetFrameRate = 200.0;
+
+	FColor GradientColor(int32 x, int32 y, int32 Width, int32 Height)
+	{
+		return FColor((uint8)(x * 255 / FMath::Max(Width - 1, 1)), (uint8)(y * 255 / FMath::Max(Height - 1, 1)), 96, 255);
+	}
+
+	// A static gradient with a bright band moving across it, so events and compression see some activity
+	void UpdateSyntheticFrame(FBenchmarkCamera& Camera)
+	{
+		const int32 Width = Camera.Width;
+		const int32 Height = Camera.Height;
+		if (Camera.Frame.Num() != Width * Height) {
+			Camera.Frame.SetNumUninitialized(Width * Height);
+			for (int32 y = 0; y < Height; y++) {
+				for (int32 x = 0; x < Width; x++) {
+					Camera.Frame[y * Width + x] = GradientColor(x, y, Width, Height);
+				}
+			}
+		}
+
+		const int32 Step = MovingBandWidth / 4;
+		// Nothing to clear on the first frame, the band starts at x = 0
+		const int32 PreviousBand = Camera.FrameNumber > 0 ? ((Camera.FrameNumber - 1) * Step) % Width : Width;
+		const int32 Band = (Camera.FrameNumber * Step) % Width;
+		for (int32 y = 0; y < Height; y++) {
+			FColor* Row = Camera.Frame.GetData() + y * Width;
+			for (int32 x = PreviousBand; x < FMath::Min(PreviousBand + MovingBandWidth, Width); x++) {
+				Row[x] = GradientColor(x, y, Width, Height);
+			}
+			for (int32 x = Band; x < FMath::Min(Band + MovingBandWidth, Width); x++) {
+				Row[x] = FColor(255, 255, 255, 255);
+			}
+		}
+		Camera.FrameNumber++;
+	}
+
+	TSharedPtr<ROSMessages::sensor_msgs::Image> MakeImageMessage(int32 Width, int32 Height)
+	{
+		TSharedPtr<ROSMessages::sensor_msgs::Image> Image = MakeShareable(new ROSMessages::sensor_msgs::Image);
+		Image->header.seq = 1;
+		Image->header.frame_id = "Camera";
+		Image->height = Height;
+		Image->width = Width;
+		Image->encoding = "rgb8";
+		Image->is_bigendian = false;
+		Image->step = 3 * Width;
+		return Image;
+	}
+
+	FROSTime MakeSimulatedTime(double Seconds)
+	{
+		const double WholeSeconds = FMath::FloorToDouble(Seconds);
+		return FROSTime((unsigned long)WholeSeconds, (unsigned long)((Seconds - WholeSeconds) * 1e9));
+	}
+
+	// Copies the frame on the render thread, standing in for ReadSurfaceData in ACamera::CaptureRenderTarget
+	void EnqueueReadback(FBenchmarkCamera& Camera)
+	{
+		// Set before enqueueing, the render thread may run the command right away
+		Camera.CaptureStartSeconds = FPlatformTime::Seconds();
+		FBenchmarkCamera* CameraPtr = &Camera;
+		ENQUEUE_RENDER_COMMAND(CameraBenchmarkReadback)(
+			[CameraPtr](FRHICommandListImmediate& RHICmdList)
+			{
+				const double ReadbackStartSeconds = FPlatformTime::Seconds();
+				CameraPtr->ReadbackFrame = CameraPtr->Frame;
+				CameraPtr->ReadbackEndSeconds = FPlatformTime::Seconds();
+				CameraPtr->ReadbackSeconds = CameraPtr->ReadbackEndSeconds - ReadbackStartSeconds;
+			});
+		Camera.ReadbackFence.BeginFence();
+		Camera.bCaptureInFlight = true;
+	}
+
+	// Converts and publishes the frame read back by EnqueueReadback, returns the bytes published
+	int64 ProcessAndPublish(FBenchmarkCamera& Camera)
+	{
+		const FColor* Frame = Camera.ReadbackFrame.GetData();
+		const FROSTime CaptureTime = Camera.CaptureTime;
+		int64 Bytes = 0;
+
+		if (Camera.DistortionRemap.IsValid()) {
+			Camera.DistortionRemap.RemapToRGB8(Frame, Camera.ImageData.GetData());
+		}
+		else {
+			ConvertBGRAToRGB8(Frame, Camera.ImageData.GetData(), Camera.ReadbackFrame.Num());
+		}
+		Camera.Image->header.time = CaptureTime;
+		Camera.Image->data = Camera.ImageData.GetData();
+		Camera.ImageTopic->Publish(Camera.Image);
+		Bytes += Camera.ImageData.Num();
+
+		if (Camera.PreviewTopic) {
+			int32 Width, Height, Stride;
+			const FColor* Level = FImagePyramid::Downscale(Frame, Camera.Width, Camera.Height, Camera.Width, PreviewLevels, Camera.PreviewScratch, Width, Height, Stride);
+			FImagePyramid::ConvertToRGB8(Level, Width, Height, Stride, Camera.PreviewData.GetData());
+			Camera.Preview->header.time = CaptureTime;
+			Camera.Preview->data = Camera.PreviewData.GetData();
+			Camera.PreviewTopic->Publish(Camera.Preview);
+			Bytes += Camera.PreviewData.Num();
+		}
+
+		if (Camera.EventTopic) {
+			Camera.EventData.Reset();
+			const int32 EventCount = Camera.EventKernel.ProcessFrame(Frame, (uint64)CaptureTime._Sec * 1000000000ull + CaptureTime._NSec, Camera.EventData);
+			if (EventCount > 0) {
+				Camera.EventCloud->header.time = CaptureTime;
+				Camera.EventCloud->width = EventCount;
+				Camera.EventCloud->row_step = Camera.EventData.Num();
+				Camera.EventCloud->data_ptr = Camera.EventData.GetData();
+				Camera.EventTopic->Publish(Camera.EventCloud);
+				Bytes += Camera.EventData.Num();
+			}
+		}
+		return Bytes;
+	}
+
+	// Times FEventCameraKernel::ProcessFrame alone on the moving band, frame updates are not counted.
+	// Returns frames per second of one core
+	double MeasureEventKernel(int32 Width, int32 Height, int32 FrameCount, bool bSimd)
+	{
+		FBenchmarkCamera Camera;
+		Camera.Width = Width;
+		Camera.Height = Height;
+		Camera.EventKernel.Init(Width, Height, 0.2f);
+		Camera.EventKernel.SetSimdEnabled(bSimd);
+
+		double KernelSeconds = 0.0;
+		int64 EventCount = 0;
+		// The first frame only sets the reference and is not timed
+		for (int32 Frame = 0; Frame <= FrameCount; Frame++) {
+			UpdateSyntheticFrame(Camera);
+			Camera.EventData.Reset();
+			const double StartSeconds = FPlatformTime::Seconds();
+			EventCount += Camera.EventKernel.ProcessFrame(Camera.Frame.GetData(), (uint64)Frame * 41666667ull, Camera.EventData);
+			if (Frame > 0) {
+				KernelSeconds += FPlatformTime::Seconds() - StartSeconds;
+			}
+		}
+		const double FramesPerSecond = FrameCount / FMath::Max(KernelSeconds, 1e-9);
+		UE_LOG(LogTemp, Display, TEXT("event kernel %dx%d %s: %d frames in %.3f ms, %.1f frames/s, %.1f events/frame"), Width, Height,
+			bSimd ? TEXT("SSE2") : TEXT("scalar"), FrameCount, KernelSeconds * 1000.0, FramesPerSecond, (double)EventCount / FrameCount);
+		return FramesPerSecond;
+	}
+
+	UTopic* MakeTopic(UROSIntegrationCore* Core, const FString& Name, const FString& MessageType)
+	{
+		UTopic* Topic = NewObject<UTopic>(UTopic::StaticClass());
+		Topic->AddToRoot();
+		Topic->Init(Core, Name, MessageType, 0);
+		Topic->Advertise();
+		return Topic;
+	}
+}
+
+UCameraBenchmarkCommandlet::UCameraBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UCameraBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 CameraCount = 4;
+	float FrameRate = 24.0f;
+	float TickRate = 60.0f;
+	float Duration = 10.0f;
+	int32 Port = 9099;
+	FString ResolutionList = TEXT("1024x1024");
+	FString CsvPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), TEXT("CameraBenchmark.csv"));
+
+	FParse::Value(*Params, TEXT("cameras="), CameraCount);
+	FParse::Value(*Params, TEXT("fps="), FrameRate);
+	FParse::Value(*Params, TEXT("tickrate="), TickRate);
+	FParse::Value(*Params, TEXT("duration="), Duration);
+	FParse::Value(*Params, TEXT("port="), Port);
+	FParse::Value(*Params, TEXT("resolutions="), ResolutionList, false);
+	FParse::Value(*Params, TEXT("csv="), CsvPath);
+	const bool bDistortion = FParse::Param(*Params, TEXT("distortion"));
+	const bool bPreview = FParse::Param(*Params, TEXT("preview"));
+	const bool bEvents = FParse::Param(*Params, TEXT("events"));
+	int32 KernelFrames = 240;
+	FParse::Value(*Params, TEXT("kernelframes="), KernelFrames);
+
+	CameraCount = FMath::Max(CameraCount, 1);
+	FrameRate = FMath::Max(FrameRate, 1.0f);
+	TickRate = FMath::Max(TickRate, 1.0f);
+	KernelFrames = FMath::Max(KernelFrames, 1);
+	const double Interval = 1.0 / FrameRate;
+	const double TickSeconds = 1.0 / TickRate;
+	const int64 TickCount = FMath::Max((int64)FMath::CeilToDouble(Duration * TickRate), (int64)1);
+
+	// Resolutions are assigned to the cameras round robin
+	TArray<FIntPoint> Resolutions;
+	TArray<FString> ResolutionStrings;
+	ResolutionList.ParseIntoArray(ResolutionStrings, TEXT(","));
+	for (const FString& Resolution : ResolutionStrings) {
+		FString Width, Height;
+		if (Resolution.Split(TEXT("x"), &Width, &Height) && FCString::Atoi(*Width) > 1 && FCString::Atoi(*Height) > 1) {
+			Resolutions.Add(FIntPoint(FCString::Atoi(*Width), FCString::Atoi(*Height)));
+		}
+	}
+	if (Resolutions.Num() == 0) {
+		UE_LOG(LogTemp, Error, TEXT("No valid resolution in -resolutions=%s, expected e.g. 1024x1024,640x480."), *ResolutionList);
+		return 1;
+	}
+
+	// The kernel alone on one core, before the pipeline shares the machine with rendering and publishing
+	if (bEvents) {
+		const double SimdFrameRate = MeasureEventKernel(EventKernelWidth, EventKernelHeight, KernelFrames, true);
+		MeasureEventKernel(EventKernelWidth, EventKernelHeight, KernelFrames, false);
+		if (SimdFrameRate < EventKernelTargetFrameRate) {
+			UE_LOG(LogTemp, Warning, TEXT("event kernel runs at %.1f frames/s at %dx%d, below the %.0f frames/s target."),
+				SimdFrameRate, EventKernelWidth, EventKernelHeight, EventKernelTargetFrameRate);
+		}
+	}
+
+	FMockRosbridgeServer MockServer;
+	if (!MockServer.Start(Port)) {
+		UE_LOG(LogTemp, Error, TEXT("Could not start the mock rosbridge on port %d."), Port);
+		return 1;
+	}
+
+	UROSIntegrationCore* Core = NewObject<UROSIntegrationCore>(UROSIntegrationCore::StaticClass());
+	Core->AddToRoot();
+	if (!Core->Init(TEXT("127.0.0.1"), Port)) {
+		UE_LOG(LogTemp, Error, TEXT("Could not connect to the mock rosbridge on port %d."), Port);
+		Core->RemoveFromRoot();
+		return 1;
+	}
+
+	TArray<FBenchmarkCamera> Cameras;
+	Cameras.SetNum(CameraCount);
+	for (int32 i = 0; i < CameraCount; i++) {
+		FBenchmarkCamera& Camera = Cameras[i];
+		Camera.Name = FString::Printf(TEXT("camera_%d"), i);
+		Camera.Width = Resolutions[i % Resolutions.Num()].X;
+		Camera.Height = Resolutions[i % Resolutions.Num()].Y;
+		Camera.ImageData.SetNumUninitialized(Camera.Width * Camera.Height * 3);
+		Camera.Image = MakeImageMessage(Camera.Width, Camera.Height);
+		Camera.ImageTopic = MakeTopic(Core, FString::Printf(TEXT("/benchmark/%s/image_raw"), *Camera.Name), TEXT("sensor_msgs/Image"));
+
+		if (bDistortion) {
+			FBrownConradyCoefficients Coefficients;
+			Coefficients.k1 = -0.28;
+			Coefficients.k2 = 0.07;
+			Camera.DistortionRemap.Build(Camera.Width, Camera.Height, FCameraIntrinsics::FromFieldOfView(Camera.Width, Camera.Height, 90.0f), Coefficients);
+		}
+		if (bPreview) {
+			const int32 PreviewWidth = Camera.Width >> PreviewLevels;
+			const int32 PreviewHeight = Camera.Height >> PreviewLevels;
+			Camera.PreviewData.SetNumUninitialized(PreviewWidth * PreviewHeight * 3);
+			Camera.Preview = MakeImageMessage(PreviewWidth, PreviewHeight);
+			Camera.PreviewTopic = MakeTopic(Core, FString::Printf(TEXT("/benchmark/%s/preview/image_raw"), *Camera.Name), TEXT("sensor_msgs/Image"));
+		}
+		if (bEvents) {
+			Camera.EventKernel.Init(Camera.Width, Camera.Height, 0.2f);
+			Camera.EventCloud = MakeShareable(new ROSMessages::sensor_msgs::PointCloud2);
+			Camera.EventCloud->header.frame_id = "Camera";
+			Camera.EventCloud->height = 1;
+			Camera.EventCloud->point_step = FEventCameraKernel::EventSize;
+			Camera.EventCloud->is_bigendian = false;
+			Camera.EventCloud->is_dense = true;
+			Camera.EventTopic = MakeTopic(Core, FString::Printf(TEXT("/benchmark/%s/events"), *Camera.Name), TEXT("sensor_msgs/PointCloud2"));
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Camera benchmark: %d cameras at %.1f fps for %.1f simulated s at %.1f ticks/s (distortion %d, preview %d, events %d, threaded rendering %d)"),
+		CameraCount, FrameRate, Duration, TickRate, bDistortion, bPreview, bEvents, GIsThreadedRendering);
+
+	// Cameras are staggered over one interval like actors ticking with different phases
+	for (int32 i = 0; i < CameraCount; i++) {
+		Cameras[i].DeltaCount = Interval * i / CameraCount;
+	}
+
+	// Fixed simulated timestep: every tick advances the simulation by TickSeconds however long it took, so runs
+	// on different machines do the same work and a slow machine just takes longer. The game thread may run one
+	// frame ahead of the render thread, the time it waits for the previous frame is the game thread stall.
+	FRenderCommandFence FrameFences[2];
+	double GameThreadStallSeconds = 0.0;
+	const double StartSeconds = FPlatformTime::Seconds();
+	for (int64 Tick = 0; Tick < TickCount; Tick++) {
+		const FROSTime SimulatedTime = MakeSimulatedTime(Tick * TickSeconds);
+
+		for (FBenchmarkCamera& Camera : Cameras) {
+			// Publish the capture requested on an earlier tick once the render thread has read it back
+			if (Camera.bCaptureInFlight && Camera.ReadbackFence.IsFenceComplete()) {
+				Camera.bCaptureInFlight = false;
+				const double ProcessStartSeconds = FPlatformTime::Seconds();
+				const int64 Bytes = ProcessAndPublish(Camera);
+				const double ProcessEndSeconds = FPlatformTime::Seconds();
+				Camera.Stats.AddFrame(Camera.ReadbackEndSeconds - Camera.CaptureStartSeconds, ProcessEndSeconds - Camera.CaptureStartSeconds,
+					ProcessEndSeconds - ProcessStartSeconds, Camera.ReadbackSeconds, Bytes);
+			}
+
+			Camera.DeltaCount += TickSeconds;
+			if (Camera.bCaptureInFlight) {
+				Camera.Stats.StalledTicks++;
+				continue;
+			}
+			if (Camera.DeltaCount >= Interval) {
+				// Whole intervals that passed without a capture are frames the camera could not deliver
+				Camera.Stats.AddDropped(FMath::Max(FMath::FloorToInt(Camera.DeltaCount / Interval) - 1, 0));
+				Camera.DeltaCount = 0.0;
+				UpdateSyntheticFrame(Camera);
+				Camera.CaptureTime = SimulatedTime;
+				EnqueueReadback(Camera);
+			}
+		}
+
+		// Like FFrameEndSync, wait for the render thread to finish the frame before the last one
+		FRenderCommandFence& FrameFence = FrameFences[Tick % 2];
+		FrameFence.BeginFence();
+		FRenderCommandFence& PreviousFrameFence = FrameFences[(Tick + 1) % 2];
+		const double WaitStartSeconds = FPlatformTime::Seconds();
+		PreviousFrameFence.Wait();
+		GameThreadStallSeconds += FPlatformTime::Seconds() - WaitStartSeconds;
+	}
+	FlushRenderingCommands();
+	const double WallSeconds = FPlatformTime::Seconds() - StartSeconds;
+	const double Elapsed = TickCount * TickSeconds;
+
+	// Give the rosbridge publisher thread a moment to flush its queue before counting received bytes
+	FPlatformProcess::Sleep(1.0f);
+	const int64 ReceivedBytes = MockServer.ReceivedBytes.GetValue();
+
+	TArray<FString> CsvLines;
+	CsvLines.Add(FCameraFrameStats::GetCsvHeader());
+	FCameraFrameStats Total;
+	for (const FBenchmarkCamera& Camera : Cameras) {
+		UE_LOG(LogTemp, Display, TEXT("%s %dx%d: %s"), *Camera.Name, Camera.Width, Camera.Height, *Camera.Stats.ToString(Elapsed));
+		CsvLines.Add(Camera.Stats.ToCsvRow(Camera.Name, Camera.Width, Camera.Height, Elapsed));
+		Total.Append(Camera.Stats);
+	}
+	Total.GameThreadStallSeconds = GameThreadStallSeconds;
+	UE_LOG(LogTemp, Display, TEXT("total: %s"), *Total.ToString(Elapsed));
+	UE_LOG(LogTemp, Display, TEXT("simulated %.2f s in %.2f s wall clock (%.2fx real time)"), Elapsed, WallSeconds, Elapsed / FMath::Max(WallSeconds, 1e-6));
+	UE_LOG(LogTemp, Display, TEXT("mock rosbridge received %.2f MB of BSON per simulated second"), ReceivedBytes / Elapsed / (1024.0 * 1024.0));
+	CsvLines.Add(Total.ToCsvRow(TEXT("total"), 0, 0, Elapsed));
+
+	if (FFileHelper::SaveStringArrayToFile(CsvLines, *CsvPath)) {
+		UE_LOG(LogTemp, Display, TEXT("Wrote %s"), *CsvPath);
+	}
+	else {
+		UE_LOG(LogTemp, Error, TEXT("Could not write %s"), *CsvPath);
+	}
+
+	for (FBenchmarkCamera& Camera : Cameras) {
+		for (UTopic* Topic : { Camera.ImageTopic, Camera.PreviewTopic, Camera.EventTopic }) {
+			if (Topic) {
+				Topic->Unadvertise();
+				Topic->RemoveFromRoot();
+			}
+		}
+	}
+	Core->RemoveFromRoot();
+	MockServer.Shutdown();
+	return 0;
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CameraBenchmarkCommandlet.generated.h"
+
+/**
+ * Measures how many cameras this machine can sustain without a GPU.
+ * Runs the CPU side of N camera pipelines (rgb8 conversion, optional lens distortion, preview
+ * pyramid and events, BSON encoding, rosbridge publishing) on synthetic frames and publishes to a
+ * local mock rosbridge that only drains the socket.
+ *
+ * The run advances a fixed simulated timestep for -duration simulated seconds and ticks the cameras
+ * like ACamera::Tick: a capture enqueues a readback on the render thread behind a render command
+ * fence and the frame is published on the first tick after the fence passed. Latency is reported
+ * twice, from capture to readback and from capture to publish, render time is the readback time
+ * measured on the render thread. Pass -AllowCommandletRendering to start the rendering thread,
+ * otherwise render commands run inline on the game thread.
+ *
+ * -events first times the event kernel alone at 1024x1024 for -kernelframes frames, with the SSE2 and
+ * the scalar loops, and warns when it stays below 200 frames per second on one core.
+ *
+ * UnrealEditor-Cmd CharmTunnelSim.uproject -run=CameraBenchmark -nullrhi -AllowCommandletRendering
+ *     -cameras=4 -resolutions=1024x1024,640x480 -fps=24 -tickrate=60 -duration=10
+ *     [-distortion] [-preview] [-events] [-kernelframes=240] [-port=9099] [-csv=Saved/Benchmarks/Cameras.csv]
+ */
+UCLASS()
+class CHARMTUNNELSIM_API UCameraBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCameraBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
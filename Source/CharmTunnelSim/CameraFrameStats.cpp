@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CameraFrameStats.h"
+
+void FCameraFrameStats::Reset()
+{
+	*this = FCameraFrameStats();
+}
+
+void FCameraFrameStats::AddFrame(double ReadbackLatencySeconds, double PublishLatencySeconds, double GameSeconds, double RenderSeconds, int64 Bytes)
+{
+	PublishedFrames++;
+	PublishedBytes += Bytes;
+	GameThreadSeconds += GameSeconds;
+	RenderThreadSeconds += RenderSeconds;
+
+	// Both arrays always have the same length, samples of one frame share an index
+	const float ReadbackSample = (float)(ReadbackLatencySeconds * 1000.0);
+	const float PublishSample = (float)(PublishLatencySeconds * 1000.0);
+	if (PublishLatencyMs.Num() < MaxLatencySamples) {
+		ReadbackLatencyMs.Add(ReadbackSample);
+		PublishLatencyMs.Add(PublishSample);
+	}
+	else {
+		ReadbackLatencyMs[NextSample] = ReadbackSample;
+		PublishLatencyMs[NextSample] = PublishSample;
+		NextSample = (NextSample + 1) % MaxLatencySamples;
+	}
+}
+
+void FCameraFrameStats::Append(const FCameraFrameStats& Other)
+{
+	PublishedFrames += Other.PublishedFrames;
+	DroppedFrames += Other.DroppedFrames;
+	PublishedBytes += Other.PublishedBytes;
+	StalledTicks += Other.StalledTicks;
+	GameThreadSeconds += Other.GameThreadSeconds;
+	RenderThreadSeconds += Other.RenderThreadSeconds;
+	GameThreadStallSeconds += Other.GameThreadStallSeconds;
+	ReadbackLatencyMs.Append(Other.ReadbackLatencyMs);
+	PublishLatencyMs.Append(Other.PublishLatencyMs);
+}
+
+double FCameraFrameStats::GetLatencyPercentileMs(double Percentile, ELatency Latency) const
+{
+	const TArray<float>& Samples = Latency == ELatency::CaptureToReadback ? ReadbackLatencyMs : PublishLatencyMs;
+	if (Samples.Num() == 0) {
+		return 0.0;
+	}
+
+	TArray<float> Sorted = Samples;
+	Sorted.Sort();
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile / 100.0 * Sorted.Num()) - 1, 0, Sorted.Num() - 1);
+	return Sorted[Index];
+}
+
+FString FCameraFrameStats::ToString(double ElapsedSeconds) const
+{
+	const double Seconds = FMath::Max(ElapsedSeconds, SMALL_NUMBER);
+	return FString::Printf(TEXT("%lld frames (%.1f fps), %lld dropped, %lld stalled ticks, readback p50 %.2f ms p95 %.2f ms, publish p50 %.2f ms p95 %.2f ms p99 %.2f ms, game %.2f ms/frame, render %.2f ms/frame, game thread stalled %.2f ms, %.2f MB/s"),
+		PublishedFrames, PublishedFrames / Seconds, DroppedFrames, StalledTicks,
+		GetLatencyPercentileMs(50.0, ELatency::CaptureToReadback), GetLatencyPercentileMs(95.0, ELatency::CaptureToReadback),
+		GetLatencyPercentileMs(50.0), GetLatencyPercentileMs(95.0), GetLatencyPercentileMs(99.0),
+		PublishedFrames > 0 ? GameThreadSeconds * 1000.0 / PublishedFrames : 0.0,
+		PublishedFrames > 0 ? RenderThreadSeconds * 1000.0 / PublishedFrames : 0.0,
+		GameThreadStallSeconds * 1000.0, PublishedBytes / Seconds / (1024.0 * 1024.0));
+}
+
+FString FCameraFrameStats::GetCsvHeader()
+{
+	return TEXT("name,width,height,seconds,frames,fps,dropped,stalled_ticks,readback_p50_ms,readback_p95_ms,readback_p99_ms,latency_p50_ms,latency_p95_ms,latency_p99_ms,latency_max_ms,game_ms_per_frame,render_ms_per_frame,game_stall_ms,bytes,bytes_per_second");
+}
+
+FString FCameraFrameStats::ToCsvRow(const FString& Name, int32 Width, int32 Height, double ElapsedSeconds) const
+{
+	const double Seconds = FMath::Max(ElapsedSeconds, SMALL_NUMBER);
+	return FString::Printf(TEXT("%s,%d,%d,%.3f,%lld,%.3f,%lld,%lld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%lld,%.1f"),
+		*Name, Width, Height, ElapsedSeconds, PublishedFrames, PublishedFrames / Seconds, DroppedFrames, StalledTicks,
+		GetLatencyPercentileMs(50.0, ELatency::CaptureToReadback), GetLatencyPercentileMs(95.0, ELatency::CaptureToReadback), GetLatencyPercentileMs(99.0, ELatency::CaptureToReadback),
+		GetLatencyPercentileMs(50.0), GetLatencyPercentileMs(95.0), GetLatencyPercentileMs(99.0), GetLatencyPercentileMs(100.0),
+		PublishedFrames > 0 ? GameThreadSeconds * 1000.0 / PublishedFrames : 0.0,
+		PublishedFrames > 0 ? RenderThreadSeconds * 1000.0 / PublishedFrames : 0.0,
+		GameThreadStallSeconds * 1000.0, PublishedBytes, PublishedBytes / Seconds);
+}
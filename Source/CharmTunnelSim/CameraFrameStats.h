@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Frame pacing numbers of one camera pipeline, shared by ACamera and the camera benchmark commandlet
+struct CHARMTUNNELSIM_API FCameraFrameStats
+{
+	// Latency samples kept for the percentiles, older ones are overwritten
+	static constexpr int32 MaxLatencySamples = 8192;
+
+	enum class ELatency : uint8
+	{
+		// Capture request until the readback is in CPU memory
+		CaptureToReadback,
+		// Capture request until the last message of the frame is published
+		CaptureToPublish,
+	};
+
+	int64 PublishedFrames = 0;
+	int64 DroppedFrames = 0;
+	int64 PublishedBytes = 0;
+
+	// Ticks where a capture was due but the previous readback had not finished yet
+	int64 StalledTicks = 0;
+
+	// Time spent converting and publishing on the game thread and reading back on the render thread
+	double GameThreadSeconds = 0.0;
+	double RenderThreadSeconds = 0.0;
+	// Time the game thread waited for the render thread at the end of its frames
+	double GameThreadStallSeconds = 0.0;
+
+	void Reset();
+	void AddFrame(double ReadbackLatencySeconds, double PublishLatencySeconds, double GameSeconds, double RenderSeconds, int64 Bytes);
+	void AddDropped(int64 Count) { DroppedFrames += Count; }
+
+	// Adds the counters and latency samples of another camera, used for totals
+	void Append(const FCameraFrameStats& Other);
+
+	// Percentile in [0, 100] of a latency in milliseconds
+	double GetLatencyPercentileMs(double Percentile, ELatency Latency = ELatency::CaptureToPublish) const;
+
+	FString ToString(double ElapsedSeconds) const;
+	static FString GetCsvHeader();
+	FString ToCsvRow(const FString& Name, int32 Width, int32 Height, double ElapsedSeconds) const;
+
+private:
+	TArray<float> ReadbackLatencyMs;
+	TArray<float> PublishLatencyMs;
+	int32 NextSample = 0;
+};
@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// CPU side camera kernels use SSE2 directly when the target has it. Every kernel keeps a scalar
+// path that produces the exact same bytes so results do not depend on the platform.
+#if PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#define CAMERA_SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define CAMERA_SIMD_SSE2 0
+#endif
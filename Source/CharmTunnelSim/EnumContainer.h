@@ -24,6 +24,22 @@ enum TunnelType
 	StartTunnel
 };
 
+UENUM(BlueprintType)
+enum CameraStreamScale
+{
+	FullResolution,
+	HalfResolution,
+	QuarterResolution
+};
+
+UENUM(BlueprintType)
+enum CameraOutputMode
+{
+	FrameOutput,
+	EventOutput,
+	FrameAndEventOutput
+};
+
 USTRUCT(Blueprintable)
 struct FMeshSectionEnd 
 {
@@ -143,6 +159,10 @@ struct FLidarDescription
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float NoiseStdDev = 0.0f;
+
+	/// Publish the point cloud through shared memory for consumers on the same Linux host.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool useSharedMemoryTransport = false;
 };
 
 USTRUCT(Blueprintable)
@@ -172,6 +192,38 @@ struct FRadarDescription
 };
 
 
+USTRUCT(Blueprintable)
+struct FCameraStreamDescription
+{
+	GENERATED_BODY()
+
+	/// Topic name where the stream will be published, camera_info goes next to it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString topicName = "";
+
+	/// Published frames per second.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float frameRate = 5.0f;
+
+	/// Box filtered downscale applied after the region of interest crop.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TEnumAsByte<CameraStreamScale> scale = CameraStreamScale::FullResolution;
+
+	/// Publish only the region of interest of the full frame.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool useRegionOfInterest = false;
+
+	/// Region of interest in full resolution pixels.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 roiX = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 roiY = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 roiWidth = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 roiHeight = 0;
+};
+
 USTRUCT(Blueprintable)
 struct FCameraDescription
 {
@@ -192,5 +244,56 @@ struct FCameraDescription
 	/// Cameras field of view.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float field_of_view = 90.0f;
+
+	/// Publish sensor_msgs/CameraInfo next to the image.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool publishCameraInfo = true;
+
+	/// CameraInfo topic, empty uses "camera_info" next to the image topic.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString cameraInfoTopicName = "";
+
+	/// Publish the image through shared memory for consumers on the same Linux host.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool useSharedMemoryTransport = false;
+
+	/// Apply Brown-Conrady lens distortion to the published image.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Distortion")
+	bool applyDistortion = false;
+
+	/// Radial distortion coefficients.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Distortion")
+	float k1 = 0.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Distortion")
+	float k2 = 0.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Distortion")
+	float k3 = 0.0f;
+
+	/// Tangential distortion coefficients.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Distortion")
+	float p1 = 0.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Distortion")
+	float p2 = 0.0f;
+
+	/// Publish frames, DVS style events or both.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Events")
+	TEnumAsByte<CameraOutputMode> outputMode = CameraOutputMode::FrameOutput;
+
+	/// Event topic, empty uses "events" below the image topic.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Events")
+	FString eventTopicName = "";
+
+	/// How often consecutive frames are compared, limited by the game frame rate.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Events")
+	float eventFrameRate = 100.0f;
+
+	/// Change of log intensity that triggers one event.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Events")
+	float eventContrastThreshold = 0.2f;
+
+	/// Extra streams cut from the same readback, e.g. a low resolution preview or full resolution crops.
+	/// They are taken from the rendered image before lens distortion.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Streams")
+	TArray<FCameraStreamDescription> derivedStreams;
 };
 
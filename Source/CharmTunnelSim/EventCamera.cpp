@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EventCamera.h"
+#include "CameraSimd.h"
+
+namespace
+{
+	// Rec. 601 luma weights in 1/256 steps
+	constexpr int32 LumaR = 77;
+	constexpr int32 LumaG = 150;
+	constexpr int32 LumaB = 29;
+
+	FORCEINLINE int32 ComputeLuma(const FColor& Pixel)
+	{
+		return (Pixel.R * LumaR + Pixel.G * LumaG + Pixel.B * LumaB + 128) >> 8;
+	}
+}
+
+void FEventCameraKernel::Init(int32 InWidth, int32 InHeight, float ContrastThreshold)
+{
+	Reset();
+	Width = FMath::Max(InWidth, 0);
+	Height = FMath::Max(InHeight, 0);
+	Threshold = (int16)FMath::Clamp(FMath::RoundToInt(ContrastThreshold * LogScale), 1, (int32)MAX_int16);
+
+	for (int32 i = 0; i < 256; i++) {
+		LogTable[i] = (int16)FMath::RoundToInt(FMath::Loge((double)i + 1.0) * LogScale);
+	}
+
+	const int32 PixelCount = Width * Height;
+	CurrentLog.SetNumZeroed(PixelCount);
+	PreviousLog.SetNumZeroed(PixelCount);
+	ReferenceLog.SetNumZeroed(PixelCount);
+}
+
+void FEventCameraKernel::Reset()
+{
+	Width = 0;
+	Height = 0;
+	bHasReference = false;
+	PreviousFrameTimeNs = 0;
+	CurrentLog.Reset();
+	PreviousLog.Reset();
+	ReferenceLog.Reset();
+}
+
+void FEventCameraKernel::ComputeLogIntensity(const FColor* Frame)
+{
+	const int32 PixelCount = Width * Height;
+	int16* Out = CurrentLog.GetData();
+	int32 i = 0;
+
+#if CAMERA_SIMD_SSE2
+	const __m128i ByteMask = _mm_set1_epi32(0xFF);
+	const __m128i WeightR = _mm_set1_epi16(LumaR);
+	const __m128i WeightG = _mm_set1_epi16(LumaG);
+	const __m128i WeightB = _mm_set1_epi16(LumaB);
+	const __m128i Half = _mm_set1_epi16(128);
+	alignas(16) uint16 Luma[8];
+
+	for (; bSimdEnabled && i + 8 <= PixelCount; i += 8) {
+		const __m128i P0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Frame + i));
+		const __m128i P1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Frame + i + 4));
+
+		// FColor is B G R A in memory, split the channels into 8 x 16 bit lanes
+		const __m128i B = _mm_packs_epi32(_mm_and_si128(P0, ByteMask), _mm_and_si128(P1, ByteMask));
+		const __m128i G = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(P0, 8), ByteMask), _mm_and_si128(_mm_srli_epi32(P1, 8), ByteMask));
+		const __m128i R = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(P0, 16), ByteMask), _mm_and_si128(_mm_srli_epi32(P1, 16), ByteMask));
+
+		// The weighted sum stays below 2^16, so wrapping 16 bit math with a logical shift is exact
+		__m128i Y = _mm_add_epi16(_mm_mullo_epi16(R, WeightR), _mm_mullo_epi16(G, WeightG));
+		Y = _mm_add_epi16(Y, _mm_add_epi16(_mm_mullo_epi16(B, WeightB), Half));
+		_mm_store_si128(reinterpret_cast<__m128i*>(Luma), _mm_srli_epi16(Y, 8));
+
+		for (int32 k = 0; k < 8; k++) {
+			Out[i + k] = LogTable[Luma[k]];
+		}
+	}
+#endif
+
+	for (; i < PixelCount; i++) {
+		Out[i] = LogTable[ComputeLuma(Frame[i])];
+	}
+}
+
+int32 FEventCameraKernel::ProcessFrame(const FColor* Frame, uint64 FrameTimeNs, TArray<uint8>& OutEvents)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FEventCameraKernel::ProcessFrame);
+
+	if (!IsInitialized() || !Frame) {
+		return 0;
+	}
+
+	ComputeLogIntensity(Frame);
+
+	if (!bHasReference) {
+		ReferenceLog = CurrentLog;
+		Swap(CurrentLog, PreviousLog);
+		PreviousFrameTimeNs = FrameTimeNs;
+		bHasReference = true;
+		return 0;
+	}
+
+	const uint32 FrameDurationNs = (uint32)FMath::Min<uint64>(FrameTimeNs > PreviousFrameTimeNs ? FrameTimeNs - PreviousFrameTimeNs : 0, MAX_uint32);
+	const int32 PixelCount = Width * Height;
+	const int16* Current = CurrentLog.GetData();
+	const int16* Reference = ReferenceLog.GetData();
+	int32 EventCount = 0;
+	int32 i = 0;
+
+#if CAMERA_SIMD_SSE2
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i ThresholdMinusOne = _mm_set1_epi16(Threshold - 1);
+
+	for (; bSimdEnabled && i + 8 <= PixelCount; i += 8) {
+		const __m128i Difference = _mm_sub_epi16(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(Current + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(Reference + i)));
+		const __m128i Magnitude = _mm_max_epi16(Difference, _mm_sub_epi16(Zero, Difference));
+
+		// Two mask bits per 16 bit lane, a static scene leaves the mask empty
+		uint32 Mask = (uint32)_mm_movemask_epi8(_mm_cmpgt_epi16(Magnitude, ThresholdMinusOne));
+		while (Mask != 0) {
+			const int32 Lane = FMath::CountTrailingZeros(Mask) >> 1;
+			Mask &= ~(3u << (Lane * 2));
+			EmitPixelEvents(i + Lane, FrameDurationNs, OutEvents, EventCount);
+		}
+	}
+#endif
+
+	for (; i < PixelCount; i++) {
+		if (FMath::Abs(Current[i] - Reference[i]) >= Threshold) {
+			EmitPixelEvents(i, FrameDurationNs, OutEvents, EventCount);
+		}
+	}
+
+	Swap(CurrentLog, PreviousLog);
+	PreviousFrameTimeNs = FrameTimeNs;
+	return EventCount;
+}
+
+void FEventCameraKernel::EmitPixelEvents(int32 PixelIndex, uint32 FrameDurationNs, TArray<uint8>& OutEvents, int32& EventCount)
+{
+	const int32 Current = CurrentLog[PixelIndex];
+	const int32 Previous = PreviousLog[PixelIndex];
+	const int32 Delta = Current - Previous;
+	int32 Reference = ReferenceLog[PixelIndex];
+
+	const int32 Step = Current > Reference ? Threshold : -Threshold;
+	const int8 Polarity = Current > Reference ? 1 : -1;
+	const int32 Crossings = FMath::Abs(Current - Reference) / Threshold;
+
+	const uint16 x = (uint16)(PixelIndex % Width);
+	const uint16 y = (uint16)(PixelIndex / Width);
+
+	int32 Offset = OutEvents.Num();
+	OutEvents.AddUninitialized(Crossings * EventSize);
+	uint8* Out = OutEvents.GetData() + Offset;
+
+	for (int32 k = 0; k < Crossings; k++, Out += EventSize) {
+		Reference += Step;
+
+		// Log intensity is assumed to change linearly between the frames
+		uint32 t = FrameDurationNs;
+		if (Delta != 0) {
+			const int64 Numerator = (int64)(Reference - Previous) * FrameDurationNs;
+			t = (uint32)FMath::Clamp<int64>(Numerator / Delta, 0, FrameDurationNs);
+		}
+
+		FMemory::Memcpy(Out, &x, sizeof(x));
+		FMemory::Memcpy(Out + 2, &y, sizeof(y));
+		FMemory::Memcpy(Out + 4, &t, sizeof(t));
+		Out[8] = (uint8)Polarity;
+	}
+
+	ReferenceLog[PixelIndex] = (int16)Reference;
+	EventCount += Crossings;
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// DVS style event generator working on consecutive camera readbacks.
+// Every pixel keeps a reference log intensity, whenever the current log intensity is at least one
+// contrast threshold away from it an event is emitted and the reference moves by the threshold.
+// Log intensity is 16 bit fixed point from a 256 entry table, so differencing and thresholding run
+// on 8 pixels per SSE2 instruction and pixels without events cost only a movemask.
+class CHARMTUNNELSIM_API FEventCameraKernel
+{
+public:
+	// Fixed point scale of the log intensity, ln(luma + 1) * LogScale
+	static constexpr int32 LogScale = 1024;
+
+	// Size of one packed event: x uint16, y uint16, t uint32, polarity int8
+	static constexpr int32 EventSize = 9;
+
+	void Init(int32 InWidth, int32 InHeight, float ContrastThreshold);
+	void Reset();
+
+	bool IsInitialized() const { return Width > 0 && Height > 0; }
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+
+	// The SSE2 loops are on by default, off runs the scalar loops that have to make the same events byte for byte
+	void SetSimdEnabled(bool bEnabled) { bSimdEnabled = bEnabled; }
+	bool IsSimdEnabled() const { return bSimdEnabled; }
+
+	// Compares Frame with the previous one and appends packed events to OutEvents.
+	// Event time t is in nanoseconds after the previous frame, interpolated between both frames.
+	// The first frame only initializes the reference and returns 0. Returns the number of events.
+	int32 ProcessFrame(const FColor* Frame, uint64 FrameTimeNs, TArray<uint8>& OutEvents);
+
+private:
+	void ComputeLogIntensity(const FColor* Frame);
+	void EmitPixelEvents(int32 PixelIndex, uint32 FrameDurationNs, TArray<uint8>& OutEvents, int32& EventCount);
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int16 Threshold = 0;
+	bool bHasReference = false;
+	bool bSimdEnabled = true;
+	uint64 PreviousFrameTimeNs = 0;
+
+	int16 LogTable[256];
+	TArray<int16> CurrentLog;
+	TArray<int16> PreviousLog;
+	TArray<int16> ReferenceLog;
+};
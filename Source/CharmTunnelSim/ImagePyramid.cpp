@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ImagePyramid.h"
+#include "CameraSimd.h"
+#include "LensDistortion.h"
+
+void FImagePyramid::DownscaleHalf(const FColor* Source, int32 Width, int32 Height, int32 SourceStride, FColor* Destination)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FImagePyramid::DownscaleHalf);
+
+	const int32 OutWidth = Width / 2;
+	const int32 OutHeight = Height / 2;
+
+#if CAMERA_SIMD_SSE2
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Two = _mm_set1_epi16(2);
+#endif
+
+	for (int32 y = 0; y < OutHeight; y++) {
+		const FColor* Row0 = Source + (int64)(2 * y) * SourceStride;
+		const FColor* Row1 = Row0 + SourceStride;
+		FColor* Out = Destination + (int64)y * OutWidth;
+		int32 x = 0;
+
+#if CAMERA_SIMD_SSE2
+		// Four source pixels of both rows give two output pixels
+		for (; x + 2 <= OutWidth; x += 2) {
+			const __m128i A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row0 + 2 * x));
+			const __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Row1 + 2 * x));
+			__m128i Lo = _mm_add_epi16(_mm_unpacklo_epi8(A, Zero), _mm_unpacklo_epi8(B, Zero));
+			__m128i Hi = _mm_add_epi16(_mm_unpackhi_epi8(A, Zero), _mm_unpackhi_epi8(B, Zero));
+			Lo = _mm_add_epi16(Lo, _mm_srli_si128(Lo, 8));
+			Hi = _mm_add_epi16(Hi, _mm_srli_si128(Hi, 8));
+			__m128i Sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(Lo, Hi), Two), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(Out + x), _mm_packus_epi16(Sum, Sum));
+		}
+#endif
+
+		for (; x < OutWidth; x++) {
+			const FColor& P00 = Row0[2 * x];
+			const FColor& P01 = Row0[2 * x + 1];
+			const FColor& P10 = Row1[2 * x];
+			const FColor& P11 = Row1[2 * x + 1];
+			Out[x].B = (uint8)((P00.B + P01.B + P10.B + P11.B + 2) >> 2);
+			Out[x].G = (uint8)((P00.G + P01.G + P10.G + P11.G + 2) >> 2);
+			Out[x].R = (uint8)((P00.R + P01.R + P10.R + P11.R + 2) >> 2);
+			Out[x].A = (uint8)((P00.A + P01.A + P10.A + P11.A + 2) >> 2);
+		}
+	}
+}
+
+const FColor* FImagePyramid::Downscale(const FColor* Source, int32 Width, int32 Height, int32 SourceStride, int32 Levels, TArray<FColor>& Scratch, int32& OutWidth, int32& OutHeight, int32& OutStride)
+{
+	OutWidth = Width;
+	OutHeight = Height;
+	OutStride = SourceStride;
+	if (Levels <= 0) {
+		return Source;
+	}
+
+	// Every level is stored right after the previous one
+	int32 TotalPixels = 0;
+	for (int32 Level = 1, w = Width, h = Height; Level <= Levels; Level++) {
+		w /= 2;
+		h /= 2;
+		TotalPixels += w * h;
+	}
+	Scratch.SetNumUninitialized(TotalPixels, false);
+
+	const FColor* Current = Source;
+	FColor* Next = Scratch.GetData();
+	for (int32 Level = 1; Level <= Levels; Level++) {
+		DownscaleHalf(Current, OutWidth, OutHeight, OutStride, Next);
+		OutWidth /= 2;
+		OutHeight /= 2;
+		OutStride = OutWidth;
+		Current = Next;
+		Next += OutWidth * OutHeight;
+	}
+	return Current;
+}
+
+void FImagePyramid::ConvertToRGB8(const FColor* Source, int32 Width, int32 Height, int32 SourceStride, uint8* Destination)
+{
+	for (int32 y = 0; y < Height; y++) {
+		ConvertBGRAToRGB8(Source + (int64)y * SourceStride, Destination + (int64)y * Width * 3, Width);
+	}
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// CPU kernels used to derive smaller images from one camera readback.
+// All functions take a row stride in pixels, so a region of interest is just a pointer into
+// the full frame and no crop copy is needed.
+struct CHARMTUNNELSIM_API FImagePyramid
+{
+	// Halves a BGRA image with a 2x2 box filter, an odd last row or column is dropped.
+	// Destination must hold (Width / 2) * (Height / 2) pixels and is tightly packed.
+	static void DownscaleHalf(const FColor* Source, int32 Width, int32 Height, int32 SourceStride, FColor* Destination);
+
+	// Downscales by 2^Levels by applying DownscaleHalf repeatedly, all levels are written into Scratch.
+	// Returns the smallest level, its size and stride go to OutWidth / OutHeight / OutStride.
+	// With zero levels the source itself is returned.
+	static const FColor* Downscale(const FColor* Source, int32 Width, int32 Height, int32 SourceStride, int32 Levels, TArray<FColor>& Scratch, int32& OutWidth, int32& OutHeight, int32& OutStride);
+
+	// Packs a BGRA region into tightly packed rgb8
+	static void ConvertToRGB8(const FColor* Source, int32 Width, int32 Height, int32 SourceStride, uint8* Destination);
+};
@@ -0,0 +1,474 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "IntersectionVertexKernel.h"
+#include "TunnelDeformationField.h"
+#include "BakedCurve.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// Where a column of the loop around the intersection ends up in the ground or wall array
+	struct FKernelColumn
+	{
+		int32 Surface = -1;
+		int32 Offset = 0;
+	};
+
+	// State the serial loop kept in actor members, now local to the row being generated
+	struct FKernelRow
+	{
+		int32 Row = 0;
+		int32 Index = 0;
+		FVector Latest = FVector::ZeroVector;
+		FVector First = FVector::ZeroVector;
+		const float* Deform = nullptr;
+		const FVector* FirstGround = nullptr;
+	};
+
+	// 0 = Floor, 1 = Right, 2 = Roof, 3 = Left
+	template<IntersectionType Type>
+	int32 GetSurfaceIndex(const FIntersectionKernelInput& In, int32 Index)
+	{
+		const int32 H = In.NumberOfHorizontalPoints;
+		if constexpr (Type == IntersectionType::Right) {
+			if (Index < H) return 2;
+			else if (Index < H + In.NumberOfVerticalPoints) return 3;
+			else if (Index < H * 2 + In.NumberOfVerticalPoints) return 0;
+		}
+		else if constexpr (Type == IntersectionType::Left) {
+			if (Index < H) return 0;
+			else if (Index < H + In.NumberOfVerticalPoints) return 1;
+			else if (Index < H * 2 + In.NumberOfVerticalPoints) return 2;
+		}
+		else {
+			if (Index < H) return 0;
+			else if (Index < H * 2) return 2;
+		}
+		return -1;
+	}
+
+	// Index of the vertex in the last loop of the parent tunnel
+	template<IntersectionType Type>
+	int32 GetArrayIndex(const FIntersectionKernelInput& In, int32 Surface, int32 Index)
+	{
+		const int32 H = In.NumberOfHorizontalPoints;
+		if constexpr (Type == IntersectionType::Right) {
+			return Surface == 0 ? Index - H - In.NumberOfVerticalPoints : Index + In.NumberOfVerticalPoints;
+		}
+		else if constexpr (Type == IntersectionType::Left) {
+			return Surface == 0 ? Index : Index - H;
+		}
+		else {
+			return Surface == 0 ? Index : Index - H + In.NumberOfVerticalPoints;
+		}
+	}
+
+	template<IntersectionType Type>
+	FVector GetFloorVertice(const FIntersectionKernelInput& In, FKernelRow& State)
+	{
+		const int32 H = In.NumberOfHorizontalPoints;
+		float sideWaysMovementAmount = 0.0f;
+
+		if constexpr (Type == IntersectionType::Right) {
+			const int32 V = In.NumberOfVerticalPoints;
+			sideWaysMovementAmount = In.HorizontalPointSize * (float)(State.Index - H - V);
+			if (State.Index == H + V) {
+				return State.First = State.Latest;
+			}
+		}
+		else {
+			sideWaysMovementAmount = In.HorizontalPointSize * State.Index;
+			if (State.Index == 0) {
+				FVector verticeOffset = FVector(0.0f, (float)(H - 1) / 2.0f * In.HorizontalPointSize, 0.0f);
+				return State.First = State.Latest - verticeOffset;
+			}
+		}
+
+		float pixelValue = State.Deform[State.Index];
+		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
+		float deform = FMath::Lerp(0.0f, In.MaxFloorDeformation, In.SurfaceVariation.X) * directionOfDeform;
+
+		return State.First + FVector(0.0f, sideWaysMovementAmount, deform);
+	}
+
+	// Right wall of the left intersection
+	FVector GetRightVertice(const FIntersectionKernelInput& In, FKernelRow& State)
+	{
+		const int32 H = In.NumberOfHorizontalPoints;
+		if (State.Index == H) {
+			State.First = State.Latest;
+			return State.Latest;
+		}
+
+		float roundnessAmount = In.Roundness.AlongWall[State.Index - H];
+		float tunnelRounding = FMath::Lerp(In.TunnelRoundValue, 0.0f, roundnessAmount);
+		float maxValue = FMath::Lerp(0.0f, In.MaxWallDeformation, In.SurfaceVariation.Y);
+
+		float pixelValue = State.Deform[State.Index];
+		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
+		float deform = directionOfDeform * maxValue;
+
+		FVector vertice = State.First + FVector(0.0f, 0.0f, In.VerticalPointSize * (float)(State.Index - H));
+		vertice += FVector(0.0f, tunnelRounding, 0.0f);
+		vertice += FVector(0.0f, deform, 0.0f);
+		return vertice;
+	}
+
+	template<IntersectionType Type>
+	FVector GetRoofVertice(const FIntersectionKernelInput& In, FKernelRow& State)
+	{
+		const int32 H = In.NumberOfHorizontalPoints;
+		const int32 V = In.NumberOfVerticalPoints;
+		float roundness;
+		float roofXRoundness = In.Roundness.AlongLength[State.Row];
+		if constexpr (Type == IntersectionType::Right) {
+			float locationOnYRoof = (float)(State.Index + 1) / (float)H;
+			float roofYRoundness = In.Roundness.AcrossRoof[State.Index + 1];
+			if (locationOnYRoof >= 0.5) roundness = roofYRoundness;
+			else roundness = FMath::Min(roofYRoundness, roofXRoundness);
+		}
+		else if constexpr (Type == IntersectionType::Left) {
+			float locationOnYRoof = (float)(State.Index - H - V + 1) / (float)H;
+			float roofYRoundness = In.Roundness.AcrossRoof[State.Index - H - V + 1];
+			if (locationOnYRoof < 0.5) roundness = roofYRoundness;
+			else roundness = FMath::Min(roofYRoundness, roofXRoundness);
+		}
+		else if constexpr (Type == IntersectionType::RightLeft) {
+			float locationOnXRoof = (float)State.Row / (float)(H - 1);
+			float roofYRoundness = In.Roundness.AcrossRoof[State.Index - H + 1];
+			if (locationOnXRoof >= 0.5) roundness = roofXRoundness;
+			else roundness = FMath::Min(roofYRoundness, roofXRoundness);
+		}
+		else {
+			float roofYRoundness = In.Roundness.AcrossRoof[State.Index - H + 1];
+			roundness = FMath::Min(roofYRoundness, roofXRoundness);
+		}
+
+		float tunnelRounding = FMath::Lerp(In.TunnelRoundValue, 0.0f, roundness);
+
+		if constexpr (Type == IntersectionType::Right) {
+			FVector selectedVector;
+			if (State.Index == 0) {
+				float yLocation = ((float)(H - 1) / 2.0f) * In.HorizontalPointSize;
+				selectedVector = State.Latest + FVector(0.0f, yLocation, ((float)V) * In.VerticalPointSize);
+				State.First = selectedVector;
+			}
+			else {
+				selectedVector = State.First - FVector(0.0f, (float)(State.Index * In.HorizontalPointSize), 0.0f);
+			}
+			selectedVector.Z += tunnelRounding / 2;
+
+			float maxValue = FMath::Lerp(0.0f, In.MaxWallDeformation, In.SurfaceVariation.Y);
+			float pixelValue = State.Deform[State.Index];
+			float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
+			float deform = directionOfDeform * maxValue;
+			return selectedVector + FVector(0.0f, 0.0f, deform);
+		}
+		else if constexpr (Type == IntersectionType::Left) {
+			if (State.Index == H + V) {
+				State.First.Z += In.VerticalPointSize * V;
+				return State.First;
+			}
+
+			FVector selectedVector = State.First;
+			float sideWaysMovementSize = (float)(State.Index - H - V) * In.HorizontalPointSize;
+			selectedVector.Y -= sideWaysMovementSize;
+			selectedVector.Z += tunnelRounding / 2;
+
+			float maxValue = FMath::Lerp(0.0f, In.MaxWallDeformation, In.SurfaceVariation.Y);
+			float pixelValue = State.Deform[State.Index];
+			float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
+			float deform = directionOfDeform * maxValue;
+			return selectedVector + FVector(0.0f, 0.0f, deform);
+		}
+		else {
+			if (State.Index == H) {
+				State.First = State.Latest + FVector(0.0f, 0.0f, V * In.VerticalPointSize);
+			}
+
+			FVector selectedVector = State.First;
+			float sideWaysMovementSize = (float)(State.Index - H) * In.HorizontalPointSize;
+			selectedVector.Y -= sideWaysMovementSize;
+			selectedVector.Z += tunnelRounding / 2;
+			return selectedVector;
+		}
+	}
+
+	// Left wall of the right intersection
+	FVector GetLeftVertice(const FIntersectionKernelInput& In, FKernelRow& State)
+	{
+		const int32 H = In.NumberOfHorizontalPoints;
+		const int32 V = In.NumberOfVerticalPoints;
+		if (State.Index == H) {
+			State.First = State.Latest;
+		}
+
+		float roundnessAmount = In.Roundness.AlongWall[State.Index - H + 1];
+		float tunnelRounding = FMath::Lerp(In.TunnelRoundValue, 0.0f, roundnessAmount);
+		float maxValue = FMath::Lerp(0.0f, In.MaxWallDeformation, In.SurfaceVariation.Y);
+
+		float pixelValue = State.Deform[State.Index];
+		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
+		float deform = directionOfDeform * maxValue;
+
+		FVector vertice = State.First - FVector(0.0f, 0.0f, In.VerticalPointSize * (State.Index - H + 1));
+		vertice.Y -= tunnelRounding;
+		vertice.Y -= deform;
+		// Last vertex of the wall is the start of the ground, so it is not deformed
+		if (State.Index == H + V - 1) {
+			if (In.HasParent) {
+				if (In.ParentWall.Num() > 0) {
+					vertice.Z = In.ParentWall.Last().Z;
+					vertice.Y = In.ParentWall.Last().Y;
+				}
+			}
+			else if (State.FirstGround) {
+				vertice.Z = State.FirstGround->Z;
+				vertice.Y = State.FirstGround->Y;
+			}
+		}
+		return vertice;
+	}
+
+	template<IntersectionType Type>
+	FVector GetVerticeBySurface(const FIntersectionKernelInput& In, int32 Surface, FKernelRow& State)
+	{
+		switch (Surface)
+		{
+		case 0:
+			return GetFloorVertice<Type>(In, State);
+		case 1:
+			return GetRightVertice(In, State);
+		case 2:
+			return GetRoofVertice<Type>(In, State);
+		case 3:
+			return GetLeftVertice(In, State);
+		}
+		return FVector(0.0f, 0.0f, 0.0f);
+	}
+
+	// One loop around the intersection, written to the row's part of the ground and wall arrays
+	template<IntersectionType Type>
+	void GenerateRow(const FIntersectionKernelInput& In, const TArray<FKernelColumn>& Columns, int32 NumGroundColumns, int32 NumWallColumns,
+		FIntersectionKernelOutput& Out, FKernelRow& State)
+	{
+		const int32 Count = Columns.Num();
+		TArray<float> deformValues;
+		deformValues.SetNumUninitialized(Count);
+		if (In.DeformationField) {
+			In.DeformationField->SampleColumn(State.Row, 0, Count, deformValues.GetData());
+		}
+		else {
+			FMemory::Memzero(deformValues.GetData(), Count * sizeof(float));
+		}
+		State.Deform = deformValues.GetData();
+
+		FVector* groundRow = Out.GroundVertices.GetData() + State.Row * NumGroundColumns;
+		FVector* wallRow = Out.WallVertices.GetData() + State.Row * NumWallColumns;
+		State.Latest = FVector((float)State.Row * In.HorizontalPointSize, 0.0f, 0.0f);
+		for (State.Index = 0; State.Index < Count; State.Index++) {
+			const FKernelColumn& column = Columns[State.Index];
+			FVector vertice = FVector::ZeroVector;
+			if (State.Row == 0 && In.HasParent) {
+				int32 arrayIndex = GetArrayIndex<Type>(In, column.Surface, State.Index);
+				const TArray<FVector>& targetArray = column.Surface == 0 ? In.ParentGround : In.ParentWall;
+				if (arrayIndex >= 0 && targetArray.Num() > arrayIndex) {
+					vertice = targetArray[arrayIndex];
+				}
+			}
+			else {
+				vertice = GetVerticeBySurface<Type>(In, column.Surface, State);
+			}
+			State.Latest = vertice;
+			(column.Surface == 0 ? groundRow : wallRow)[column.Offset] = vertice;
+		}
+		State.Deform = nullptr;
+	}
+
+	template<IntersectionType Type>
+	void GenerateVertices(const FIntersectionKernelInput& In, FIntersectionKernelOutput& Out)
+	{
+		const int32 Rows = In.NumberOfHorizontalPoints;
+		const int32 H = In.NumberOfHorizontalPoints;
+
+		// Surfaces only depend on the column, so every row has the same split between the ground and wall arrays
+		TArray<FKernelColumn> Columns;
+		Columns.SetNum(In.LoopAroundTunnelLastIndex + 1);
+		int32 NumGroundColumns = 0;
+		int32 NumWallColumns = 0;
+		for (int32 Index = 0; Index < Columns.Num(); Index++) {
+			Columns[Index].Surface = GetSurfaceIndex<Type>(In, Index);
+			Columns[Index].Offset = Columns[Index].Surface == 0 ? NumGroundColumns++ : NumWallColumns++;
+		}
+		if (Rows <= 0 || Columns.Num() == 0) {
+			return;
+		}
+		Out.GroundVertices.SetNumUninitialized(Rows * NumGroundColumns);
+		Out.WallVertices.SetNumUninitialized(Rows * NumWallColumns);
+
+		// First row goes first, the right intersection closes the left wall of later rows to its first ground vertex
+		FKernelRow FirstRow;
+		FirstRow.First = In.FirstVertice;
+		FirstRow.FirstGround = In.ExistingFirstGround.GetPtrOrNull();
+		GenerateRow<Type>(In, Columns, NumGroundColumns, NumWallColumns, Out, FirstRow);
+
+		const FVector* FirstGround = In.ExistingFirstGround.GetPtrOrNull();
+		if (!FirstGround && NumGroundColumns > 0) {
+			FirstGround = &Out.GroundVertices[0];
+		}
+		FKernelRow LastRow = FirstRow;
+		ParallelFor(Rows - 1, [&](int32 Task)
+		{
+			FKernelRow State;
+			State.Row = Task + 1;
+			State.First = In.FirstVertice;
+			State.FirstGround = FirstGround;
+			GenerateRow<Type>(In, Columns, NumGroundColumns, NumWallColumns, Out, State);
+			if (State.Row == Rows - 1) {
+				LastRow = State;
+			}
+		});
+		Out.LatestVertice = LastRow.Latest;
+		Out.FirstVertice = LastRow.First;
+		Out.SurfaceIndex = Columns.Last().Surface;
+
+		auto GetVertex = [&](int32 Row, int32 Index) -> const FVector& {
+			const FKernelColumn& column = Columns[Index];
+			return column.Surface == 0 ? Out.GroundVertices[Row * NumGroundColumns + column.Offset] : Out.WallVertices[Row * NumWallColumns + column.Offset];
+		};
+		// Vertices of one column of the loop in every row
+		auto AddColumn = [&](TArray<FVector>& Target, int32 Surface, int32 Index) {
+			if (Columns.IsValidIndex(Index) && Columns[Index].Surface == Surface) {
+				for (int32 Row = 0; Row < Rows; Row++) {
+					Target.Add(GetVertex(Row, Index));
+				}
+			}
+		};
+		// Vertices of a surface in the last row
+		auto AddLastRow = [&](TArray<FVector>& Target, int32 Surface) {
+			for (int32 Index = 0; Index < Columns.Num(); Index++) {
+				if (Columns[Index].Surface == Surface) {
+					Target.Add(GetVertex(Rows - 1, Index));
+				}
+			}
+		};
+
+		if constexpr (Type == IntersectionType::Right) {
+			AddColumn(Out.LastRightRoofVertices, 2, 0);
+			AddLastRow(Out.LastStraightRoofVertices, 2);
+			AddLastRow(Out.LastLeftWallVertices, 3);
+			AddColumn(Out.LastLeftFloorVertices, 0, H + In.NumberOfVerticalPoints);
+			AddLastRow(Out.LastStraightFloorVertices, 0);
+			AddColumn(Out.LastRightFloorVertices, 0, In.LoopAroundTunnelLastIndex);
+		}
+		else if constexpr (Type == IntersectionType::Left) {
+			AddColumn(Out.LastLeftFloorVertices, 0, 0);
+			AddLastRow(Out.LastStraightFloorVertices, 0);
+			AddColumn(Out.LastRightFloorVertices, 1, H);
+			AddLastRow(Out.LastRightWallVertices, 1);
+			AddColumn(Out.LastLeftRoofVertices, 2, In.LoopAroundTunnelLastIndex);
+			AddLastRow(Out.LastStraightRoofVertices, 2);
+		}
+		else {
+			AddColumn(Out.LastLeftFloorVertices, 0, 0);
+			AddLastRow(Out.LastStraightFloorVertices, 0);
+			AddColumn(Out.LastRightFloorVertices, 0, H - 1);
+			AddColumn(Out.LastLeftRoofVertices, 2, In.LoopAroundTunnelLastIndex);
+			AddLastRow(Out.LastStraightRoofVertices, 2);
+			AddColumn(Out.LastRightRoofVertices, 2, H);
+		}
+	}
+}
+
+void FIntersectionRoundnessTable::Build(const FBakedCurve& Curve, int32 HorizontalPoints, int32 VerticalPoints)
+{
+	// Same float divisions as the loops, so index k is the curve at the time the serial loop evaluated it
+	TArray<float> Times;
+	auto Evaluate = [&Curve, &Times](TArray<float>& Values, int32 Count, float Divisor) {
+		Times.SetNumUninitialized(Count);
+		for (int32 k = 0; k < Count; k++) {
+			Times[k] = (float)k / Divisor;
+		}
+		Values.SetNumUninitialized(Count);
+		Curve.EvalBatch(Times, Values);
+	};
+
+	Evaluate(AcrossRoof, FMath::Max(HorizontalPoints + 1, 0), (float)HorizontalPoints);
+	Evaluate(AlongWall, FMath::Max(VerticalPoints + 1, 0), (float)VerticalPoints);
+	Evaluate(AlongLength, FMath::Max(HorizontalPoints, 0), (float)(HorizontalPoints - 1));
+}
+
+void FIntersectionVertexKernel::Generate(const FIntersectionKernelInput& Input, FIntersectionKernelOutput& Output)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FIntersectionVertexKernel::Generate);
+
+	Output.LatestVertice = FVector::ZeroVector;
+	Output.FirstVertice = Input.FirstVertice;
+	switch (Input.Type)
+	{
+	case IntersectionType::Right:
+		GenerateVertices<IntersectionType::Right>(Input, Output);
+		break;
+	case IntersectionType::Left:
+		GenerateVertices<IntersectionType::Left>(Input, Output);
+		break;
+	case IntersectionType::RightLeft:
+		GenerateVertices<IntersectionType::RightLeft>(Input, Output);
+		break;
+	case IntersectionType::All:
+		GenerateVertices<IntersectionType::All>(Input, Output);
+		break;
+	}
+}
+
+void FIntersectionVertexKernel::AppendEndWall(const FIntersectionKernelInput& Input, const TArray<FVector>& LastStraightRoofVertices, const TArray<FVector>& LastStraightFloorVertices,
+	FVector& LatestVertice, TArray<FVector>& WallVertices, TArray<FVector>& LastRightWallVertices, TArray<FVector>& LastLeftWallVertices)
+{
+	const int32 H = Input.NumberOfHorizontalPoints;
+	const int32 numberOfPointsInEndWall = H * Input.NumberOfVerticalPoints;
+	if (numberOfPointsInEndWall <= 0 || LastStraightRoofVertices.Num() == 0) {
+		return;
+	}
+	WallVertices.Reserve(WallVertices.Num() + numberOfPointsInEndWall);
+	FVector startVertice = LastStraightRoofVertices[0];
+
+	int32 previousRow = -1;
+	for (int32 endWallCurrentIndex = 0; endWallCurrentIndex < numberOfPointsInEndWall; endWallCurrentIndex++) {
+		int32 currentRow = endWallCurrentIndex / H;
+
+		if (previousRow != -1 && previousRow != currentRow) {
+			LastLeftWallVertices.Add(LatestVertice);
+		}
+
+		// Last row is the straight floor going back
+		if (endWallCurrentIndex >= numberOfPointsInEndWall - H) {
+			int32 lastRowIndex = endWallCurrentIndex - (numberOfPointsInEndWall - H);
+			const FVector& floorVertice = LastStraightFloorVertices[LastStraightFloorVertices.Num() - lastRowIndex - 1];
+			if (currentRow != previousRow) {
+				LastRightWallVertices.Add(floorVertice);
+				previousRow = currentRow;
+			}
+			if (endWallCurrentIndex == numberOfPointsInEndWall - 1) {
+				LastLeftWallVertices.Add(floorVertice);
+			}
+			WallVertices.Add(floorVertice);
+		}
+		// New row one step down, also the first row
+		else if (currentRow != previousRow) {
+			startVertice.Z -= Input.VerticalPointSize;
+			float roundnessAmount = Input.Roundness.AlongWall[currentRow + 1];
+			float tunnelRounding = FMath::Lerp(Input.TunnelRoundValue, 0.0f, roundnessAmount);
+
+			startVertice.X = LastStraightRoofVertices[0].X + tunnelRounding + Input.HorizontalPointSize;
+			LatestVertice = startVertice;
+			WallVertices.Add(LatestVertice);
+			LastRightWallVertices.Add(LatestVertice);
+			previousRow = currentRow;
+		}
+		else {
+			LatestVertice.Y -= Input.HorizontalPointSize;
+			WallVertices.Add(LatestVertice);
+		}
+	}
+}
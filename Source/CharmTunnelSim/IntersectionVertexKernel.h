@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnumContainer.h"
+
+class FTunnelDeformationField;
+struct FBakedCurve;
+
+// Roundness curve evaluated once at every point the intersection loops read it. The loops only ever
+// read the curve at k / numberOfHorizontalPoints, k / numberOfVerticalPoints and at the forward row
+// over numberOfHorizontalPoints - 1, so the table is filled from the baked curve with one batch per row.
+struct FIntersectionRoundnessTable
+{
+	// Curve at (float)k / (float)numberOfHorizontalPoints, k in [0, numberOfHorizontalPoints]
+	TArray<float> AcrossRoof;
+	// Curve at (float)k / (float)numberOfVerticalPoints, k in [0, numberOfVerticalPoints]
+	TArray<float> AlongWall;
+	// Curve at (float)row / (float)(numberOfHorizontalPoints - 1) for every forward row
+	TArray<float> AlongLength;
+
+	void Build(const FBakedCurve& Curve, int32 HorizontalPoints, int32 VerticalPoints);
+};
+
+// Everything the vertex loops of an intersection read, copied from the actor so rows can be generated on any thread
+struct FIntersectionKernelInput
+{
+	IntersectionType Type = IntersectionType::Right;
+	int32 NumberOfHorizontalPoints = 0;
+	int32 NumberOfVerticalPoints = 0;
+	int32 LoopAroundTunnelLastIndex = 0;
+	float HorizontalPointSize = 0.0f;
+	float VerticalPointSize = 0.0f;
+	FVector2D SurfaceVariation = FVector2D::ZeroVector;
+	float TunnelRoundValue = 0.0f;
+	float MaxWallDeformation = 0.0f;
+	float MaxFloorDeformation = 0.0f;
+	const FTunnelDeformationField* DeformationField = nullptr;
+	FIntersectionRoundnessTable Roundness;
+
+	// Last loop of the parent tunnel already in intersection space, the first row is copied from it
+	bool HasParent = false;
+	TArray<FVector> ParentGround;
+	TArray<FVector> ParentWall;
+	// First ground vertex already in the actor's arrays, the right intersection closes its left wall to it
+	TOptional<FVector> ExistingFirstGround;
+	// Loop state the actor had before generation, kept when no row changes it
+	FVector FirstVertice = FVector::ZeroVector;
+};
+
+struct FIntersectionKernelOutput
+{
+	TArray<FVector> GroundVertices;
+	TArray<FVector> WallVertices;
+	TArray<FVector> LastRightWallVertices;
+	TArray<FVector> LastLeftWallVertices;
+	TArray<FVector> LastStraightRoofVertices;
+	TArray<FVector> LastRightRoofVertices;
+	TArray<FVector> LastLeftRoofVertices;
+	TArray<FVector> LastRightFloorVertices;
+	TArray<FVector> LastStraightFloorVertices;
+	TArray<FVector> LastLeftFloorVertices;
+
+	// Loop state after the last vertex, what the actor's loop members held after the serial loop
+	FVector LatestVertice = FVector::ZeroVector;
+	FVector FirstVertice = FVector::ZeroVector;
+	int32 SurfaceIndex = -1;
+};
+
+// Vertex generation of AProceduralIntersection without any actor state. Each forward row only depends on the
+// input (and on the first row for the right intersection), so the first row is generated before the others
+// and the rest run in parallel, writing to their own part of arrays sized up front. The code of every surface
+// is the same arithmetic as the loop in AProceduralIntersection, only specialized per intersection type. The roundness
+// comes from the baked curve, so vertices differ from the serial loop by at most the bake error times the tunnel rounding.
+// tunnel.Intersection.VerifyKernel compares the two on the intersections of a level, the
+// CharmTunnelSim.Intersection.VertexKernelGolden test against vertices the serial loop made.
+struct CHARMTUNNELSIM_API FIntersectionVertexKernel
+{
+	static void Generate(const FIntersectionKernelInput& Input, FIntersectionKernelOutput& Output);
+
+	// End wall of a RightLeft intersection, it continues from the straight roof and floor already stored in the arrays
+	static void AppendEndWall(const FIntersectionKernelInput& Input, const TArray<FVector>& LastStraightRoofVertices, const TArray<FVector>& LastStraightFloorVertices,
+		FVector& LatestVertice, TArray<FVector>& WallVertices, TArray<FVector>& LastRightWallVertices, TArray<FVector>& LastLeftWallVertices);
+};
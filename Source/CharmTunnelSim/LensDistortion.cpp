@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LensDistortion.h"
+#include "CameraSimd.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// Iterations used to invert the distortion polynomial, converges well below 1/128 pixel for any usable lens
+	constexpr int32 UndistortIterations = 20;
+
+	constexpr int32 WeightOne = 1 << FLensDistortionRemap::FractionBits;
+}
+
+FCameraIntrinsics FCameraIntrinsics::FromFieldOfView(int32 Width, int32 Height, float HorizontalFOVDegrees)
+{
+	FCameraIntrinsics Intrinsics;
+	const double HalfFOV = FMath::DegreesToRadians(FMath::Clamp((double)HorizontalFOVDegrees, 1.0, 179.0)) * 0.5;
+
+	// Scene capture uses the horizontal field of view and square pixels
+	Intrinsics.fx = (Width * 0.5) / FMath::Tan(HalfFOV);
+	Intrinsics.fy = Intrinsics.fx;
+	Intrinsics.cx = (Width - 1) * 0.5;
+	Intrinsics.cy = (Height - 1) * 0.5;
+	return Intrinsics;
+}
+
+void FLensDistortionRemap::Reset()
+{
+	Width = 0;
+	Height = 0;
+	Entries.Reset();
+	Tiles.Reset();
+}
+
+void FLensDistortionRemap::Build(int32 InWidth, int32 InHeight, const FCameraIntrinsics& Intrinsics, const FBrownConradyCoefficients& Coefficients)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FLensDistortionRemap::Build);
+
+	Reset();
+	if (InWidth < 2 || InHeight < 2 || Intrinsics.fx <= 0.0 || Intrinsics.fy <= 0.0) {
+		UE_LOG(LogTemp, Error, TEXT("Lens distortion remap needs at least 2x2 pixels and positive focal lengths."));
+		return;
+	}
+
+	Width = InWidth;
+	Height = InHeight;
+	Entries.SetNumUninitialized(Width * Height);
+
+	// Tile table, entries are stored tile after tile in row major order inside each tile
+	const int32 TilesX = FMath::DivideAndRoundUp(Width, TileSize);
+	const int32 TilesY = FMath::DivideAndRoundUp(Height, TileSize);
+	Tiles.Reserve(TilesX * TilesY);
+	int32 FirstEntry = 0;
+	for (int32 TileY = 0; TileY < TilesY; TileY++) {
+		for (int32 TileX = 0; TileX < TilesX; TileX++) {
+			FRemapTile& Tile = Tiles.AddDefaulted_GetRef();
+			Tile.X = TileX * TileSize;
+			Tile.Y = TileY * TileSize;
+			Tile.SizeX = FMath::Min(TileSize, Width - Tile.X);
+			Tile.SizeY = FMath::Min(TileSize, Height - Tile.Y);
+			Tile.FirstEntry = FirstEntry;
+			FirstEntry += Tile.SizeX * Tile.SizeY;
+		}
+	}
+
+	const FBrownConradyCoefficients C = Coefficients;
+	const FCameraIntrinsics K = Intrinsics;
+	const int32 SourceWidth = Width;
+	const int32 SourceHeight = Height;
+
+	ParallelFor(Tiles.Num(), [this, C, K, SourceWidth, SourceHeight](int32 TileIndex)
+	{
+		const FRemapTile& Tile = Tiles[TileIndex];
+		FRemapEntry* Entry = Entries.GetData() + Tile.FirstEntry;
+
+		for (int32 y = Tile.Y; y < Tile.Y + Tile.SizeY; y++) {
+			for (int32 x = Tile.X; x < Tile.X + Tile.SizeX; x++, Entry++) {
+				// Normalized coordinates of the distorted output pixel
+				const double xd = (x - K.cx) / K.fx;
+				const double yd = (y - K.cy) / K.fy;
+
+				// Invert the Brown-Conrady model with fixed point iteration, same as OpenCV undistortPoints
+				double xu = xd;
+				double yu = yd;
+				for (int32 i = 0; i < UndistortIterations; i++) {
+					const double r2 = xu * xu + yu * yu;
+					const double radial = 1.0 + r2 * (C.k1 + r2 * (C.k2 + r2 * C.k3));
+					const double dx = 2.0 * C.p1 * xu * yu + C.p2 * (r2 + 2.0 * xu * xu);
+					const double dy = C.p1 * (r2 + 2.0 * yu * yu) + 2.0 * C.p2 * xu * yu;
+					xu = (xd - dx) / radial;
+					yu = (yd - dy) / radial;
+				}
+
+				// Position of the same ray in the rendered pinhole image
+				const double su = xu * K.fx + K.cx;
+				const double sv = yu * K.fy + K.cy;
+				if (!FMath::IsFinite(su) || !FMath::IsFinite(sv) || su < -0.5 || sv < -0.5 || su >= SourceWidth - 0.5 || sv >= SourceHeight - 0.5) {
+					Entry->SourceIndex = INDEX_NONE;
+					Entry->FracX = 0;
+					Entry->FracY = 0;
+					continue;
+				}
+
+				// Clamp so the 2x2 footprint always stays inside the image
+				const double cu = FMath::Clamp(su, 0.0, SourceWidth - 1.0);
+				const double cv = FMath::Clamp(sv, 0.0, SourceHeight - 1.0);
+				const int32 x0 = FMath::Min((int32)cu, SourceWidth - 2);
+				const int32 y0 = FMath::Min((int32)cv, SourceHeight - 2);
+				Entry->SourceIndex = y0 * SourceWidth + x0;
+				Entry->FracX = (uint8)FMath::Clamp(FMath::RoundToInt((cu - x0) * WeightOne), 0, WeightOne);
+				Entry->FracY = (uint8)FMath::Clamp(FMath::RoundToInt((cv - y0) * WeightOne), 0, WeightOne);
+			}
+		}
+	});
+}
+
+void FLensDistortionRemap::RemapToRGB8(const FColor* Source, uint8* Destination) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FLensDistortionRemap::RemapToRGB8);
+
+	if (!IsValid() || !Source || !Destination) {
+		return;
+	}
+
+	ParallelFor(Tiles.Num(), [this, Source, Destination](int32 TileIndex)
+	{
+		RemapTile(Tiles[TileIndex], Source, Destination);
+	});
+}
+
+void FLensDistortionRemap::RemapTile(const FRemapTile& Tile, const FColor* Source, uint8* Destination) const
+{
+	const FRemapEntry* Entry = Entries.GetData() + Tile.FirstEntry;
+	constexpr int32 Shift = 2 * FractionBits;
+	constexpr int32 Round = 1 << (Shift - 1);
+
+#if CAMERA_SIMD_SSE2
+	const __m128i Zero = _mm_setzero_si128();
+	const __m128i Rounding = _mm_set1_epi32(Round);
+#endif
+
+	for (int32 y = Tile.Y; y < Tile.Y + Tile.SizeY; y++) {
+		uint8* Out = Destination + ((int64)y * Width + Tile.X) * 3;
+
+		for (int32 x = 0; x < Tile.SizeX; x++, Entry++, Out += 3) {
+			if (Entry->SourceIndex == INDEX_NONE) {
+				Out[0] = 0;
+				Out[1] = 0;
+				Out[2] = 0;
+				continue;
+			}
+
+			const int32 wx1 = Entry->FracX;
+			const int32 wx0 = WeightOne - wx1;
+			const int32 wy1 = Entry->FracY;
+			const int32 wy0 = WeightOne - wy1;
+			const int32 w00 = wx0 * wy0;
+			const int32 w01 = wx1 * wy0;
+			const int32 w10 = wx0 * wy1;
+			const int32 w11 = wx1 * wy1;
+
+			const FColor* Top = Source + Entry->SourceIndex;
+			const FColor* Bottom = Top + Width;
+
+#if CAMERA_SIMD_SSE2
+			// Two neighbouring pixels are interleaved per channel so one madd does the horizontal blend
+			__m128i TopPair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(Top));
+			__m128i BottomPair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(Bottom));
+			TopPair = _mm_unpacklo_epi8(_mm_unpacklo_epi8(TopPair, _mm_srli_si128(TopPair, 4)), Zero);
+			BottomPair = _mm_unpacklo_epi8(_mm_unpacklo_epi8(BottomPair, _mm_srli_si128(BottomPair, 4)), Zero);
+
+			__m128i Sum = _mm_add_epi32(
+				_mm_madd_epi16(TopPair, _mm_set1_epi32((w01 << 16) | w00)),
+				_mm_madd_epi16(BottomPair, _mm_set1_epi32((w11 << 16) | w10)));
+			Sum = _mm_srli_epi32(_mm_add_epi32(Sum, Rounding), Shift);
+			Sum = _mm_packus_epi16(_mm_packs_epi32(Sum, Zero), Zero);
+
+			// Lanes are in FColor memory order, B G R A
+			const uint32 Pixel = (uint32)_mm_cvtsi128_si32(Sum);
+			Out[0] = (uint8)(Pixel >> 16);
+			Out[1] = (uint8)(Pixel >> 8);
+			Out[2] = (uint8)Pixel;
+#else
+			Out[0] = (uint8)((Top[0].R * w00 + Top[1].R * w01 + Bottom[0].R * w10 + Bottom[1].R * w11 + Round) >> Shift);
+			Out[1] = (uint8)((Top[0].G * w00 + Top[1].G * w01 + Bottom[0].G * w10 + Bottom[1].G * w11 + Round) >> Shift);
+			Out[2] = (uint8)((Top[0].B * w00 + Top[1].B * w01 + Bottom[0].B * w10 + Bottom[1].B * w11 + Round) >> Shift);
+#endif
+		}
+	}
+}
+
+void ConvertBGRAToRGB8(const FColor* Source, uint8* Destination, int32 PixelCount)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ConvertBGRAToRGB8);
+
+	for (int32 i = 0; i < PixelCount; i++, Destination += 3) {
+		Destination[0] = Source[i].R;
+		Destination[1] = Source[i].G;
+		Destination[2] = Source[i].B;
+	}
+}
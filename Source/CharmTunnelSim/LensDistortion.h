@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Pinhole intrinsics in ROS / OpenCV pixel convention (pixel centers on integer coordinates)
+struct FCameraIntrinsics
+{
+	double fx = 0.0;
+	double fy = 0.0;
+	double cx = 0.0;
+	double cy = 0.0;
+
+	// Intrinsics of an ideal pinhole camera with square pixels and the given horizontal field of view
+	static FCameraIntrinsics FromFieldOfView(int32 Width, int32 Height, float HorizontalFOVDegrees);
+};
+
+// Brown-Conrady coefficients in the order used by the ROS "plumb_bob" model: k1, k2, p1, p2, k3
+struct FBrownConradyCoefficients
+{
+	double k1 = 0.0;
+	double k2 = 0.0;
+	double p1 = 0.0;
+	double p2 = 0.0;
+	double k3 = 0.0;
+
+	bool IsZero() const { return k1 == 0.0 && k2 == 0.0 && p1 == 0.0 && p2 == 0.0 && k3 == 0.0; }
+};
+
+// Precomputed remap table that turns the rendered pinhole image into a distorted image.
+// Building the table solves the inverse distortion once per pixel, after that applying it is a
+// table walk with fixed point bilinear filtering. The table is stored tile by tile so both the
+// table and the source rows of one tile stay in cache, and tiles are processed in parallel.
+// The remap writes packed rgb8 directly, so it replaces the plain BGRA -> RGB conversion instead
+// of adding another frame copy.
+class CHARMTUNNELSIM_API FLensDistortionRemap
+{
+public:
+	// Size of the square tiles the output image is split into
+	static constexpr int32 TileSize = 64;
+
+	// Bits of sub pixel precision kept for the bilinear weights
+	static constexpr int32 FractionBits = 7;
+
+	void Build(int32 InWidth, int32 InHeight, const FCameraIntrinsics& Intrinsics, const FBrownConradyCoefficients& Coefficients);
+	void Reset();
+
+	bool IsValid() const { return Entries.Num() > 0; }
+	bool Matches(int32 InWidth, int32 InHeight) const { return IsValid() && Width == InWidth && Height == InHeight; }
+
+	// Remaps a BGRA frame of Width x Height pixels into Destination as packed rgb8 (Width * Height * 3 bytes)
+	void RemapToRGB8(const FColor* Source, uint8* Destination) const;
+
+private:
+	// One output pixel: top left source pixel of the bilinear footprint and its sub pixel offsets.
+	// Pixels that map outside the rendered image have SourceIndex INDEX_NONE and stay black.
+	struct FRemapEntry
+	{
+		int32 SourceIndex;
+		uint8 FracX;
+		uint8 FracY;
+	};
+
+	struct FRemapTile
+	{
+		int32 X;
+		int32 Y;
+		int32 SizeX;
+		int32 SizeY;
+		int32 FirstEntry;
+	};
+
+	void RemapTile(const FRemapTile& Tile, const FColor* Source, uint8* Destination) const;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	TArray<FRemapEntry> Entries;
+	TArray<FRemapTile> Tiles;
+};
+
+// Converts a BGRA frame into packed rgb8 without any remapping
+CHARMTUNNELSIM_API void ConvertBGRAToRGB8(const FColor* Source, uint8* Destination, int32 PixelCount);
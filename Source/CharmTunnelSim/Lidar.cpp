@@ -37,6 +37,11 @@ void ALidar::BeginPlay()
 
         // (Optional) Advertise the topic
         LidarDataTopic->Advertise();
+
+        // Same-host consumers can read the points from shared memory instead of rosbridge
+        if (Description.useSharedMemoryTransport) {
+            LidarDataTopic->EnableSharedMemoryTransport();
+        }
     }
 
     /// DATA FIELDS FOR POINTCLOUD
@@ -106,6 +111,11 @@ void ALidar::Tick(float DeltaTime)
 
         // (Optional) Advertise the topic
         LidarDataTopic->Advertise();
+
+        // Same-host consumers can read the points from shared memory instead of rosbridge
+        if (Description.useSharedMemoryTransport) {
+            LidarDataTopic->EnableSharedMemoryTransport();
+        }
     }
 
     SimulateLidar(DeltaTime);
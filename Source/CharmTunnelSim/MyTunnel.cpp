@@ -13,6 +13,9 @@ AMyTunnel::AMyTunnel()
 	Spline = CreateDefaultSubobject<USplineComponent>(TEXT("Spline"));
 	Spline->SetupAttachment(RootComponent);
 	Spline->bEditableWhenInherited = true;
+
+	// Collision of updated sections is cooked off the game thread so editing the spline stays responsive
+	ProceduralMesh->bUseAsyncCooking = true;
 }
 
 void AMyTunnel::BeginPlay()
@@ -28,131 +31,166 @@ void AMyTunnel::OnConstruction(const FTransform& Transform)
 
 void AMyTunnel::UpdateTunnel(float TunnelWidth, float TunnelHeight, float SurfaceVariation, UTexture2D* SurfaceTexture, int32 Resolution, int32 SubsectionCount)
 {
-	// Determine the starting spline point to update.
-	int32 StartSplinePoint = FMath::Max(0, Spline->GetNumberOfSplinePoints() - 4);
+	TRACE_CPUPROFILER_EVENT_SCOPE(AMyTunnel::UpdateTunnel);
+
+	SubsectionCount = FMath::Max(SubsectionCount, 1);
+	const int32 RingResolution = FMath::Max(Resolution + 1, 1);
+	const int32 NumSegments = FMath::Max(Spline->GetNumberOfSplinePoints() - 1, 0);
+	const int32 NewSectionCount = NumSegments * SubsectionCount;
+
+	// Profile and triangles are the same for every section
+	FTunnelRingProfile Profile;
+	BuildProfile(TunnelWidth, TunnelHeight, RingResolution, Profile);
+	TArray<int32> Triangles;
+	BuildTriangles(RingResolution, Triangles);
+
+	uint32 NewProfileHash = GetTypeHash(TunnelWidth);
+	NewProfileHash = HashCombine(NewProfileHash, GetTypeHash(TunnelHeight));
+	NewProfileHash = HashCombine(NewProfileHash, GetTypeHash(RingResolution));
+	NewProfileHash = HashCombine(NewProfileHash, GetTypeHash(SubsectionCount));
+	const bool bRebuildAll = NewProfileHash != ProfileHash;
+
+	// One frame per subsection boundary, the end of a section is the start of the next one
+	TArray<FTunnelRingFrame> NewFrames;
+	NewFrames.SetNum(NewSectionCount > 0 ? NewSectionCount + 1 : 0);
+	for (int32 Ring = 0; Ring < NewFrames.Num(); ++Ring)
+	{
+		int32 SplineIndex = Ring / SubsectionCount;
+		int32 Subsection = Ring % SubsectionCount;
+		float Alpha = static_cast<float>(SplineIndex) + (static_cast<float>(Subsection) / SubsectionCount);
+		NewFrames[Ring] = FTunnelRingFrame::FromSpline(Spline, Alpha);
+	}
 
-	// Generate mesh sections for each spline segment with subsections.
-	for (int32 i = StartSplinePoint; i < Spline->GetNumberOfSplinePoints() - 1; ++i)
+	for (int32 MeshSectionIndex = 0; MeshSectionIndex < NewSectionCount; ++MeshSectionIndex)
 	{
-		for (int32 j = 0; j < Subsections; ++j)
+		// Keep sections whose frames did not move
+		bool bUnchanged = !bRebuildAll && MeshSectionIndex < SectionCount && RingFrames.IsValidIndex(MeshSectionIndex + 1)
+			&& RingFrames[MeshSectionIndex] == NewFrames[MeshSectionIndex] && RingFrames[MeshSectionIndex + 1] == NewFrames[MeshSectionIndex + 1];
+		FProcMeshSection* Section = ProceduralMesh->GetProcMeshSection(MeshSectionIndex);
+		if (!bUnchanged || !Section || Section->ProcVertexBuffer.Num() == 0)
+		{
+			GenerateMeshSection(MeshSectionIndex, Profile, NewFrames[MeshSectionIndex], NewFrames[MeshSectionIndex + 1], Triangles);
+		}
+		if (ProceduralMesh->GetMaterial(MeshSectionIndex) != TunnelMaterial)
 		{
-			// Calculate the start and end alpha for the current subsection.
-			float StartAlpha = (static_cast<float>(i) + (static_cast<float>(j) / SubsectionCount));
-			float EndAlpha = (static_cast<float>(i) + ((static_cast<float>(j) + 1) / SubsectionCount));
+			ProceduralMesh->SetMaterial(MeshSectionIndex, TunnelMaterial);
+		}
+	}
+
+	// Sections the tunnel no longer reaches stay in the component for reuse but are emptied
+	for (int32 MeshSectionIndex = NewSectionCount; MeshSectionIndex < FMath::Max(SectionCount, ProceduralMesh->GetNumSections()); ++MeshSectionIndex)
+	{
+		ProceduralMesh->ClearMeshSection(MeshSectionIndex);
+	}
 
-			// Generate a unique mesh section index using the spline point index and subsection index.
-			int32 MeshSectionIndex = i * Subsections + j;
+	SectionCount = NewSectionCount;
+	RingFrames = MoveTemp(NewFrames);
+	ProfileHash = NewProfileHash;
+}
 
-			GenerateMeshSection(MeshSectionIndex, i, TunnelWidth, TunnelHeight, SurfaceVariation, SurfaceTexture, Resolution + 1, StartAlpha, EndAlpha);
-			SectionCount++;
-		}
+void AMyTunnel::BuildProfile(float TunnelWidth, float TunnelHeight, int32 Resolution, FTunnelRingProfile& OutProfile)
+{
+	OutProfile.Reset((Resolution + 1) * 2);
+
+	// Walls and roof
+	for (int32 i = 0; i <= Resolution; ++i)
+	{
+		float Ratio = static_cast<float>(i) / Resolution;
+		float VerticalAngle = FMath::Lerp(0.0f, PI, Ratio);
+
+		// Calculate the height and width based on the vertical angle
+		float CustomHeight = TunnelHeight * FMath::Sin(VerticalAngle);
+		float CustomWidth = TunnelWidth * 0.5f * FMath::Cos(VerticalAngle);
+
+		FVector2D RadialOffset(CustomWidth, -CustomHeight);
+		OutProfile.AddPoint(RadialOffset, -RadialOffset.GetSafeNormal(), Ratio);
+	}
+
+	// Bottom
+	for (int32 i = 0; i <= Resolution; ++i)
+	{
+		float Ratio = static_cast<float>(i) / Resolution;
+		float HorizontalAngle = Ratio * PI * 2.0f;
+
+		OutProfile.AddPoint(FVector2D(TunnelWidth * 0.5f * FMath::Cos(HorizontalAngle), 0.0f), FVector2D(0.0f, -1.0f), Ratio);
 	}
 }
 
-void AMyTunnel::GenerateMeshSection(int32 MeshSectionIndex, int32 SplineIndex, float TunnelWidth, float TunnelHeight, float SurfaceVariation, UTexture2D* SurfaceTexture, int32 Resolution, float StartAlpha, float EndAlpha)
+void AMyTunnel::BuildTriangles(int32 Resolution, TArray<int32>& OutTriangles)
 {
-	// Generate vertices, normals, UVs, and tangents for the current spline segment.
-	TArray<FVector> Vertices;
-	TArray<FVector> Normals;
-	TArray<FVector2D> UVs;
-	TArray<FProcMeshTangent> Tangents;
-	GenerateSectionVertices(SplineIndex, StartAlpha, EndAlpha, Width, Height, Resolution, Vertices, Normals, UVs, Tangents);
+	OutTriangles.Reset((Resolution * 2 - 1) * 6);
 
 	// Generate triangles for the outer walls.
-	TArray<int32> Triangles;
 	for (int32 i = 0; i < Resolution; ++i)
 	{
 		int32 VertexIndex = i * 2;
 
-		Triangles.Add(VertexIndex);
-		Triangles.Add(VertexIndex + 1);
-		Triangles.Add(VertexIndex + 2);
+		OutTriangles.Add(VertexIndex);
+		OutTriangles.Add(VertexIndex + 1);
+		OutTriangles.Add(VertexIndex + 2);
 
-		Triangles.Add(VertexIndex + 1);
-		Triangles.Add(VertexIndex + 3);
-		Triangles.Add(VertexIndex + 2);
+		OutTriangles.Add(VertexIndex + 1);
+		OutTriangles.Add(VertexIndex + 3);
+		OutTriangles.Add(VertexIndex + 2);
 	}
 
 	// Generate triangles for the bottom.
-	int32 NumBottomVertices = (Resolution + 1) * 2;
 	int32 Offset = (Resolution + 1) * 2;
 	for (int32 i = 0; i < Resolution - 1; ++i)
 	{
 		int32 VertexIndex = i * 2;
 
-		Triangles.Add(Offset + VertexIndex);
-		Triangles.Add(Offset + VertexIndex + 2);
-		Triangles.Add(Offset + VertexIndex + 1);
+		OutTriangles.Add(Offset + VertexIndex);
+		OutTriangles.Add(Offset + VertexIndex + 2);
+		OutTriangles.Add(Offset + VertexIndex + 1);
 
-		Triangles.Add(Offset + VertexIndex + 1);
-		Triangles.Add(Offset + VertexIndex + 2);
-		Triangles.Add(Offset + VertexIndex + 3);
+		OutTriangles.Add(Offset + VertexIndex + 1);
+		OutTriangles.Add(Offset + VertexIndex + 2);
+		OutTriangles.Add(Offset + VertexIndex + 3);
 	}
-
-	// Create the mesh section and enable collision.
-	ProceduralMesh->CreateMeshSection(MeshSectionIndex, Vertices, Triangles, Normals, UVs, TArray<FColor>(), Tangents, true);
-	// Set the material of the new section.
-	ProceduralMesh->SetMaterial(MeshSectionIndex, TunnelMaterial);
-
 }
 
-void AMyTunnel::GenerateSectionVertices(int32 SplineIndex, float StartAlpha, float EndAlpha, float TunnelWidth, float TunnelHeight, int32 Resolution, TArray<FVector>& Vertices, TArray<FVector>& Normals, TArray<FVector2D>& UVs, TArray<FProcMeshTangent>& Tangents)
+void AMyTunnel::GenerateMeshSection(int32 MeshSectionIndex, const FTunnelRingProfile& Profile, const FTunnelRingFrame& Start, const FTunnelRingFrame& End, const TArray<int32>& Triangles)
 {
-	// Get the starting and ending spline points using the alpha values.
-	FVector StartLocation = Spline->GetLocationAtSplineInputKey(StartAlpha, ESplineCoordinateSpace::Local);
-	FVector EndLocation = Spline->GetLocationAtSplineInputKey(EndAlpha, ESplineCoordinateSpace::Local);
-
-	// Calculate the forward, right, and up vectors for both spline points.
-	FVector StartForward = Spline->GetDirectionAtSplineInputKey(StartAlpha, ESplineCoordinateSpace::Local);
-	FVector EndForward = Spline->GetDirectionAtSplineInputKey(EndAlpha, ESplineCoordinateSpace::Local);
-	FVector StartRight = FVector::CrossProduct(StartForward, FVector::UpVector).GetSafeNormal();
-	FVector EndRight = FVector::CrossProduct(EndForward, FVector::UpVector).GetSafeNormal();
-	FVector StartUp = FVector::CrossProduct(StartForward, StartRight).GetSafeNormal();
-	FVector EndUp = FVector::CrossProduct(EndForward, EndRight).GetSafeNormal();
-
-	// Generate vertices for the tunnel based on the custom shape.
-	for (int32 i = 0; i <= Resolution; ++i)
-	{
-		float Ratio = static_cast<float>(i) / Resolution;
-		float VerticalAngle = FMath::Lerp(0.0f, PI, Ratio);
-
-		// Calculate the height and width based on the vertical angle
-		float CustomHeight = Height * FMath::Sin(VerticalAngle);
-		float CustomWidth = Width * 0.5f * FMath::Cos(VerticalAngle);
-
-		FVector StartRadialOffset = StartRight * CustomWidth - StartUp * CustomHeight;
-		FVector EndRadialOffset = EndRight * CustomWidth - EndUp * CustomHeight;
-
-		Vertices.Add(StartLocation + StartRadialOffset);
-		Normals.Add(-StartRadialOffset.GetSafeNormal());
-		UVs.Add(FVector2D(Ratio, 1.0f));
-
-		Vertices.Add(EndLocation + EndRadialOffset);
-		Normals.Add(-EndRadialOffset.GetSafeNormal());
-		UVs.Add(FVector2D(Ratio, 0.0f));
+	// Generate vertices, normals, UVs, and tangents for the current spline segment.
+	TArray<FVector> Vertices;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FProcMeshTangent> Tangents;
+	GenerateSectionVertices(Profile, Start, End, Vertices, Normals, UVs, Tangents);
 
-		Tangents.Add(FProcMeshTangent(StartForward, false));
-		Tangents.Add(FProcMeshTangent(EndForward, false));
+	// A section of the same size is updated in place, which keeps its buffers and skips setting it up again
+	FProcMeshSection* Section = ProceduralMesh->GetProcMeshSection(MeshSectionIndex);
+	if (Section && Section->ProcVertexBuffer.Num() == Vertices.Num() && Section->ProcIndexBuffer.Num() == Triangles.Num())
+	{
+		ProceduralMesh->UpdateMeshSection(MeshSectionIndex, Vertices, Normals, UVs, TArray<FColor>(), Tangents);
 	}
-
-	// Add bottom vertices
-	for (int32 i = 0; i <= Resolution; ++i)
+	else
 	{
-		float Ratio = static_cast<float>(i) / Resolution;
-		float HorizontalAngle = Ratio * PI * 2.0f;
-
-		FVector StartRadialOffset = StartRight * (Width * 0.5f * FMath::Cos(HorizontalAngle));
-		FVector EndRadialOffset = EndRight * (Width * 0.5f * FMath::Cos(HorizontalAngle));
-
-		Vertices.Add(StartLocation + StartRadialOffset);
-		Normals.Add(-StartUp);
-		UVs.Add(FVector2D(Ratio, 1.0f));
-		Tangents.Add(FProcMeshTangent(StartForward, false));
+		ProceduralMesh->CreateMeshSection(MeshSectionIndex, Vertices, Triangles, Normals, UVs, TArray<FColor>(), Tangents, true);
+	}
+}
 
-		Vertices.Add(EndLocation + EndRadialOffset);
-		Normals.Add(-EndUp);
-		UVs.Add(FVector2D(Ratio, 0.0f));
-		Tangents.Add(FProcMeshTangent(EndForward, false));
+void AMyTunnel::GenerateSectionVertices(const FTunnelRingProfile& Profile, const FTunnelRingFrame& Start, const FTunnelRingFrame& End, TArray<FVector>& Vertices, TArray<FVector>& Normals, TArray<FVector2D>& UVs, TArray<FProcMeshTangent>& Tangents)
+{
+	// Start and end ring are interleaved, vertex 2 * i is profile point i at the start and 2 * i + 1 at the end
+	const int32 NumVertices = Profile.Num() * 2;
+	Vertices.SetNumUninitialized(NumVertices);
+	Normals.SetNumUninitialized(NumVertices);
+	UVs.SetNumUninitialized(NumVertices);
+	Tangents.SetNumUninitialized(NumVertices);
+
+	FTunnelRingSweep::SweepRing(Profile, Start, Vertices.GetData(), Normals.GetData(), 2);
+	FTunnelRingSweep::SweepRing(Profile, End, Vertices.GetData() + 1, Normals.GetData() + 1, 2);
+
+	const FProcMeshTangent StartTangent(Start.Forward, false);
+	const FProcMeshTangent EndTangent(End.Forward, false);
+	for (int32 i = 0; i < Profile.Num(); ++i)
+	{
+		UVs[i * 2] = FVector2D(Profile.U[i], 1.0f);
+		UVs[i * 2 + 1] = FVector2D(Profile.U[i], 0.0f);
+		Tangents[i * 2] = StartTangent;
+		Tangents[i * 2 + 1] = EndTangent;
 	}
 }
 
@@ -6,6 +6,7 @@
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
 #include "Components/SplineComponent.h"
+#include "TunnelRingSweep.h"
 #include "MyTunnel.generated.h"
 
 
@@ -42,12 +43,20 @@ public:
 	void AddIntersection();
 
 	void UpdateTunnel(float TunnelWidth, float TunnelHeight, float SurfaceVariation, UTexture2D* SurfaceTexture, int32 Resolution, int32 SubsectionCount);
-	void GenerateMeshSection(int32 MeshSectionIndex, int32 SplineIndex, float TunnelWidth, float TunnelHeight, float SurfaceVariation, UTexture2D* SurfaceTexture, int32 Resolution, float StartAlpha, float EndAlpha);
-	void GenerateSectionVertices(int32 SplineIndex, float StartAlpha, float EndAlpha, float TunnelWidth, float TunnelHeight, int32 Resolution, TArray<FVector>& Vertices, TArray<FVector>& Normals, TArray<FVector2D>& UVs, TArray<FProcMeshTangent>& Tangents);
+	void GenerateMeshSection(int32 MeshSectionIndex, const FTunnelRingProfile& Profile, const FTunnelRingFrame& Start, const FTunnelRingFrame& End, const TArray<int32>& Triangles);
+	void GenerateSectionVertices(const FTunnelRingProfile& Profile, const FTunnelRingFrame& Start, const FTunnelRingFrame& End, TArray<FVector>& Vertices, TArray<FVector>& Normals, TArray<FVector2D>& UVs, TArray<FProcMeshTangent>& Tangents);
+	// Arch of the walls and roof followed by the floor, Resolution + 1 points each
+	static void BuildProfile(float TunnelWidth, float TunnelHeight, int32 Resolution, FTunnelRingProfile& OutProfile);
+	static void BuildTriangles(int32 Resolution, TArray<int32>& OutTriangles);
 	AMyTunnel* CreateIntersection(float BranchingAngle);
 
 private:
-	int32 SectionCount;
+	// Frames at the subsection boundaries the sections were generated from. Sections between
+	// frames that did not move are kept as they are when the tunnel is updated again
+	TArray<FTunnelRingFrame> RingFrames;
+	uint32 ProfileHash = 0;
+	// Mesh sections in use, sections after these are cleared and reused when the tunnel grows again
+	int32 SectionCount = 0;
 };
 
 
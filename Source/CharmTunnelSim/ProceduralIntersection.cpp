@@ -1,8 +1,38 @@
 
 #include "ProceduralIntersection.h"
 #include "ProceduralTunnel.h"
+#include "IntersectionVertexKernel.h"
+#include "TunnelOccupancySubsystem.h"
+#include "TunnelGenerationStats.h"
 #include "Components/StaticMeshComponent.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Materials/MaterialInterface.h"
+#include "UObject/ConstructorHelpers.h"
+#include "EngineUtils.h"
+
+static TAutoConsoleVariable<bool> CVarIntersectionKernel(
+	TEXT("tunnel.Intersection.Kernel"), true,
+	TEXT("Generate intersection vertices with the parallel kernel, otherwise with the serial loop."));
+
+static FAutoConsoleCommandWithWorld VerifyIntersectionKernelCommand(
+	TEXT("tunnel.Intersection.VerifyKernel"),
+	TEXT("Generates every intersection in the world with the serial loop and the parallel kernel for all intersection types and checks the vertices match within the error of the baked roundness curve."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (!World) {
+			return;
+		}
+
+		int32 checkedCount = 0;
+		int32 failedCount = 0;
+		for (TActorIterator<AProceduralIntersection> It(World); It; ++It) {
+			checkedCount++;
+			if (!It->VerifyVertexKernel()) {
+				failedCount++;
+			}
+		}
+		UE_LOG(LogTemp, Log, TEXT("Intersection vertex kernel: %d of %d intersections match the serial loop."), checkedCount - failedCount, checkedCount);
+	}));
 
 
 // Sets default values
@@ -11,6 +41,11 @@ AProceduralIntersection::AProceduralIntersection()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// Same materials the Blueprint MakeMesh assigned, subclasses can override them
+	static ConstructorHelpers::FObjectFinder<UMaterialInterface> groundMaterialFinder(TEXT("/Game/Charm/Materials/Tunnel/Ground/M_TunnelGround_Inst.M_TunnelGround_Inst"));
+	static ConstructorHelpers::FObjectFinder<UMaterialInterface> wallMaterialFinder(TEXT("/Game/Charm/Materials/Tunnel/Wall/M_TunnelWall_Inst.M_TunnelWall_Inst"));
+	groundMaterial = groundMaterialFinder.Object;
+	wallMaterial = wallMaterialFinder.Object;
 }
 
 // Called when the game starts or when spawned
@@ -74,16 +109,124 @@ void AProceduralIntersection::ClearArrays()
 	groundVertices.Empty();
 	wallUV.Empty();
 	groundUV.Empty();
+	nativeWallTriangles.Empty();
+	nativeGroundTriangles.Empty();
+	nativeWallNormals.Empty();
+	nativeGroundNormals.Empty();
+	nativeWallTangents.Empty();
+	nativeGroundTangents.Empty();
 	//lastStraightRoofVertices.Empty();
 }
 
 // Generate Intersection to right and straight
 void AProceduralIntersection::IntersectionGenerationLoop() 
 {
+	UpdateDeformationField();
+	{
+		TUNNEL_GENERATION_PHASE_SCOPE(VertexGeneration);
+		if (CVarIntersectionKernel.GetValueOnGameThread()) {
+			GenerateVertices();
+		}
+		else {
+			GenerateVerticesReference();
+		}
+	}
+
+	if (useNativeMeshBuilder) {
+		// The Blueprint graph fills groundUV and wallUV, the native builder only adds UVs that are missing
+		if (UsesBlueprintUVs()) {
+			MakeMeshTriangles();
+		}
+		MakeMeshTriangles_Implementation();
+		MakeMeshTangentsAndNormals_Implementation();
+		MakeMesh_Implementation();
+	}
+	else {
+		MakeMeshTriangles();
+		MakeMeshTangentsAndNormals();
+		MakeMesh();
+	}
+	if(!isUpdate) 
+	{
+		AddContinuationTunnels();
+	}
+}
+
+// Copy the loop parameters into the kernel and append what it generated, the same way the serial loop appends to the arrays
+void AProceduralIntersection::GenerateVertices()
+{
+	FIntersectionKernelInput input;
+	input.Type = intersectionType;
+	input.NumberOfHorizontalPoints = numberOfHorizontalPoints;
+	input.NumberOfVerticalPoints = numberOfVerticalPoints;
+	input.LoopAroundTunnelLastIndex = loopAroundTunnelLastIndex;
+	input.HorizontalPointSize = horizontalPointSize;
+	input.VerticalPointSize = verticalPointSize;
+	input.SurfaceVariation = surfaceVariation;
+	input.TunnelRoundValue = tunnelRoundValue;
+	input.MaxWallDeformation = maxWallDeformation;
+	input.MaxFloorDeformation = maxFloorDeformation;
+	input.DeformationField = deformationField.Get();
+	bakedRoundnessCurve.Bake(roundnessCurve);
+	input.Roundness.Build(bakedRoundnessCurve, numberOfHorizontalPoints, numberOfVerticalPoints);
+	input.FirstVertice = firstVertice;
+	if (groundVertices.Num() > 0) {
+		input.ExistingFirstGround = groundVertices[0];
+	}
+	if (IsValid(parentTunnel)) {
+		input.HasParent = true;
+		if (parentTunnel->meshEnds.Num() > 0) {
+			const FMeshSectionEnd& parentEnd = parentTunnel->meshEnds.Last();
+			input.ParentGround.Reserve(parentEnd.GroundVertives.Num());
+			for (const FVector& vertex : parentEnd.GroundVertives) {
+				input.ParentGround.Add(TransformVertex(vertex));
+			}
+			input.ParentWall.Reserve(parentEnd.WallVertices.Num());
+			for (const FVector& vertex : parentEnd.WallVertices) {
+				input.ParentWall.Add(TransformVertex(vertex));
+			}
+		}
+	}
+
+	FIntersectionKernelOutput output;
+	FIntersectionVertexKernel::Generate(input, output);
+
+	groundVertices.Append(output.GroundVertices);
+	wallVertices.Append(output.WallVertices);
+	lastRightWallVertices.Append(output.LastRightWallVertices);
+	lastLeftWallVertices.Append(output.LastLeftWallVertices);
+	lastStraightRoofVertices.Append(output.LastStraightRoofVertices);
+	lastRightRoofVertices.Append(output.LastRightRoofVertices);
+	lastLeftRoofVertices.Append(output.LastLeftRoofVertices);
+	lastRightFloorVertices.Append(output.LastRightFloorVertices);
+	lastStraightFloorVertices.Append(output.LastStraightFloorVertices);
+	lastLeftFloorVertices.Append(output.LastLeftFloorVertices);
+
+	// Leave the loop members as the serial loop does, Blueprints may read them after generation
+	forwarLoopIndex = FMath::Max(numberOfHorizontalPoints, 0);
+	if (numberOfHorizontalPoints > 0 && loopAroundTunnelLastIndex >= 0) {
+		loopAroundTunnelCurrentIndex = loopAroundTunnelLastIndex + 1;
+		surfaceIndex = output.SurfaceIndex;
+		latestVertice = output.LatestVertice;
+		firstVertice = output.FirstVertice;
+	}
+
+	if (intersectionType == IntersectionType::RightLeft) {
+		FIntersectionVertexKernel::AppendEndWall(input, lastStraightRoofVertices, lastStraightFloorVertices, latestVertice, wallVertices, lastRightWallVertices, lastLeftWallVertices);
+	}
+}
+
+// Generate the vertices one at a time around the intersection, row after row
+void AProceduralIntersection::GenerateVerticesReference()
+{
+	deformValues.SetNumUninitialized(loopAroundTunnelLastIndex + 1);
+
 	// Forward loop is the size of points in width
 	for (forwarLoopIndex = 0; forwarLoopIndex < numberOfHorizontalPoints; forwarLoopIndex++)
 	{
 		latestVertice = FVector((float)forwarLoopIndex * horizontalPointSize, 0.0f, 0.0f);
+		// Read deformation of the whole loop around the intersection at once
+		deformationField->SampleColumn(forwarLoopIndex, 0, deformValues.Num(), deformValues.GetData());
 		// Around tunnel loop
 		for (loopAroundTunnelCurrentIndex = 0; loopAroundTunnelCurrentIndex <= loopAroundTunnelLastIndex; loopAroundTunnelCurrentIndex++)
 		{
@@ -143,13 +286,249 @@ void AProceduralIntersection::IntersectionGenerationLoop()
 			}
 		}
 	}
-	MakeMeshTriangles();
-	MakeMeshTangentsAndNormals();
-	MakeMesh();
-	if(!isUpdate) 
-	{
-		AddContinuationTunnels();
+}
+
+bool AProceduralIntersection::VerifyVertexKernel()
+{
+	if (!IsValid(roundnessCurve) || numberOfHorizontalPoints < 2 || numberOfVerticalPoints < 1 || (IsValid(parentTunnel) && parentTunnel->meshEnds.Num() == 0)) {
+		UE_LOG(LogTemp, Warning, TEXT("%s: intersection is not set up for generation, vertex kernel not verified."), *GetName());
+		return true;
+	}
+
+	static const TCHAR* arrayNames[] = {
+		TEXT("groundVertices"), TEXT("wallVertices"), TEXT("lastRightWallVertices"), TEXT("lastLeftWallVertices"), TEXT("lastStraightRoofVertices"),
+		TEXT("lastRightRoofVertices"), TEXT("lastLeftRoofVertices"), TEXT("lastRightFloorVertices"), TEXT("lastStraightFloorVertices"), TEXT("lastLeftFloorVertices") };
+	TArray<FVector>* arrays[] = {
+		&groundVertices, &wallVertices, &lastRightWallVertices, &lastLeftWallVertices, &lastStraightRoofVertices,
+		&lastRightRoofVertices, &lastLeftRoofVertices, &lastRightFloorVertices, &lastStraightFloorVertices, &lastLeftFloorVertices };
+	const int32 arrayCount = UE_ARRAY_COUNT(arrays);
+
+	// Everything the loops change is put back at the end
+	TArray<TArray<FVector>> savedArrays;
+	for (int32 i = 0; i < arrayCount; i++) {
+		savedArrays.Add(*arrays[i]);
+	}
+	TEnumAsByte<IntersectionType> savedType = intersectionType;
+	int32 savedLastIndex = loopAroundTunnelLastIndex;
+	FVector savedLatestVertice = latestVertice;
+	FVector savedFirstVertice = firstVertice;
+	int32 savedSurfaceIndex = surfaceIndex;
+	int32 savedForwardIndex = forwarLoopIndex;
+	int32 savedAroundIndex = loopAroundTunnelCurrentIndex;
+
+	bool matching = true;
+	const IntersectionType types[] = { IntersectionType::Right, IntersectionType::Left, IntersectionType::All, IntersectionType::RightLeft };
+	for (IntersectionType type : types) {
+		intersectionType = type;
+		if (type == IntersectionType::Right || type == IntersectionType::Left) {
+			loopAroundTunnelLastIndex = numberOfHorizontalPoints * 2 + numberOfVerticalPoints - 1;
+		}
+		else {
+			loopAroundTunnelLastIndex = numberOfHorizontalPoints * 2 - 1;
+		}
+		UpdateDeformationField();
+
+		// Both paths start from empty arrays and the same loop state
+		TArray<TArray<FVector>> referenceArrays;
+		for (int32 i = 0; i < arrayCount; i++) {
+			arrays[i]->Reset();
+		}
+		firstVertice = savedFirstVertice;
+		GenerateVerticesReference();
+		for (int32 i = 0; i < arrayCount; i++) {
+			referenceArrays.Add(MoveTemp(*arrays[i]));
+			arrays[i]->Reset();
+		}
+		FVector referenceLatestVertice = latestVertice;
+		FVector referenceFirstVertice = firstVertice;
+
+		firstVertice = savedFirstVertice;
+		GenerateVertices();
+		// Roundness moves a vertex by at most the rounding value, so the bake error scales with it
+		const double tolerance = (double)FMath::Max(bakedRoundnessCurve.GetMeasuredError(), FBakedCurve::DefaultMaxError) * FMath::Abs(tunnelRoundValue) + KINDA_SMALL_NUMBER;
+		for (int32 i = 0; i < arrayCount; i++) {
+			const TArray<FVector>& reference = referenceArrays[i];
+			const TArray<FVector>& generated = *arrays[i];
+			if (reference.Num() != generated.Num()) {
+				UE_LOG(LogTemp, Error, TEXT("%s type %d: %s has %d vertices, serial loop made %d."), *GetName(), (int32)type, arrayNames[i], generated.Num(), reference.Num());
+				matching = false;
+				continue;
+			}
+			for (int32 v = 0; v < reference.Num(); v++) {
+				if (!reference[v].Equals(generated[v], tolerance)) {
+					UE_LOG(LogTemp, Error, TEXT("%s type %d: %s[%d] is %s, serial loop made %s."), *GetName(), (int32)type, arrayNames[i], v, *generated[v].ToString(), *reference[v].ToString());
+					matching = false;
+					break;
+				}
+			}
+		}
+		if (!referenceLatestVertice.Equals(latestVertice, tolerance) || !referenceFirstVertice.Equals(firstVertice, tolerance)) {
+			UE_LOG(LogTemp, Error, TEXT("%s type %d: loop state after generation differs from the serial loop."), *GetName(), (int32)type);
+			matching = false;
+		}
 	}
+
+	for (int32 i = 0; i < arrayCount; i++) {
+		*arrays[i] = MoveTemp(savedArrays[i]);
+	}
+	intersectionType = savedType;
+	loopAroundTunnelLastIndex = savedLastIndex;
+	latestVertice = savedLatestVertice;
+	firstVertice = savedFirstVertice;
+	surfaceIndex = savedSurfaceIndex;
+	forwarLoopIndex = savedForwardIndex;
+	loopAroundTunnelCurrentIndex = savedAroundIndex;
+	UpdateDeformationField();
+
+	if (matching) {
+		UE_LOG(LogTemp, Log, TEXT("%s: vertex kernel matches the serial loop for all intersection types."), *GetName());
+	}
+	return matching;
+}
+
+// Every forward step adds one row to the grids. The end wall of RightLeft intersection is its own grid after the roof
+void AProceduralIntersection::GetMeshGrids(TArray<FTunnelMeshGrid>& groundGrids, TArray<FTunnelMeshGrid>& wallGrids) const
+{
+	int32 rows = numberOfHorizontalPoints;
+	if (rows < 2) {
+		return;
+	}
+
+	if (groundVertices.Num() % rows == 0) {
+		groundGrids.Add(FTunnelMeshGrid(0, rows, groundVertices.Num() / rows));
+	}
+
+	if (intersectionType == IntersectionType::RightLeft) {
+		int32 roofVertices = rows * numberOfHorizontalPoints;
+		if (wallVertices.Num() == roofVertices + numberOfVerticalPoints * numberOfHorizontalPoints) {
+			wallGrids.Add(FTunnelMeshGrid(0, rows, numberOfHorizontalPoints));
+			wallGrids.Add(FTunnelMeshGrid(roofVertices, numberOfVerticalPoints, numberOfHorizontalPoints));
+		}
+	}
+	else if (wallVertices.Num() % rows == 0) {
+		wallGrids.Add(FTunnelMeshGrid(0, rows, wallVertices.Num() / rows));
+	}
+
+	if (groundGrids.Num() == 0 || wallGrids.Num() == 0) {
+		UE_LOG(LogTemp, Error, TEXT("Intersection vertices (%d ground, %d wall) do not form regular grids."), groundVertices.Num(), wallVertices.Num());
+	}
+}
+
+bool AProceduralIntersection::UsesBlueprintUVs() const
+{
+	return !useNativeUVs && GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AProceduralIntersection, MakeMeshTriangles));
+}
+
+// Build triangle indices of the intersection, UVs only if they are not already there for every vertex
+void AProceduralIntersection::MakeMeshTriangles_Implementation()
+{
+	TUNNEL_GENERATION_PHASE_SCOPE(Triangles);
+	TArray<FTunnelMeshGrid> groundGrids;
+	TArray<FTunnelMeshGrid> wallGrids;
+	GetMeshGrids(groundGrids, wallGrids);
+
+	nativeGroundTriangles.Reset();
+	nativeWallTriangles.Reset();
+	bool buildGroundUV = groundUV.Num() != groundVertices.Num();
+	bool buildWallUV = wallUV.Num() != wallVertices.Num();
+	if (buildGroundUV) {
+		groundUV.SetNumUninitialized(groundVertices.Num());
+	}
+	if (buildWallUV) {
+		wallUV.SetNumUninitialized(wallVertices.Num());
+	}
+	for (const FTunnelMeshGrid& grid : groundGrids) {
+		FTunnelMeshBuilder::AppendTriangles(grid, nativeGroundTriangles);
+		if (buildGroundUV) {
+			FTunnelMeshBuilder::ComputeUVs(groundVertices, grid, 200.0f, groundUV);
+		}
+	}
+	for (const FTunnelMeshGrid& grid : wallGrids) {
+		FTunnelMeshBuilder::AppendTriangles(grid, nativeWallTriangles);
+		if (buildWallUV) {
+			FTunnelMeshBuilder::ComputeUVs(wallVertices, grid, 200.0f, wallUV);
+		}
+	}
+}
+
+// Build smooth normals and tangents of the intersection
+void AProceduralIntersection::MakeMeshTangentsAndNormals_Implementation()
+{
+	TUNNEL_GENERATION_PHASE_SCOPE(Normals);
+	TArray<FTunnelMeshGrid> groundGrids;
+	TArray<FTunnelMeshGrid> wallGrids;
+	GetMeshGrids(groundGrids, wallGrids);
+
+	nativeGroundNormals.SetNumUninitialized(groundVertices.Num());
+	nativeGroundTangents.SetNumUninitialized(groundVertices.Num());
+	nativeWallNormals.SetNumUninitialized(wallVertices.Num());
+	nativeWallTangents.SetNumUninitialized(wallVertices.Num());
+	for (const FTunnelMeshGrid& grid : groundGrids) {
+		FTunnelMeshBuilder::ComputeNormalsAndTangents(groundVertices, grid, nativeGroundNormals, nativeGroundTangents);
+	}
+	for (const FTunnelMeshGrid& grid : wallGrids) {
+		FTunnelMeshBuilder::ComputeNormalsAndTangents(wallVertices, grid, nativeWallNormals, nativeWallTangents);
+	}
+}
+
+// Upload ground to section 0 and walls to section 1 of the intersection mesh
+void AProceduralIntersection::MakeMesh_Implementation()
+{
+	if (!IsValid(IntersectionMesh)) {
+		UE_LOG(LogTemp, Warning, TEXT("Intersection %s has no mesh component to build into."), *GetName());
+		return;
+	}
+	FTunnelMeshUpload::UploadSection(IntersectionMesh, 0, groundVertices, nativeGroundTriangles, nativeGroundNormals, groundUV, nativeGroundTangents);
+	FTunnelMeshUpload::UploadSection(IntersectionMesh, 1, wallVertices, nativeWallTriangles, nativeWallNormals, wallUV, nativeWallTangents);
+	if (groundMaterial) {
+		IntersectionMesh->SetMaterial(0, groundMaterial);
+	}
+	if (wallMaterial) {
+		IntersectionMesh->SetMaterial(1, wallMaterial);
+	}
+
+	if (UTunnelOccupancySubsystem* occupancy = GetWorld() ? GetWorld()->GetSubsystem<UTunnelOccupancySubsystem>() : nullptr) {
+		occupancy->MarkMeshDirty(IntersectionMesh);
+	}
+}
+
+// Make sure deformation values are decoded before generating vertices
+void AProceduralIntersection::UpdateDeformationField()
+{
+	int32 fieldWidth = numberOfHorizontalPoints;
+	int32 fieldHeight = loopAroundTunnelLastIndex + 1;
+
+	if (IsValid(deformTexture)) {
+		TSharedPtr<const FTunnelDeformationField> textureField = FTunnelDeformationField::FindOrDecode(deformTexture);
+		if (textureField.IsValid()) {
+			deformationField = textureField;
+			isDeformationFieldBaked = false;
+			return;
+		}
+	}
+
+	// Blueprint override is called once per texel here instead of once per vertex on every update
+	if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AProceduralIntersection, GetPixelValue))) {
+		if (!isDeformationFieldBaked || !deformationField.IsValid() || deformationField->GetWidth() != fieldWidth || deformationField->GetHeight() != fieldHeight) {
+			TSharedPtr<FTunnelDeformationField> bakedField = MakeShared<FTunnelDeformationField>();
+			bakedField->InitFromSampler(fieldWidth, fieldHeight, [this](int32 x, int32 y) { return GetPixelValue(x, y); });
+			deformationField = bakedField;
+			isDeformationFieldBaked = true;
+		}
+		return;
+	}
+
+	// Without a texture or override the surface is not deformed, noise is only used when asked for
+	deformationField = useProceduralDeformation ? FTunnelDeformationField::FindOrCreateProcedural(fieldWidth, fieldHeight) : FTunnelDeformationField::FindOrCreateFlat(fieldWidth, fieldHeight);
+	isDeformationFieldBaked = false;
+}
+
+void AProceduralIntersection::ResetDeformationField()
+{
+	// The texture may have been edited, decode it again instead of reusing the shared field
+	FTunnelDeformationField::Evict(deformTexture);
+	deformationField.Reset();
+	isDeformationFieldBaked = false;
 }
 
 void AProceduralIntersection::StoreVertice()
@@ -356,7 +735,7 @@ FVector AProceduralIntersection::GetFloorVertice()
 	}
 
 	// Apply deformation to the starting location
-	float pixelValue = GetPixelValue(forwarLoopIndex, loopAroundTunnelCurrentIndex);
+	float pixelValue = deformValues[loopAroundTunnelCurrentIndex];
 	// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 	float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 	float deform = FMath::Lerp(0.0f, maxFloorDeformation, surfaceVariation.X) * directionOfDeform;
@@ -384,7 +763,7 @@ FVector AProceduralIntersection::GetRightVertice()
 	float maxValue = FMath::Lerp(0.0f, maxWallDeformation, surfaceVariation.Y);
 
 	// Apply deformation to the starting location
-	float pixelValue = GetPixelValue(forwarLoopIndex, loopAroundTunnelCurrentIndex);
+	float pixelValue = deformValues[loopAroundTunnelCurrentIndex];
 	// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 	float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 	float deform = directionOfDeform * maxValue;
@@ -458,7 +837,7 @@ FVector AProceduralIntersection::GetRoofVertice()
 		// Calculate the amount of deform based on the texture value at this point.
 		float maxValue = FMath::Lerp(0.0f, maxWallDeformation, surfaceVariation.Y);
 		// Apply deformation to the starting location
-		float pixelValue = GetPixelValue(forwarLoopIndex, loopAroundTunnelCurrentIndex);
+		float pixelValue = deformValues[loopAroundTunnelCurrentIndex];
 		// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 		float deform = directionOfDeform * maxValue;
@@ -484,7 +863,7 @@ FVector AProceduralIntersection::GetRoofVertice()
 		// Calculate the amount of deform based on the texture value at this point.
 		float maxValue = FMath::Lerp(0.0f, maxWallDeformation, surfaceVariation.Y);
 		// Apply deformation to the starting location
-		float pixelValue = GetPixelValue(forwarLoopIndex, loopAroundTunnelCurrentIndex);
+		float pixelValue = deformValues[loopAroundTunnelCurrentIndex];
 		// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 		float deform = directionOfDeform * maxValue;
@@ -527,7 +906,7 @@ FVector AProceduralIntersection::GetLeftVertice()
 	float maxValue = FMath::Lerp(0.0f, maxWallDeformation, surfaceVariation.Y);
 
 	// Apply deformation to the starting location
-	float pixelValue = GetPixelValue(forwarLoopIndex, loopAroundTunnelCurrentIndex);
+	float pixelValue = deformValues[loopAroundTunnelCurrentIndex];
 	// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 	float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 	float deform = directionOfDeform * maxValue;
@@ -5,9 +5,14 @@
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
 #include "EnumContainer.h"
+#include "TunnelDeformationField.h"
+#include "BakedCurve.h"
+#include "TunnelMeshBuilder.h"
 #include "ProceduralIntersection.generated.h"
 
 class AProceduralTunnel;
+class UTexture2D;
+class UMaterialInterface;
 
 UCLASS()
 class CHARMTUNNELSIM_API AProceduralIntersection : public AActor
@@ -72,6 +77,19 @@ public:
 	TArray<FVector2D> wallUV;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	TArray<FVector2D> groundUV;
+	// Buffers of the native mesh builder, Blueprint subclasses keep their own triangle, normal and tangent variables
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Meshes")
+	TArray<int32> nativeWallTriangles;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Meshes")
+	TArray<int32> nativeGroundTriangles;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Meshes")
+	TArray<FVector> nativeWallNormals;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Meshes")
+	TArray<FVector> nativeGroundNormals;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Meshes")
+	TArray<FProcMeshTangent> nativeWallTangents;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Meshes")
+	TArray<FProcMeshTangent> nativeGroundTangents;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	FVector latestVertice;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
@@ -93,9 +111,26 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	UCurveFloat* roundnessCurve; 
+	// roundnessCurve sampled before the kernel fills its roundness table
+	FBakedCurve bakedRoundnessCurve;
 	float tunnelRoundValue = 100.0f; // HOW MUCH WE ADD ROUNDNESS TO TUNNEL
 	UFUNCTION(BlueprintImplementableEvent, Category = "Deformation")
 	float GetPixelValue(int32 x, int32 y);
+	// Noise texture decoded once into the deformation field. If not set a Blueprint GetPixelValue override is baked,
+	// otherwise the surface is not deformed unless useProceduralDeformation is set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+	UTexture2D* deformTexture;
+	// Deform with perlin noise when there is neither a texture nor a GetPixelValue override
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+	bool useProceduralDeformation = false;
+	// Drops the decoded deformation values so they are decoded again on next generation
+	UFUNCTION(BlueprintCallable, Category = "Deformation")
+	void ResetDeformationField();
+	void UpdateDeformationField();
+	TSharedPtr<const FTunnelDeformationField> deformationField;
+	bool isDeformationFieldBaked = false;
+	// Deformation values of the current loop around the intersection
+	TArray<float> deformValues;
 
 	// FUNCTIONS
 	UFUNCTION(BlueprintCallable)
@@ -104,6 +139,12 @@ public:
 	void SetValues(FVector2D scale, IntersectionType type, AProceduralTunnel* parent, FVector2D variation, bool update);
 	UFUNCTION(BlueprintCallable)
 	void IntersectionGenerationLoop();
+	// Fills the vertex arrays with FIntersectionVertexKernel, rows are generated in parallel
+	void GenerateVertices();
+	// Serial vertex loop the kernel was made from, used when tunnel.Intersection.Kernel is off and to verify the kernel
+	void GenerateVerticesReference();
+	// Generates the vertices with both paths for every intersection type and logs differences larger than the curve bake error, the intersection is left as it was
+	bool VerifyVertexKernel();
 	void StoreVertice();
 	int32 GetArrayIndex();
 	int32 GetSurfaceIndex();
@@ -115,12 +156,30 @@ public:
 	FVector GetLeftVertice();
 	FVector GetRoofVertice();
 
-	UFUNCTION(BlueprintImplementableEvent)
+	// Triangles, normals, tangents and the mesh upload are done in C++,
+	// Blueprint overrides are only called when useNativeMeshBuilder is turned off
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	bool useNativeMeshBuilder = true;
+	// Distance based UVs of the native builder. When off, UVs still come from a Blueprint MakeMeshTriangles override
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	bool useNativeUVs = false;
+	bool UsesBlueprintUVs() const;
+	// Materials of the ground (section 0) and wall (section 1) set by the native MakeMesh
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	UMaterialInterface* groundMaterial;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	UMaterialInterface* wallMaterial;
+	UFUNCTION(BlueprintNativeEvent)
 	void MakeMeshTriangles();
-	UFUNCTION(BlueprintImplementableEvent)
+	virtual void MakeMeshTriangles_Implementation();
+	UFUNCTION(BlueprintNativeEvent)
 	void MakeMeshTangentsAndNormals();
-	UFUNCTION(BlueprintImplementableEvent)
+	virtual void MakeMeshTangentsAndNormals_Implementation();
+	UFUNCTION(BlueprintNativeEvent)
 	void MakeMesh();
+	virtual void MakeMesh_Implementation();
+	// Returns the vertice grids of the ground and wall arrays for the current intersection type
+	void GetMeshGrids(TArray<FTunnelMeshGrid>& groundGrids, TArray<FTunnelMeshGrid>& wallGrids) const;
 	UFUNCTION(BlueprintImplementableEvent)
 	void AddContinuationTunnels();
 	
@@ -10,9 +10,45 @@
 #include "Components/StaticMeshComponent.h"
 #include "Math/UnrealMathVectorCommon.h"
 #include "Algo/Reverse.h"
+#include "Materials/MaterialInterface.h"
+#include "UObject/ConstructorHelpers.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "TunnelEndpointSubsystem.h"
+#include "TunnelOccupancySubsystem.h"
+#include "TunnelGenerationStats.h"
 
 using namespace std;
 
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkTunnelMeshBuilderCommand(
+	TEXT("tunnel.BenchmarkMeshBuilder"),
+	TEXT("Times the Blueprint triangle, normal and tangent graphs against the native builder on the first section of every tunnel in the world. Usage: tunnel.BenchmarkMeshBuilder [Iterations=20]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World) {
+			return;
+		}
+		int32 iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 20;
+
+		int32 tunnelCount = 0;
+		for (TActorIterator<AProceduralTunnel> It(World); It; ++It) {
+			double blueprintMs = 0.0;
+			double nativeMs = 0.0;
+			if (It->BenchmarkMeshBuilder(iterations, blueprintMs, nativeMs)) {
+				UE_LOG(LogTemp, Display, TEXT("%s: Blueprint %.3f ms, native %.3f ms per section (%.1fx)"),
+					*It->GetName(), blueprintMs, nativeMs, blueprintMs / FMath::Max(nativeMs, 1e-6));
+				tunnelCount++;
+			}
+		}
+		if (tunnelCount == 0) {
+			UE_LOG(LogTemp, Warning, TEXT("No tunnel with Blueprint mesh graphs and a generated section to benchmark."));
+		}
+	}));
+
 // Sets default values
 AProceduralTunnel::AProceduralTunnel()
 {
@@ -32,6 +68,14 @@ AProceduralTunnel::AProceduralTunnel()
 		loopAroundTunnelLastIndex = 80 - 1;
 	}
 
+	lodScreenSizes = { 1.0f, 0.3f, 0.12f, 0.05f };
+
+	// Same materials the Blueprint MakeMesh assigned, subclasses can override them
+	static ConstructorHelpers::FObjectFinder<UMaterialInterface> groundMaterialFinder(TEXT("/Game/Charm/Materials/Tunnel/Ground/M_TunnelGround_Inst.M_TunnelGround_Inst"));
+	static ConstructorHelpers::FObjectFinder<UMaterialInterface> wallMaterialFinder(TEXT("/Game/Charm/Materials/Tunnel/Wall/M_TunnelWall_Inst.M_TunnelWall_Inst"));
+	groundMaterial = groundMaterialFinder.Object;
+	wallMaterial = wallMaterialFinder.Object;
+
 	RootComponent = CreateDefaultSubobject<USceneComponent>("Root Scene Component");
 	RootComponent->SetMobility(EComponentMobility::Static);
 	SetRootComponent(RootComponent);
@@ -66,7 +110,40 @@ AProceduralTunnel::AProceduralTunnel()
 void AProceduralTunnel::BeginPlay()
 {
 	Super::BeginPlay();
-	
+	UpdateEndpoints();
+}
+
+// Runs in the editor whenever the tunnel is placed, moved or edited
+void AProceduralTunnel::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+	UpdateEndpoints();
+}
+
+void AProceduralTunnel::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Worker reads the actor, it must be done before the actor goes away
+	FinishAsyncGenerationLoop(true);
+	if (UTunnelEndpointSubsystem* endpoints = GetWorld() ? GetWorld()->GetSubsystem<UTunnelEndpointSubsystem>() : nullptr) {
+		endpoints->RemoveTunnel(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void AProceduralTunnel::Destroyed()
+{
+	FinishAsyncGenerationLoop(true);
+	if (UTunnelEndpointSubsystem* endpoints = GetWorld() ? GetWorld()->GetSubsystem<UTunnelEndpointSubsystem>() : nullptr) {
+		endpoints->RemoveTunnel(this);
+	}
+	Super::Destroyed();
+}
+
+void AProceduralTunnel::UpdateEndpoints()
+{
+	if (UTunnelEndpointSubsystem* endpoints = GetWorld() ? GetWorld()->GetSubsystem<UTunnelEndpointSubsystem>() : nullptr) {
+		endpoints->UpdateTunnel(this);
+	}
 }
 
 // Called every frame
@@ -74,6 +151,24 @@ void AProceduralTunnel::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	if (asyncGenerationPass.IsValid()) {
+		FinishAsyncGenerationLoop(false);
+	}
+	if (pendingMeshUploads.Num() > 0) {
+		UploadPendingMeshes(meshUploadBudgetMs / 1000.0);
+	}
+	if (lodCount > 1 || lodMeshes.Num() > 0 || meshSections.Num() > TunnelMeshes.Num()) {
+		UpdateMeshLods();
+	}
+	if (dirtyScatterSections.Num() > 0 || scatterRulesHash != FTunnelScatter::GetRulesHash(scatterRules, scatterSeed)) {
+		UpdateScatter();
+	}
+}
+
+// Tunnels are drawn in the editor viewport as well, queued uploads must not wait for play
+bool AProceduralTunnel::ShouldTickIfViewportsOnly() const
+{
+	return asyncGenerationPass.IsValid() || pendingMeshUploads.Num() > 0 || lodMeshes.Num() > TunnelMeshes.Num() * 3 || dirtyScatterSections.Num() > 0 || scatterRulesHash != FTunnelScatter::GetRulesHash(scatterRules, scatterSeed);
 }
 
 // Destroy the last mesh
@@ -110,40 +205,39 @@ void AProceduralTunnel::SnapToEndOfOtherSpline()
 	int32 lastIndex = SplineComponent->GetNumberOfSplinePoints() - 1;
 	FVector lastPointLocation = SplineComponent->GetLocationAtSplinePoint(lastIndex, ESplineCoordinateSpace::World);
 
-	// Retrieve all tunnel actors in the world
-	TArray<AActor*> FoundActors;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AProceduralTunnel::StaticClass(), FoundActors);
+	// Only tunnel ends near the end of this spline are looked at, not every tunnel in the world
+	UTunnelEndpointSubsystem* endpoints = GetWorld()->GetSubsystem<UTunnelEndpointSubsystem>();
+	TArray<FTunnelEndpoint> nearbyEnds;
+	if (endpoints) {
+		endpoints->FindEndpoints(lastPointLocation, maxDistanceToSnapSplineEnds, this, nearbyEnds);
+	}
 
 	// Initialize to the maximum allowed distance to find the closest tunnel within range.
 	float shortestDistance = maxDistanceToSnapSplineEnds;
+	FVector currentEndDirection = SplineComponent->GetDirectionAtSplinePoint(lastIndex, ESplineCoordinateSpace::World);
 
-	// Loop through all tunnels to find the closest valid one to connect to
-	for (AActor* tunnelActor : FoundActors)
+	// Loop through nearby tunnel ends to find the closest valid one to connect to
+	for (const FTunnelEndpoint& end : nearbyEnds)
 	{
-		// Safely cast the actor to AProceduralTunnel
-		AProceduralTunnel* tunnel = Cast<AProceduralTunnel>(tunnelActor);
-
-		// Skip if casting failed or if we're checking the current tunnel itself
+		AProceduralTunnel* tunnel = end.Tunnel.Get();
 		if (!tunnel || tunnel->SplineComponent == SplineComponent) continue;
 
-		// Determine which point of the tunnel to consider for snapping
-		USplineComponent* spline = tunnel->SplineComponent;
-		int32 splineIndexToSnap = (tunnel->tunnelType == TunnelType::StartTunnel) ? 0 : spline->GetNumberOfSplinePoints() - 1;
+		// Start tunnels are snapped to at their start, others at their end
+		bool snapToStart = tunnel->tunnelType == TunnelType::StartTunnel;
+		if (end.bIsStart != snapToStart) continue;
 
 		// Compute the distance and direction to the potential connecting point
-		FVector comparedPointLocation = spline->GetLocationAtSplinePoint(splineIndexToSnap, ESplineCoordinateSpace::World);
-		float distance = FVector::Distance(comparedPointLocation, lastPointLocation);
-		FVector currentEndDirection = SplineComponent->GetDirectionAtSplinePoint(lastIndex, ESplineCoordinateSpace::World);
-		FVector directionToOtherEnd = (comparedPointLocation - lastPointLocation).GetSafeNormal();
+		float distance = FVector::Distance(end.Location, lastPointLocation);
+		FVector directionToOtherEnd = (end.Location - lastPointLocation).GetSafeNormal();
 		float dotProduct = FVector::DotProduct(currentEndDirection, directionToOtherEnd);
 
 		// Update the closest tunnel details if this tunnel is a better match
 		if (distance < shortestDistance && dotProduct >= 0)
 		{
-			closestPoint = comparedPointLocation;
-			closestTangent = spline->GetTangentAtSplinePoint(splineIndexToSnap, ESplineCoordinateSpace::World);
+			closestPoint = end.Location;
+			closestTangent = end.Tangent;
 			closestTunnel = tunnel;
-			connectToStart = (splineIndexToSnap == 0);
+			connectToStart = end.bIsStart;
 			shortestDistance = distance;  // Update the shortest distance found
 		}
 	}
@@ -175,6 +269,7 @@ void AProceduralTunnel::SnapToEndOfOtherSpline()
 		connectedActor = nullptr;
 		isEndConnected = false;
 	}
+	UpdateEndpoints();
 }
 
 // This will control the addition of new spline points on drag event and remove when undoing or reseting
@@ -197,10 +292,14 @@ void AProceduralTunnel::ControlSplinePoints()
 	{
 		for(UProceduralMeshComponent* mesh : TunnelMeshes) 
 		{
-			mesh->DestroyComponent();
+			if (IsValid(mesh)) {
+				mesh->DestroyComponent();
+			}
 		}
 		TunnelMeshes.Empty();
 		meshEnds.Empty();
+		meshSections.Empty();
+		pendingMeshUploads.Empty();
 	}
 }
 
@@ -300,6 +399,13 @@ int32 AProceduralTunnel::CalculateRecreationStartIndex()
 	// But we also want to clamp base value to be in range of 0 - 2
 	// Draging the end of tunnel does not affect meshes after third mesh (index 2)
 	int32 baseMeshIndex = FMath::Clamp(lastMeshIndex, 0, 2);
+	// With incremental regeneration start from the first section whose spline frames moved instead,
+	// moved tangents can reach further back than three sections and clean sections in the range are skipped
+	if (useIncrementalRegeneration && useNativeMeshBuilder && generatedParamsHash == GetGenerationParamsHash()) {
+		UpdateSplineFrames();
+		int32 firstDirtySegment = splineFrames.GetFirstDirtySegment();
+		baseMeshIndex = firstDirtySegment == INDEX_NONE ? 0 : FMath::Clamp(lastMeshIndex - firstDirtySegment, 0, lastMeshIndex);
+	}
 	// This gives us extra offset if user has clicked tunnel end further 
 	// by clicking user can move tunnel end far away from original location
 	// by doing this there is much more caps between spline points where is no mesh created
@@ -320,37 +426,1153 @@ int32 AProceduralTunnel::CalculateRecreationStartIndex()
 	return indexOfMeshFromStartRecreation;
 }
 
+namespace
+{
+	// Every loop around the tunnel adds one row to the section grid
+	bool GetSectionGrid(int32 stepCount, const TArray<FVector>& vertices, FTunnelMeshGrid& grid)
+	{
+		int32 rows = stepCount + 1;
+		if (rows < 2 || vertices.Num() % rows != 0) {
+			UE_LOG(LogTemp, Error, TEXT("Tunnel section with %d vertices does not form %d rows."), vertices.Num(), rows);
+			return false;
+		}
+		grid = FTunnelMeshGrid(0, rows, vertices.Num() / rows);
+		return true;
+	}
+
+	void BuildSectionTriangles(int32 stepCount, const TArray<FVector>& vertices, TArray<int32>& triangles, TArray<FVector2D>& uv)
+	{
+		TUNNEL_GENERATION_PHASE_SCOPE(Triangles);
+		triangles.Reset();
+		FTunnelMeshGrid grid;
+		if (!GetSectionGrid(stepCount, vertices, grid)) {
+			return;
+		}
+		FTunnelMeshBuilder::AppendTriangles(grid, triangles);
+
+		// Mesh end data may carry UVs of the previous section, only complete sets are kept
+		if (uv.Num() != vertices.Num()) {
+			uv.SetNumUninitialized(vertices.Num());
+			FTunnelMeshBuilder::ComputeUVs(vertices, grid, 200.0f, uv);
+		}
+	}
+
+	// Takes triangles, normals, tangents and UVs of the existing mesh and rebuilds them only around the regenerated loops
+	bool PatchSectionMesh(int32 stepCount, int32 firstLoop, int32 lastLoop, const TArray<FVector>& vertices, const FTunnelMeshSectionData& existing,
+		TArray<int32>& triangles, TArray<FVector>& normals, TArray<FProcMeshTangent>& tangents, TArray<FVector2D>& uv)
+	{
+		TUNNEL_GENERATION_PHASE_SCOPE(Normals);
+		int32 count = vertices.Num();
+		FTunnelMeshGrid grid;
+		if (existing.Vertices.Num() != count || existing.Normals.Num() != count || existing.Tangents.Num() != count || existing.UV.Num() != count
+			|| !GetSectionGrid(stepCount, vertices, grid)) {
+			return false;
+		}
+		// Kept geometry is shared with the mesh, the patched section gets its own arrays
+		triangles = existing.Triangles;
+		normals = existing.Normals;
+		tangents = existing.Tangents;
+		uv = existing.UV;
+		// Normals of the loops next to a moved one change as well
+		FTunnelMeshBuilder::ComputeNormalsAndTangents(vertices, grid, firstLoop - 1, lastLoop + 1, normals, tangents);
+		FTunnelMeshBuilder::ComputeUVs(vertices, grid, 200.0f, uv, firstLoop);
+		return true;
+	}
+
+	void BuildSectionNormalsAndTangents(int32 stepCount, const TArray<FVector>& vertices, TArray<FVector>& normals, TArray<FProcMeshTangent>& tangents)
+	{
+		TUNNEL_GENERATION_PHASE_SCOPE(Normals);
+		FTunnelMeshGrid grid;
+		if (!GetSectionGrid(stepCount, vertices, grid)) {
+			return;
+		}
+		normals.SetNumUninitialized(vertices.Num());
+		tangents.SetNumUninitialized(vertices.Num());
+		FTunnelMeshBuilder::ComputeNormalsAndTangents(vertices, grid, normals, tangents);
+	}
+
+	// Structs with padding are hashed member by member so the key does not depend on the padding bytes
+	void AddTransformToKey(FTunnelSectionKeyBuilder& key, const FTransform& transform)
+	{
+		key.Add(transform.GetLocation());
+		key.Add(transform.GetRotation());
+		key.Add(transform.GetScale3D());
+	}
+
+	void AddCurveToKey(FTunnelSectionKeyBuilder& key, const UCurveFloat* curve)
+	{
+		key.Add(IsValid(curve));
+		if (!IsValid(curve)) {
+			return;
+		}
+		key.Add(curve->FloatCurve.DefaultValue);
+		for (const FRichCurveKey& curveKey : curve->FloatCurve.GetConstRefOfKeys()) {
+			key.Add(curveKey.Time);
+			key.Add(curveKey.Value);
+			key.Add(curveKey.ArriveTangent);
+			key.Add(curveKey.LeaveTangent);
+			key.Add((uint8)curveKey.InterpMode.GetValue());
+			key.Add((uint8)curveKey.TangentMode.GetValue());
+		}
+	}
+
+	void AddEndToKey(FTunnelSectionKeyBuilder& key, const FMeshSectionEnd& end)
+	{
+		key.AddArray(end.GroundVertives);
+		key.AddArray(end.WallVertices);
+		key.AddArray(end.GroundUV);
+		key.AddArray(end.WallUV);
+	}
+
+	TSharedRef<const FTunnelCachedSection> MakeCachedSection(const FTunnelSectionState& state)
+	{
+		TSharedRef<FTunnelCachedSection> cached = MakeShared<FTunnelCachedSection>();
+		cached->Ground.Vertices = state.groundVertices;
+		cached->Ground.Triangles = state.groundTriangles;
+		cached->Ground.Normals = state.groundNormals;
+		cached->Ground.UV = state.groundUV;
+		cached->Ground.Tangents = state.groundTangents;
+		cached->Wall.Vertices = state.wallVertices;
+		cached->Wall.Triangles = state.wallTriangles;
+		cached->Wall.Normals = state.wallNormals;
+		cached->Wall.UV = state.wallUV;
+		cached->Wall.Tangents = state.wallTangents;
+		cached->End = state.currentMeshEndData;
+		cached->bHasTunnelStart = state.hasTunnelStartMeshData;
+		if (state.hasTunnelStartMeshData) {
+			cached->TunnelStart = state.tunnelStartMeshData;
+		}
+		return cached;
+	}
+
+	void CopyCachedSection(const FTunnelCachedSection& cached, FTunnelSectionState& state)
+	{
+		state.groundVertices = cached.Ground.Vertices;
+		state.groundTriangles = cached.Ground.Triangles;
+		state.groundNormals = cached.Ground.Normals;
+		state.groundUV = cached.Ground.UV;
+		state.groundTangents = cached.Ground.Tangents;
+		state.wallVertices = cached.Wall.Vertices;
+		state.wallTriangles = cached.Wall.Triangles;
+		state.wallNormals = cached.Wall.Normals;
+		state.wallUV = cached.Wall.UV;
+		state.wallTangents = cached.Wall.Tangents;
+		state.currentMeshEndData = cached.End;
+		state.hasTunnelStartMeshData = cached.bHasTunnelStart;
+		if (cached.bHasTunnelStart) {
+			state.tunnelStartMeshData = cached.TunnelStart;
+		}
+	}
+}
+
 // Regenerate section of tunnel. One section is space between 2 back to back spline points
+// Sections are generated in parallel, only the mesh upload runs on the game thread in the original order
 void AProceduralTunnel::ProceduralGenerationLoop(int32 firstIndex, int32 lastIndex, bool isMeshPartUpdate) {
+	TRACE_CPUPROFILER_EVENT_SCOPE(AProceduralTunnel::ProceduralGenerationLoop);
+
+	// A pass still running on a worker reads the same variables, it is finished first
+	FinishAsyncGenerationLoop(true);
+
+	FTunnelGenerationPass pass;
+	if (!BeginGenerationPass(firstIndex, lastIndex, isMeshPartUpdate, pass)) {
+		return;
+	}
+	GeneratePassSections(pass);
+	FinishGenerationPass(pass);
+}
+
+bool AProceduralTunnel::BeginAsyncGenerationLoop(int32 firstIndex, int32 lastIndex, bool isMeshPartUpdate) {
+	if (asyncGenerationPass.IsValid()) {
+		return false;
+	}
+	TSharedPtr<FTunnelGenerationPass> pass = MakeShared<FTunnelGenerationPass>();
+	if (!BeginGenerationPass(firstIndex, lastIndex, isMeshPartUpdate, *pass)) {
+		return false;
+	}
+	asyncGenerationPass = pass;
+	asyncGeneration = Async(EAsyncExecution::ThreadPool, [this, pass]()
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(AProceduralTunnel::AsyncGenerationLoop);
+		GeneratePassSections(*pass);
+	});
+	return true;
+}
+
+bool AProceduralTunnel::FinishAsyncGenerationLoop(bool wait) {
+	if (!asyncGenerationPass.IsValid()) {
+		return true;
+	}
+	if (!wait && !asyncGeneration.IsReady()) {
+		return false;
+	}
+	asyncGeneration.Wait();
+	asyncGeneration.Reset();
+	TSharedPtr<FTunnelGenerationPass> pass = MoveTemp(asyncGenerationPass);
+	FinishGenerationPass(*pass);
+	return true;
+}
+
+void AProceduralTunnel::GeneratePassSections(FTunnelGenerationPass& pass) const {
+	// Seam loops between two sections of this pass are generated first. The last loop of a section is the first
+	// loop of the next one, so both sections take it from the same data and the seam stays closed
+	ParallelFor(pass.sections.Num() - 1, [this, &pass](int32 sectionIndex)
+	{
+		GenerateSeam(pass, sectionIndex);
+	});
+	LinkSeams(pass);
+
+	// Sections only read the actor and write their own state
+	ParallelFor(pass.sections.Num(), [this, &pass](int32 sectionIndex)
+	{
+		GenerateSection(pass, sectionIndex);
+	});
+}
+
+bool AProceduralTunnel::BeginGenerationPass(int32 firstIndex, int32 lastIndex, bool isMeshPartUpdate, FTunnelGenerationPass& pass) {
+	// Spline was edited, other tunnels snapping to this one must see its new ends
+	UpdateEndpoints();
+
 	// Initialize variables for procedural generation loop
 	InitializeProceduralGenerationLoopVariables(firstIndex, lastIndex);
 
-	// Loop through the tunnel sections
+	pass.lastIndex = lastIndex;
+	pass.isMeshPartUpdate = isMeshPartUpdate;
+
+	// One state per tunnel section in generation order
+	TArray<FTunnelSectionState>& sections = pass.sections;
+	sections.Reserve(lastIndex - firstIndex + 1);
+	bool noMeshesBefore = TunnelMeshes.Num() == 0;
 	for (int32 index = firstIndex; index <= lastIndex; index++) {
-		indexOfCurrentMesh = abs(index);
-		ClearArrays();
+		FTunnelSectionState& state = sections.AddDefaulted_GetRef();
+		state.indexOfCurrentMesh = abs(index);
 
 		// Calulate step count and last step size on selected tunnel section
-		CalculateStepsInTunnelSection();
+		CalculateStepsInTunnelSection(state);
+
+		// Only the first section made into an empty tunnel is the start of the whole tunnel
+		state.noMeshesBeforeSection = noMeshesBefore;
+		if (state.stepCountToMakeCurrentMesh > 0) {
+			noMeshesBefore = false;
+		}
+	}
+	if (sections.Num() == 0) {
+		return false;
+	}
+
+	// Sections whose spline frames did not move keep their mesh, the others only generate the loops that moved
+	pass.paramsHash = GetGenerationParamsHash();
+	if (useIncrementalRegeneration && useNativeMeshBuilder && generatedParamsHash == pass.paramsHash) {
+		for (FTunnelSectionState& state : sections) {
+			if (state.stepCountToMakeCurrentMesh > 0) {
+				PrepareIncrementalSection(state);
+			}
+		}
+	}
+	pass.seams.SetNum(sections.Num());
+
+	// Inputs shared by every section are hashed once, sections add their own frames and boundary loops
+	pass.useGeometryCache = useGeometryCache && useNativeMeshBuilder && deformationField.IsValid() && FTunnelGeometryCache::IsEnabled();
+	if (pass.useGeometryCache) {
+		pass.cacheKeyBase = GetGenerationCacheKey();
+	}
+	return true;
+}
+
+// Generates the loop between section sectionIndex and the next one
+void AProceduralTunnel::GenerateSeam(FTunnelGenerationPass& pass, int32 sectionIndex) const {
+	TUNNEL_GENERATION_PHASE_SCOPE(VertexGeneration);
+	const FTunnelSectionState& section = pass.sections[sectionIndex];
+	if (section.stepCountToMakeCurrentMesh <= 0 || pass.sections[sectionIndex + 1].stepCountToMakeCurrentMesh <= 0) {
+		return;
+	}
+	FTunnelSectionState seamState = section;
+	// Vertices are clamped against the loop before them so loops never overlap in tight curves.
+	// Generate that loop first, otherwise the seam has nothing to be clamped against
+	seamState.stepIndexInsideMesh = section.stepCountToMakeCurrentMesh - 1;
+	GenerateVerticesForCurrentLoop(seamState, pass.lastIndex);
+	seamState.stepIndexInsideMesh = section.stepCountToMakeCurrentMesh;
+	GenerateVerticesForCurrentLoop(seamState, pass.lastIndex);
+	pass.seams[sectionIndex] = MoveTemp(seamState.currentMeshEndData);
+}
+
+void AProceduralTunnel::LinkSeams(FTunnelGenerationPass& pass) const {
+	for (int32 sectionIndex = 0; sectionIndex < pass.sections.Num() - 1; sectionIndex++) {
+		if (pass.seams[sectionIndex].GroundVertives.Num() > 0) {
+			pass.sections[sectionIndex].endSeam = &pass.seams[sectionIndex];
+			pass.sections[sectionIndex + 1].startSeam = &pass.seams[sectionIndex];
+		}
+	}
+}
+
+void AProceduralTunnel::GenerateSection(FTunnelGenerationPass& pass, int32 sectionIndex) const {
+	FTunnelSectionState& state = pass.sections[sectionIndex];
+	// Check if there is enough space for at least one step
+	if (state.stepCountToMakeCurrentMesh <= 0 || state.isClean) {
+		return;
+	}
+
+	// Same inputs give the same section, take it from the cache if it was made before
+	FTunnelSectionCacheKey cacheKey;
+	if (pass.useGeometryCache) {
+		cacheKey = GetSectionCacheKey(pass, state);
+		if (TSharedPtr<const FTunnelCachedSection> cached = FTunnelGeometryCache::Get().Find(cacheKey)) {
+			CopyCachedSection(*cached, state);
+			return;
+		}
+	}
+
+	// Reset the current mesh end data
+	ResetCurrentMeshEndData(state);
+
+	// Generate vertices and UVs for the tunnel mesh
+	GenerateVerticesAndUVs(state, pass.isMeshPartUpdate, pass.lastIndex);
+
+	// Create the mesh triangles, tangents, and normals
+	if (useNativeMeshBuilder) {
+		if (!state.patchExisting || !PatchSectionMesh(state.stepCountToMakeCurrentMesh, state.firstDirtyLoop, state.lastDirtyLoop, state.groundVertices,
+			state.existing->ground, state.groundTriangles, state.groundNormals, state.groundTangents, state.groundUV)) {
+			BuildSectionTriangles(state.stepCountToMakeCurrentMesh, state.groundVertices, state.groundTriangles, state.groundUV);
+			BuildSectionNormalsAndTangents(state.stepCountToMakeCurrentMesh, state.groundVertices, state.groundNormals, state.groundTangents);
+		}
+		if (!state.patchExisting || !PatchSectionMesh(state.stepCountToMakeCurrentMesh, state.firstDirtyLoop, state.lastDirtyLoop, state.wallVertices,
+			state.existing->wall, state.wallTriangles, state.wallNormals, state.wallTangents, state.wallUV)) {
+			BuildSectionTriangles(state.stepCountToMakeCurrentMesh, state.wallVertices, state.wallTriangles, state.wallUV);
+			BuildSectionNormalsAndTangents(state.stepCountToMakeCurrentMesh, state.wallVertices, state.wallNormals, state.wallTangents);
+		}
+	}
+
+	// Patched sections keep loops that moved less than the tolerance, only fully generated sections are stored
+	if (pass.useGeometryCache && !state.patchExisting) {
+		FTunnelGeometryCache::Get().Add(cacheKey, MakeCachedSection(state));
+	}
+}
+
+void AProceduralTunnel::FinishGenerationPass(FTunnelGenerationPass& pass) {
+	// Upload in the original order, MakeMesh keeps TunnelMeshes and meshEnds up to date
+	for (FTunnelSectionState& state : pass.sections) {
+		if (state.stepCountToMakeCurrentMesh > 0 && !state.isClean) {
+			UploadSection(state);
+		}
+	}
+
+	// Frames of these sections are now what their meshes were made from
+	generatedParamsHash = pass.paramsHash;
+	for (const FTunnelSectionState& state : pass.sections) {
+		splineFrames.ClearDirty(SplineComponent->GetNumberOfSplinePoints() - (state.indexOfCurrentMesh + 2));
+	}
+}
+
+// Works out which loops of a section moved since its mesh was made. Loop k is at spline frame sample k
+void AProceduralTunnel::PrepareIncrementalSection(FTunnelSectionState& state)
+{
+	int32 segment = SplineComponent->GetNumberOfSplinePoints() - (state.indexOfCurrentMesh + 2);
+	// Meshes are stored from the start of the tunnel like spline segments
+	TSharedPtr<const FTunnelMeshSections> existing = GetMeshSections(segment);
+	int32 rows = state.stepCountToMakeCurrentMesh + 1;
+	if (!existing.IsValid() || existing->ground.Vertices.Num() % rows != 0 || existing->wall.Vertices.Num() % rows != 0) {
+		return;
+	}
+	state.existing = existing;
+
+	int32 firstLoop = INDEX_NONE;
+	int32 lastLoop = INDEX_NONE;
+	auto markLoops = [&firstLoop, &lastLoop, &state](int32 first, int32 last)
+	{
+		first = FMath::Min(first, state.stepCountToMakeCurrentMesh);
+		last = FMath::Min(last, state.stepCountToMakeCurrentMesh);
+		firstLoop = firstLoop == INDEX_NONE ? first : FMath::Min(firstLoop, first);
+		lastLoop = lastLoop == INDEX_NONE ? last : FMath::Max(lastLoop, last);
+	};
+
+	int32 firstSample = 0;
+	int32 lastSample = 0;
+	if (splineFrames.GetDirtySamples(segment, firstSample, lastSample)) {
+		markLoops(firstSample, lastSample);
+	}
+	// First loop is the end of the previous section, which is at one of the last two samples of its segment
+	if (segment > 0 && splineFrames.GetDirtySamples(segment - 1, firstSample, lastSample)
+		&& lastSample >= splineFrames.GetSegmentFrames(segment - 1).Num() - 2) {
+		markLoops(0, 0);
+	}
+	// Start of a child tunnel follows the intersection, not the spline
+	if (segment == 0 && tunnelType != TunnelType::StartTunnel) {
+		markLoops(0, 0);
+	}
+
+	if (firstLoop == INDEX_NONE) {
+		state.isClean = true;
+		return;
+	}
+	state.patchExisting = true;
+	state.firstDirtyLoop = firstLoop;
+	// The loop after a moved one is clamped against it for overlap, so it is generated again as well
+	state.lastDirtyLoop = FMath::Min(lastLoop + 1, state.stepCountToMakeCurrentMesh);
+}
+
+TSharedPtr<const FTunnelMeshSections> AProceduralTunnel::GetMeshSections(int32 meshIndex) const
+{
+	if (!TunnelMeshes.IsValidIndex(meshIndex) || !IsValid(TunnelMeshes[meshIndex]) || !meshSections.IsValidIndex(meshIndex)) {
+		return nullptr;
+	}
+	const TSharedPtr<const FTunnelMeshSections>& sections = meshSections[meshIndex];
+	if (!sections.IsValid() || sections->ground.Vertices.Num() == 0 || sections->wall.Vertices.Num() == 0) {
+		return nullptr;
+	}
+	return sections;
+}
+
+// Everything besides the spline that the generated vertices depend on
+uint32 AProceduralTunnel::GetGenerationParamsHash() const
+{
+	uint32 hash = GetTypeHash(numberOfHorizontalPoints);
+	hash = HashCombine(hash, GetTypeHash(numberOfVerticalPoints));
+	hash = HashCombine(hash, GetTypeHash(loopAroundTunnelLastIndex));
+	hash = HashCombine(hash, GetTypeHash(horizontalPointSize));
+	hash = HashCombine(hash, GetTypeHash(verticalPointSize));
+	hash = HashCombine(hash, GetTypeHash(widthScale));
+	hash = HashCombine(hash, GetTypeHash(heightScale));
+	hash = HashCombine(hash, GetTypeHash(localTunnelScale));
+	hash = HashCombine(hash, GetTypeHash(surfaceVariation));
+	hash = HashCombine(hash, GetTypeHash(floorDeformation));
+	hash = HashCombine(hash, GetTypeHash(wallDeformation));
+	hash = HashCombine(hash, GetTypeHash(tunnelRoundValue));
+	hash = HashCombine(hash, GetTypeHash(noiseTextureXresolution));
+	hash = HashCombine(hash, GetTypeHash((uint8)tunnelType.GetValue()));
+	hash = HashCombine(hash, GetTypeHash(useRotationMinimizingFrames));
+	hash = HashCombine(hash, GetTypeHash(isEndConnected));
+	hash = HashCombine(hash, PointerHash(deformationField.Get()));
+	hash = HashCombine(hash, PointerHash(deformCurve));
+	hash = HashCombine(hash, PointerHash(stopDeformCurve));
+	hash = HashCombine(hash, PointerHash(connectedActor));
+	hash = HashCombine(hash, PointerHash(intersection));
+	hash = HashCombine(hash, PointerHash(parentIntersection));
+	return hash;
+}
+
+// Everything besides the spline frames and boundary loops of a section that its geometry is made from
+FTunnelSectionCacheKey AProceduralTunnel::GetGenerationCacheKey() const
+{
+	FTunnelSectionKeyBuilder key;
+	key.Add(numberOfHorizontalPoints);
+	key.Add(numberOfVerticalPoints);
+	key.Add(loopAroundTunnelLastIndex);
+	key.Add(horizontalPointSize);
+	key.Add(verticalPointSize);
+	key.Add(widthScale);
+	key.Add(heightScale);
+	key.Add(localTunnelScale);
+	key.Add(surfaceVariation);
+	key.Add(floorDeformation);
+	key.Add(wallDeformation);
+	key.Add(maxFloorDeformation);
+	key.Add(maxWallDeformation);
+	key.Add(tunnelRoundValue);
+	key.Add(noiseTextureXresolution);
+	key.Add((uint8)tunnelType.GetValue());
+	key.Add(useRotationMinimizingFrames);
+	key.Add(deformationField->GetContentHash());
+	AddCurveToKey(key, deformCurve);
+	AddCurveToKey(key, stopDeformCurve);
+	// Frames are in spline space and vertices in actor space
+	AddTransformToKey(key, SplineComponent->GetRelativeTransform());
+	return key.Key;
+}
+
+// Section part of the cache key: its spline frames, where it is in the tunnel and every loop it takes from outside
+FTunnelSectionCacheKey AProceduralTunnel::GetSectionCacheKey(const FTunnelGenerationPass& pass, const FTunnelSectionState& state) const
+{
+	FTunnelSectionKeyBuilder key(pass.cacheKeyBase);
+	int32 numberOfSplinePoints = SplineComponent->GetNumberOfSplinePoints();
+	int32 segment = numberOfSplinePoints - (state.indexOfCurrentMesh + 2);
+	key.Add(numberOfSplinePoints);
+	key.Add(state.indexOfCurrentMesh);
+	key.Add(indexOfLastMesh);
+	key.Add(pass.isMeshPartUpdate);
+	key.Add(state.noMeshesBeforeSection);
+	key.Add(state.stepCountToMakeCurrentMesh);
+	key.Add(state.lastStepSizeOnSpline);
+	key.Add(splineFrames.GetSegmentStartDistance(segment));
+	for (const FSplineFrame& frame : splineFrames.GetSegmentFrames(segment)) {
+		key.Add(frame.Location);
+		key.Add(frame.Tangent);
+		key.Add(frame.Right);
+		key.Add(frame.Up);
+		key.Add(frame.Distance);
+	}
+
+	// Seams and mesh ends of the neighbouring sections
+	key.Add(state.startSeam != nullptr);
+	if (state.startSeam) {
+		AddEndToKey(key, *state.startSeam);
+	}
+	key.Add(state.endSeam != nullptr);
+	if (state.endSeam) {
+		AddEndToKey(key, *state.endSeam);
+	}
+	int32 meshEndIndex = numberOfSplinePoints - 3 - state.indexOfCurrentMesh;
+	key.Add(meshEnds.IsValidIndex(meshEndIndex));
+	if (meshEnds.IsValidIndex(meshEndIndex)) {
+		AddEndToKey(key, meshEnds[meshEndIndex]);
+	}
+	if (pass.isMeshPartUpdate && state.indexOfCurrentMesh == indexOfLastMesh && meshEnds.IsValidIndex(meshEnds.Num() - 1 - state.indexOfCurrentMesh)) {
+		AddEndToKey(key, meshEnds[meshEnds.Num() - 1 - state.indexOfCurrentMesh]);
+	}
+
+	// Walls of the last section turn towards the branches of the intersection at the end, which ones depends on its type
+	key.Add(IsValid(intersection));
+	if (IsValid(intersection)) {
+		key.Add((uint8)intersection->intersectionType.GetValue());
+		key.Add(intersection->horizontalPointSize);
+		key.Add(intersection->verticalPointSize);
+	}
+
+	// End joined to another tunnel takes its loop from that tunnel
+	bool isJoinedEnd = state.indexOfCurrentMesh == indexOfLastMesh && IsValid(connectedActor) && isEndConnected;
+	key.Add(isJoinedEnd);
+	if (isJoinedEnd) {
+		AddTransformToKey(key, connectedActor->GetActorTransform().GetRelativeTransform(GetActorTransform()));
+		key.Add((uint8)connectedActor->tunnelType.GetValue());
+		if (connectedActor->tunnelType == TunnelType::StartTunnel) {
+			AddEndToKey(key, connectedActor->tunnelStartMeshData);
+		}
+		else if (connectedActor->meshEnds.Num() > 0) {
+			AddEndToKey(key, connectedActor->meshEnds.Last());
+		}
+	}
+
+	// First loop of a child tunnel is taken from its intersection and the intersection's parent tunnel
+	bool isChildTunnelStart = (segment == 0 || state.noMeshesBeforeSection) && tunnelType != TunnelType::StartTunnel && IsValid(parentIntersection);
+	key.Add(isChildTunnelStart);
+	if (isChildTunnelStart) {
+		AddTransformToKey(key, parentIntersection->GetActorTransform().GetRelativeTransform(GetActorTransform()));
+		key.Add((uint8)parentIntersection->intersectionType.GetValue());
+		key.Add(parentIntersection->verticalPointSize);
+		key.AddArray(parentIntersection->lastRightWallVertices);
+		key.AddArray(parentIntersection->lastLeftWallVertices);
+		key.AddArray(parentIntersection->lastStraightRoofVertices);
+		key.AddArray(parentIntersection->lastRightRoofVertices);
+		key.AddArray(parentIntersection->lastLeftRoofVertices);
+		key.AddArray(parentIntersection->lastRightFloorVertices);
+		key.AddArray(parentIntersection->lastStraightFloorVertices);
+		key.AddArray(parentIntersection->lastLeftFloorVertices);
+		key.Add(IsValid(parentsParentTunnel));
+		if (IsValid(parentsParentTunnel) && parentsParentTunnel->meshEnds.Num() > 0) {
+			AddTransformToKey(key, parentsParentTunnel->GetActorTransform().GetRelativeTransform(GetActorTransform()));
+			AddEndToKey(key, parentsParentTunnel->meshEnds.Last());
+		}
+	}
+	return key.Key;
+}
+
+// Copies a generated section into the Blueprint visible arrays and builds the mesh
+void AProceduralTunnel::UploadSection(FTunnelSectionState& state)
+{
+	groundVertices = MoveTemp(state.groundVertices);
+	groundTriangles = MoveTemp(state.groundTriangles);
+	groundUV = MoveTemp(state.groundUV);
+	groundNormals = MoveTemp(state.groundNormals);
+	groundTangents = MoveTemp(state.groundTangents);
+	wallVertices = MoveTemp(state.wallVertices);
+	wallTriangles = MoveTemp(state.wallTriangles);
+	wallUV = MoveTemp(state.wallUV);
+	wallNormals = MoveTemp(state.wallNormals);
+	wallTangents = MoveTemp(state.wallTangents);
+	currentMeshEndData = MoveTemp(state.currentMeshEndData);
+	if (state.hasTunnelStartMeshData) {
+		tunnelStartMeshData = MoveTemp(state.tunnelStartMeshData);
+	}
+	stepCountToMakeCurrentMesh = state.stepCountToMakeCurrentMesh;
+
+	if (!useNativeMeshBuilder) {
+		MakeMeshTriangles();
+		MakeMeshTangentsAndNormals();
+	}
+	else if (UsesBlueprintUVs()) {
+		// Only the UVs are taken from the Blueprint graph, it gets empty UV arrays like before the native builder
+		TArray<int32> nativeGroundTriangles = MoveTemp(groundTriangles);
+		TArray<int32> nativeWallTriangles = MoveTemp(wallTriangles);
+		TArray<FVector2D> nativeGroundUV = MoveTemp(groundUV);
+		TArray<FVector2D> nativeWallUV = MoveTemp(wallUV);
+		groundUV.Reset();
+		wallUV.Reset();
+		MakeMeshTriangles();
+		groundTriangles = MoveTemp(nativeGroundTriangles);
+		wallTriangles = MoveTemp(nativeWallTriangles);
+		if (groundUV.Num() != groundVertices.Num()) {
+			groundUV = MoveTemp(nativeGroundUV);
+		}
+		if (wallUV.Num() != wallVertices.Num()) {
+			wallUV = MoveTemp(nativeWallUV);
+		}
+	}
+
+	// Build the mesh with the generated data. BP_ProceduralTunnel implements MakeMesh, so the native
+	// upload queue is only used when it is called directly, like the native triangles and normals above
+	if (useNativeMeshBuilder) {
+		MakeMesh_Implementation(state.indexOfCurrentMesh);
+	}
+	else {
+		MakeMesh(state.indexOfCurrentMesh);
+	}
+}
+
+bool AProceduralTunnel::UsesBlueprintUVs() const
+{
+	return !useNativeUVs && GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AProceduralTunnel, MakeMeshTriangles));
+}
+
+bool AProceduralTunnel::BenchmarkMeshBuilder(int32 iterations, double& blueprintMs, double& nativeMs)
+{
+	if (!GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AProceduralTunnel, MakeMeshTriangles))
+		|| !GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AProceduralTunnel, MakeMeshTangentsAndNormals))) {
+		return false;
+	}
+	TSharedPtr<const FTunnelMeshSections> sections = GetMeshSections(0);
+	if (meshRows.Num() == 0 || meshRows[0] < 2 || !sections.IsValid()) {
+		return false;
+	}
+	const FTunnelMeshSectionData& ground = sections->ground;
+	const FTunnelMeshSectionData& wall = sections->wall;
+
+	int32 previousStepCount = stepCountToMakeCurrentMesh;
+	stepCountToMakeCurrentMesh = meshRows[0] - 1;
+	// Both paths start from the arrays UploadSection hands them, only vertices are filled in
+	auto resetSection = [this, &ground, &wall]()
+	{
+		groundVertices = ground.Vertices;
+		wallVertices = wall.Vertices;
+		groundTriangles.Reset();
+		groundUV.Reset();
+		groundNormals.Reset();
+		groundTangents.Reset();
+		wallTriangles.Reset();
+		wallUV.Reset();
+		wallNormals.Reset();
+		wallTangents.Reset();
+	};
+	auto timeIterations = [iterations, &resetSection](TFunctionRef<void()> build)
+	{
+		double seconds = 0.0;
+		for (int32 iteration = 0; iteration < iterations; iteration++) {
+			resetSection();
+			double start = FPlatformTime::Seconds();
+			build();
+			seconds += FPlatformTime::Seconds() - start;
+		}
+		return seconds * 1000.0 / iterations;
+	};
+
+	blueprintMs = timeIterations([this]()
+	{
+		MakeMeshTriangles();
+		MakeMeshTangentsAndNormals();
+	});
+	nativeMs = timeIterations([this]()
+	{
+		MakeMeshTriangles_Implementation();
+		MakeMeshTangentsAndNormals_Implementation();
+	});
+
+	resetSection();
+	groundVertices.Reset();
+	wallVertices.Reset();
+	stepCountToMakeCurrentMesh = previousStepCount;
+	return true;
+}
+
+// Build triangle indices and UVs of the current mesh section
+void AProceduralTunnel::MakeMeshTriangles_Implementation()
+{
+	BuildSectionTriangles(stepCountToMakeCurrentMesh, groundVertices, groundTriangles, groundUV);
+	BuildSectionTriangles(stepCountToMakeCurrentMesh, wallVertices, wallTriangles, wallUV);
+}
+
+// Build smooth normals and tangents of the current mesh section
+void AProceduralTunnel::MakeMeshTangentsAndNormals_Implementation()
+{
+	BuildSectionNormalsAndTangents(stepCountToMakeCurrentMesh, groundVertices, groundNormals, groundTangents);
+	BuildSectionNormalsAndTangents(stepCountToMakeCurrentMesh, wallVertices, wallNormals, wallTangents);
+}
 
-		// Check if there is enough space for at least one step
-		if (stepCountToMakeCurrentMesh > 0) {
-			// Reset the current mesh end data
-			ResetCurrentMeshEndData();
+// Records the section end right away so following sections and passes can connect to it, the mesh upload is queued
+void AProceduralTunnel::MakeMesh_Implementation(int32 meshPartIndex)
+{
+	// Meshes are stored from the start of the tunnel while meshPartIndex counts from the end
+	int32 meshIndex = SplineComponent->GetNumberOfSplinePoints() - 2 - meshPartIndex;
+	if (meshIndex < 0) {
+		return;
+	}
+
+	if (meshEnds.Num() <= meshIndex) {
+		meshEnds.SetNum(meshIndex + 1);
+	}
+	meshEnds[meshIndex] = currentMeshEndData;
+
+	FTunnelMeshSectionData ground;
+	ground.Vertices = MoveTemp(groundVertices);
+	ground.Triangles = MoveTemp(groundTriangles);
+	ground.Normals = MoveTemp(groundNormals);
+	ground.UV = MoveTemp(groundUV);
+	ground.Tangents = MoveTemp(groundTangents);
+	FTunnelMeshSectionData wall;
+	wall.Vertices = MoveTemp(wallVertices);
+	wall.Triangles = MoveTemp(wallTriangles);
+	wall.Normals = MoveTemp(wallNormals);
+	wall.UV = MoveTemp(wallUV);
+	wall.Tangents = MoveTemp(wallTangents);
+	QueueMeshUpload(meshIndex, stepCountToMakeCurrentMesh + 1, MoveTemp(ground), MoveTemp(wall));
+}
+
+void AProceduralTunnel::QueueMeshUpload(int32 meshIndex, int32 rows, FTunnelMeshSectionData&& ground, FTunnelMeshSectionData&& wall)
+{
+	UProceduralMeshComponent* mesh = GetOrCreateTunnelMesh(meshIndex);
+	if (meshRows.Num() <= meshIndex) {
+		meshRows.SetNumZeroed(meshIndex + 1);
+	}
+	meshRows[meshIndex] = rows;
+	if (meshSections.Num() <= meshIndex) {
+		meshSections.SetNum(meshIndex + 1);
+	}
+	TSharedRef<FTunnelMeshSections> sections = MakeShared<FTunnelMeshSections>();
+	sections->ground = MoveTemp(ground);
+	sections->wall = MoveTemp(wall);
+	meshSections[meshIndex] = sections;
+
+	// A section that is still waiting is replaced, only the latest shape of it matters
+	FPendingTunnelMeshUpload* upload = pendingMeshUploads.FindByPredicate([mesh](const FPendingTunnelMeshUpload& pending) { return pending.mesh == mesh; });
+	if (!upload) {
+		upload = &pendingMeshUploads.AddDefaulted_GetRef();
+		upload->mesh = mesh;
+	}
+	upload->rows = rows;
+	upload->sections = meshSections[meshIndex];
+
+	if (meshUploadBudgetMs <= 0.0f) {
+		FlushMeshUploads();
+	}
+}
+
+void AProceduralTunnel::RestoreMesh(int32 meshIndex, int32 rows, const FMeshSectionEnd& end, FTunnelMeshSectionData&& ground, FTunnelMeshSectionData&& wall)
+{
+	if (meshEnds.Num() <= meshIndex) {
+		meshEnds.SetNum(meshIndex + 1);
+	}
+	meshEnds[meshIndex] = end;
+	QueueMeshUpload(meshIndex, rows, MoveTemp(ground), MoveTemp(wall));
+}
+
+bool AProceduralTunnel::IsMeshUploadPending(const UProceduralMeshComponent* mesh) const
+{
+	return pendingMeshUploads.ContainsByPredicate([mesh](const FPendingTunnelMeshUpload& pending) { return pending.mesh.Get() == mesh; });
+}
 
-			// Generate vertices and UVs for the tunnel mesh
-			GenerateVerticesAndUVs(isMeshPartUpdate, lastIndex);
+bool AProceduralTunnel::CancelMeshUpload(const UProceduralMeshComponent* mesh)
+{
+	return pendingMeshUploads.RemoveAll([mesh](const FPendingTunnelMeshUpload& pending) { return pending.mesh.Get() == mesh; }) > 0;
+}
 
-			// Create the mesh triangles, tangents, and normals
-			MakeMeshTriangles();
-			MakeMeshTangentsAndNormals();
+void AProceduralTunnel::FlushMeshUploads()
+{
+	UploadPendingMeshes(TNumericLimits<double>::Max());
+}
 
-			// Build the mesh with the generated data
-			MakeMesh(indexOfCurrentMesh);
+// Uploads queued sections in the order they were made until the time budget is used
+void AProceduralTunnel::UploadPendingMeshes(double budgetSeconds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AProceduralTunnel::UploadPendingMeshes);
+
+	double startTime = FPlatformTime::Seconds();
+	int32 uploadCount = 0;
+	while (uploadCount < pendingMeshUploads.Num()) {
+		FPendingTunnelMeshUpload& upload = pendingMeshUploads[uploadCount++];
+		// Mesh may have been destroyed by undo or reset while waiting
+		if (UProceduralMeshComponent* mesh = upload.mesh.Get()) {
+			UploadMeshLods(mesh, upload);
+		}
+		if (FPlatformTime::Seconds() - startTime >= budgetSeconds) {
+			break;
+		}
+	}
+	pendingMeshUploads.RemoveAt(0, uploadCount);
+}
+
+// Uploads the full resolution level of a section, the shown level and the collision level. Other levels are made
+// when UpdateMeshLods shows them, so only the levels in use take memory
+void AProceduralTunnel::UploadMeshLods(UProceduralMeshComponent* mesh, const FPendingTunnelMeshUpload& upload)
+{
+	int32 meshIndex = TunnelMeshes.IndexOfByKey(mesh);
+	if (meshIndex == INDEX_NONE) {
+		return;
+	}
+	int32 levels = FMath::Clamp(lodCount, 1, 4);
+	int32 collisionLevel = FMath::Clamp(collisionLod, 0, levels - 1);
+	if (shownMeshLods.Num() <= meshIndex) {
+		shownMeshLods.SetNumZeroed(meshIndex + 1);
+	}
+	int32 shownLevel = FMath::Min((int32)shownMeshLods[meshIndex], levels - 1);
+	for (int32 lod = 0; lod < levels; lod++) {
+		if (lod == 0 || lod == shownLevel || lod == collisionLevel) {
+			UploadMeshLod(meshIndex, lod, upload.rows, upload.sections->ground, upload.sections->wall);
+		}
+		else if (UProceduralMeshComponent* lodMesh = GetLodMesh(meshIndex, lod)) {
+			// Made from the old shape of the section
+			lodMesh->ClearAllMeshSections();
+		}
+	}
+	// Meshes made before levels had their own components kept them as extra sections
+	for (int32 sectionIndex = 2; sectionIndex < mesh->GetNumSections(); sectionIndex++) {
+		mesh->ClearMeshSection(sectionIndex);
+	}
+
+	if (UTunnelOccupancySubsystem* occupancy = GetWorld() ? GetWorld()->GetSubsystem<UTunnelOccupancySubsystem>() : nullptr) {
+		occupancy->MarkMeshDirty(mesh);
+	}
+	MarkScatterDirty(meshIndex);
+}
+
+// Coarse levels are made from the full resolution grids
+void AProceduralTunnel::UploadMeshLod(int32 meshIndex, int32 lod, int32 rows, const FTunnelMeshSectionData& ground, const FTunnelMeshSectionData& wall)
+{
+	UProceduralMeshComponent* mesh = lod == 0 ? TunnelMeshes[meshIndex] : GetOrCreateLodMesh(meshIndex, lod);
+	int32 levels = FMath::Clamp(lodCount, 1, 4);
+	int32 collisionLevel = FMath::Clamp(collisionLod, 0, levels - 1);
+	for (int32 surface = 0; surface < 2; surface++) {
+		const FTunnelMeshSectionData& data = surface == 0 ? ground : wall;
+		FTunnelMeshSectionData lodData;
+		FTunnelMeshGrid grid;
+		if (lod > 0 && GetSectionGrid(rows - 1, data.Vertices, grid)) {
+			FTunnelMeshBuilder::BuildLod(data, grid, 1 << lod, lodData);
+		}
+		else {
+			lodData = data;
+		}
+		lodData.bEnableCollision = lod == collisionLevel;
+
+		FTunnelMeshUpload::UploadSection(mesh, surface, lodData);
+		UMaterialInterface* material = surface == 0 ? groundMaterial : wallMaterial;
+		if (material) {
+			mesh->SetMaterial(surface, material);
 		}
 	}
 }
 
+void AProceduralTunnel::UploadStreamedMesh(int32 meshIndex, FTunnelMeshSectionData&& ground, FTunnelMeshSectionData&& wall)
+{
+	if (!TunnelMeshes.IsValidIndex(meshIndex) || !IsValid(TunnelMeshes[meshIndex]) || !meshRows.IsValidIndex(meshIndex)) {
+		return;
+	}
+	if (meshSections.Num() <= meshIndex) {
+		meshSections.SetNum(meshIndex + 1);
+	}
+	TSharedRef<FTunnelMeshSections> sections = MakeShared<FTunnelMeshSections>();
+	sections->ground = MoveTemp(ground);
+	sections->wall = MoveTemp(wall);
+	meshSections[meshIndex] = sections;
+
+	FPendingTunnelMeshUpload upload;
+	upload.mesh = TunnelMeshes[meshIndex];
+	upload.rows = meshRows[meshIndex];
+	upload.sections = sections;
+	UploadMeshLods(TunnelMeshes[meshIndex], upload);
+}
+
+void AProceduralTunnel::ClearMeshLods(int32 meshIndex)
+{
+	for (int32 lod = 1; lod < 4; lod++) {
+		if (UProceduralMeshComponent* lodMesh = GetLodMesh(meshIndex, lod)) {
+			lodMesh->ClearAllMeshSections();
+			lodMesh->SetVisibility(false);
+		}
+	}
+	if (shownMeshLods.IsValidIndex(meshIndex)) {
+		shownMeshLods[meshIndex] = 0;
+	}
+	if (meshSections.IsValidIndex(meshIndex)) {
+		meshSections[meshIndex].Reset();
+	}
+	if (TunnelMeshes.IsValidIndex(meshIndex) && IsValid(TunnelMeshes[meshIndex])) {
+		TunnelMeshes[meshIndex]->SetVisibility(true);
+	}
+}
+
+void AProceduralTunnel::UpdateMeshLods()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AProceduralTunnel::UpdateMeshLods);
+
+	// Level components and kept geometry of meshes removed by undo or reset
+	int32 usedComponents = TunnelMeshes.Num() * 3;
+	for (int32 index = usedComponents; index < lodMeshes.Num(); index++) {
+		if (IsValid(lodMeshes[index])) {
+			lodMeshes[index]->DestroyComponent();
+		}
+	}
+	if (lodMeshes.Num() > usedComponents) {
+		lodMeshes.SetNum(usedComponents);
+	}
+	if (meshSections.Num() > TunnelMeshes.Num()) {
+		meshSections.SetNum(TunnelMeshes.Num());
+	}
+
+	// The editor has no player camera, full resolution is shown there
+	APlayerController* playerController = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+	if (!playerController || !playerController->PlayerCameraManager) {
+		return;
+	}
+	FVector viewLocation = playerController->PlayerCameraManager->GetCameraLocation();
+	float halfFov = FMath::DegreesToRadians(FMath::Clamp(playerController->PlayerCameraManager->GetFOVAngle(), 1.0f, 170.0f) * 0.5f);
+	float screenMultiple = 1.0f / FMath::Tan(halfFov);
+
+	// Every switch touches two components once, levels that have to be made again share the upload budget
+	// and the remaining meshes switch on the next frame
+	double startTime = FPlatformTime::Seconds();
+	double budgetSeconds = meshUploadBudgetMs > 0.0f ? meshUploadBudgetMs / 1000.0 : TNumericLimits<double>::Max();
+	if (shownMeshLods.Num() < TunnelMeshes.Num()) {
+		shownMeshLods.SetNumZeroed(TunnelMeshes.Num());
+	}
+	for (int32 meshIndex = 0; meshIndex < TunnelMeshes.Num(); meshIndex++) {
+		UProceduralMeshComponent* mesh = TunnelMeshes[meshIndex];
+		// Streamed out or not uploaded yet
+		if (!IsValid(mesh) || mesh->GetNumSections() < 2) {
+			continue;
+		}
+		int32 lod = GetMeshLod(mesh, viewLocation, screenMultiple);
+		if (lod != shownMeshLods[meshIndex] && ShowMeshLod(meshIndex, lod) && FPlatformTime::Seconds() - startTime >= budgetSeconds) {
+			break;
+		}
+	}
+}
+
+bool AProceduralTunnel::ShowMeshLod(int32 meshIndex, int32 lod)
+{
+	UProceduralMeshComponent* shown = lod == 0 ? TunnelMeshes[meshIndex] : GetLodMesh(meshIndex, lod);
+	if (!shown || shown->GetNumSections() < 2) {
+		// Released when it was hidden, made again from the full resolution sections
+		TSharedPtr<const FTunnelMeshSections> sections = GetMeshSections(meshIndex);
+		if (!meshRows.IsValidIndex(meshIndex) || !sections.IsValid()) {
+			return false;
+		}
+		UploadMeshLod(meshIndex, lod, meshRows[meshIndex], sections->ground, sections->wall);
+		shown = lod == 0 ? TunnelMeshes[meshIndex] : GetLodMesh(meshIndex, lod);
+	}
+
+	int32 hiddenLevel = shownMeshLods[meshIndex];
+	UProceduralMeshComponent* hidden = hiddenLevel == 0 ? TunnelMeshes[meshIndex] : GetLodMesh(meshIndex, hiddenLevel);
+	shown->SetVisibility(true);
+	if (hidden) {
+		hidden->SetVisibility(false);
+		// Level 0 is what saving, export and occupancy read, the collision level has to stay for traces
+		int32 collisionLevel = FMath::Clamp(collisionLod, 0, FMath::Clamp(lodCount, 1, 4) - 1);
+		if (hiddenLevel != 0 && hiddenLevel != collisionLevel) {
+			hidden->ClearAllMeshSections();
+		}
+	}
+	shownMeshLods[meshIndex] = (uint8)lod;
+	return true;
+}
+
+// Same screen size measure the engine uses for static mesh LODs: bounds diameter relative to the screen height
+int32 AProceduralTunnel::GetMeshLod(const UProceduralMeshComponent* mesh, const FVector& viewLocation, float screenMultiple) const
+{
+	const FBoxSphereBounds& bounds = mesh->Bounds;
+	float distance = FMath::Max(1.0f, (float)FVector::Distance(bounds.Origin, viewLocation));
+	float screenSize = screenMultiple * bounds.SphereRadius / distance;
+
+	int32 levels = FMath::Clamp(lodCount, 1, 4);
+	int32 lod = 0;
+	while (lod + 1 < levels && lodScreenSizes.IsValidIndex(lod + 1) && screenSize < lodScreenSizes[lod + 1]) {
+		lod++;
+	}
+	return lod;
+}
+
+UProceduralMeshComponent* AProceduralTunnel::GetOrCreateTunnelMesh(int32 meshIndex)
+{
+	if (TunnelMeshes.IsValidIndex(meshIndex) && IsValid(TunnelMeshes[meshIndex])) {
+		return TunnelMeshes[meshIndex];
+	}
+
+	if (TunnelMeshes.Num() <= meshIndex) {
+		TunnelMeshes.SetNumZeroed(meshIndex + 1);
+	}
+	// Levels left from a mesh removed by undo or reset belong to the old section
+	ClearMeshLods(meshIndex);
+	UProceduralMeshComponent* mesh = NewObject<UProceduralMeshComponent>(this, NAME_None, RF_Transactional);
+	mesh->bUseAsyncCooking = true;
+	mesh->SetupAttachment(RootComponent);
+	mesh->RegisterComponent();
+	AddInstanceComponent(mesh);
+	TunnelMeshes[meshIndex] = mesh;
+	return mesh;
+}
+
+UProceduralMeshComponent* AProceduralTunnel::GetLodMesh(int32 meshIndex, int32 lod) const
+{
+	int32 index = meshIndex * 3 + lod - 1;
+	return lod > 0 && lodMeshes.IsValidIndex(index) && IsValid(lodMeshes[index]) ? lodMeshes[index] : nullptr;
+}
+
+// Level components are attached to the root like the tunnel meshes, they start hidden so making them costs no render data
+UProceduralMeshComponent* AProceduralTunnel::GetOrCreateLodMesh(int32 meshIndex, int32 lod)
+{
+	if (UProceduralMeshComponent* mesh = GetLodMesh(meshIndex, lod)) {
+		return mesh;
+	}
+
+	int32 index = meshIndex * 3 + lod - 1;
+	if (lodMeshes.Num() <= index) {
+		lodMeshes.SetNumZeroed(index + 1);
+	}
+	UProceduralMeshComponent* mesh = NewObject<UProceduralMeshComponent>(this, NAME_None, RF_Transactional);
+	mesh->bUseAsyncCooking = true;
+	mesh->SetVisibility(false);
+	mesh->SetupAttachment(RootComponent);
+	mesh->RegisterComponent();
+	AddInstanceComponent(mesh);
+	lodMeshes[index] = mesh;
+	return mesh;
+}
+
+void AProceduralTunnel::RegenerateScatter()
+{
+	for (int32 meshIndex = 0; meshIndex < TunnelMeshes.Num(); meshIndex++) {
+		dirtyScatterSections.Add(meshIndex);
+	}
+}
+
+void AProceduralTunnel::MarkScatterDirty(int32 meshIndex)
+{
+	if (meshIndex != INDEX_NONE && scatterRules.Num() > 0) {
+		dirtyScatterSections.Add(meshIndex);
+	}
+}
+
+void AProceduralTunnel::ClearScatter(int32 meshIndex)
+{
+	for (int32 rule = 0; rule < scatterRules.Num(); rule++) {
+		int32 index = meshIndex * scatterRules.Num() + rule;
+		if (scatterComponents.IsValidIndex(index) && IsValid(scatterComponents[index])) {
+			scatterComponents[index]->ClearInstances();
+		}
+	}
+}
+
+void AProceduralTunnel::UpdateScatter()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AProceduralTunnel::UpdateScatter);
+
+	// Components are laid out by the rule count, changed rules start over
+	uint32 rulesHash = FTunnelScatter::GetRulesHash(scatterRules, scatterSeed);
+	if (rulesHash != scatterRulesHash) {
+		scatterRulesHash = rulesHash;
+		for (UHierarchicalInstancedStaticMeshComponent* component : scatterComponents) {
+			if (IsValid(component)) {
+				component->DestroyComponent();
+			}
+		}
+		scatterComponents.Empty();
+		dirtyScatterSections.Reset();
+		if (scatterRules.Num() > 0) {
+			RegenerateScatter();
+		}
+	}
+
+	// Sections removed by undo or reset
+	int32 usedComponents = TunnelMeshes.Num() * scatterRules.Num();
+	for (int32 index = usedComponents; index < scatterComponents.Num(); index++) {
+		if (IsValid(scatterComponents[index])) {
+			scatterComponents[index]->DestroyComponent();
+		}
+	}
+	if (scatterComponents.Num() > usedComponents) {
+		scatterComponents.SetNum(usedComponents);
+	}
+	if (dirtyScatterSections.Num() == 0) {
+		return;
+	}
+
+	// Surface grids are read from the full detail mesh sections, frames from the spline frame table
+	TArray<int32> meshIndices;
+	TArray<FTunnelScatterSection> sections;
+	FTransform splineToActor = SplineComponent->GetRelativeTransform();
+	for (int32 meshIndex : dirtyScatterSections) {
+		UProceduralMeshComponent* mesh = TunnelMeshes.IsValidIndex(meshIndex) ? TunnelMeshes[meshIndex] : nullptr;
+		if (!IsValid(mesh)) {
+			continue;
+		}
+		// Streamed out, instances come back with the section
+		if (mesh->GetNumSections() < 2 || !meshRows.IsValidIndex(meshIndex) || meshIndex >= splineFrames.GetNumSegments()) {
+			ClearScatter(meshIndex);
+			continue;
+		}
+		FTunnelScatterSection& section = sections.AddDefaulted_GetRef();
+		meshIndices.Add(meshIndex);
+		section.Ground = mesh->GetProcMeshSection(0)->ProcVertexBuffer;
+		section.Wall = mesh->GetProcMeshSection(1)->ProcVertexBuffer;
+		section.Rows = meshRows[meshIndex];
+		section.RightWallColumns = numberOfVerticalPoints;
+		section.RoofColumns = numberOfHorizontalPoints;
+		section.Length = splineFrames.GetSegmentLength(meshIndex);
+		// Loop k is at spline frame sample k
+		TArrayView<const FSplineFrame> frames = splineFrames.GetSegmentFrames(meshIndex);
+		section.Forward.SetNumUninitialized(section.Rows);
+		section.Up.SetNumUninitialized(section.Rows);
+		for (int32 row = 0; row < section.Rows && frames.Num() > 0; row++) {
+			const FSplineFrame& frame = frames[FMath::Min(row, frames.Num() - 1)];
+			section.Forward[row] = splineToActor.TransformVectorNoScale(frame.Tangent);
+			section.Up[row] = splineToActor.TransformVectorNoScale(frame.Up);
+		}
+	}
+	dirtyScatterSections.Reset();
+
+	// Every section and rule is placed on its own, the seed makes the result independent of the thread it runs on
+	int32 ruleCount = scatterRules.Num();
+	TArray<TArray<FTransform>> placements;
+	placements.SetNum(sections.Num() * ruleCount);
+	ParallelFor(placements.Num(), [this, &sections, &meshIndices, &placements, ruleCount](int32 index)
+	{
+		int32 sectionIndex = index / ruleCount;
+		int32 rule = index % ruleCount;
+		FTunnelScatter::PlaceInstances(sections[sectionIndex], scatterRules[rule],
+			FTunnelScatter::GetSectionSeed(scatterSeed, meshIndices[sectionIndex], rule), placements[index]);
+	});
+
+	for (int32 index = 0; index < placements.Num(); index++) {
+		int32 componentIndex = meshIndices[index / ruleCount] * ruleCount + index % ruleCount;
+		// Sections without instances of a rule get no component
+		if (placements[index].Num() == 0) {
+			if (scatterComponents.IsValidIndex(componentIndex) && IsValid(scatterComponents[componentIndex])) {
+				scatterComponents[componentIndex]->ClearInstances();
+			}
+			continue;
+		}
+		UHierarchicalInstancedStaticMeshComponent* component = GetOrCreateScatterComponent(meshIndices[index / ruleCount], index % ruleCount);
+		component->ClearInstances();
+		component->AddInstances(placements[index], false);
+	}
+}
+
+UHierarchicalInstancedStaticMeshComponent* AProceduralTunnel::GetOrCreateScatterComponent(int32 meshIndex, int32 rule)
+{
+	int32 index = meshIndex * scatterRules.Num() + rule;
+	if (scatterComponents.IsValidIndex(index) && IsValid(scatterComponents[index])) {
+		return scatterComponents[index];
+	}
+
+	if (scatterComponents.Num() <= index) {
+		scatterComponents.SetNumZeroed(index + 1);
+	}
+	const FTunnelScatterRule& scatterRule = scatterRules[rule];
+	UHierarchicalInstancedStaticMeshComponent* component = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, NAME_None, RF_Transactional);
+	component->SetStaticMesh(scatterRule.Mesh);
+	component->SetCullDistances(scatterRule.CullStartDistance, scatterRule.CullEndDistance);
+	component->SetCollisionEnabled(scatterRule.EnableCollision ? ECollisionEnabled::QueryAndPhysics : ECollisionEnabled::NoCollision);
+	component->SetupAttachment(RootComponent);
+	component->RegisterComponent();
+	AddInstanceComponent(component);
+	scatterComponents[index] = component;
+	return component;
+}
+
 // Initialize variables required for the procedural generation loop
 void AProceduralTunnel::InitializeProceduralGenerationLoopVariables(int32 firstIndex, int32 lastIndex) {
 	meshLoopFirstIndex = abs(firstIndex);
@@ -362,64 +1584,135 @@ void AProceduralTunnel::InitializeProceduralGenerationLoopVariables(int32 firstI
 			parentsParentTunnel = Cast<AProceduralTunnel>(parentIntersection->parentTunnel);
 		}
 	}
+
+	UpdateDeformationField();
+	UpdateSplineFrames();
+	// Curves are read for every wall and roof vertex, sections evaluate the baked tables instead
+	bakedDeformCurve.Bake(deformCurve);
+	bakedStopDeformCurve.Bake(stopDeformCurve);
+}
+
+void AProceduralTunnel::UpdateSplineFrames()
+{
+	TUNNEL_GENERATION_PHASE_SCOPE(SplineSampling);
+	// Direction changes are measured as the distance they move the tunnel wall
+	float directionTolerance = regenerationTolerance / FMath::Max(widthScale * 100.0f, 1.0f);
+	splineFrames.Update(SplineComponent, horizontalPointSize, useRotationMinimizingFrames, regenerationTolerance, directionTolerance);
+}
+
+// Make sure deformation values are decoded before generating vertices
+void AProceduralTunnel::UpdateDeformationField() {
+	// Texture x coordinate goes from 0 to noiseTextureXresolution and y around the tunnel
+	int32 fieldWidth = (int32)noiseTextureXresolution + 1;
+	int32 fieldHeight = loopAroundTunnelLastIndex + 1;
+
+	if (IsValid(deformTexture)) {
+		TSharedPtr<const FTunnelDeformationField> textureField = FTunnelDeformationField::FindOrDecode(deformTexture);
+		if (textureField.IsValid()) {
+			deformationField = textureField;
+			isDeformationFieldBaked = false;
+			return;
+		}
+	}
+
+	// Blueprint override is called once per texel here instead of once per vertex on every regeneration
+	if (GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(AProceduralTunnel, GetPixelValue))) {
+		if (!isDeformationFieldBaked || !deformationField.IsValid() || deformationField->GetWidth() != fieldWidth || deformationField->GetHeight() != fieldHeight) {
+			TSharedPtr<FTunnelDeformationField> bakedField = MakeShared<FTunnelDeformationField>();
+			bakedField->InitFromSampler(fieldWidth, fieldHeight, [this](int32 x, int32 y) { return GetPixelValue(x, y); });
+			deformationField = bakedField;
+			isDeformationFieldBaked = true;
+		}
+		return;
+	}
+
+	// Without a texture or override the surface is not deformed, noise is only used when asked for
+	deformationField = useProceduralDeformation ? FTunnelDeformationField::FindOrCreateProcedural(fieldWidth, fieldHeight) : FTunnelDeformationField::FindOrCreateFlat(fieldWidth, fieldHeight);
+	isDeformationFieldBaked = false;
+}
+
+void AProceduralTunnel::ResetDeformationField() {
+	// The texture may have been edited, decode it again instead of reusing the shared field
+	FTunnelDeformationField::Evict(deformTexture);
+	deformationField.Reset();
+	isDeformationFieldBaked = false;
 }
 
 // Calculate how many steps we can fit between selected tunnel section also calculate how big the last step can be
-void AProceduralTunnel::CalculateStepsInTunnelSection() {
-	// End spline point distance on spline
-	float locationOnSplineWhereMeshEnds = SplineComponent->GetDistanceAlongSplineAtSplinePoint(SplineComponent->GetNumberOfSplinePoints() - (indexOfCurrentMesh + 1));
-	// Starting spline point distance on spline
-	float locationOnSplineWhereMeshStarts = SplineComponent->GetDistanceAlongSplineAtSplinePoint(SplineComponent->GetNumberOfSplinePoints() - (indexOfCurrentMesh + 2));
-	stepCountToMakeCurrentMesh = FMath::Floor((locationOnSplineWhereMeshEnds - locationOnSplineWhereMeshStarts) / horizontalPointSize);
-	float remainder = ((locationOnSplineWhereMeshEnds - locationOnSplineWhereMeshStarts) / horizontalPointSize) - (float)stepCountToMakeCurrentMesh;
-	lastStepSizeOnSpline = horizontalPointSize * remainder + horizontalPointSize;
+void AProceduralTunnel::CalculateStepsInTunnelSection(FTunnelSectionState& state) const {
+	// Spline segment between the start and end spline point of the section
+	int32 segment = SplineComponent->GetNumberOfSplinePoints() - (state.indexOfCurrentMesh + 2);
+	if (segment < 0 || segment >= splineFrames.GetNumSegments()) {
+		state.stepCountToMakeCurrentMesh = 0;
+		return;
+	}
+	float sectionLength = splineFrames.GetSegmentLength(segment);
+	state.stepCountToMakeCurrentMesh = FMath::Floor(sectionLength / horizontalPointSize);
+	float remainder = (sectionLength / horizontalPointSize) - (float)state.stepCountToMakeCurrentMesh;
+	state.lastStepSizeOnSpline = horizontalPointSize * remainder + horizontalPointSize;
 }
 
 // Reset the current mesh end data
-void AProceduralTunnel::ResetCurrentMeshEndData() {
-	currentMeshEndData = FMeshSectionEnd();
+void AProceduralTunnel::ResetCurrentMeshEndData(FTunnelSectionState& state) const {
+	state.currentMeshEndData = FMeshSectionEnd();
 }
 
 // Generate vertices and UVs for the tunnel mesh
-void AProceduralTunnel::GenerateVerticesAndUVs(bool isMeshPartUpdate, int32 lastIndex) {
-	for (stepIndexInsideMesh = 0; stepIndexInsideMesh <= stepCountToMakeCurrentMesh; stepIndexInsideMesh++) {
+void AProceduralTunnel::GenerateVerticesAndUVs(FTunnelSectionState& state, bool isMeshPartUpdate, int32 lastIndex) const {
+	TUNNEL_GENERATION_PHASE_SCOPE(VertexGeneration);
+	for (state.stepIndexInsideMesh = 0; state.stepIndexInsideMesh <= state.stepCountToMakeCurrentMesh; state.stepIndexInsideMesh++) {
 		// Clear arrays holding vertice data of start of tunnel
-		if (IsFirstLoopOfWholeTunnel()) {
-			tunnelStartMeshData.Reset();
+		if (IsFirstLoopOfWholeTunnel(state)) {
+			state.tunnelStartMeshData.Reset();
+			state.hasTunnelStartMeshData = true;
+		}
+		// Seams shared with the neighbouring sections of this generation pass
+		if (state.stepIndexInsideMesh == 0 && state.startSeam) {
+			state.groundVertices.Append(state.startSeam->GroundVertives);
+			state.wallVertices.Append(state.startSeam->WallVertices);
+		}
+		else if (IsOnTheEndOfCurrentMeshSection(state) && state.endSeam) {
+			state.groundVertices.Append(state.endSeam->GroundVertives);
+			state.wallVertices.Append(state.endSeam->WallVertices);
+			state.currentMeshEndData = *state.endSeam;
 		}
 		// If true we will accuire previous mesh sections end vertice data to make seamless connection between mesh sections 
-		if (ShouldUseMeshEndData(isMeshPartUpdate)) {
-			GetMeshEndData(isMeshPartUpdate);
+		else if (ShouldUseMeshEndData(state, isMeshPartUpdate)) {
+			GetMeshEndData(state, isMeshPartUpdate);
 		} 
-		else if (IsOnTheEndOfTunnel() && indexOfLastMesh == 0 && !isMeshPartUpdate && IsValid(connectedActor) && isEndConnected) {
+		else if (IsOnTheEndOfTunnel(state) && indexOfLastMesh == 0 && !isMeshPartUpdate && IsValid(connectedActor) && isEndConnected) {
 			if (connectedActor->tunnelType == TunnelType::StartTunnel) {
 				TArray<FVector> ground = TransformVectors(connectedActor->tunnelStartMeshData.GroundVertives, connectedActor, this);
 				TArray<FVector> walls = TransformVectors(connectedActor->tunnelStartMeshData.WallVertices, connectedActor, this);
-				groundVertices.Append(ground);
-				wallVertices.Append(walls);
-				currentMeshEndData.GroundVertives = ground;
-				currentMeshEndData.WallVertices = walls;
+				state.groundVertices.Append(ground);
+				state.wallVertices.Append(walls);
+				state.currentMeshEndData.GroundVertives = ground;
+				state.currentMeshEndData.WallVertices = walls;
 			}
 			else {
 				TArray<FVector> ground = TransformVectors(connectedActor->meshEnds[connectedActor->meshEnds.Num()-1].GroundVertives, connectedActor, this);
 				TArray<FVector> walls = TransformVectors(connectedActor->meshEnds[connectedActor->meshEnds.Num() - 1].WallVertices, connectedActor, this);
 				Algo::Reverse(ground);
 				Algo::Reverse(walls);
-				groundVertices.Append(ground);
-				wallVertices.Append(walls);
-				currentMeshEndData.GroundVertives = ground; 
-				currentMeshEndData.WallVertices = walls;
+				state.groundVertices.Append(ground);
+				state.wallVertices.Append(walls);
+				state.currentMeshEndData.GroundVertives = ground; 
+				state.currentMeshEndData.WallVertices = walls;
 			}
 		}
+		// Loops that did not move since the mesh was made are copied from it
+		else if (ShouldReuseExistingLoop(state)) {
+			AppendExistingLoop(state);
+		}
 		else {
 			// This is default way of creting vertices around the tunnel
-			GenerateVerticesForCurrentLoop(lastIndex);
+			GenerateVerticesForCurrentLoop(state, lastIndex);
 		}
 	}
 }
 
 // Transforms mesh end data vectors from other actors local space to other actor local space
-TArray<FVector> AProceduralTunnel::TransformVectors(const TArray<FVector>& Vectors, AActor* SourceActor, AActor* TargetActor)
+TArray<FVector> AProceduralTunnel::TransformVectors(const TArray<FVector>& Vectors, const AActor* SourceActor, const AActor* TargetActor) const
 {
 	TArray<FVector> TransformedVectors;
 
@@ -454,21 +1747,21 @@ TArray<FVector> AProceduralTunnel::TransformVectors(const TArray<FVector>& Vecto
 }
 
 // Returns boolean if we should use previous mesh section end data to make seamless connection between sections
-bool AProceduralTunnel::ShouldUseMeshEndData (bool isMeshPartUpdate) {
-	int32 meshEndIndex = SplineComponent->GetNumberOfSplinePoints() - 3 - indexOfCurrentMesh;
+bool AProceduralTunnel::ShouldUseMeshEndData (FTunnelSectionState& state, bool isMeshPartUpdate) const {
+	int32 meshEndIndex = SplineComponent->GetNumberOfSplinePoints() - 3 - state.indexOfCurrentMesh;
 	// If there is intersection added and we are in the end of current mesh 
 	// return false because we want to recreate end before connecting with intersection
-	if(IsValid(intersection) && stepIndexInsideMesh == stepCountToMakeCurrentMesh && indexOfCurrentMesh == 0) {
+	if(IsValid(intersection) && state.stepIndexInsideMesh == state.stepCountToMakeCurrentMesh && state.indexOfCurrentMesh == 0) {
 		return false;
 	} 
 	else 
 	{
 		// If we are in the first step on creating current mesh section. And there is mesh end we can use
-		if((stepIndexInsideMesh == 0) && (meshEnds.Num() > 0) && (meshEndIndex >= 0) && (meshEnds.Num() - 1 >= meshEndIndex)) {
+		if((state.stepIndexInsideMesh == 0) && (meshEnds.Num() > 0) && (meshEndIndex >= 0) && (meshEnds.Num() - 1 >= meshEndIndex)) {
 			return true;
 		}
 		// If we are in the end of last mesh to create and mesh part is udpated
-		if(indexOfCurrentMesh == indexOfLastMesh && stepIndexInsideMesh == stepCountToMakeCurrentMesh && isMeshPartUpdate) {
+		if(state.indexOfCurrentMesh == indexOfLastMesh && state.stepIndexInsideMesh == state.stepCountToMakeCurrentMesh && isMeshPartUpdate) {
 			return true;	
 		}
 		return false;
@@ -476,146 +1769,162 @@ bool AProceduralTunnel::ShouldUseMeshEndData (bool isMeshPartUpdate) {
 }
 
 // Use the previous meshs sections end vertices data for the current tunnel section
-void AProceduralTunnel::GetMeshEndData(bool isMeshPartUpdate) {
+void AProceduralTunnel::GetMeshEndData(FTunnelSectionState& state, bool isMeshPartUpdate) const {
 	// Calculate the index that provides the correct mesh end data from the array (previous meshes end)
-	int32 meshEndIndex = SplineComponent->GetNumberOfSplinePoints() - 3 - indexOfCurrentMesh; 
+	int32 meshEndIndex = SplineComponent->GetNumberOfSplinePoints() - 3 - state.indexOfCurrentMesh; 
 
 	// Check if we are at the end of the last mesh that we are generating and the height is adjusted
 	// In this case, we want to use this mesh's previously saved end data
-	if (indexOfCurrentMesh == indexOfLastMesh && stepIndexInsideMesh == stepCountToMakeCurrentMesh && isMeshPartUpdate) 
+	if (state.indexOfCurrentMesh == indexOfLastMesh && state.stepIndexInsideMesh == state.stepCountToMakeCurrentMesh && isMeshPartUpdate) 
 	{																													 
-		meshEndIndex = meshEnds.Num() - 1 - indexOfCurrentMesh;
-		currentMeshEndData = meshEnds[meshEndIndex];
+		meshEndIndex = meshEnds.Num() - 1 - state.indexOfCurrentMesh;
+		state.currentMeshEndData = meshEnds[meshEndIndex];
 	}
 
 	// Get the end data for the current tunnel section
 	FMeshSectionEnd end = meshEnds[meshEndIndex]; 
 
 	// Add end data to arrays that are used to generate the tunnel
-	groundVertices.Append(end.GroundVertives);	  
-	groundUV.Append(end.GroundUV);
-	wallVertices.Append(end.WallVertices);
-	wallUV.Append(end.WallUV);
+	state.groundVertices.Append(end.GroundVertives);	  
+	state.groundUV.Append(end.GroundUV);
+	state.wallVertices.Append(end.WallVertices);
+	state.wallUV.Append(end.WallUV);
 }
 
 // Generate vector locations around the tunnel
-void AProceduralTunnel::GenerateVerticesForCurrentLoop(int32 lastIndex) {
+void AProceduralTunnel::GenerateVerticesForCurrentLoop(FTunnelSectionState& state, int32 lastIndex) const {
 	// Initialize start location and right vector 
-	InitializeStartVectorRightVectorAndValueInTexture();
+	InitializeStartVectorRightVectorAndValueInTexture(state);
+
+	// Read deformation of the whole loop around the tunnel at once
+	state.deformValues.SetNumUninitialized(loopAroundTunnelLastIndex + 1);
+	deformationField->SampleColumn(state.forwardStepInDeformTexture, 0, state.deformValues.Num(), state.deformValues.GetData());
 
 	// Loop through each point in the loop that goes around tunnel
-	for (loopAroundTunnelCurrentIndex = 0; loopAroundTunnelCurrentIndex <= loopAroundTunnelLastIndex; loopAroundTunnelCurrentIndex++) {
+	for (state.loopAroundTunnelCurrentIndex = 0; state.loopAroundTunnelCurrentIndex <= loopAroundTunnelLastIndex; state.loopAroundTunnelCurrentIndex++) {
 		// Get the surface index and array index for this point
-		surfaceIndex = GetSurfaceIndex();
+		state.surfaceIndex = GetSurfaceIndex(state);
 		// Get index of current vertice. Can be used to retrieve right vertice location from other tunnel in conncetion event
-		verticeIndex = GetIndexOfVertice();
+		state.verticeIndex = GetIndexOfVertice(state);
 
 		// Check if this is the first loop around and if it's a special tunnel type
-		bool isFirstLoopAround = GetIsFirstLoopAround();
+		bool isFirstLoopAround = GetIsFirstLoopAround(state);
 
 		// Get vertice for child tunnel of intersection from the parent intersection when we are in first loop of tunnel. 
 		// This is needed to create seamless cap between intersection and child tunnel
 		if (isFirstLoopAround && tunnelType != TunnelType::StartTunnel) {
-			latestVertice = GetVerticeForStartOfChildTunnel();
+			state.latestVertice = GetVerticeForStartOfChildTunnel(state);
 		}
 		else {
 			// Get the vertice for a default tunnel
-			latestVertice = GetVerticeForDefaultTunnel(isFirstLoopAround);
+			state.latestVertice = GetVerticeForDefaultTunnel(state, isFirstLoopAround);
 		}
 
 		// Adjust the latest vertice for overlap
-		latestVertice = AdjustLatestVerticeForOverlap(latestVertice, surfaceIndex);
+		state.latestVertice = AdjustLatestVerticeForOverlap(state, state.latestVertice, state.surfaceIndex);
 
 		// Save the first vertice if needed
-		SaveFirstVerticeIfNeeded(latestVertice);
+		SaveFirstVerticeIfNeeded(state, state.latestVertice);
 
 		// Add the vertice to the appropriate array
-		AddCreatedVerticeToArrays(latestVertice, surfaceIndex);
+		AddCreatedVerticeToArrays(state, state.latestVertice, state.surfaceIndex);
 
 		// Save the first loop vertice data if this is the first loop of the whole tunnel
-		if (IsFirstLoopOfWholeTunnel()) {
-			SaveFirstLoopVerticeData(surfaceIndex, latestVertice);
+		if (IsFirstLoopOfWholeTunnel(state)) {
+			SaveFirstLoopVerticeData(state, state.surfaceIndex, state.latestVertice);
 		}
 
 		// Save the end mesh vertice data if this is the end of the current mesh
-		if (IsOnTheEndOfCurrentMeshSection()) {
-			SaveEndMeshVerticeData(surfaceIndex, latestVertice);
+		if (IsOnTheEndOfCurrentMeshSection(state)) {
+			SaveEndMeshVerticeData(state, state.surfaceIndex, state.latestVertice);
 		}
 	}
 }
 
 // Returns vertice for tunnel that is child tunnel of intersection.
-FVector AProceduralTunnel::GetVerticeForStartOfChildTunnel() {
+FVector AProceduralTunnel::GetVerticeForStartOfChildTunnel(FTunnelSectionState& state) const {
 	FVector vertice;
 	switch (tunnelType) {
 	case 0:
-		vertice = RightTunnelStart();
+		vertice = RightTunnelStart(state);
 		break;
 	case 1:
-		vertice = LeftTunnelStart();
+		vertice = LeftTunnelStart(state);
 		break;
 	case 2:
-		vertice = StraightTunnelStart();
+		vertice = StraightTunnelStart(state);
 		break;
 	}
 	return vertice;
 }
 
 // Returns true if we are in the end of the tunnel
-bool AProceduralTunnel::IsOnTheEndOfTunnel() {
-	return indexOfCurrentMesh == indexOfLastMesh && IsOnTheEndOfCurrentMeshSection();
+bool AProceduralTunnel::ShouldReuseExistingLoop(FTunnelSectionState& state) const {
+	// End loop fills the mesh end data and the first loop of the tunnel its start data, those are always generated
+	return state.patchExisting
+		&& (state.stepIndexInsideMesh < state.firstDirtyLoop || state.stepIndexInsideMesh > state.lastDirtyLoop)
+		&& !IsOnTheEndOfCurrentMeshSection(state)
+		&& !IsFirstLoopOfWholeTunnel(state);
+}
+void AProceduralTunnel::AppendExistingLoop(FTunnelSectionState& state) const {
+	int32 rows = state.stepCountToMakeCurrentMesh + 1;
+	int32 groundColumns = state.existing->ground.Vertices.Num() / rows;
+	int32 wallColumns = state.existing->wall.Vertices.Num() / rows;
+	state.groundVertices.Append(state.existing->ground.Vertices.GetData() + state.stepIndexInsideMesh * groundColumns, groundColumns);
+	state.wallVertices.Append(state.existing->wall.Vertices.GetData() + state.stepIndexInsideMesh * wallColumns, wallColumns);
+}
+bool AProceduralTunnel::IsOnTheEndOfTunnel(FTunnelSectionState& state) const {
+	return state.indexOfCurrentMesh == indexOfLastMesh && IsOnTheEndOfCurrentMeshSection(state);
 }
 
 // Returns true if we are in the end of current mesh section.
-bool AProceduralTunnel::IsOnTheEndOfCurrentMeshSection() {
+bool AProceduralTunnel::IsOnTheEndOfCurrentMeshSection(FTunnelSectionState& state) const {
 	// Returns true if the current loop index is equal to the last loop index, indicating the end of the current mesh.
-	return stepIndexInsideMesh == stepCountToMakeCurrentMesh;
+	return state.stepIndexInsideMesh == state.stepCountToMakeCurrentMesh;
 }
 
 // Returns the appropriate vertice for a default tunnel segment based on the surface index, whether it's the first loop around the tunnel, and if there's an intersection added.
-FVector AProceduralTunnel::GetVerticeForDefaultTunnel(bool isFirstLoopAround) {
+FVector AProceduralTunnel::GetVerticeForDefaultTunnel(FTunnelSectionState& state, bool isFirstLoopAround) const {
 	FVector vertice;
-	switch (surfaceIndex) {
+	switch (state.surfaceIndex) {
 	case 0:
-		vertice = GetVerticeOnGround();
+		vertice = GetVerticeOnGround(state);
 		break;
 	case 1:
-		vertice = GetVerticeOnRightWall(isFirstLoopAround);
+		vertice = GetVerticeOnRightWall(state, isFirstLoopAround);
 		break;
 	case 2:
-		vertice = GetVerticeOnRoof();
+		vertice = GetVerticeOnRoof(state);
 		break;
 	case 3:
-		vertice = GetVerticeOnLeftWall(isFirstLoopAround);
+		vertice = GetVerticeOnLeftWall(state, isFirstLoopAround);
 		break;
 	}
 	return vertice;
 }
 
 // Adjusts the latest vertice position for overlap, ensuring a smooth transition between tunnel segments.
-FVector AProceduralTunnel::AdjustLatestVerticeForOverlap(FVector vertice, int32 surface) {
+FVector AProceduralTunnel::AdjustLatestVerticeForOverlap(FTunnelSectionState& state, FVector vertice, int32 surface) const {
 	FVector previousLoopVertice = FVector(0.0f, 0.0f, 0.0f);
 	// On the walls/roof
 	if (surface != 0) {
 		int32 previousVertice = numberOfHorizontalPoints + numberOfVerticalPoints * 2;
-		if (wallVertices.Num() - previousVertice >= 0) {
-			previousLoopVertice = wallVertices[wallVertices.Num() - previousVertice];
+		if (state.wallVertices.Num() - previousVertice >= 0) {
+			previousLoopVertice = state.wallVertices[state.wallVertices.Num() - previousVertice];
 		}
 	}
 	// On the floor
 	else {
-		if (groundVertices.Num() - numberOfHorizontalPoints >= 0) {
-			previousLoopVertice = groundVertices[groundVertices.Num() - numberOfHorizontalPoints];
+		if (state.groundVertices.Num() - numberOfHorizontalPoints >= 0) {
+			previousLoopVertice = state.groundVertices[state.groundVertices.Num() - numberOfHorizontalPoints];
 		}
 	}
-	// This is forward vector pointing at startLocationOnSpline
-	forwardVector;
-
+	// Forward vector is pointing at startLocationOnSpline
 	// If a valid vertice is found for comparison, adjust the current vertice position if necessary.
 	if (previousLoopVertice != FVector(0.0f, 0.0f, 0.0f)) {
 		// Calculate the projections of the vectors onto the forward vector
-		float currentVerticeProjection = FVector::DotProduct((vertice - startLocationOnSpline).GetSafeNormal(), forwardVector);
-		float previousVerticeProjection = FVector::DotProduct((previousLoopVertice - startLocationOnSpline).GetSafeNormal(), forwardVector);
+		float currentVerticeProjection = FVector::DotProduct((vertice - state.startLocationOnSpline).GetSafeNormal(), state.forwardVector);
+		float previousVerticeProjection = FVector::DotProduct((previousLoopVertice - state.startLocationOnSpline).GetSafeNormal(), state.forwardVector);
 
 		// If previous vertices projection is larger than current vertices projection, we set current vertice to previous vertices location.
 		if (previousVerticeProjection >= currentVerticeProjection) {
@@ -627,90 +1936,90 @@ FVector AProceduralTunnel::AdjustLatestVerticeForOverlap(FVector vertice, int32
 }
 
 // Saves the first vertice of the loop if the current index of the loop around the tunnel is 1.
-void AProceduralTunnel::SaveFirstVerticeIfNeeded(FVector vertice) {
-	if (loopAroundTunnelCurrentIndex == 0) {
-		firstVertice = vertice;
+void AProceduralTunnel::SaveFirstVerticeIfNeeded(FTunnelSectionState& state, FVector vertice) const {
+	if (state.loopAroundTunnelCurrentIndex == 0) {
+		state.firstVertice = vertice;
 	}
 }
 
 // Adds the generated vertice to the appropriate array based on the surface type.
-void AProceduralTunnel::AddCreatedVerticeToArrays(FVector vertice, int32 surface) {
+void AProceduralTunnel::AddCreatedVerticeToArrays(FTunnelSectionState& state, FVector vertice, int32 surface) const {
 	// If the surface type is 0 (floor), add the vertice to the groundVertices array.
 	if (surface == 0) {
-		groundVertices.Add(vertice);
+		state.groundVertices.Add(vertice);
 	}
 	// For all other surface types (1 - right wall, 2 - roof, 3 - left wall),
 	// add the vertice to the wallVertices array.
 	else {
-		wallVertices.Add(vertice);
+		state.wallVertices.Add(vertice);
 	}
 }
 
 // Determines if the current loop is the first loop of the entire tunnel.
-bool AProceduralTunnel::IsFirstLoopOfWholeTunnel() {
+bool AProceduralTunnel::IsFirstLoopOfWholeTunnel(FTunnelSectionState& state) const {
 	// Returns true if the conditions for the first loop of the whole tunnel are met:
 	// - The spline point index (indexOfCurrentMesh) is one less than the total number of spline points,
 	//   or there are no tunnel meshes.
 	// - The point cap loop index (stepIndexInsideMesh) is 0.
-	return ((SplineComponent->GetNumberOfSplinePoints() - 1) - indexOfCurrentMesh == 1 || TunnelMeshes.Num() == 0) && stepIndexInsideMesh == 0;
+	return ((SplineComponent->GetNumberOfSplinePoints() - 1) - state.indexOfCurrentMesh == 1 || state.noMeshesBeforeSection) && state.stepIndexInsideMesh == 0;
 }
 
 // Stores the vertices of the first loop in the tunnel based on the provided surface index.
-void AProceduralTunnel::SaveFirstLoopVerticeData(int32 surface, FVector vertice) {
+void AProceduralTunnel::SaveFirstLoopVerticeData(FTunnelSectionState& state, int32 surface, FVector vertice) const {
 	// Selects the appropriate array to save the vertex data based on the surface index.
 	if (surface == 0) {
-		tunnelStartMeshData.GroundVertives.Add(vertice);
+		state.tunnelStartMeshData.GroundVertives.Add(vertice);
 	}
 	else {
-		tunnelStartMeshData.WallVertices.Add(vertice);
+		state.tunnelStartMeshData.WallVertices.Add(vertice);
 	}
 }
 
 // Saves the end mesh vertice data based on the provided surface index and vertice position.
-void AProceduralTunnel::SaveEndMeshVerticeData(int32 surface, FVector vertice) {
+void AProceduralTunnel::SaveEndMeshVerticeData(FTunnelSectionState& state, int32 surface, FVector vertice) const {
 	// Switch on the surface index to determine which part of the tunnel to update.
 	if (surface == 0) {
-		currentMeshEndData.GroundVertives.Add(vertice);
+		state.currentMeshEndData.GroundVertives.Add(vertice);
 	}
 	else {
-		currentMeshEndData.WallVertices.Add(vertice);
+		state.currentMeshEndData.WallVertices.Add(vertice);
 	}
 }
 
 // Get vertices for intersections child tunnel pointing to right
-FVector AProceduralTunnel::RightTunnelStart() 
+FVector AProceduralTunnel::RightTunnelStart(FTunnelSectionState& state) const
 {
 	FVector vertice;
-	switch (surfaceIndex)
+	switch (state.surfaceIndex)
 	{
 	case 0:
-		vertice = parentIntersection->lastRightFloorVertices[parentIntersection->lastRightFloorVertices.Num() - 1 - verticeIndex];
+		vertice = parentIntersection->lastRightFloorVertices[parentIntersection->lastRightFloorVertices.Num() - 1 - state.verticeIndex];
 		return TransformVerticeToLocalSpace(parentIntersection, vertice);
 		break;
 	case 1:
 		if (IsValid(parentsParentTunnel)) {
 			// Get data of last mesh end
-			vertice = parentsParentTunnel->meshEnds[parentsParentTunnel->meshEnds.Num() - 1].WallVertices[verticeIndex];
+			vertice = parentsParentTunnel->meshEnds[parentsParentTunnel->meshEnds.Num() - 1].WallVertices[state.verticeIndex];
 			return TransformVerticeToLocalSpace(parentsParentTunnel, vertice);
 		}
 		else {
-			return GetVerticeOnRightWall(true);
+			return GetVerticeOnRightWall(state, true);
 		}
 		break;
 	case 2:
-		vertice = parentIntersection->lastRightRoofVertices[verticeIndex];
+		vertice = parentIntersection->lastRightRoofVertices[state.verticeIndex];
 		return TransformVerticeToLocalSpace(parentIntersection, vertice);
 		break;
 	case 3:
 		if(parentIntersection->intersectionType == IntersectionType::RightLeft)
 		{
-			vertice = parentIntersection->lastRightWallVertices[verticeIndex];
+			vertice = parentIntersection->lastRightWallVertices[state.verticeIndex];
 			return TransformVerticeToLocalSpace(parentIntersection, vertice);
 			break;
 		}
 		else 
 		{
-			return GetVerticeOnLeftWall(true);
+			return GetVerticeOnLeftWall(state, true);
 			break;
 		}	
 	default:
@@ -720,38 +2029,38 @@ FVector AProceduralTunnel::RightTunnelStart()
 }
 
 // Get vertices for intersections child tunnel pointing to left
-FVector AProceduralTunnel::LeftTunnelStart() 
+FVector AProceduralTunnel::LeftTunnelStart(FTunnelSectionState& state) const
 {
 	FVector vertice;
-	switch (surfaceIndex)
+	switch (state.surfaceIndex)
 	{
 	case 0:
-		vertice = parentIntersection->lastLeftFloorVertices[verticeIndex];
+		vertice = parentIntersection->lastLeftFloorVertices[state.verticeIndex];
 		return TransformVerticeToLocalSpace(parentIntersection, vertice);
 		break;
 	case 1:
 		if(parentIntersection->intersectionType == IntersectionType::RightLeft)
 		{
-			vertice = parentIntersection->lastLeftWallVertices[parentIntersection->lastLeftWallVertices.Num() - (1 + verticeIndex)];
+			vertice = parentIntersection->lastLeftWallVertices[parentIntersection->lastLeftWallVertices.Num() - (1 + state.verticeIndex)];
 			return TransformVerticeToLocalSpace(parentIntersection, vertice);
 			break;
 		}
 		else 
 		{
-			return GetVerticeOnRightWall(true);;
+			return GetVerticeOnRightWall(state, true);;
 			break;
 		}
 	case 2:
-		vertice = parentIntersection->lastLeftRoofVertices[parentIntersection->lastLeftRoofVertices.Num() - (1 + verticeIndex)];
+		vertice = parentIntersection->lastLeftRoofVertices[parentIntersection->lastLeftRoofVertices.Num() - (1 + state.verticeIndex)];
 		return TransformVerticeToLocalSpace(parentIntersection, vertice);
 		break;
 	case 3:
 		if (IsValid(parentsParentTunnel)) {
-			vertice = parentsParentTunnel->meshEnds[parentsParentTunnel->meshEnds.Num() - 1].WallVertices[loopAroundTunnelCurrentIndex - numberOfHorizontalPoints];
+			vertice = parentsParentTunnel->meshEnds[parentsParentTunnel->meshEnds.Num() - 1].WallVertices[state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints];
 			return TransformVerticeToLocalSpace(parentsParentTunnel, vertice);
 		}
 		else {
-			return GetVerticeOnLeftWall(true);
+			return GetVerticeOnLeftWall(state, true);
 		}
 		break;
 	default:
@@ -761,42 +2070,42 @@ FVector AProceduralTunnel::LeftTunnelStart()
 }
 
 // Get vertices for intersections child tunnel pointing forward
-FVector AProceduralTunnel::StraightTunnelStart()
+FVector AProceduralTunnel::StraightTunnelStart(FTunnelSectionState& state) const
 {
 	FVector vertice;
-	switch (surfaceIndex)
+	switch (state.surfaceIndex)
 	{
 	case 0:
-		vertice = parentIntersection->lastStraightFloorVertices[verticeIndex];
+		vertice = parentIntersection->lastStraightFloorVertices[state.verticeIndex];
 		return TransformVerticeToLocalSpace(parentIntersection, vertice);
 		break;
 	case 1:
 		if (IsValid(rightSideTunnel))
 		{
-			vertice = rightSideTunnel->tunnelStartMeshData.WallVertices[rightSideTunnel->tunnelStartMeshData.WallVertices.Num() - (1 + verticeIndex)];
+			vertice = rightSideTunnel->tunnelStartMeshData.WallVertices[rightSideTunnel->tunnelStartMeshData.WallVertices.Num() - (1 + state.verticeIndex)];
 			return TransformVerticeToLocalSpace(rightSideTunnel, vertice);
 			break;
 		}
 		else
 		{
-			vertice = parentIntersection->lastRightWallVertices[verticeIndex];
+			vertice = parentIntersection->lastRightWallVertices[state.verticeIndex];
 			return TransformVerticeToLocalSpace(parentIntersection, vertice);
 			break;
 		}
 	case 2:
-		vertice = parentIntersection->lastStraightRoofVertices[verticeIndex];
+		vertice = parentIntersection->lastStraightRoofVertices[state.verticeIndex];
 		return TransformVerticeToLocalSpace(parentIntersection, vertice);
 		break;
 	case 3:
 		if (IsValid(leftSideTunnel))
 		{
-			vertice = leftSideTunnel->tunnelStartMeshData.WallVertices[numberOfVerticalPoints - verticeIndex - 1];
+			vertice = leftSideTunnel->tunnelStartMeshData.WallVertices[numberOfVerticalPoints - state.verticeIndex - 1];
 			return TransformVerticeToLocalSpace(leftSideTunnel, vertice);
 			break;
 		}
 		else
 		{
-			vertice = parentIntersection->lastLeftWallVertices[verticeIndex];
+			vertice = parentIntersection->lastLeftWallVertices[state.verticeIndex];
 			return TransformVerticeToLocalSpace(parentIntersection, vertice);
 			break;
 		}
@@ -806,30 +2115,30 @@ FVector AProceduralTunnel::StraightTunnelStart()
 	}
 }
 
-FVector AProceduralTunnel::TransformVerticeToLocalSpace(AActor* actorFrom, FVector vector) {
+FVector AProceduralTunnel::TransformVerticeToLocalSpace(const AActor* actorFrom, FVector vector) const {
 	vector = UKismetMathLibrary::TransformLocation(actorFrom->GetTransform(), vector); 							   // FLIP FROM CONNECTED ACTORS TRANSFORM TO WORLD TRANSFORM
 	vector = UKismetMathLibrary::InverseTransformLocation(this->GetTransform(), vector);
 	return vector;
 }
 
 // Get vertice for ground 
-FVector AProceduralTunnel::GetVerticeOnGround()
+FVector AProceduralTunnel::GetVerticeOnGround(FTunnelSectionState& state) const
 {
-	if (loopAroundTunnelCurrentIndex == 0)
+	if (state.loopAroundTunnelCurrentIndex == 0)
 	{
-		wallStartVertice = latestVertice;
-		return latestVertice;
+		state.wallStartVertice = state.latestVertice;
+		return state.latestVertice;
 	}
 
 	// Apply deformation to the starting location
-	float pixelValue = GetPixelValue(forwardStepInDeformTexture, loopAroundTunnelCurrentIndex);
+	float pixelValue = state.deformValues[state.loopAroundTunnelCurrentIndex];
 	// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 	float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 	float deform = FMath::Lerp(0.0f, maxFloorDeformation, floorDeformation) * directionOfDeform;
 
 	// Add sideways movement to start location
-	float stepSize = horizontalPointSize * (float)loopAroundTunnelCurrentIndex;
-	FVector stepToSide = wallStartVertice + rightVector * stepSize;
+	float stepSize = horizontalPointSize * (float)state.loopAroundTunnelCurrentIndex;
+	FVector stepToSide = state.wallStartVertice + state.rightVector * stepSize;
 	return FVector(stepToSide.X, stepToSide.Y, stepToSide.Z + deform);
 }
 
@@ -844,124 +2153,124 @@ const float horizontalPointMaxSize = 225;
 // Predefined values for extra movement based on index
 const TArray<float> EXTRA_MOVEMENTS = { 100.0f, 50.0f, 30.0f, 10.0f, 0.0f };
 
-FVector AProceduralTunnel::GetVerticeOnRightWall(bool isFirstLoopARound)
+FVector AProceduralTunnel::GetVerticeOnRightWall(FTunnelSectionState& state, bool isFirstLoopARound) const
 {
 	bool isEndOrStar = false;
 
 	// If it's the start of the right wall, just use the latest vertex
-	if (loopAroundTunnelCurrentIndex == numberOfHorizontalPoints)
+	if (state.loopAroundTunnelCurrentIndex == numberOfHorizontalPoints)
 	{
-		wallStartVertice = latestVertice;
-		return latestVertice;
+		state.wallStartVertice = state.latestVertice;
+		return state.latestVertice;
 	}
 
-	FVector rVector = rightVector;
+	FVector rVector = state.rightVector;
 	float extraMovementToEnd = 0.0f;
 	// Calculate how many steps we need to round in end or in the start of tunnel
 	float alphaValue = FMath::Clamp(horizontalPointSize / horizontalPointMaxSize, 0, 1);
 	int32 numberOfStepsToRound = FMath::RoundToInt32(FMath::Lerp(maxStepCountToRound, minStepCountToRound, alphaValue));
 
 	// Rotate the start position of the vertex if certain conditions are met
-	if (ShouldRotateStartPositionRightWall(numberOfStepsToRound))
+	if (ShouldRotateStartPositionRightWall(state, numberOfStepsToRound))
 	{
 		isEndOrStar = true;
-		float alpha = float(stepIndexInsideMesh) / float(numberOfStepsToRound);
+		float alpha = float(state.stepIndexInsideMesh) / float(numberOfStepsToRound);
 		float rotateAmount = FMath::Lerp(ROTATE_LERP_START_NEGATIVE, ROTATE_LERP_END, alpha);
-		extraMovementToEnd = stopDeformCurve->GetFloatValue(alpha);;
-		rVector = RotateVectorByAmount(rightVector, rotateAmount);
+		extraMovementToEnd = bakedStopDeformCurve.Eval(alpha);;
+		rVector = RotateVectorByAmount(state.rightVector, rotateAmount);
 	}
 
 	// Rotate the end position of the vertex for valid intersections
-	if (IsValid(intersection) && ShouldRotateEndPositionRightWall(numberOfStepsToRound))
+	if (IsValid(intersection) && ShouldRotateEndPositionRightWall(state, numberOfStepsToRound))
 	{
 		isEndOrStar = true;
-		float startValue = stepIndexInsideMesh - (stepCountToMakeCurrentMesh - numberOfStepsToRound);
+		float startValue = state.stepIndexInsideMesh - (state.stepCountToMakeCurrentMesh - numberOfStepsToRound);
 		float alpha = startValue / float(numberOfStepsToRound);
 		float rotateAmount = FMath::Lerp(ROTATE_LERP_END, ROTATE_LERP_START_POSITIVE, alpha);
-		extraMovementToEnd = stopDeformCurve->GetFloatValue(1 - alpha);//FMath::Lerp(0, 100, alpha);
+		extraMovementToEnd = bakedStopDeformCurve.Eval(1 - alpha);//FMath::Lerp(0, 100, alpha);
 
-		rVector = RotateVectorByAmount(rightVector, rotateAmount);
+		rVector = RotateVectorByAmount(state.rightVector, rotateAmount);
 	}
 
 	// Calculate the relative location on the wall
-	float locationOnWall = (float)(loopAroundTunnelCurrentIndex - numberOfHorizontalPoints) / (float)(numberOfVerticalPoints);
+	float locationOnWall = (float)(state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints) / (float)(numberOfVerticalPoints);
 
 	// Adjust the vertex size based on if it's the first loop and if there's a valid parent intersection
 	float wVerticeSize = isFirstLoopARound && IsValid(parentIntersection) ? parentIntersection->verticalPointSize : verticalPointSize;
 
 	// Calculate the roundness of the tunnel using the deform curve
-	float roundnessAmount = deformCurve->GetFloatValue(locationOnWall);
+	float roundnessAmount = bakedDeformCurve.Eval(locationOnWall);
 	FVector tunnelRoundness = rVector * (FMath::Lerp(tunnelRoundValue + extraMovementToEnd, 0.0f, roundnessAmount));
 
 	// Determine the vertical location on the wall and calculate the final wall vertex
-	FVector wallVertice = wallStartVertice + FVector(0.0f, 0.0f, (loopAroundTunnelCurrentIndex - numberOfHorizontalPoints) * wVerticeSize);
+	FVector wallVertice = state.wallStartVertice + FVector(0.0f, 0.0f, (state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints) * wVerticeSize);
 	wallVertice += tunnelRoundness;
 
 	// Apply deformation to the vertex unless it's at the start or end of the tunnel
 	//if (!isEndOrStar) {
-		float pixelValue = GetPixelValue(forwardStepInDeformTexture, loopAroundTunnelCurrentIndex);
+		float pixelValue = state.deformValues[state.loopAroundTunnelCurrentIndex];
 		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
-		wallVertice += FMath::Lerp(0.0f, maxWallDeformation, wallDeformation) * directionOfDeform * rightVector;
+		wallVertice += FMath::Lerp(0.0f, maxWallDeformation, wallDeformation) * directionOfDeform * state.rightVector;
 	//}
 
 	return wallVertice;
 }
 
 // Checks whether the start position of the vertex should be rotated based on several conditions
-bool AProceduralTunnel::ShouldRotateStartPositionRightWall(int32 stepCountToRound)
+bool AProceduralTunnel::ShouldRotateStartPositionRightWall(FTunnelSectionState& state, int32 stepCountToRound) const
 {
 	bool isStraightTunnelAfterLeftIntersection = tunnelType == TunnelType::StraightTunnel && parentIntersection->intersectionType == IntersectionType::Left;
 	bool isLeftTunnelAfterRightLeftIntersection = tunnelType == TunnelType::LeftTunnel && parentIntersection->intersectionType == IntersectionType::RightLeft;
 
-	bool isUnderStepCount = stepIndexInsideMesh <= stepCountToRound;
+	bool isUnderStepCount = state.stepIndexInsideMesh <= stepCountToRound;
 	bool isNotStartTunnel = tunnelType != TunnelType::StartTunnel;
 	bool isParentIntersectionCorrect = !isStraightTunnelAfterLeftIntersection && !isLeftTunnelAfterRightLeftIntersection;
-	bool isFirstMesh = (SplineComponent->GetNumberOfSplinePoints() - 1 - indexOfCurrentMesh == 1) || TunnelMeshes.Num() == 0;
+	bool isFirstMesh = (SplineComponent->GetNumberOfSplinePoints() - 1 - state.indexOfCurrentMesh == 1) || state.noMeshesBeforeSection;
 	bool conditionFour = (tunnelType == TunnelType::StraightTunnel && IsValid(rightSideTunnel)) || tunnelType != TunnelType::StraightTunnel;
 
 	return isUnderStepCount && isNotStartTunnel && isParentIntersectionCorrect && isFirstMesh && conditionFour;
 }
 
 // Checks whether the end position of the vertex should be rotated based on several conditions
-bool AProceduralTunnel::ShouldRotateEndPositionRightWall(int32 stepCountToRound)
+bool AProceduralTunnel::ShouldRotateEndPositionRightWall(FTunnelSectionState& state, int32 stepCountToRound) const
 {
-	return indexOfCurrentMesh == 0 &&
-		stepIndexInsideMesh <= stepCountToMakeCurrentMesh &&
-		stepIndexInsideMesh >= stepCountToMakeCurrentMesh - stepCountToRound &&
+	return state.indexOfCurrentMesh == 0 &&
+		state.stepIndexInsideMesh <= state.stepCountToMakeCurrentMesh &&
+		state.stepIndexInsideMesh >= state.stepCountToMakeCurrentMesh - stepCountToRound &&
 		intersection->intersectionType != IntersectionType::Left;
 }
 
 // Returns a rotated vector based on a given vector and rotation amount
-FVector AProceduralTunnel::RotateVectorByAmount(const FVector& vector, float rotateAmount)
+FVector AProceduralTunnel::RotateVectorByAmount(const FVector& vector, float rotateAmount) const
 {
 	FRotator rotator = FRotator(0.0f, rotateAmount, 0.0f);
 	return rotator.RotateVector(vector);
 }
 
 // Get vertice for roof
-FVector AProceduralTunnel::GetVerticeOnRoof()
+FVector AProceduralTunnel::GetVerticeOnRoof(FTunnelSectionState& state) const
 {
 	// Save start vertice when entering first time
-	if (loopAroundTunnelCurrentIndex == numberOfHorizontalPoints + numberOfVerticalPoints)
+	if (state.loopAroundTunnelCurrentIndex == numberOfHorizontalPoints + numberOfVerticalPoints)
 	{
-		wallStartVertice.Z += verticalPointSize * numberOfVerticalPoints;
+		state.wallStartVertice.Z += verticalPointSize * numberOfVerticalPoints;
 		//return wallStartVertice;
 	}
 
-	FVector wallVertice = wallStartVertice;
+	FVector wallVertice = state.wallStartVertice;
 
-    float sideWaysMovementSize = (float)(loopAroundTunnelCurrentIndex - numberOfHorizontalPoints - numberOfVerticalPoints) * -horizontalPointSize;
-	wallVertice += rightVector * sideWaysMovementSize;
+    float sideWaysMovementSize = (float)(state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints - numberOfVerticalPoints) * -horizontalPointSize;
+	wallVertice += state.rightVector * sideWaysMovementSize;
 
     // Apply roundness to the starting location
-    float roundingIndex = (float)(loopAroundTunnelCurrentIndex - numberOfHorizontalPoints - numberOfVerticalPoints) / (float)(numberOfHorizontalPoints - 1);
-    float roundnessAmount = deformCurve->GetFloatValue(roundingIndex);
+    float roundingIndex = (float)(state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints - numberOfVerticalPoints) / (float)(numberOfHorizontalPoints - 1);
+    float roundnessAmount = bakedDeformCurve.Eval(roundingIndex);
     float tunnelRounding = FMath::Lerp(tunnelRoundValue, 0.0f, roundnessAmount);
 	// Divide rounding by 2 to add more natural roundness to roof
 	wallVertice.Z += tunnelRounding / 2.0f;
 
     // Apply deformation to the starting location
-    float pixelValue = GetPixelValue(forwardStepInDeformTexture, loopAroundTunnelCurrentIndex);
+    float pixelValue = state.deformValues[state.loopAroundTunnelCurrentIndex];
 	// Pixel value is in range 0-1 and we want to change it to range between -1 - 1
 	float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
 	wallVertice.Z += FMath::Lerp(0.0f, maxWallDeformation, wallDeformation) * directionOfDeform;
@@ -970,22 +2279,22 @@ FVector AProceduralTunnel::GetVerticeOnRoof()
 }
 
 // Get vertice for the left wall of the tunnel
-FVector AProceduralTunnel::GetVerticeOnLeftWall(bool isFirstLoopARound)
+FVector AProceduralTunnel::GetVerticeOnLeftWall(FTunnelSectionState& state, bool isFirstLoopARound) const
 {
 	bool isEndOrStar = false;
 	float extraMovementToEnd = 0.0f;
-	FVector rVector = rightVector;
+	FVector rVector = state.rightVector;
 
 	// If we've completed a loop around the tunnel, return the first vertice
-	if (loopAroundTunnelCurrentIndex == loopAroundTunnelLastIndex)
+	if (state.loopAroundTunnelCurrentIndex == loopAroundTunnelLastIndex)
 	{
-		return firstVertice;
+		return state.firstVertice;
 	}
 
 	// If this is the start of the wall, save the starting vertice
-	if (loopAroundTunnelCurrentIndex == numberOfHorizontalPoints * 2 + numberOfVerticalPoints)
+	if (state.loopAroundTunnelCurrentIndex == numberOfHorizontalPoints * 2 + numberOfVerticalPoints)
 	{
-		wallStartVertice = latestVertice;
+		state.wallStartVertice = state.latestVertice;
 	}
 
 	// Adjust the vertice size if this is the first loop and a valid parent intersection exists
@@ -996,73 +2305,73 @@ FVector AProceduralTunnel::GetVerticeOnLeftWall(bool isFirstLoopARound)
 	int32 numberOfStepsToRound = FMath::RoundToInt32(FMath::Lerp(maxStepCountToRound, minStepCountToRound, alphaValue));
 
 	// Decide if we need to rotate the starting position of the wall based on tunnel conditions
-	if (ShouldRotateStartPositionLeftWall(numberOfStepsToRound))
+	if (ShouldRotateStartPositionLeftWall(state, numberOfStepsToRound))
 	{
-		wallStartVertice = FVector(firstVertice.X, firstVertice.Y, firstVertice.Z + ((float)(numberOfVerticalPoints)*verticalPointSize));
+		state.wallStartVertice = FVector(state.firstVertice.X, state.firstVertice.Y, state.firstVertice.Z + ((float)(numberOfVerticalPoints)*verticalPointSize));
 		isEndOrStar = true;
 
-		float alpha = float(stepIndexInsideMesh) / float(numberOfStepsToRound);
+		float alpha = float(state.stepIndexInsideMesh) / float(numberOfStepsToRound);
 		float rotateAmount = FMath::Lerp(ROTATE_LERP_START_POSITIVE, ROTATE_LERP_END, alpha);
-		extraMovementToEnd = stopDeformCurve->GetFloatValue(alpha);;
-		rVector = RotateVectorByAmount(rightVector, rotateAmount);
+		extraMovementToEnd = bakedStopDeformCurve.Eval(alpha);;
+		rVector = RotateVectorByAmount(state.rightVector, rotateAmount);
 	}
 
 	// Decide if we need to rotate the ending position of the wall based on tunnel conditions
-	if (ShouldRotateEndPositionLeftWall(numberOfStepsToRound))
+	if (ShouldRotateEndPositionLeftWall(state, numberOfStepsToRound))
 	{
 		isEndOrStar = true;
 
-		float startValue = stepIndexInsideMesh - (stepCountToMakeCurrentMesh - numberOfStepsToRound);
+		float startValue = state.stepIndexInsideMesh - (state.stepCountToMakeCurrentMesh - numberOfStepsToRound);
 		float alpha = startValue / float(numberOfStepsToRound);
 		float rotateAmount = FMath::Lerp(ROTATE_LERP_END, ROTATE_LERP_START_NEGATIVE, alpha);
-		extraMovementToEnd = stopDeformCurve->GetFloatValue(1 - alpha);
-		rVector = RotateVectorByAmount(rightVector, rotateAmount);
+		extraMovementToEnd = bakedStopDeformCurve.Eval(1 - alpha);
+		rVector = RotateVectorByAmount(state.rightVector, rotateAmount);
 	}
 
 	// Calculate location on wall and apply roundness based on the deform curve
-	float locationOnWall = (float)(loopAroundTunnelCurrentIndex - numberOfHorizontalPoints * 2 - numberOfVerticalPoints + 1) / (float)numberOfVerticalPoints;
-	float roundnessAmount = deformCurve->GetFloatValue(locationOnWall);
-	if (IsValid(intersection) && stepIndexInsideMesh == stepCountToMakeCurrentMesh)
+	float locationOnWall = (float)(state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints * 2 - numberOfVerticalPoints + 1) / (float)numberOfVerticalPoints;
+	float roundnessAmount = bakedDeformCurve.Eval(locationOnWall);
+	if (IsValid(intersection) && state.stepIndexInsideMesh == state.stepCountToMakeCurrentMesh)
 	{
 		roundnessAmount = FMath::Clamp(roundnessAmount - 0.1f, 0.0f, 1.0f);
 	}
 	FVector tunnelRoundness = rVector * FMath::Lerp((tunnelRoundValue + extraMovementToEnd) * -1, 0.0f, roundnessAmount);
 
 	// Calculate wall vertice position
-	float zLocation = (loopAroundTunnelCurrentIndex - numberOfHorizontalPoints * 2 - numberOfVerticalPoints + 1) * (wVerticeSize * -1.0f);
-	FVector wallVertice = wallStartVertice + FVector(0.0f, 0.0f, zLocation) + tunnelRoundness;
+	float zLocation = (state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints * 2 - numberOfVerticalPoints + 1) * (wVerticeSize * -1.0f);
+	FVector wallVertice = state.wallStartVertice + FVector(0.0f, 0.0f, zLocation) + tunnelRoundness;
 
 	// If it's not the end or start, apply deformation based on the deform texture
 	//if (!isEndOrStar)
 	//{
-		float pixelValue = GetPixelValue(forwardStepInDeformTexture, loopAroundTunnelCurrentIndex);
+		float pixelValue = state.deformValues[state.loopAroundTunnelCurrentIndex];
 		float directionOfDeform = FMath::Lerp(-1.0f, 1.0f, pixelValue);
-		wallVertice += FMath::Lerp(0.0f, maxWallDeformation, wallDeformation) * directionOfDeform * rightVector;
+		wallVertice += FMath::Lerp(0.0f, maxWallDeformation, wallDeformation) * directionOfDeform * state.rightVector;
 	//}
 
 	return wallVertice;
 }
 
 // Check if we need to rotate the starting position of the left wall based on various tunnel conditions
-bool AProceduralTunnel::ShouldRotateStartPositionLeftWall(int32 stepCountToRound)
+bool AProceduralTunnel::ShouldRotateStartPositionLeftWall(FTunnelSectionState& state, int32 stepCountToRound) const
 {
 	bool isStraightTunnelAfterRightIntersection = tunnelType == TunnelType::StraightTunnel && parentIntersection->intersectionType == IntersectionType::Right;
 	bool isRightTunnelAfterRightLeftIntersection = tunnelType == TunnelType::RightTunnel && parentIntersection->intersectionType == IntersectionType::RightLeft;
 	
-	bool isUnderStepCount = stepIndexInsideMesh <= stepCountToRound;
+	bool isUnderStepCount = state.stepIndexInsideMesh <= stepCountToRound;
 	bool isNotStartTunnel = tunnelType != TunnelType::StartTunnel;
 	bool isParentIntersectionCorrect = !isStraightTunnelAfterRightIntersection && !isRightTunnelAfterRightLeftIntersection;
-	bool isFirstMesh = (SplineComponent->GetNumberOfSplinePoints() - 1 - indexOfCurrentMesh == 1) || TunnelMeshes.Num() == 0;
+	bool isFirstMesh = (SplineComponent->GetNumberOfSplinePoints() - 1 - state.indexOfCurrentMesh == 1) || state.noMeshesBeforeSection;
 	bool conditionFour = (tunnelType == TunnelType::StraightTunnel && IsValid(leftSideTunnel)) || tunnelType != TunnelType::StraightTunnel;
 
 	return isUnderStepCount && isNotStartTunnel && isParentIntersectionCorrect && isFirstMesh && conditionFour;
 }
 
 // Check if we need to rotate the ending position of the left wall based on various tunnel conditions
-bool AProceduralTunnel::ShouldRotateEndPositionLeftWall(int32 stepCountToRound)
+bool AProceduralTunnel::ShouldRotateEndPositionLeftWall(FTunnelSectionState& state, int32 stepCountToRound) const
 {
-	bool conditionOne = IsValid(intersection) && indexOfCurrentMesh == 0;
-	bool conditionTwo = stepIndexInsideMesh <= stepCountToMakeCurrentMesh && stepIndexInsideMesh >= stepCountToMakeCurrentMesh - stepCountToRound;
+	bool conditionOne = IsValid(intersection) && state.indexOfCurrentMesh == 0;
+	bool conditionTwo = state.stepIndexInsideMesh <= state.stepCountToMakeCurrentMesh && state.stepIndexInsideMesh >= state.stepCountToMakeCurrentMesh - stepCountToRound;
 	bool conditionThree = intersection->intersectionType != IntersectionType::Right;
 
 	return conditionOne && conditionTwo && conditionThree;
@@ -1070,21 +2379,21 @@ bool AProceduralTunnel::ShouldRotateEndPositionLeftWall(int32 stepCountToRound)
 
 
 // Returns index of current vertice. This index can be used for getting other tunnels correct index in connection situation
-int32 AProceduralTunnel::GetIndexOfVertice() 
+int32 AProceduralTunnel::GetIndexOfVertice(FTunnelSectionState& state) const
 {
-	switch (surfaceIndex)
+	switch (state.surfaceIndex)
 	{
 		case 0: 
-			return loopAroundTunnelCurrentIndex;
+			return state.loopAroundTunnelCurrentIndex;
 			break;
 		case 1: 
-			return loopAroundTunnelCurrentIndex - numberOfHorizontalPoints;
+			return state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints;
 			break;
 		case 2: 
-			return loopAroundTunnelCurrentIndex - numberOfHorizontalPoints - numberOfVerticalPoints;
+			return state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints - numberOfVerticalPoints;
 			break;
 		case 3: 
-			return loopAroundTunnelCurrentIndex - numberOfHorizontalPoints * 2 - numberOfVerticalPoints;
+			return state.loopAroundTunnelCurrentIndex - numberOfHorizontalPoints * 2 - numberOfVerticalPoints;
 			break;
 		default:
 			return 0;
@@ -1093,30 +2402,30 @@ int32 AProceduralTunnel::GetIndexOfVertice()
 }
 
 // Returns true if this is first loop around tunnel
-bool AProceduralTunnel::GetIsFirstLoopAround() 
+bool AProceduralTunnel::GetIsFirstLoopAround(FTunnelSectionState& state) const
 {
 	// Calculate the index of the last spline point in the tunnel mesh.
 	int32 lastSplineIndex = SplineComponent->GetNumberOfSplinePoints() - 1;
-	int32 meshLastIndex = lastSplineIndex - indexOfCurrentMesh;
+	int32 meshLastIndex = lastSplineIndex - state.indexOfCurrentMesh;
 
 	// Check if this is the first loop around the tunnel.
-	bool isFirstLoop = (meshLastIndex == 1 || TunnelMeshes.Num() == 0) && stepIndexInsideMesh == 0;
+	bool isFirstLoop = (meshLastIndex == 1 || state.noMeshesBeforeSection) && state.stepIndexInsideMesh == 0;
 
 	return isFirstLoop;
 }
 
 // Return the index of the surface we are currently on.
 // 0 = Floor, 1 = Right, 2 = Roof, 3 = Left
-int32 AProceduralTunnel::GetSurfaceIndex() 
+int32 AProceduralTunnel::GetSurfaceIndex(FTunnelSectionState& state) const
 {
-	if(loopAroundTunnelCurrentIndex < numberOfHorizontalPoints) {
+	if(state.loopAroundTunnelCurrentIndex < numberOfHorizontalPoints) {
 		return 0;
 	} 
-	else if (loopAroundTunnelCurrentIndex < numberOfHorizontalPoints + numberOfVerticalPoints)
+	else if (state.loopAroundTunnelCurrentIndex < numberOfHorizontalPoints + numberOfVerticalPoints)
 	{
 		return 1;
 	}
-	else if (loopAroundTunnelCurrentIndex < numberOfHorizontalPoints * 2 + numberOfVerticalPoints)
+	else if (state.loopAroundTunnelCurrentIndex < numberOfHorizontalPoints * 2 + numberOfVerticalPoints)
 	{
 		return 2;
 	}
@@ -1127,30 +2436,33 @@ int32 AProceduralTunnel::GetSurfaceIndex()
 }
 
 // Set start vector location, right vector and x step value for deformationlist
-void AProceduralTunnel::InitializeStartVectorRightVectorAndValueInTexture()
+void AProceduralTunnel::InitializeStartVectorRightVectorAndValueInTexture(FTunnelSectionState& state) const
 {
 	// Get spline point index from where our curren mesh section starts
-	int32 splinePointIndex = SplineComponent->GetNumberOfSplinePoints() - (indexOfCurrentMesh + 2);
+	int32 splinePointIndex = SplineComponent->GetNumberOfSplinePoints() - (state.indexOfCurrentMesh + 2);
 	// Distance on spline at start spline point
-	float startDistance = SplineComponent->GetDistanceAlongSplineAtSplinePoint(splinePointIndex); 
+	float startDistance = splineFrames.GetSegmentStartDistance(splinePointIndex);
 
-	/// Get current distance on spline. If at the end of tunnel last step is taken in lastStepSizeOnSpline because it can differ from normal step size
-	float currentDistance = IsOnTheEndOfTunnel()
-		? startDistance + ((float)(stepIndexInsideMesh - 1) * horizontalPointSize + lastStepSizeOnSpline)
-		: startDistance + (float)stepIndexInsideMesh * horizontalPointSize;
+	/// Get current distance inside the section. If at the end of tunnel last step is taken in lastStepSizeOnSpline because it can differ from normal step size
+	float distanceInSection = IsOnTheEndOfTunnel(state)
+		? (float)(state.stepIndexInsideMesh - 1) * horizontalPointSize + state.lastStepSizeOnSpline
+		: (float)state.stepIndexInsideMesh * horizontalPointSize;
+	float currentDistance = startDistance + distanceInSection;
+	// Steps land on the cached samples, so this is a direct table lookup
+	const FSplineFrame frame = splineFrames.GetFrame(splinePointIndex, distanceInSection);
 
 	// Calculate distance on spline in steps
 	float distanceOnSpline = currentDistance / horizontalPointSize; 
 
 	// Get location in local space at current distance
-	startLocationOnSpline = SplineComponent->GetLocationAtDistanceAlongSpline(currentDistance, ESplineCoordinateSpace::Local);
+	state.startLocationOnSpline = frame.Location;
 	// Get right vector in local space at current distance
-	FVector rightVectorOnDistance = SplineComponent->GetRightVectorAtDistanceAlongSpline(currentDistance, ESplineCoordinateSpace::Local);
+	FVector rightVectorOnDistance = frame.Right;
 	// Rotatotr to get forward vector from right vector
 	const FRotator rot = FRotator(0.0f, -90, 0.0f);
 	// Get forward vector from right vector
 	FVector result = rot.RotateVector(rightVectorOnDistance);
-	forwardVector = result;
+	state.forwardVector = result;
 
 	// Calculate how many times we can fit our noise texture on the distance we have moved
 	int32 whole = FMath::FloorToFloat(distanceOnSpline / noiseTextureXresolution);
@@ -1160,12 +2472,12 @@ void AProceduralTunnel::InitializeStartVectorRightVectorAndValueInTexture()
 
 	/// MOVE FORWARD ON NOISE TEXTURE
 	if (remainder == 0 || whole == 0) {
-		forwardStepInDeformTexture = FMath::FloorToInt(distanceOnSpline - (float)FMath::FloorToFloat(distanceOnSpline / noiseTextureXresolution) * noiseTextureXresolution);
+		state.forwardStepInDeformTexture = FMath::FloorToInt(distanceOnSpline - (float)FMath::FloorToFloat(distanceOnSpline / noiseTextureXresolution) * noiseTextureXresolution);
 	}
 	/// MOVE BACKWARD ON NOISE TEXTURE
 	else {
 		int32 x = FMath::FloorToInt(distanceOnSpline - (float)FMath::FloorToFloat(distanceOnSpline / noiseTextureXresolution) * noiseTextureXresolution);
-		forwardStepInDeformTexture = (int32)noiseTextureXresolution - x;
+		state.forwardStepInDeformTexture = (int32)noiseTextureXresolution - x;
 	}
 
 
@@ -1177,20 +2489,21 @@ void AProceduralTunnel::InitializeStartVectorRightVectorAndValueInTexture()
 	float x = negativeRightVector.X * sideWaysMultiplier;
 	float y = negativeRightVector.Y * sideWaysMultiplier;
 	float z = negativeRightVector.Z * sideWaysMultiplier;
-	latestVertice = startLocationOnSpline + FVector(x, y, z);
+	state.latestVertice = state.startLocationOnSpline + FVector(x, y, z);
 
 	// Set the right vector
-	rightVector = FVector(rightVectorOnDistance.X, rightVectorOnDistance.Y, 0.0f);
+	state.rightVector = FVector(rightVectorOnDistance.X, rightVectorOnDistance.Y, 0.0f);
 }
 
 // Clear arrays that hold data for generating tunnel
 void AProceduralTunnel::ClearArrays () {
-	wallVertices.Empty();
-	wallTriangles.Empty();
-	wallUV.Empty();
-	groundVertices.Empty();
-	groundTriangles.Empty();
-	groundUV.Empty();
+	// Reset keeps the allocations, every section has about the same size
+	wallVertices.Reset();
+	wallTriangles.Reset();
+	wallUV.Reset();
+	groundVertices.Reset();
+	groundTriangles.Reset();
+	groundUV.Reset();
 }
 
 // These are values used when tunnel construction is called
@@ -4,6 +4,7 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Components/SplineComponent.h"
+#include "Async/Future.h"
 #include "Components/StaticMeshComponent.h"
 #include "Containers/Array.h"
 #include "Curves/CurveFloat.h"
@@ -11,9 +12,104 @@
 #include "ProceduralMeshComponent.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "EnumContainer.h"
+#include "TunnelDeformationField.h"
+#include "TunnelMeshBuilder.h"
+#include "SplineFrameCache.h"
+#include "TunnelMeshUpload.h"
+#include "TunnelGeometryCache.h"
+#include "TunnelScatter.h"
+#include "BakedCurve.h"
 #include "ProceduralTunnel.generated.h"
 
 class AProceduralIntersection;
+class UTexture2D;
+class UMaterialInterface;
+class UHierarchicalInstancedStaticMeshComponent;
+
+// Full resolution geometry of a tunnel mesh as it was last made. The tunnel keeps it so incremental regeneration,
+// LOD switches and the mesh builder benchmark do not copy it back out of the mesh component. It is replaced as a
+// whole when the mesh is made again, a pass running on a worker keeps the shape it started from
+struct FTunnelMeshSections
+{
+	FTunnelMeshSectionData ground;
+	FTunnelMeshSectionData wall;
+};
+
+// Loop state of generating one tunnel mesh section. Every section owns its state so sections can be
+// generated in parallel, the actor itself is only read while vertices are generated.
+struct FTunnelSectionState
+{
+	// Section index counted from the end of the tunnel, 0 is the last section
+	int32 indexOfCurrentMesh = 0;
+	int32 stepCountToMakeCurrentMesh = 0;
+	float lastStepSizeOnSpline = 0.0f;
+	int32 stepIndexInsideMesh = 0;
+	int32 loopAroundTunnelCurrentIndex = 0;
+	int32 surfaceIndex = 0;
+	int32 verticeIndex = 0;
+	int32 forwardStepInDeformTexture = 0;
+	FVector wallStartVertice = FVector::ZeroVector;
+	FVector firstVertice = FVector::ZeroVector;
+	FVector latestVertice = FVector::ZeroVector;
+	FVector rightVector = FVector::ZeroVector;
+	FVector forwardVector = FVector::ZeroVector;
+	FVector startLocationOnSpline = FVector::ZeroVector;
+	// Deformation values of the current loop around the tunnel
+	TArray<float> deformValues;
+
+	TArray<FVector> groundVertices;
+	TArray<FVector> wallVertices;
+	TArray<FVector2D> groundUV;
+	TArray<FVector2D> wallUV;
+	TArray<int32> groundTriangles;
+	TArray<int32> wallTriangles;
+	TArray<FVector> groundNormals;
+	TArray<FVector> wallNormals;
+	TArray<FProcMeshTangent> groundTangents;
+	TArray<FProcMeshTangent> wallTangents;
+
+	FMeshSectionEnd currentMeshEndData;
+	// Only filled by the section that makes the first loop of the whole tunnel
+	FMeshSectionEnd tunnelStartMeshData;
+	bool hasTunnelStartMeshData = false;
+	// True if the tunnel had no meshes when this section is made, replaces checking TunnelMeshes while sections are generated
+	bool noMeshesBeforeSection = false;
+
+	// Seam loops shared with the neighbouring sections of the same generation pass. They are used as
+	// the first / last loop of this section so both sides of a seam use exactly the same vertices
+	const FMeshSectionEnd* startSeam = nullptr;
+	const FMeshSectionEnd* endSeam = nullptr;
+
+	// Incremental regeneration. A clean section keeps its mesh, a patched one reuses the loops of its
+	// current mesh outside firstDirtyLoop - lastDirtyLoop and only rebuilds normals and UVs around them
+	bool isClean = false;
+	bool patchExisting = false;
+	int32 firstDirtyLoop = 0;
+	int32 lastDirtyLoop = 0;
+	TSharedPtr<const FTunnelMeshSections> existing;
+};
+
+// Sections of one generation pass with the seam loops between them
+struct FTunnelGenerationPass
+{
+	TArray<FTunnelSectionState> sections;
+	TArray<FMeshSectionEnd> seams;
+	int32 lastIndex = 0;
+	bool isMeshPartUpdate = false;
+	uint32 paramsHash = 0;
+	// Hash of the inputs shared by every section of the pass, section keys continue from it
+	bool useGeometryCache = false;
+	FTunnelSectionCacheKey cacheKeyBase;
+};
+
+// Section geometry waiting to be uploaded to its mesh component
+struct FPendingTunnelMeshUpload
+{
+	TWeakObjectPtr<UProceduralMeshComponent> mesh;
+	// Loops along the tunnel, used to find the grids for LODs
+	int32 rows = 0;
+	TSharedPtr<const FTunnelMeshSections> sections;
+};
 
 UCLASS(Blueprintable)
 class CHARMTUNNELSIM_API AProceduralTunnel : public AActor
@@ -35,10 +131,15 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void OnConstruction(const FTransform& Transform) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Destroyed() override;
 
 public:	
+	// Keeps the ends of this tunnel up to date in the endpoint grid used for snapping
+	void UpdateEndpoints();
+
 	//DEFAULT VALUES
-	FVector wallStartVertice;
 	float maxDistanceToSnapSplineEnds = 400.0f;
 	float stepSizeOnSpline = 50.0f; ///100 original lower the number the higher the resolution
 	float lastStepSizeOnSpline = 0.0f;
@@ -55,8 +156,21 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
 	float wallDeformation;
 	float noiseTextureXresolution = 500.0f;
+	// Noise texture decoded once into the deformation field. If not set a Blueprint GetPixelValue override is baked,
+	// otherwise the surface is not deformed unless useProceduralDeformation is set
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+	UTexture2D* deformTexture;
+	// Deform with perlin noise when there is neither a texture nor a GetPixelValue override
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Deformation")
+	bool useProceduralDeformation = false;
 	UFUNCTION(BlueprintImplementableEvent, Category = "Deformation")
 	float GetPixelValue(int32 x, int32 y);
+	// Drops the decoded deformation values so they are decoded again on next generation
+	UFUNCTION(BlueprintCallable, Category = "Deformation")
+	void ResetDeformationField();
+	void UpdateDeformationField();
+	TSharedPtr<const FTunnelDeformationField> deformationField;
+	bool isDeformationFieldBaked = false;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	UCurveFloat* stopDeformCurve;
 
@@ -115,20 +229,76 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
 	TArray<UProceduralMeshComponent*> TunnelMeshes;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	UMaterialInterface* groundMaterial;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	UMaterialInterface* wallMaterial;
+	// Time per frame spent uploading queued sections, at least one section is uploaded every frame. 0 uploads right away
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	float meshUploadBudgetMs = 4.0f;
+	// Sections made by native MakeMesh that are not on their mesh component yet, at most one per component
+	TArray<FPendingTunnelMeshUpload> pendingMeshUploads;
+	// Pass started by BeginAsyncGenerationLoop and its worker, the pass is finished on the game thread in Tick
+	TSharedPtr<FTunnelGenerationPass> asyncGenerationPass;
+	TFuture<void> asyncGeneration;
+	// Levels of detail of every section, each level halves the loops and the points around the tunnel of the previous one.
+	// Level 0 is the tunnel mesh, level N has its own component in lodMeshes and only the component of the level matching
+	// the screen size is visible. Hidden components have no render data, coarse levels are made when they are shown and
+	// released when they are hidden again, except the collision level
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes", meta = (ClampMin = "1", ClampMax = "4"))
+	int32 lodCount = 3;
+	// Index meshIndex * 3 + level - 1
+	UPROPERTY()
+	TArray<UProceduralMeshComponent*> lodMeshes;
+	// Level shown for every mesh, counted from the start of the tunnel
+	TArray<uint8> shownMeshLods;
+	// Screen size (bounds diameter relative to the screen height) below which each level is used, first value is for level 0
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes")
+	TArray<float> lodScreenSizes;
+	// Level that gets collision. Coarse levels make cheaper collision for sensor traces
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Meshes", meta = (ClampMin = "0", ClampMax = "3"))
+	int32 collisionLod = 0;
+
+	// Meshes placed along the tunnel with one instanced component per section and rule, so sections are culled,
+	// streamed and placed again on their own. Placement is seeded per section and only follows the generated
+	// geometry, the same tunnel always gets the same instances
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scatter")
+	TArray<FTunnelScatterRule> scatterRules;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scatter")
+	int32 scatterSeed = 0;
+	// Index meshIndex * scatterRules.Num() + rule
+	UPROPERTY()
+	TArray<UHierarchicalInstancedStaticMeshComponent*> scatterComponents;
+	// Sections whose instances are placed again on the next tick, counted from the start of the tunnel
+	TSet<int32> dirtyScatterSections;
+	// Rules and seed the components were made with
+	uint32 scatterRulesHash = 0;
 
 	// LOOP VARIABLES
+	// Per section loop state lives in FTunnelSectionState, these describe the whole generation pass
 	int32 meshLoopFirstIndex;
 	int32 indexOfLastMesh;
-	int32 indexOfCurrentMesh;
+	// Step count of the section that is currently handed to MakeMesh
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	int32 stepCountToMakeCurrentMesh;
-	int32 stepIndexInsideMesh;
-	int32 loopAroundTunnelCurrentIndex;
-
-	int32 surfaceIndex;
-	int32 verticeIndex;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	float horizontalPointSize;
+	// Carry the tunnel frame along each section without twisting instead of using the spline's up vector at every step.
+	// Frames still match the spline rotation at spline points, where sections and intersections connect
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
+	bool useRotationMinimizingFrames = true;
+	// Spline frames sampled every horizontalPointSize, refreshed per changed segment before each generation pass
+	FSplineFrameCache splineFrames;
+	// Only loops whose spline frames moved more than regenerationTolerance (cm) are generated again, the rest of the mesh is patched in place
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
+	bool useIncrementalRegeneration = true;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
+	float regenerationTolerance = 0.1f;
+	// Hash of everything besides the spline that changes generated vertices, incremental regeneration is only used while it stays the same
+	uint32 generatedParamsHash = 0;
+	// Sections whose inputs hash to a section made before (by any tunnel, also in an earlier session) are taken from the geometry cache
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
+	bool useGeometryCache = true;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	float verticalPointSize;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
@@ -137,15 +307,11 @@ public:
 	FMeshSectionEnd currentMeshEndData;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	TArray<FMeshSectionEnd> meshEnds;
-	int32 forwardStepInDeformTexture;
-	FVector firstVertice;
-	FVector latestVertice;
-	FVector rightVector;
-	FVector forwardVector;
-	FVector startLocationOnSpline;
-	TArray<float> deformValues;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Procedural loop params")
 	UCurveFloat* deformCurve;
+	// deformCurve and stopDeformCurve sampled at the start of every generation pass
+	FBakedCurve bakedDeformCurve;
+	FBakedCurve bakedStopDeformCurve;
 
 	
 	float tunnelRoundValue = 100.0f;
@@ -156,6 +322,7 @@ public:
 
 
 	virtual void Tick(float DeltaTime) override;
+	virtual bool ShouldTickIfViewportsOnly() const override;
 
 	UFUNCTION(BlueprintCallable)
 	void SnapToEndOfOtherSpline();
@@ -170,61 +337,149 @@ public:
 
 	void AddOrRemoveSplinePoints();
 
-	void InitializeProceduralGenerationLoopVariables(int32 firstIndex, int32 lastIndex);
-	void CalculateStepsInTunnelSection();
-	void ResetCurrentMeshEndData();
-	void GenerateVerticesAndUVs(bool isMeshPartUpdate, int32 lastIndex);
-	void GetMeshEndData(bool isMeshPartUpdate);
-	void GenerateVerticesForCurrentLoop(int32 lastIndex);
+	// Phases of ProceduralGenerationLoop. Begin, LinkSeams and Finish run on the game thread, GenerateSeam and
+	// GenerateSection only read the actor so sections of many tunnels can be generated in one parallel batch
+	bool BeginGenerationPass(int32 firstIndex, int32 lastIndex, bool isMeshPartUpdate, FTunnelGenerationPass& pass);
+	void GenerateSeam(FTunnelGenerationPass& pass, int32 sectionIndex) const;
+	void LinkSeams(FTunnelGenerationPass& pass) const;
+	void GenerateSection(FTunnelGenerationPass& pass, int32 sectionIndex) const;
+	void FinishGenerationPass(FTunnelGenerationPass& pass);
+	// Seams and sections of a begun pass, GenerateSeam and GenerateSection in parallel
+	void GeneratePassSections(FTunnelGenerationPass& pass) const;
+
+	// ProceduralGenerationLoop with seams and sections generated on a worker thread, so the game thread does not wait
+	// for them. Returns false if a pass is already running or there is nothing to generate. The meshes are queued for
+	// upload by FinishAsyncGenerationLoop, which Tick calls once the worker is done
+	bool BeginAsyncGenerationLoop(int32 firstIndex, int32 lastIndex, bool isMeshPartUpdate);
+	// Returns true if no pass is running anymore. With wait it blocks until the worker is done
+	bool FinishAsyncGenerationLoop(bool wait);
+	bool IsAsyncGenerationRunning() const { return asyncGenerationPass.IsValid(); }
+	// Section made by MakeMesh that is still waiting in the upload queue
+	bool IsMeshUploadPending(const UProceduralMeshComponent* mesh) const;
+	// Drops the queued upload of a mesh, returns false if nothing was queued for it
+	bool CancelMeshUpload(const UProceduralMeshComponent* mesh);
 
-	int32 GetSurfaceIndex();
-	int32 GetIndexOfVertice();
-
-	bool GetIsFirstLoopAround();
-	bool ShouldUseMeshEndData (bool isMeshPartUpdate);
+	void InitializeProceduralGenerationLoopVariables(int32 firstIndex, int32 lastIndex);
+	void UpdateSplineFrames();
+	uint32 GetGenerationParamsHash() const;
+	// Geometry cache keys. Unlike GetGenerationParamsHash these only hash content, so they stay the same across sessions
+	FTunnelSectionCacheKey GetGenerationCacheKey() const;
+	FTunnelSectionCacheKey GetSectionCacheKey(const FTunnelGenerationPass& pass, const FTunnelSectionState& state) const;
+	// Decides on the game thread which loops of a section must be generated again
+	void PrepareIncrementalSection(FTunnelSectionState& state);
+	// Geometry the mesh was last made from, null if it was not made by the native builder or is streamed out
+	TSharedPtr<const FTunnelMeshSections> GetMeshSections(int32 meshIndex) const;
+	// Copies a generated section into the Blueprint visible arrays and builds its mesh on the game thread
+	void UploadSection(FTunnelSectionState& state);
+
+	// Section generation. These only read the actor and write the given section state
+	void CalculateStepsInTunnelSection(FTunnelSectionState& state) const;
+	void ResetCurrentMeshEndData(FTunnelSectionState& state) const;
+	void GenerateVerticesAndUVs(FTunnelSectionState& state, bool isMeshPartUpdate, int32 lastIndex) const;
+	void GetMeshEndData(FTunnelSectionState& state, bool isMeshPartUpdate) const;
+	void GenerateVerticesForCurrentLoop(FTunnelSectionState& state, int32 lastIndex) const;
+
+	int32 GetSurfaceIndex(FTunnelSectionState& state) const;
+	int32 GetIndexOfVertice(FTunnelSectionState& state) const;
+
+	bool GetIsFirstLoopAround(FTunnelSectionState& state) const;
+	bool ShouldReuseExistingLoop(FTunnelSectionState& state) const;
+	void AppendExistingLoop(FTunnelSectionState& state) const;
+	bool ShouldUseMeshEndData (FTunnelSectionState& state, bool isMeshPartUpdate) const;
 
 	// Transforms mesh end data vectors from other actors local space to other actor local space
-	TArray<FVector> TransformVectors(const TArray<FVector>& Vectors, AActor* SourceActor, AActor* TargetActor);
+	TArray<FVector> TransformVectors(const TArray<FVector>& Vectors, const AActor* SourceActor, const AActor* TargetActor) const;
 
 	// Functions used to get intersections child tunnels start vertices to align with intersection
-	FVector RightTunnelStart();
-	FVector LeftTunnelStart();
-	FVector StraightTunnelStart();
-	FVector TransformVerticeToLocalSpace(AActor* actorFrom, FVector vector);
+	FVector RightTunnelStart(FTunnelSectionState& state) const;
+	FVector LeftTunnelStart(FTunnelSectionState& state) const;
+	FVector StraightTunnelStart(FTunnelSectionState& state) const;
+	FVector TransformVerticeToLocalSpace(const AActor* actorFrom, FVector vector) const;
 
 	// Basic functions to get vertice locations on different surfaces
-	FVector GetVerticeOnGround();
-	FVector GetVerticeOnRightWall(bool isFirstLoopARound);
-	bool ShouldRotateStartPositionRightWall(int32 stepCountToRound);
-	bool ShouldRotateEndPositionRightWall(int32 stepCountToRound);
-	FVector RotateVectorByAmount(const FVector& vector, float rotateAmount);
-	FVector GetVerticeOnRoof();
-	FVector GetVerticeOnLeftWall(bool isFirstLoopARound);
-	bool ShouldRotateStartPositionLeftWall(int32 stepCountToRound);
-	bool ShouldRotateEndPositionLeftWall(int32 stepCountToRound);
-
-	void InitializeStartVectorRightVectorAndValueInTexture();
+	FVector GetVerticeOnGround(FTunnelSectionState& state) const;
+	FVector GetVerticeOnRightWall(FTunnelSectionState& state, bool isFirstLoopARound) const;
+	bool ShouldRotateStartPositionRightWall(FTunnelSectionState& state, int32 stepCountToRound) const;
+	bool ShouldRotateEndPositionRightWall(FTunnelSectionState& state, int32 stepCountToRound) const;
+	FVector RotateVectorByAmount(const FVector& vector, float rotateAmount) const;
+	FVector GetVerticeOnRoof(FTunnelSectionState& state) const;
+	FVector GetVerticeOnLeftWall(FTunnelSectionState& state, bool isFirstLoopARound) const;
+	bool ShouldRotateStartPositionLeftWall(FTunnelSectionState& state, int32 stepCountToRound) const;
+	bool ShouldRotateEndPositionLeftWall(FTunnelSectionState& state, int32 stepCountToRound) const;
+
+	void InitializeStartVectorRightVectorAndValueInTexture(FTunnelSectionState& state) const;
 	void ClearArrays();
 
-	FVector GetVerticeForStartOfChildTunnel();
-	bool IsOnTheEndOfTunnel();
-	FVector GetVerticeForDefaultTunnel(bool isFirstLoopAround);
-	FVector AdjustLatestVerticeForOverlap(FVector latestVertice, int32 surfaceIndex);
-	void SaveFirstVerticeIfNeeded(FVector latestVertice);
-	void AddCreatedVerticeToArrays(FVector latestVertice, int32 surfaceIndex);
-	bool IsFirstLoopOfWholeTunnel();
-	void SaveFirstLoopVerticeData(int32 surfaceIndex, FVector latestVertice);
-	bool IsOnTheEndOfCurrentMeshSection();
-	void SaveEndMeshVerticeData(int32 surfaceIndex, FVector latestVertice);
+	FVector GetVerticeForStartOfChildTunnel(FTunnelSectionState& state) const;
+	bool IsOnTheEndOfTunnel(FTunnelSectionState& state) const;
+	FVector GetVerticeForDefaultTunnel(FTunnelSectionState& state, bool isFirstLoopAround) const;
+	FVector AdjustLatestVerticeForOverlap(FTunnelSectionState& state, FVector latestVertice, int32 surfaceIndex) const;
+	void SaveFirstVerticeIfNeeded(FTunnelSectionState& state, FVector latestVertice) const;
+	void AddCreatedVerticeToArrays(FTunnelSectionState& state, FVector latestVertice, int32 surfaceIndex) const;
+	bool IsFirstLoopOfWholeTunnel(FTunnelSectionState& state) const;
+	void SaveFirstLoopVerticeData(FTunnelSectionState& state, int32 surfaceIndex, FVector latestVertice) const;
+	bool IsOnTheEndOfCurrentMeshSection(FTunnelSectionState& state) const;
+	void SaveEndMeshVerticeData(FTunnelSectionState& state, int32 surfaceIndex, FVector latestVertice) const;
 
 	UFUNCTION(BlueprintCallable)
 	void DestroyLastMesh();
 
-	// Tunnel foundation functions
-	UFUNCTION(BlueprintImplementableEvent)
+	// Tunnel foundation functions. Triangles, normals and tangents are built in C++,
+	// Blueprint overrides are only called when useNativeMeshBuilder is turned off
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tunnel foundation")
+	bool useNativeMeshBuilder = true;
+	// Distance based UVs of the native builder. When off, UVs still come from a Blueprint MakeMeshTriangles override
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tunnel foundation")
+	bool useNativeUVs = false;
+	bool UsesBlueprintUVs() const;
+	// Times the Blueprint MakeMeshTriangles and MakeMeshTangentsAndNormals graphs against the native builder on the
+	// first section of this tunnel. Returns false if the class has no Blueprint graphs or the tunnel has no section yet
+	bool BenchmarkMeshBuilder(int32 iterations, double& blueprintMs, double& nativeMs);
+	UFUNCTION(BlueprintNativeEvent)
 	void MakeMeshTriangles();
-	UFUNCTION(BlueprintImplementableEvent)
+	virtual void MakeMeshTriangles_Implementation();
+	UFUNCTION(BlueprintNativeEvent)
 	void MakeMeshTangentsAndNormals();
-	UFUNCTION(BlueprintImplementableEvent)
+	virtual void MakeMeshTangentsAndNormals_Implementation();
+	// Native MakeMesh keeps TunnelMeshes and meshEnds up to date right away and queues the render and collision upload.
+	// It is called directly while useNativeMeshBuilder is on, a Blueprint override only runs when it is turned off
+	UFUNCTION(BlueprintNativeEvent)
 	void MakeMesh(int32 meshPartIndex);
+	virtual void MakeMesh_Implementation(int32 meshPartIndex);
+	// Uploads every queued section now
+	UFUNCTION(BlueprintCallable)
+	void FlushMeshUploads();
+	void UploadPendingMeshes(double budgetSeconds);
+	void UploadMeshLods(UProceduralMeshComponent* mesh, const FPendingTunnelMeshUpload& upload);
+	// Builds one level from full resolution sections and puts it on its component
+	void UploadMeshLod(int32 meshIndex, int32 lod, int32 rows, const FTunnelMeshSectionData& ground, const FTunnelMeshSectionData& wall);
+	// Puts a streamed in section back on its components right away, the levels are made like for a queued upload
+	void UploadStreamedMesh(int32 meshIndex, FTunnelMeshSectionData&& ground, FTunnelMeshSectionData&& wall);
+	// Releases the coarse levels and the kept geometry of a streamed out section, level 0 is shown again once the section comes back
+	void ClearMeshLods(int32 meshIndex);
+	void QueueMeshUpload(int32 meshIndex, int32 rows, FTunnelMeshSectionData&& ground, FTunnelMeshSectionData&& wall);
+	// Puts saved section geometry on a mesh without generating it, meshIndex counts from the start of the tunnel
+	void RestoreMesh(int32 meshIndex, int32 rows, const FMeshSectionEnd& end, FTunnelMeshSectionData&& ground, FTunnelMeshSectionData&& wall);
+	// Loops along each mesh from the start of the tunnel, needed for LODs and saving
+	TArray<int32> meshRows;
+	// Geometry of each mesh from the start of the tunnel, shared with its queued upload
+	TArray<TSharedPtr<const FTunnelMeshSections>> meshSections;
+	// Shows the level of every tunnel mesh that matches its screen size from the player camera
+	void UpdateMeshLods();
+	int32 GetMeshLod(const UProceduralMeshComponent* mesh, const FVector& viewLocation, float screenMultiple) const;
+	// Switches the visible component of a mesh, a released level is made again first. Returns false if it could not be made
+	bool ShowMeshLod(int32 meshIndex, int32 lod);
+	UProceduralMeshComponent* GetOrCreateTunnelMesh(int32 meshIndex);
+	UProceduralMeshComponent* GetLodMesh(int32 meshIndex, int32 lod) const;
+	UProceduralMeshComponent* GetOrCreateLodMesh(int32 meshIndex, int32 lod);
+
+	// Places the instances of every section again
+	UFUNCTION(BlueprintCallable, Category = "Scatter")
+	void RegenerateScatter();
+	void MarkScatterDirty(int32 meshIndex);
+	// Removes the instances of a section until it is marked dirty again, used when the section is streamed out
+	void ClearScatter(int32 meshIndex);
+	// Places the instances of dirty sections in parallel and puts them on their components
+	void UpdateScatter();
+	UHierarchicalInstancedStaticMeshComponent* GetOrCreateScatterComponent(int32 meshIndex, int32 rule);
 };
@@ -4,6 +4,9 @@
 #include "SaveLoadTunnelFromFile.h"
 #include "HAL/PlatformFileManager.h"
 #include "Misc/FileHelper.h"
+#include "TunnelSaveFile.h"
+#include "TunnelMeshExport.h"
+#include "Engine/Engine.h"
 
 FString USaveLoadTunnelFromFile::LoadFromFile(FString FilePath, bool& bOutSuccess, FString& OutInfoMessage)
 {
@@ -39,6 +42,37 @@ void USaveLoadTunnelFromFile::SaveToFile(FString FilePath, FString String, bool&
 	return;
 }
 
+void USaveLoadTunnelFromFile::SaveTunnelsToBinaryFile(UObject* WorldContextObject, FString FilePath, bool bIncludeMeshes, bool& bOutSuccess, FString& OutInfoMessage)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	bOutSuccess = FTunnelSaveFile::Save(World, FilePath, bIncludeMeshes, OutInfoMessage);
+	if (bOutSuccess) {
+		OutInfoMessage = FString::Printf(TEXT("Write tunnels succeeded - '%s'"), *FilePath);
+	}
+}
+
+FTunnelNetworkActors USaveLoadTunnelFromFile::LoadTunnelsFromBinaryFile(UObject* WorldContextObject, FString FilePath, TSubclassOf<AProceduralTunnel> TunnelClass,
+	TSubclassOf<AProceduralIntersection> IntersectionClass, bool& bOutSuccess, FString& OutInfoMessage)
+{
+	FTunnelNetworkActors Actors;
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	FTunnelSaveFile File;
+	bOutSuccess = File.Open(FilePath, OutInfoMessage) && File.Spawn(World, TunnelClass, IntersectionClass, Actors, OutInfoMessage);
+	if (bOutSuccess) {
+		OutInfoMessage = FString::Printf(TEXT("Read tunnels succeeded - '%s'"), *FilePath);
+	}
+	return Actors;
+}
+
+void USaveLoadTunnelFromFile::ExportTunnelMeshes(UObject* WorldContextObject, FString FilePath, bool& bOutSuccess, FString& OutInfoMessage)
+{
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	bOutSuccess = FTunnelMeshExport::Export(World, FilePath, OutInfoMessage);
+	if (bOutSuccess) {
+		OutInfoMessage = FString::Printf(TEXT("Export tunnel meshes succeeded - '%s'"), *FilePath);
+	}
+}
+
 // Function to compute the cross product of two 2D vectors
 float cross(const FVector2D& u, const FVector2D& v) {
 	return u.X * v.Y- u.Y * v.X;
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "TunnelNetwork.h"
 #include "SaveLoadTunnelFromFile.generated.h"
 
 /**
@@ -23,6 +24,19 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "SaveToFile")
 		static void SaveToFile(FString FilePath, FString String, bool& bOutSuccess, FString& OutInfoMessage);
 
+	// Binary tunnel save with the tunnel graph, splines and optionally the generated meshes, see FTunnelSaveFile
+	UFUNCTION(BlueprintCallable, Category = "SaveToFile", meta = (WorldContext = "WorldContextObject"))
+		static void SaveTunnelsToBinaryFile(UObject* WorldContextObject, FString FilePath, bool bIncludeMeshes, bool& bOutSuccess, FString& OutInfoMessage);
+
+	// Spawns the tunnels of a binary save, saved meshes are uploaded as they are instead of generating them again
+	UFUNCTION(BlueprintCallable, Category = "LoadFromFile", meta = (WorldContext = "WorldContextObject"))
+		static FTunnelNetworkActors LoadTunnelsFromBinaryFile(UObject* WorldContextObject, FString FilePath, TSubclassOf<AProceduralTunnel> TunnelClass,
+			TSubclassOf<AProceduralIntersection> IntersectionClass, bool& bOutSuccess, FString& OutInfoMessage);
+
+	// Writes the generated geometry of every tunnel and intersection, the extension selects OBJ, PLY, glTF or GLB. See FTunnelMeshExport
+	UFUNCTION(BlueprintCallable, Category = "SaveToFile", meta = (WorldContext = "WorldContextObject"))
+		static void ExportTunnelMeshes(UObject* WorldContextObject, FString FilePath, bool& bOutSuccess, FString& OutInfoMessage);
+
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "VerticeCalculations")
 		static bool IsPointInsideRectangle2D(const FVector2D& P, const FVector2D& A, const FVector2D& B, const FVector2D& C, const FVector2D& D);
 	
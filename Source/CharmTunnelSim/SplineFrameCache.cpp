@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SplineFrameCache.h"
+#include "Components/SplineComponent.h"
+
+int32 FSplineFrameCache::Update(const USplineComponent* Spline, float InSpacing, bool bInRotationMinimizing, float PositionTolerance, float DirectionTolerance)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FSplineFrameCache::Update);
+
+	InSpacing = FMath::Max(InSpacing, 1.0f);
+	if (InSpacing != Spacing || bInRotationMinimizing != bRotationMinimizing) {
+		Invalidate();
+		Spacing = InSpacing;
+		bRotationMinimizing = bInRotationMinimizing;
+	}
+
+	const int32 NumSegments = IsValid(Spline) ? FMath::Max(Spline->GetNumberOfSplinePoints() - 1, 0) : 0;
+	// New segments start dirty, segments moved by an inserted or removed point no longer match their key
+	Segments.SetNum(NumSegments);
+	int32 FirstChanged = INDEX_NONE;
+
+	// Frames before this update of every segment that may change, to find the samples that really moved
+	TMap<int32, TArray<FSplineFrame>> PreviousFrames;
+	TArray<float> PreviousStartDistances;
+	PreviousStartDistances.SetNumUninitialized(NumSegments);
+
+	for (int32 Index = 0; Index < NumSegments; Index++) {
+		FSegment& Segment = Segments[Index];
+		// Earlier segments may have changed length, start distances are cheap to refresh
+		PreviousStartDistances[Index] = Segment.StartDistance;
+		Segment.StartDistance = Spline->GetDistanceAlongSplineAtSplinePoint(Index);
+
+		const FSegmentKey Key = MakeKey(Spline, Index);
+		if (Segment.bDirty || !(Segment.Key == Key)) {
+			PreviousFrames.Add(Index, MoveTemp(Segment.Frames));
+			Segment.Key = Key;
+			Segment.bDirty = false;
+			SampleSegment(Spline, Index, Segment);
+			if (bRotationMinimizing) {
+				ApplyRotationMinimizingFrames(Segment);
+			}
+			if (FirstChanged == INDEX_NONE) {
+				FirstChanged = Index;
+			}
+		}
+		else if (FMath::Abs(Segment.StartDistance - PreviousStartDistances[Index]) > PositionTolerance) {
+			// Same shape further along the spline, deformation is read from a different place
+			MarkDirty(Segment, 0, Segment.Frames.Num() - 1);
+		}
+	}
+
+	for (TPair<int32, TArray<FSplineFrame>>& Previous : PreviousFrames) {
+		MarkDirtySamples(Segments[Previous.Key], Previous.Value, PreviousStartDistances[Previous.Key], PositionTolerance, DirectionTolerance);
+	}
+	return FirstChanged;
+}
+
+bool FSplineFrameCache::GetDirtySamples(int32 Segment, int32& OutFirst, int32& OutLast) const
+{
+	if (!Segments.IsValidIndex(Segment) || Segments[Segment].FirstDirtySample == INDEX_NONE) {
+		return false;
+	}
+	OutFirst = Segments[Segment].FirstDirtySample;
+	OutLast = Segments[Segment].LastDirtySample;
+	return true;
+}
+
+bool FSplineFrameCache::IsSampleDirty(int32 Segment, int32 Sample) const
+{
+	int32 First = 0;
+	int32 Last = 0;
+	return GetDirtySamples(Segment, First, Last) && Sample >= First && Sample <= Last;
+}
+
+int32 FSplineFrameCache::GetFirstDirtySegment() const
+{
+	for (int32 Index = 0; Index < Segments.Num(); Index++) {
+		if (Segments[Index].FirstDirtySample != INDEX_NONE) {
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void FSplineFrameCache::ClearDirty(int32 Segment)
+{
+	if (Segments.IsValidIndex(Segment)) {
+		Segments[Segment].FirstDirtySample = INDEX_NONE;
+		Segments[Segment].LastDirtySample = INDEX_NONE;
+	}
+}
+
+void FSplineFrameCache::MarkDirtySamples(FSegment& Segment, const TArray<FSplineFrame>& PreviousFrames, float PreviousStartDistance, float PositionTolerance, float DirectionTolerance)
+{
+	const int32 LastSample = Segment.Frames.Num() - 1;
+	if (PreviousFrames.Num() != Segment.Frames.Num() || FMath::Abs(Segment.StartDistance - PreviousStartDistance) > PositionTolerance) {
+		MarkDirty(Segment, 0, LastSample);
+		return;
+	}
+
+	const float PositionToleranceSquared = FMath::Square(PositionTolerance);
+	const float DirectionToleranceSquared = FMath::Square(DirectionTolerance);
+	for (int32 Index = 0; Index <= LastSample; Index++) {
+		const FSplineFrame& Frame = Segment.Frames[Index];
+		const FSplineFrame& Previous = PreviousFrames[Index];
+		const bool bMoved = FVector::DistSquared(Frame.Location, Previous.Location) > PositionToleranceSquared
+			|| FMath::Abs(Frame.Distance - Previous.Distance) > PositionTolerance
+			|| FVector::DistSquared(Frame.Right, Previous.Right) > DirectionToleranceSquared
+			|| FVector::DistSquared(Frame.Up, Previous.Up) > DirectionToleranceSquared
+			|| FVector::DistSquared(Frame.Tangent, Previous.Tangent) > DirectionToleranceSquared;
+		if (bMoved) {
+			MarkDirty(Segment, Index, Index);
+		}
+	}
+}
+
+void FSplineFrameCache::MarkDirty(FSegment& Segment, int32 First, int32 Last)
+{
+	if (Last < First) {
+		return;
+	}
+	Segment.FirstDirtySample = Segment.FirstDirtySample == INDEX_NONE ? First : FMath::Min(Segment.FirstDirtySample, First);
+	Segment.LastDirtySample = Segment.LastDirtySample == INDEX_NONE ? Last : FMath::Max(Segment.LastDirtySample, Last);
+}
+
+void FSplineFrameCache::Invalidate()
+{
+	for (FSegment& Segment : Segments) {
+		Segment.bDirty = true;
+	}
+}
+
+void FSplineFrameCache::InvalidateSegment(int32 Segment)
+{
+	if (Segments.IsValidIndex(Segment)) {
+		Segments[Segment].bDirty = true;
+	}
+}
+
+FSplineFrame FSplineFrameCache::GetFrame(int32 Segment, float DistanceInSegment) const
+{
+	const TArray<FSplineFrame>& Frames = Segments[Segment].Frames;
+	check(Frames.Num() >= 2);
+
+	// Samples are evenly spaced apart from the last one, so the sample before the distance is found directly
+	const int32 Index = FMath::Clamp(FMath::FloorToInt(DistanceInSegment / Spacing), 0, Frames.Num() - 2);
+	const FSplineFrame& A = Frames[Index];
+	const FSplineFrame& B = Frames[Index + 1];
+	const float SampleLength = B.Distance - A.Distance;
+	const float Alpha = SampleLength > UE_KINDA_SMALL_NUMBER ? FMath::Clamp((DistanceInSegment - A.Distance) / SampleLength, 0.0f, 1.0f) : 0.0f;
+	if (Alpha == 0.0f) {
+		return A;
+	}
+	if (Alpha == 1.0f) {
+		return B;
+	}
+
+	FSplineFrame Frame;
+	Frame.Distance = DistanceInSegment;
+	Frame.Location = FMath::Lerp(A.Location, B.Location, Alpha);
+	Frame.Tangent = FMath::Lerp(A.Tangent, B.Tangent, Alpha).GetSafeNormal(UE_SMALL_NUMBER, A.Tangent);
+	// Keep the frame orthonormal after blending
+	Frame.Up = FMath::Lerp(A.Up, B.Up, Alpha);
+	Frame.Up = (Frame.Up - Frame.Tangent * FVector::DotProduct(Frame.Up, Frame.Tangent)).GetSafeNormal(UE_SMALL_NUMBER, A.Up);
+	Frame.Right = FVector::CrossProduct(Frame.Up, Frame.Tangent);
+	return Frame;
+}
+
+FSplineFrameCache::FSegmentKey FSplineFrameCache::MakeKey(const USplineComponent* Spline, int32 Segment)
+{
+	FSegmentKey Key;
+	Key.StartLocation = Spline->GetLocationAtSplinePoint(Segment, ESplineCoordinateSpace::Local);
+	Key.StartLeaveTangent = Spline->GetLeaveTangentAtSplinePoint(Segment, ESplineCoordinateSpace::Local);
+	Key.EndLocation = Spline->GetLocationAtSplinePoint(Segment + 1, ESplineCoordinateSpace::Local);
+	Key.EndArriveTangent = Spline->GetArriveTangentAtSplinePoint(Segment + 1, ESplineCoordinateSpace::Local);
+	Key.StartRotation = Spline->GetQuaternionAtSplinePoint(Segment, ESplineCoordinateSpace::Local);
+	Key.EndRotation = Spline->GetQuaternionAtSplinePoint(Segment + 1, ESplineCoordinateSpace::Local);
+	return Key;
+}
+
+void FSplineFrameCache::SampleSegment(const USplineComponent* Spline, int32 Index, FSegment& Segment) const
+{
+	Segment.Length = Spline->GetDistanceAlongSplineAtSplinePoint(Index + 1) - Segment.StartDistance;
+
+	const int32 NumSteps = FMath::Max(FMath::CeilToInt(Segment.Length / Spacing - UE_KINDA_SMALL_NUMBER), 1);
+	Segment.Frames.Reset(NumSteps + 1);
+	for (int32 Step = 0; Step <= NumSteps; Step++) {
+		FSplineFrame& Frame = Segment.Frames.AddDefaulted_GetRef();
+		Frame.Distance = Step < NumSteps ? Step * Spacing : Segment.Length;
+
+		// One reparameterization lookup per sample, everything else is evaluated at the input key
+		const float InputKey = Spline->GetInputKeyAtDistanceAlongSpline(Segment.StartDistance + Frame.Distance);
+		Frame.Location = Spline->GetLocationAtSplineInputKey(InputKey, ESplineCoordinateSpace::Local);
+		Frame.Tangent = Spline->GetDirectionAtSplineInputKey(InputKey, ESplineCoordinateSpace::Local);
+		Frame.Right = Spline->GetRightVectorAtSplineInputKey(InputKey, ESplineCoordinateSpace::Local);
+		Frame.Up = Spline->GetUpVectorAtSplineInputKey(InputKey, ESplineCoordinateSpace::Local);
+	}
+}
+
+void FSplineFrameCache::ApplyRotationMinimizingFrames(FSegment& Segment)
+{
+	TArray<FSplineFrame>& Frames = Segment.Frames;
+	if (Frames.Num() < 2) {
+		return;
+	}
+	// Sampled from the spline, this is the frame the next segment starts with
+	const FVector EndUp = Frames.Last().Up;
+
+	// The first frame keeps the spline's own orientation, every later one continues from the frame before it
+	for (int32 Index = 1; Index < Frames.Num(); Index++) {
+		const FSplineFrame& Previous = Frames[Index - 1];
+		FSplineFrame& Frame = Frames[Index];
+		// Double reflection method: reflect over the chord between the samples, then over the tangent difference
+		FVector Up = Previous.Up;
+		FVector Tangent = Previous.Tangent;
+		const FVector Chord = Frame.Location - Previous.Location;
+		const float ChordSize = Chord.SizeSquared();
+		if (ChordSize > UE_SMALL_NUMBER) {
+			Up -= (2.0f / ChordSize) * FVector::DotProduct(Chord, Up) * Chord;
+			Tangent -= (2.0f / ChordSize) * FVector::DotProduct(Chord, Tangent) * Chord;
+		}
+		const FVector TangentDelta = Frame.Tangent - Tangent;
+		const float TangentDeltaSize = TangentDelta.SizeSquared();
+		if (TangentDeltaSize > UE_SMALL_NUMBER) {
+			Up -= (2.0f / TangentDeltaSize) * FVector::DotProduct(TangentDelta, Up) * TangentDelta;
+		}
+		Frame.Up = (Up - Frame.Tangent * FVector::DotProduct(Up, Frame.Tangent)).GetSafeNormal(UE_SMALL_NUMBER, Previous.Up);
+	}
+
+	// Twist between the carried and the spline's up vector at the segment end, removed gradually along the segment
+	const FSplineFrame& Last = Frames.Last();
+	const float Twist = FMath::Atan2(FVector::DotProduct(FVector::CrossProduct(Last.Up, EndUp), Last.Tangent), FVector::DotProduct(Last.Up, EndUp));
+	for (int32 Index = 1; Index < Frames.Num(); Index++) {
+		FSplineFrame& Frame = Frames[Index];
+		const float Alpha = Segment.Length > UE_KINDA_SMALL_NUMBER ? Frame.Distance / Segment.Length : 1.0f;
+		Frame.Up = Index == Frames.Num() - 1 ? EndUp : Frame.Up.RotateAngleAxis(FMath::RadiansToDegrees(Twist * Alpha), Frame.Tangent);
+		Frame.Right = FVector::CrossProduct(Frame.Up, Frame.Tangent);
+	}
+}
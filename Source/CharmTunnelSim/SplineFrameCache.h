@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USplineComponent;
+
+// One sample of the spline frame table, vectors are in spline local space
+struct FSplineFrame
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Tangent = FVector::ForwardVector;
+	FVector Right = FVector::RightVector;
+	FVector Up = FVector::UpVector;
+	// Distance from the start of the segment the frame belongs to
+	float Distance = 0.0f;
+};
+
+// Uniformly sampled frames of a spline, one block of samples per segment between two spline points.
+// Samples are taken every Spacing units from the segment start plus one at the segment end, so
+// generation steps of the same size index the table directly instead of searching the reparameterization table.
+// Segments are compared against their control points on every update and only changed ones are sampled again.
+// Samples that moved more than a tolerance are remembered as dirty until cleared, so generation can rebuild
+// only the loops of the tunnel whose frames actually changed.
+// With rotation minimizing frames the up vector is carried along each segment (double reflection), so the
+// frame does not twist on slopes and does not flip when the spline gets steep. Every segment starts and ends
+// on the spline's own frame at its points, the twist left at the end is spread over the segment. Frames at
+// spline points are then what intersections and neighbouring segments use, and editing a segment does not
+// change the frames of any other segment.
+class CHARMTUNNELSIM_API FSplineFrameCache
+{
+public:
+	// Brings the table up to date with the spline. Must run on the game thread, reading is safe from any thread afterwards.
+	// Samples whose location moved more than PositionTolerance or whose vectors turned more than DirectionTolerance
+	// (length of the difference of unit vectors) are marked dirty. Returns the first segment that was sampled again or INDEX_NONE
+	int32 Update(const USplineComponent* Spline, float InSpacing, bool bInRotationMinimizing, float PositionTolerance = 0.0f, float DirectionTolerance = 0.0f);
+
+	// Dirty samples of a segment, collected over updates until ClearDirty
+	bool GetDirtySamples(int32 Segment, int32& OutFirst, int32& OutLast) const;
+	bool IsSampleDirty(int32 Segment, int32 Sample) const;
+	int32 GetFirstDirtySegment() const;
+	void ClearDirty(int32 Segment);
+
+	// Forces segments to be sampled again on next update
+	void Invalidate();
+	void InvalidateSegment(int32 Segment);
+
+	int32 GetNumSegments() const { return Segments.Num(); }
+	float GetSpacing() const { return Spacing; }
+	float GetSegmentStartDistance(int32 Segment) const { return Segments[Segment].StartDistance; }
+	float GetSegmentLength(int32 Segment) const { return Segments[Segment].Length; }
+
+	// Sampled frames of one segment, the first is at the segment start and the last at the segment end
+	TArrayView<const FSplineFrame> GetSegmentFrames(int32 Segment) const { return Segments[Segment].Frames; }
+
+	// Frame at a distance from the segment start, exact on sample distances and interpolated between them
+	FSplineFrame GetFrame(int32 Segment, float DistanceInSegment) const;
+
+private:
+	// Control points a segment was sampled from
+	struct FSegmentKey
+	{
+		FVector StartLocation = FVector::ZeroVector;
+		FVector StartLeaveTangent = FVector::ZeroVector;
+		FVector EndLocation = FVector::ZeroVector;
+		FVector EndArriveTangent = FVector::ZeroVector;
+		FQuat StartRotation = FQuat::Identity;
+		FQuat EndRotation = FQuat::Identity;
+
+		bool operator==(const FSegmentKey& Other) const
+		{
+			return StartLocation == Other.StartLocation && StartLeaveTangent == Other.StartLeaveTangent
+				&& EndLocation == Other.EndLocation && EndArriveTangent == Other.EndArriveTangent
+				&& StartRotation.Equals(Other.StartRotation, 0.0f) && EndRotation.Equals(Other.EndRotation, 0.0f);
+		}
+	};
+
+	struct FSegment
+	{
+		FSegmentKey Key;
+		bool bDirty = true;
+		int32 FirstDirtySample = INDEX_NONE;
+		int32 LastDirtySample = INDEX_NONE;
+		float StartDistance = 0.0f;
+		float Length = 0.0f;
+		TArray<FSplineFrame> Frames;
+	};
+
+	static FSegmentKey MakeKey(const USplineComponent* Spline, int32 Segment);
+	void SampleSegment(const USplineComponent* Spline, int32 Index, FSegment& Segment) const;
+	// Carries the up vector of the first frame along the segment and twists it back onto the spline's up vector at the end
+	static void ApplyRotationMinimizingFrames(FSegment& Segment);
+	// Marks samples that differ from the frames the segment had before the update
+	static void MarkDirtySamples(FSegment& Segment, const TArray<FSplineFrame>& PreviousFrames, float PreviousStartDistance, float PositionTolerance, float DirectionTolerance);
+	static void MarkDirty(FSegment& Segment, int32 First, int32 Last);
+
+	TArray<FSegment> Segments;
+	float Spacing = 0.0f;
+	bool bRotationMinimizing = false;
+};
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "EventCamera.h"
+#include "Math/RandomStream.h"
+
+namespace
+{
+	constexpr int32 FrameCount = 8;
+	constexpr uint64 FrameDurationNs = 41666667;
+
+	// Random frames where some pixels keep their color, so both static and changing lanes end up in one SSE2 block
+	void MakeRandomFrames(FRandomStream& Random, int32 Width, int32 Height, TArray<TArray<FColor>>& OutFrames)
+	{
+		OutFrames.SetNum(FrameCount);
+		for (int32 Frame = 0; Frame < FrameCount; Frame++) {
+			TArray<FColor>& Pixels = OutFrames[Frame];
+			Pixels.SetNumUninitialized(Width * Height);
+			for (int32 i = 0; i < Pixels.Num(); i++) {
+				if (Frame > 0 && Random.FRand() < 0.5f) {
+					Pixels[i] = OutFrames[Frame - 1][i];
+				}
+				else {
+					Pixels[i] = FColor((uint8)Random.RandRange(0, 255), (uint8)Random.RandRange(0, 255), (uint8)Random.RandRange(0, 255), 255);
+				}
+			}
+		}
+	}
+
+	// Events of every frame, one after the other
+	TArray<uint8> RunKernel(const TArray<TArray<FColor>>& Frames, int32 Width, int32 Height, bool bSimd, int32& OutEventCount)
+	{
+		FEventCameraKernel Kernel;
+		Kernel.Init(Width, Height, 0.2f);
+		Kernel.SetSimdEnabled(bSimd);
+		TArray<uint8> Events;
+		OutEventCount = 0;
+		for (int32 Frame = 0; Frame < Frames.Num(); Frame++) {
+			OutEventCount += Kernel.ProcessFrame(Frames[Frame].GetData(), Frame * FrameDurationNs, Events);
+		}
+		return Events;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FEventCameraKernelSimdTest, "CharmTunnelSim.Camera.EventKernelSimd",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Runs the SSE2 and the scalar loops on the same random frames, the packed events have to be the same byte for byte.
+// Odd sizes leave a scalar tail after the last block of 8 pixels
+bool FEventCameraKernelSimdTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Random(4242);
+	for (const FIntPoint& Size : { FIntPoint(64, 48), FIntPoint(67, 45), FIntPoint(5, 3) }) {
+		TArray<TArray<FColor>> Frames;
+		MakeRandomFrames(Random, Size.X, Size.Y, Frames);
+
+		int32 SimdEventCount = 0;
+		int32 ScalarEventCount = 0;
+		const TArray<uint8> SimdEvents = RunKernel(Frames, Size.X, Size.Y, true, SimdEventCount);
+		const TArray<uint8> ScalarEvents = RunKernel(Frames, Size.X, Size.Y, false, ScalarEventCount);
+
+		TestTrue(FString::Printf(TEXT("%dx%d random frames make events"), Size.X, Size.Y), ScalarEventCount > 0);
+		TestEqual(FString::Printf(TEXT("%dx%d event count"), Size.X, Size.Y), SimdEventCount, ScalarEventCount);
+		TestEqual(FString::Printf(TEXT("%dx%d packed size"), Size.X, Size.Y), SimdEvents.Num(), ScalarEventCount * FEventCameraKernel::EventSize);
+		if (!TestEqual(FString::Printf(TEXT("%dx%d event bytes"), Size.X, Size.Y), SimdEvents.Num(), ScalarEvents.Num())) {
+			continue;
+		}
+		for (int32 i = 0; i < SimdEvents.Num(); i++) {
+			if (SimdEvents[i] != ScalarEvents[i]) {
+				AddError(FString::Printf(TEXT("%dx%d event %d differs at byte %d, SSE2 made %u, scalar %u."), Size.X, Size.Y,
+					i / FEventCameraKernel::EventSize, i % FEventCameraKernel::EventSize, SimdEvents[i], ScalarEvents[i]));
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,361 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Vertices the serial loop (AProceduralIntersection::GenerateVerticesReference, the generation before the vertex
+// kernel) made for the inputs of IntersectionVertexKernelTest.cpp: 4 horizontal and 3 vertical points of 100 and
+// 50 cm, rounding 40, wall and floor deformation 20 and 10 at surface variation (0.5, 0.25), the roundness curve
+// with linear keys (0, 0) (0.5, 0.2) (1, 1) and deformation texel (x, y) = ((x * 5 + y * 3) % 7) / 6.
+// Positions are rounded to 0.0001 cm. Arrays are in the order of FIntersectionKernelOutput, the RightLeft case
+// includes the end wall. Do not regenerate these from the kernel, they are what it is checked against.
+struct FIntersectionKernelGolden
+{
+	const TCHAR* Name;
+	FVector LatestVertice;
+	FVector FirstVertice;
+	TArray<FVector> Arrays[10];
+};
+
+inline const TArray<FIntersectionKernelGolden>& GetIntersectionKernelGolden()
+{
+	static const TArray<FIntersectionKernelGolden> Golden = {
+		{
+			TEXT("Right"), FVector(300.0000, 148.3333, -1.6667), FVector(300.0000, -151.6667, -1.6667),
+			{
+				// GroundVertices
+				{
+					FVector(0.0000, -151.6667, -1.6667), FVector(0.0000, -51.6667, -1.6667),
+					FVector(0.0000, 48.3333, 3.3333), FVector(0.0000, 148.3333, -3.3333),
+					FVector(100.0000, -151.6667, -1.6667), FVector(100.0000, -51.6667, -5.0000),
+					FVector(100.0000, 48.3333, 0.0000), FVector(100.0000, 148.3333, -6.6667),
+					FVector(200.0000, -151.6667, -1.6667), FVector(200.0000, -51.6667, 3.3333),
+					FVector(200.0000, 48.3333, -3.3333), FVector(200.0000, 148.3333, 1.6667),
+					FVector(300.0000, -151.6667, -1.6667), FVector(300.0000, -51.6667, 0.0000),
+					FVector(300.0000, 48.3333, -6.6667), FVector(300.0000, 148.3333, -1.6667),
+				},
+				// WallVertices
+				{
+					FVector(0.0000, 150.0000, 165.0000), FVector(0.0000, 50.0000, 166.0000),
+					FVector(0.0000, -50.0000, 163.0000), FVector(0.0000, -150.0000, 148.3333),
+					FVector(0.0000, -188.0000, 98.3333), FVector(0.0000, -168.0000, 48.3333),
+					FVector(0.0000, -151.6667, -1.6667), FVector(100.0000, 150.0000, 171.3333),
+					FVector(100.0000, 50.0000, 162.6667), FVector(100.0000, -50.0000, 159.6667),
+					FVector(100.0000, -150.0000, 145.0000), FVector(100.0000, -184.6667, 95.0000),
+					FVector(100.0000, -176.3333, 45.0000), FVector(100.0000, -151.6667, -1.6667),
+					FVector(200.0000, 150.0000, 168.0000), FVector(200.0000, 50.0000, 171.0000),
+					FVector(200.0000, -50.0000, 156.3333), FVector(200.0000, -150.0000, 153.3333),
+					FVector(200.0000, -181.3333, 103.3333), FVector(200.0000, -173.0000, 53.3333),
+					FVector(200.0000, -151.6667, -1.6667), FVector(300.0000, 150.0000, 164.6667),
+					FVector(300.0000, 50.0000, 167.6667), FVector(300.0000, -50.0000, 153.0000),
+					FVector(300.0000, -150.0000, 150.0000), FVector(300.0000, -189.6667, 100.0000),
+					FVector(300.0000, -169.6667, 50.0000), FVector(300.0000, -151.6667, -1.6667),
+				},
+				// LastRightWallVertices
+				{},
+				// LastLeftWallVertices
+				{
+					FVector(300.0000, -189.6667, 100.0000), FVector(300.0000, -169.6667, 50.0000),
+					FVector(300.0000, -151.6667, -1.6667),
+				},
+				// LastStraightRoofVertices
+				{
+					FVector(300.0000, 150.0000, 164.6667), FVector(300.0000, 50.0000, 167.6667),
+					FVector(300.0000, -50.0000, 153.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightRoofVertices
+				{
+					FVector(0.0000, 150.0000, 165.0000), FVector(100.0000, 150.0000, 171.3333),
+					FVector(200.0000, 150.0000, 168.0000), FVector(300.0000, 150.0000, 164.6667),
+				},
+				// LastLeftRoofVertices
+				{},
+				// LastRightFloorVertices
+				{
+					FVector(0.0000, 148.3333, -3.3333), FVector(100.0000, 148.3333, -6.6667),
+					FVector(200.0000, 148.3333, 1.6667), FVector(300.0000, 148.3333, -1.6667),
+				},
+				// LastStraightFloorVertices
+				{
+					FVector(300.0000, -151.6667, -1.6667), FVector(300.0000, -51.6667, 0.0000),
+					FVector(300.0000, 48.3333, -6.6667), FVector(300.0000, 148.3333, -1.6667),
+				},
+				// LastLeftFloorVertices
+				{
+					FVector(0.0000, -151.6667, -1.6667), FVector(100.0000, -151.6667, -1.6667),
+					FVector(200.0000, -151.6667, -1.6667), FVector(300.0000, -151.6667, -1.6667),
+				},
+			}
+		},
+		{
+			TEXT("Left"), FVector(300.0000, -150.0000, 150.0000), FVector(300.0000, 150.0000, 150.0000),
+			{
+				// GroundVertices
+				{
+					FVector(0.0000, -150.0000, 0.0000), FVector(0.0000, -50.0000, 0.0000),
+					FVector(0.0000, 50.0000, 5.0000), FVector(0.0000, 150.0000, -1.6667),
+					FVector(100.0000, -150.0000, 0.0000), FVector(100.0000, -50.0000, -3.3333),
+					FVector(100.0000, 50.0000, 1.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(200.0000, -150.0000, 0.0000), FVector(200.0000, -50.0000, 5.0000),
+					FVector(200.0000, 50.0000, -1.6667), FVector(200.0000, 150.0000, 3.3333),
+					FVector(300.0000, -150.0000, 0.0000), FVector(300.0000, -50.0000, 1.6667),
+					FVector(300.0000, 50.0000, -5.0000), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// WallVertices
+				{
+					FVector(0.0000, 150.0000, -1.6667), FVector(0.0000, 181.3333, 48.3333),
+					FVector(0.0000, 173.0000, 98.3333), FVector(0.0000, 150.0000, 148.3333),
+					FVector(0.0000, 50.0000, 168.3333), FVector(0.0000, -50.0000, 173.3333),
+					FVector(0.0000, -150.0000, 166.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(100.0000, 189.6667, 45.0000), FVector(100.0000, 169.6667, 95.0000),
+					FVector(100.0000, 150.0000, 145.0000), FVector(100.0000, 50.0000, 159.0000),
+					FVector(100.0000, -50.0000, 164.0000), FVector(100.0000, -150.0000, 157.3333),
+					FVector(200.0000, 150.0000, 3.3333), FVector(200.0000, 186.3333, 53.3333),
+					FVector(200.0000, 166.3333, 103.3333), FVector(200.0000, 150.0000, 153.3333),
+					FVector(200.0000, 50.0000, 174.3333), FVector(200.0000, -50.0000, 162.3333),
+					FVector(200.0000, -150.0000, 167.3333), FVector(300.0000, 150.0000, 0.0000),
+					FVector(300.0000, 183.0000, 50.0000), FVector(300.0000, 174.6667, 100.0000),
+					FVector(300.0000, 150.0000, 150.0000), FVector(300.0000, 50.0000, 167.6667),
+					FVector(300.0000, -50.0000, 153.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightWallVertices
+				{
+					FVector(300.0000, 150.0000, 0.0000), FVector(300.0000, 183.0000, 50.0000),
+					FVector(300.0000, 174.6667, 100.0000),
+				},
+				// LastLeftWallVertices
+				{},
+				// LastStraightRoofVertices
+				{
+					FVector(300.0000, 150.0000, 150.0000), FVector(300.0000, 50.0000, 167.6667),
+					FVector(300.0000, -50.0000, 153.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightRoofVertices
+				{},
+				// LastLeftRoofVertices
+				{
+					FVector(0.0000, -150.0000, 166.6667), FVector(100.0000, -150.0000, 157.3333),
+					FVector(200.0000, -150.0000, 167.3333), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightFloorVertices
+				{
+					FVector(0.0000, 150.0000, -1.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(200.0000, 150.0000, 3.3333), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastStraightFloorVertices
+				{
+					FVector(300.0000, -150.0000, 0.0000), FVector(300.0000, -50.0000, 1.6667),
+					FVector(300.0000, 50.0000, -5.0000), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastLeftFloorVertices
+				{
+					FVector(0.0000, -150.0000, 0.0000), FVector(100.0000, -150.0000, 0.0000),
+					FVector(200.0000, -150.0000, 0.0000), FVector(300.0000, -150.0000, 0.0000),
+				},
+			}
+		},
+		{
+			TEXT("RightLeft"), FVector(421.3333, -150.0000, 50.0000), FVector(300.0000, 150.0000, 150.0000),
+			{
+				// GroundVertices
+				{
+					FVector(0.0000, -150.0000, 0.0000), FVector(0.0000, -50.0000, 0.0000),
+					FVector(0.0000, 50.0000, 5.0000), FVector(0.0000, 150.0000, -1.6667),
+					FVector(100.0000, -150.0000, 0.0000), FVector(100.0000, -50.0000, -3.3333),
+					FVector(100.0000, 50.0000, 1.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(200.0000, -150.0000, 0.0000), FVector(200.0000, -50.0000, 5.0000),
+					FVector(200.0000, 50.0000, -1.6667), FVector(200.0000, 150.0000, 3.3333),
+					FVector(300.0000, -150.0000, 0.0000), FVector(300.0000, -50.0000, 1.6667),
+					FVector(300.0000, 50.0000, -5.0000), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// WallVertices
+				{
+					FVector(0.0000, 150.0000, 168.3333), FVector(0.0000, 50.0000, 168.3333),
+					FVector(0.0000, -50.0000, 168.3333), FVector(0.0000, -150.0000, 168.3333),
+					FVector(100.0000, 150.0000, 163.0000), FVector(100.0000, 50.0000, 162.3333),
+					FVector(100.0000, -50.0000, 162.3333), FVector(100.0000, -150.0000, 162.3333),
+					FVector(200.0000, 150.0000, 164.0000), FVector(200.0000, 50.0000, 164.0000),
+					FVector(200.0000, -50.0000, 164.0000), FVector(200.0000, -150.0000, 164.0000),
+					FVector(300.0000, 150.0000, 150.0000), FVector(300.0000, 50.0000, 150.0000),
+					FVector(300.0000, -50.0000, 150.0000), FVector(300.0000, -150.0000, 150.0000),
+					FVector(434.6667, 150.0000, 100.0000), FVector(434.6667, 50.0000, 100.0000),
+					FVector(434.6667, -50.0000, 100.0000), FVector(434.6667, -150.0000, 100.0000),
+					FVector(421.3333, 150.0000, 50.0000), FVector(421.3333, 50.0000, 50.0000),
+					FVector(421.3333, -50.0000, 50.0000), FVector(421.3333, -150.0000, 50.0000),
+					FVector(300.0000, 150.0000, 0.0000), FVector(300.0000, 50.0000, -5.0000),
+					FVector(300.0000, -50.0000, 1.6667), FVector(300.0000, -150.0000, 0.0000),
+				},
+				// LastRightWallVertices
+				{
+					FVector(434.6667, 150.0000, 100.0000), FVector(421.3333, 150.0000, 50.0000),
+					FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastLeftWallVertices
+				{
+					FVector(434.6667, -150.0000, 100.0000), FVector(421.3333, -150.0000, 50.0000),
+					FVector(300.0000, -150.0000, 0.0000),
+				},
+				// LastStraightRoofVertices
+				{
+					FVector(300.0000, 150.0000, 150.0000), FVector(300.0000, 50.0000, 150.0000),
+					FVector(300.0000, -50.0000, 150.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightRoofVertices
+				{
+					FVector(0.0000, 150.0000, 168.3333), FVector(100.0000, 150.0000, 163.0000),
+					FVector(200.0000, 150.0000, 164.0000), FVector(300.0000, 150.0000, 150.0000),
+				},
+				// LastLeftRoofVertices
+				{
+					FVector(0.0000, -150.0000, 168.3333), FVector(100.0000, -150.0000, 162.3333),
+					FVector(200.0000, -150.0000, 164.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightFloorVertices
+				{
+					FVector(0.0000, 150.0000, -1.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(200.0000, 150.0000, 3.3333), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastStraightFloorVertices
+				{
+					FVector(300.0000, -150.0000, 0.0000), FVector(300.0000, -50.0000, 1.6667),
+					FVector(300.0000, 50.0000, -5.0000), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastLeftFloorVertices
+				{
+					FVector(0.0000, -150.0000, 0.0000), FVector(100.0000, -150.0000, 0.0000),
+					FVector(200.0000, -150.0000, 0.0000), FVector(300.0000, -150.0000, 0.0000),
+				},
+			}
+		},
+		{
+			TEXT("All"), FVector(300.0000, -150.0000, 150.0000), FVector(300.0000, 150.0000, 150.0000),
+			{
+				// GroundVertices
+				{
+					FVector(0.0000, -150.0000, 0.0000), FVector(0.0000, -50.0000, 0.0000),
+					FVector(0.0000, 50.0000, 5.0000), FVector(0.0000, 150.0000, -1.6667),
+					FVector(100.0000, -150.0000, 0.0000), FVector(100.0000, -50.0000, -3.3333),
+					FVector(100.0000, 50.0000, 1.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(200.0000, -150.0000, 0.0000), FVector(200.0000, -50.0000, 5.0000),
+					FVector(200.0000, 50.0000, -1.6667), FVector(200.0000, 150.0000, 3.3333),
+					FVector(300.0000, -150.0000, 0.0000), FVector(300.0000, -50.0000, 1.6667),
+					FVector(300.0000, 50.0000, -5.0000), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// WallVertices
+				{
+					FVector(0.0000, 150.0000, 168.3333), FVector(0.0000, 50.0000, 168.3333),
+					FVector(0.0000, -50.0000, 168.3333), FVector(0.0000, -150.0000, 168.3333),
+					FVector(100.0000, 150.0000, 163.0000), FVector(100.0000, 50.0000, 162.3333),
+					FVector(100.0000, -50.0000, 162.3333), FVector(100.0000, -150.0000, 162.3333),
+					FVector(200.0000, 150.0000, 171.3333), FVector(200.0000, 50.0000, 169.3333),
+					FVector(200.0000, -50.0000, 164.0000), FVector(200.0000, -150.0000, 164.0000),
+					FVector(300.0000, 150.0000, 168.0000), FVector(300.0000, 50.0000, 166.0000),
+					FVector(300.0000, -50.0000, 158.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightWallVertices
+				{},
+				// LastLeftWallVertices
+				{},
+				// LastStraightRoofVertices
+				{
+					FVector(300.0000, 150.0000, 168.0000), FVector(300.0000, 50.0000, 166.0000),
+					FVector(300.0000, -50.0000, 158.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightRoofVertices
+				{
+					FVector(0.0000, 150.0000, 168.3333), FVector(100.0000, 150.0000, 163.0000),
+					FVector(200.0000, 150.0000, 171.3333), FVector(300.0000, 150.0000, 168.0000),
+				},
+				// LastLeftRoofVertices
+				{
+					FVector(0.0000, -150.0000, 168.3333), FVector(100.0000, -150.0000, 162.3333),
+					FVector(200.0000, -150.0000, 164.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightFloorVertices
+				{
+					FVector(0.0000, 150.0000, -1.6667), FVector(100.0000, 150.0000, -5.0000),
+					FVector(200.0000, 150.0000, 3.3333), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastStraightFloorVertices
+				{
+					FVector(300.0000, -150.0000, 0.0000), FVector(300.0000, -50.0000, 1.6667),
+					FVector(300.0000, 50.0000, -5.0000), FVector(300.0000, 150.0000, 0.0000),
+				},
+				// LastLeftFloorVertices
+				{
+					FVector(0.0000, -150.0000, 0.0000), FVector(100.0000, -150.0000, 0.0000),
+					FVector(200.0000, -150.0000, 0.0000), FVector(300.0000, -150.0000, 0.0000),
+				},
+			}
+		},
+		{
+			TEXT("RightWithParent"), FVector(300.0000, 320.0000, 75.0000), FVector(300.0000, 20.0000, 75.0000),
+			{
+				// GroundVertices
+				{
+					FVector(-5.0000, 150.0000, 0.0000), FVector(-5.0000, 50.0000, 1.5000),
+					FVector(-5.0000, -50.0000, 3.0000), FVector(-5.0000, -150.0000, 4.5000),
+					FVector(100.0000, 20.0000, 75.0000), FVector(100.0000, 120.0000, 71.6667),
+					FVector(100.0000, 220.0000, 76.6667), FVector(100.0000, 320.0000, 70.0000),
+					FVector(200.0000, 20.0000, 75.0000), FVector(200.0000, 120.0000, 80.0000),
+					FVector(200.0000, 220.0000, 73.3333), FVector(200.0000, 320.0000, 78.3333),
+					FVector(300.0000, 20.0000, 75.0000), FVector(300.0000, 120.0000, 76.6667),
+					FVector(300.0000, 220.0000, 70.0000), FVector(300.0000, 320.0000, 75.0000),
+				},
+				// WallVertices
+				{
+					FVector(-5.0000, 140.0000, 225.0000), FVector(-5.0000, 120.0000, 200.0000),
+					FVector(-5.0000, 100.0000, 175.0000), FVector(-5.0000, 80.0000, 150.0000),
+					FVector(-5.0000, 60.0000, 125.0000), FVector(-5.0000, 40.0000, 100.0000),
+					FVector(-5.0000, 20.0000, 75.0000), FVector(100.0000, 150.0000, 171.3333),
+					FVector(100.0000, 50.0000, 162.6667), FVector(100.0000, -50.0000, 159.6667),
+					FVector(100.0000, -150.0000, 145.0000), FVector(100.0000, -184.6667, 95.0000),
+					FVector(100.0000, -176.3333, 45.0000), FVector(100.0000, 20.0000, 75.0000),
+					FVector(200.0000, 150.0000, 168.0000), FVector(200.0000, 50.0000, 171.0000),
+					FVector(200.0000, -50.0000, 156.3333), FVector(200.0000, -150.0000, 153.3333),
+					FVector(200.0000, -181.3333, 103.3333), FVector(200.0000, -173.0000, 53.3333),
+					FVector(200.0000, 20.0000, 75.0000), FVector(300.0000, 150.0000, 164.6667),
+					FVector(300.0000, 50.0000, 167.6667), FVector(300.0000, -50.0000, 153.0000),
+					FVector(300.0000, -150.0000, 150.0000), FVector(300.0000, -189.6667, 100.0000),
+					FVector(300.0000, -169.6667, 50.0000), FVector(300.0000, 20.0000, 75.0000),
+				},
+				// LastRightWallVertices
+				{},
+				// LastLeftWallVertices
+				{
+					FVector(300.0000, -189.6667, 100.0000), FVector(300.0000, -169.6667, 50.0000),
+					FVector(300.0000, 20.0000, 75.0000),
+				},
+				// LastStraightRoofVertices
+				{
+					FVector(300.0000, 150.0000, 164.6667), FVector(300.0000, 50.0000, 167.6667),
+					FVector(300.0000, -50.0000, 153.0000), FVector(300.0000, -150.0000, 150.0000),
+				},
+				// LastRightRoofVertices
+				{
+					FVector(-5.0000, 140.0000, 225.0000), FVector(100.0000, 150.0000, 171.3333),
+					FVector(200.0000, 150.0000, 168.0000), FVector(300.0000, 150.0000, 164.6667),
+				},
+				// LastLeftRoofVertices
+				{},
+				// LastRightFloorVertices
+				{
+					FVector(-5.0000, -150.0000, 4.5000), FVector(100.0000, 320.0000, 70.0000),
+					FVector(200.0000, 320.0000, 78.3333), FVector(300.0000, 320.0000, 75.0000),
+				},
+				// LastStraightFloorVertices
+				{
+					FVector(300.0000, 20.0000, 75.0000), FVector(300.0000, 120.0000, 76.6667),
+					FVector(300.0000, 220.0000, 70.0000), FVector(300.0000, 320.0000, 75.0000),
+				},
+				// LastLeftFloorVertices
+				{
+					FVector(-5.0000, 150.0000, 0.0000), FVector(100.0000, 20.0000, 75.0000),
+					FVector(200.0000, 20.0000, 75.0000), FVector(300.0000, 20.0000, 75.0000),
+				},
+			}
+		},
+	};
+	return Golden;
+}
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "IntersectionVertexKernel.h"
+#include "IntersectionVertexKernelGolden.h"
+#include "TunnelDeformationField.h"
+#include "BakedCurve.h"
+#include "Curves/CurveFloat.h"
+
+namespace
+{
+	// Golden positions are rounded to 0.0001 cm, the baked roundness curve adds its error on top
+	constexpr double GoldenTolerance = 0.001;
+
+	struct FGoldenCase
+	{
+		IntersectionType Type;
+		bool bHasParent;
+	};
+
+	// Same order as GetIntersectionKernelGolden
+	const FGoldenCase GoldenCases[] = {
+		{ IntersectionType::Right, false },
+		{ IntersectionType::Left, false },
+		{ IntersectionType::RightLeft, false },
+		{ IntersectionType::All, false },
+		{ IntersectionType::Right, true },
+	};
+
+	const TCHAR* OutputArrayNames[] = {
+		TEXT("GroundVertices"), TEXT("WallVertices"), TEXT("LastRightWallVertices"), TEXT("LastLeftWallVertices"), TEXT("LastStraightRoofVertices"),
+		TEXT("LastRightRoofVertices"), TEXT("LastLeftRoofVertices"), TEXT("LastRightFloorVertices"), TEXT("LastStraightFloorVertices"), TEXT("LastLeftFloorVertices") };
+
+	UCurveFloat* MakeRoundnessCurve()
+	{
+		UCurveFloat* Curve = NewObject<UCurveFloat>(GetTransientPackage());
+		for (const FVector2f& Key : { FVector2f(0.0f, 0.0f), FVector2f(0.5f, 0.2f), FVector2f(1.0f, 1.0f) }) {
+			const FKeyHandle Handle = Curve->FloatCurve.AddKey(Key.X, Key.Y);
+			Curve->FloatCurve.SetKeyInterpMode(Handle, RCIM_Linear);
+		}
+		return Curve;
+	}
+
+	// Inputs the golden vertices were made with, see IntersectionVertexKernelGolden.h
+	void MakeGoldenInput(const FGoldenCase& Case, const FBakedCurve& Curve, FTunnelDeformationField& Field, FIntersectionKernelInput& Input)
+	{
+		Input.Type = Case.Type;
+		Input.NumberOfHorizontalPoints = 4;
+		Input.NumberOfVerticalPoints = 3;
+		const int32 H = Input.NumberOfHorizontalPoints;
+		const int32 V = Input.NumberOfVerticalPoints;
+		Input.LoopAroundTunnelLastIndex = Case.Type == IntersectionType::Right || Case.Type == IntersectionType::Left ? H * 2 + V - 1 : H * 2 - 1;
+		Input.HorizontalPointSize = 100.0f;
+		Input.VerticalPointSize = 50.0f;
+		Input.SurfaceVariation = FVector2D(0.5f, 0.25f);
+		Input.TunnelRoundValue = 40.0f;
+		Input.MaxWallDeformation = 20.0f;
+		Input.MaxFloorDeformation = 10.0f;
+
+		Field.InitFromSampler(H, Input.LoopAroundTunnelLastIndex + 1, [](int32 X, int32 Y) { return (float)((X * 5 + Y * 3) % 7) / 6.0f; });
+		Input.DeformationField = &Field;
+		Input.Roundness.Build(Curve, H, V);
+
+		// Last loop of a parent tunnel, already in intersection space
+		if (Case.bHasParent) {
+			Input.HasParent = true;
+			for (int32 Index = 0; Index < H; Index++) {
+				Input.ParentGround.Add(FVector(-5.0f, 150.0f - 100.0f * Index, 1.5f * Index));
+			}
+			for (int32 Index = 0; Index < H + V * 2; Index++) {
+				Input.ParentWall.Add(FVector(-5.0f, 200.0f - 20.0f * Index, 300.0f - 25.0f * Index));
+			}
+		}
+	}
+
+	// Generates like AProceduralIntersection::GenerateVertices, the end wall of RightLeft continues from the kernel output
+	void GenerateGolden(const FIntersectionKernelInput& Input, FIntersectionKernelOutput& Output)
+	{
+		FIntersectionVertexKernel::Generate(Input, Output);
+		if (Input.Type == IntersectionType::RightLeft) {
+			FIntersectionVertexKernel::AppendEndWall(Input, Output.LastStraightRoofVertices, Output.LastStraightFloorVertices,
+				Output.LatestVertice, Output.WallVertices, Output.LastRightWallVertices, Output.LastLeftWallVertices);
+		}
+	}
+
+	void GetOutputArrays(const FIntersectionKernelOutput& Output, const TArray<FVector>* (&Arrays)[10])
+	{
+		Arrays[0] = &Output.GroundVertices;
+		Arrays[1] = &Output.WallVertices;
+		Arrays[2] = &Output.LastRightWallVertices;
+		Arrays[3] = &Output.LastLeftWallVertices;
+		Arrays[4] = &Output.LastStraightRoofVertices;
+		Arrays[5] = &Output.LastRightRoofVertices;
+		Arrays[6] = &Output.LastLeftRoofVertices;
+		Arrays[7] = &Output.LastRightFloorVertices;
+		Arrays[8] = &Output.LastStraightFloorVertices;
+		Arrays[9] = &Output.LastLeftFloorVertices;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIntersectionVertexKernelGoldenTest, "CharmTunnelSim.Intersection.VertexKernelGolden",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Generates every intersection type with the vertex kernel and compares it to what the serial loop made for the same input
+bool FIntersectionVertexKernelGoldenTest::RunTest(const FString& Parameters)
+{
+	const TArray<FIntersectionKernelGolden>& Golden = GetIntersectionKernelGolden();
+	if (!TestEqual(TEXT("Golden data has every case"), Golden.Num(), (int32)UE_ARRAY_COUNT(GoldenCases))) {
+		return false;
+	}
+	FBakedCurve Curve;
+	Curve.Bake(MakeRoundnessCurve());
+
+	for (int32 CaseIndex = 0; CaseIndex < Golden.Num(); CaseIndex++) {
+		const FIntersectionKernelGolden& Expected = Golden[CaseIndex];
+		FTunnelDeformationField Field;
+		FIntersectionKernelInput Input;
+		MakeGoldenInput(GoldenCases[CaseIndex], Curve, Field, Input);
+
+		FIntersectionKernelOutput Output;
+		GenerateGolden(Input, Output);
+		const double Tolerance = GoldenTolerance + (double)Curve.GetMeasuredError() * Input.TunnelRoundValue;
+		const TArray<FVector>* Arrays[10];
+		GetOutputArrays(Output, Arrays);
+
+		for (int32 ArrayIndex = 0; ArrayIndex < (int32)UE_ARRAY_COUNT(Arrays); ArrayIndex++) {
+			const TArray<FVector>& Actual = *Arrays[ArrayIndex];
+			const TArray<FVector>& ExpectedArray = Expected.Arrays[ArrayIndex];
+			if (!TestEqual(FString::Printf(TEXT("%s %s vertex count"), Expected.Name, OutputArrayNames[ArrayIndex]), Actual.Num(), ExpectedArray.Num())) {
+				continue;
+			}
+			for (int32 Vertex = 0; Vertex < Actual.Num(); Vertex++) {
+				if (!Actual[Vertex].Equals(ExpectedArray[Vertex], Tolerance)) {
+					AddError(FString::Printf(TEXT("%s %s[%d] is %s, serial loop made %s."), Expected.Name, OutputArrayNames[ArrayIndex], Vertex,
+						*Actual[Vertex].ToString(), *ExpectedArray[Vertex].ToString()));
+					break;
+				}
+			}
+		}
+		TestTrue(FString::Printf(TEXT("%s latest vertex"), Expected.Name), Output.LatestVertice.Equals(Expected.LatestVertice, Tolerance));
+		TestTrue(FString::Printf(TEXT("%s first vertex"), Expected.Name), Output.FirstVertice.Equals(Expected.FirstVertice, Tolerance));
+
+		// Rows run in parallel, a second run has to make the same vertices exactly
+		FIntersectionKernelOutput Again;
+		GenerateGolden(Input, Again);
+		TestTrue(FString::Printf(TEXT("%s is the same on every run"), Expected.Name),
+			Again.GroundVertices == Output.GroundVertices && Again.WallVertices == Output.WallVertices);
+	}
+	return true;
+}
+
+#endif
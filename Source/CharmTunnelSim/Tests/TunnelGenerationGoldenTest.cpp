@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TunnelReferenceCases.h"
+#include "TunnelGenerationStats.h"
+#include "TunnelNetwork.h"
+#include "ProceduralTunnel.h"
+#include "ProceduralIntersection.h"
+#include "TunnelTestWorld.h"
+#include "HAL/IConsoleManager.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTunnelGenerationGoldenTest, "CharmTunnelSim.Generation.Golden",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Generates every reference case twice and compares the geometry hash with Benchmarks/TunnelGolden.txt. Runs headless:
+// UnrealEditor-Cmd CharmTunnelSim.uproject -ExecCmds="Automation RunTests CharmTunnelSim.Generation; Quit" -nullrhi -unattended
+// A case missing from the golden file is only checked for repeatable output and logged, record it with -run=TunnelBenchmark -record
+// on the same engine build
+bool FTunnelGenerationGoldenTest::RunTest(const FString& Parameters)
+{
+	UClass* TunnelClass = LoadClass<AProceduralTunnel>(nullptr, FTunnelReferenceCases::DefaultTunnelClass);
+	UClass* IntersectionClass = LoadClass<AProceduralIntersection>(nullptr, FTunnelReferenceCases::DefaultIntersectionClass);
+	if (!TestNotNull(TEXT("Tunnel class is loaded"), TunnelClass) || !TestNotNull(TEXT("Intersection class is loaded"), IntersectionClass)) {
+		return false;
+	}
+	const FString GoldenPath = FTunnelReferenceCases::GetDefaultGoldenPath();
+	const TMap<FString, FString> Golden = FTunnelReferenceCases::LoadGoldenFile(GoldenPath);
+
+	// Cached geometry would be read back instead of generated
+	IConsoleVariable* CacheVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("tunnel.Cache.Enable"));
+	const bool bCacheWasEnabled = CacheVariable && CacheVariable->GetBool();
+	if (CacheVariable) {
+		CacheVariable->Set(false, ECVF_SetByCode);
+	}
+	FTunnelGenerationStats& Stats = FTunnelGenerationStats::Get();
+	const bool bWasCollecting = Stats.IsCollecting();
+	Stats.Reset();
+
+	{
+		FTunnelTestWorld TestWorld(TEXT("TunnelGoldenTest"));
+		for (const FTunnelReferenceCase& Case : FTunnelReferenceCases::Make()) {
+			// Second run is timed, the first one also loads the assets the classes use
+			FTunnelGeometryHash Hashes[2];
+			double Seconds = 0.0;
+			bool bGenerated = true;
+			for (int32 Run = 0; Run < 2 && bGenerated; Run++) {
+				Stats.SetCollecting(Run == 1);
+				FTunnelNetworkActors Actors;
+				FString Error;
+				const double StartSeconds = FPlatformTime::Seconds();
+				bGenerated = UTunnelNetworkLibrary::GenerateTunnelNetwork(TestWorld.World, Case.Network, TunnelClass, IntersectionClass, Actors, Error);
+				Seconds = FPlatformTime::Seconds() - StartSeconds;
+				TestTrue(FString::Printf(TEXT("%s is generated (%s)"), *Case.Name, *Error), bGenerated);
+				Hashes[Run] = FTunnelReferenceCases::HashActors(Actors, FTunnelReferenceCases::DefaultTolerance);
+				FTunnelReferenceCases::DestroyActors(Actors);
+			}
+			Stats.SetCollecting(false);
+			if (!bGenerated) {
+				continue;
+			}
+
+			// Parallel generation has to make the same tunnel every time
+			TestEqual(FString::Printf(TEXT("%s makes the same geometry on every run"), *Case.Name), Hashes[1].ToString(), Hashes[0].ToString());
+			if (const FString* Expected = Golden.Find(Case.Name)) {
+				TestEqual(FString::Printf(TEXT("%s geometry (vertices, triangles, hash)"), *Case.Name), Hashes[0].ToString(), *Expected);
+			}
+			else {
+				AddWarning(FString::Printf(TEXT("%s is not in %s, skipped comparing the %s it made. Record it with -run=TunnelBenchmark -record -cases=%s."),
+					*Case.Name, *GoldenPath, *Hashes[0].ToString(), *Case.Name));
+			}
+			AddInfo(FString::Printf(TEXT("%s: %.3f ms, %lld vertices, %lld triangles."), *Case.Name, Seconds * 1000.0, Hashes[0].Vertices, Hashes[0].Triangles));
+		}
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+	AddInfo(FString::Printf(TEXT("Generation phases of all cases:\n%s"), *Stats.ToString()));
+
+	Stats.Reset();
+	Stats.SetCollecting(bWasCollecting);
+	if (CacheVariable) {
+		CacheVariable->Set(bCacheWasEnabled, ECVF_SetByCode);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TunnelSaveFile.h"
+#include "TunnelNetwork.h"
+#include "TunnelReferenceCases.h"
+#include "ProceduralTunnel.h"
+#include "ProceduralIntersection.h"
+#include "TunnelTestWorld.h"
+#include "TunnelEndpointSubsystem.h"
+#include "Components/SplineComponent.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	// Positions are saved as floats, a few hundredths of a centimeter is their precision this far from the origin
+	constexpr double PositionTolerance = 0.05;
+
+	// A curved tunnel and a sloped one. The second tunnel is moved and rolled after generating, so its actor transform is
+	// not the one a tunnel gets when it is spawned from its spline and restoring has to move the saved geometry
+	FTunnelNetwork MakeRoundTripNetwork()
+	{
+		FTunnelNetwork Network;
+		FTunnelNetworkEdge& Curve = Network.Edges.AddDefaulted_GetRef();
+		Curve.Id = TEXT("curve");
+		Curve.Points = { FVector(0.0, 0.0, 0.0), FVector(1500.0, 0.0, 0.0), FVector(2500.0, 900.0, 0.0), FVector(3500.0, 0.0, 0.0) };
+		FTunnelNetworkEdge& Slope = Network.Edges.AddDefaulted_GetRef();
+		Slope.Id = TEXT("slope");
+		Slope.Points = { FVector(0.0, 6000.0, 0.0), FVector(2000.0, 6000.0, -250.0), FVector(4000.0, 6000.0, -750.0) };
+		return Network;
+	}
+
+	// Full resolution ground and wall of every mesh in world space
+	bool GetWorldSections(const AProceduralTunnel* Tunnel, TArray<TArray<FVector>>& OutPositions, TArray<TArray<uint32>>& OutIndices)
+	{
+		for (UProceduralMeshComponent* Mesh : Tunnel->TunnelMeshes) {
+			if (!IsValid(Mesh) || Mesh->GetNumSections() < 2) {
+				return false;
+			}
+			const FTransform& Transform = Mesh->GetComponentTransform();
+			for (int32 Surface = 0; Surface < 2; Surface++) {
+				const FProcMeshSection* Section = Mesh->GetProcMeshSection(Surface);
+				TArray<FVector>& Positions = OutPositions.AddDefaulted_GetRef();
+				Positions.Reserve(Section->ProcVertexBuffer.Num());
+				for (const FProcMeshVertex& Vertex : Section->ProcVertexBuffer) {
+					Positions.Add(Transform.TransformPosition(Vertex.Position));
+				}
+				OutIndices.Add(Section->ProcIndexBuffer);
+			}
+		}
+		return true;
+	}
+
+	AProceduralTunnel* FindTunnel(const TArray<AProceduralTunnel*>& Tunnels, const FString& Name)
+	{
+		AProceduralTunnel* const* Found = Tunnels.FindByPredicate([&Name](const AProceduralTunnel* Tunnel) { return Tunnel->GetName() == Name; });
+		return Found ? *Found : nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTunnelSaveFileRoundTripTest, "CharmTunnelSim.SaveFile.RoundTrip",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Saves generated tunnels, loads them into a fresh world and compares the world space geometry of every section
+bool FTunnelSaveFileRoundTripTest::RunTest(const FString& Parameters)
+{
+	UClass* TunnelClass = LoadClass<AProceduralTunnel>(nullptr, FTunnelReferenceCases::DefaultTunnelClass);
+	UClass* IntersectionClass = LoadClass<AProceduralIntersection>(nullptr, FTunnelReferenceCases::DefaultIntersectionClass);
+	if (!TestNotNull(TEXT("Tunnel class is loaded"), TunnelClass) || !TestNotNull(TEXT("Intersection class is loaded"), IntersectionClass)) {
+		return false;
+	}
+	const FString FilePath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("TunnelRoundTrip.ctun"));
+
+	FTunnelTestWorld Source(TEXT("TunnelSaveSource"));
+	FTunnelNetworkActors Generated;
+	FString Error;
+	const double GenerateStart = FPlatformTime::Seconds();
+	if (!TestTrue(FString::Printf(TEXT("Network is generated (%s)"), *Error),
+		UTunnelNetworkLibrary::GenerateTunnelNetwork(Source.World, MakeRoundTripNetwork(), TunnelClass, IntersectionClass, Generated, Error))) {
+		return false;
+	}
+	const double GenerateSeconds = FPlatformTime::Seconds() - GenerateStart;
+	AProceduralTunnel* Moved = Generated.Tunnels.Last();
+	Moved->SetActorLocationAndRotation(Moved->GetActorLocation() + FVector(300.0, -200.0, 150.0), FRotator(5.0, 20.0, 15.0));
+
+	const double SaveStart = FPlatformTime::Seconds();
+	if (!TestTrue(TEXT("Tunnels are saved"), FTunnelSaveFile::Save(Source.World, FilePath, true, Error))) {
+		AddError(Error);
+		return false;
+	}
+	const double SaveSeconds = FPlatformTime::Seconds() - SaveStart;
+
+	// Load is everything from opening the file to meshes on their components
+	FTunnelTestWorld Target(TEXT("TunnelSaveTarget"));
+	FTunnelNetworkActors Loaded;
+	const double LoadStart = FPlatformTime::Seconds();
+	FTunnelSaveFile File;
+	const bool bOpened = File.Open(FilePath, Error);
+	const bool bSpawned = bOpened && File.Spawn(Target.World, TunnelClass, IntersectionClass, Loaded, Error);
+	const double LoadSeconds = FPlatformTime::Seconds() - LoadStart;
+	if (!TestTrue(FString::Printf(TEXT("Save file is opened and spawned (%s)"), *Error), bSpawned)) {
+		return false;
+	}
+	AddInfo(FString::Printf(TEXT("Generate %.2f ms, save %.2f ms, load %.2f ms (%d sections, %s)"), GenerateSeconds * 1000.0, SaveSeconds * 1000.0,
+		LoadSeconds * 1000.0, File.GetSections().Num(), File.IsMemoryMapped() ? TEXT("memory mapped") : TEXT("read into memory")));
+
+	const FTunnelNetwork& Network = File.GetNetwork();
+	TestEqual(TEXT("Every tunnel is spawned"), Loaded.Tunnels.Num(), Generated.Tunnels.Num());
+	for (int32 EdgeIndex = 0; EdgeIndex < Network.Edges.Num() && EdgeIndex < Loaded.Tunnels.Num(); EdgeIndex++) {
+		const AProceduralTunnel* Original = FindTunnel(Generated.Tunnels, Network.Edges[EdgeIndex].Id);
+		const AProceduralTunnel* Restored = Loaded.Tunnels[EdgeIndex];
+		if (!TestNotNull(TEXT("Saved tunnel is one of the generated ones"), Original) || !TestNotNull(TEXT("Tunnel is spawned"), Restored)) {
+			continue;
+		}
+
+		TArray<TArray<FVector>> OriginalPositions;
+		TArray<TArray<FVector>> RestoredPositions;
+		TArray<TArray<uint32>> OriginalIndices;
+		TArray<TArray<uint32>> RestoredIndices;
+		TestTrue(TEXT("Original meshes are uploaded"), GetWorldSections(Original, OriginalPositions, OriginalIndices));
+		TestTrue(TEXT("Restored meshes are uploaded"), GetWorldSections(Restored, RestoredPositions, RestoredIndices));
+		if (!TestEqual(FString::Printf(TEXT("%s section count"), *Network.Edges[EdgeIndex].Id), RestoredPositions.Num(), OriginalPositions.Num())) {
+			continue;
+		}
+
+		for (int32 Section = 0; Section < OriginalPositions.Num(); Section++) {
+			const TArray<FVector>& Expected = OriginalPositions[Section];
+			const TArray<FVector>& Actual = RestoredPositions[Section];
+			TestTrue(FString::Printf(TEXT("%s section %d has the same triangles"), *Network.Edges[EdgeIndex].Id, Section), RestoredIndices[Section] == OriginalIndices[Section]);
+			if (!TestEqual(FString::Printf(TEXT("%s section %d vertex count"), *Network.Edges[EdgeIndex].Id, Section), Actual.Num(), Expected.Num())) {
+				continue;
+			}
+			double MaxError = 0.0;
+			for (int32 Vertex = 0; Vertex < Expected.Num(); Vertex++) {
+				MaxError = FMath::Max(MaxError, FVector::Dist(Expected[Vertex], Actual[Vertex]));
+			}
+			TestTrue(FString::Printf(TEXT("%s section %d is at the same place in the world, off by %.4f cm"), *Network.Edges[EdgeIndex].Id, Section, MaxError),
+				MaxError <= PositionTolerance);
+		}
+
+		// Snapping finds the restored tunnel at the end of its loaded spline
+		const USplineComponent* Spline = Restored->SplineComponent;
+		const FVector EndLocation = Spline->GetLocationAtSplinePoint(Spline->GetNumberOfSplinePoints() - 1, ESplineCoordinateSpace::World);
+		TArray<FTunnelEndpoint> Endpoints;
+		Target.World->GetSubsystem<UTunnelEndpointSubsystem>()->FindEndpoints(EndLocation, 1.0f, nullptr, Endpoints);
+		TestTrue(FString::Printf(TEXT("%s end is in the endpoint grid"), *Network.Edges[EdgeIndex].Id),
+			Endpoints.ContainsByPredicate([Restored](const FTunnelEndpoint& Endpoint) { return Endpoint.Tunnel.Get() == Restored && !Endpoint.bIsStart; }));
+	}
+
+	IFileManager::Get().Delete(*FilePath);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTunnelSaveFileCorruptedTest, "CharmTunnelSim.SaveFile.Corrupted",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Damaged graphs and chunks of an unknown version are refused instead of read
+bool FTunnelSaveFileCorruptedTest::RunTest(const FString& Parameters)
+{
+	FTunnelNetwork Network = MakeRoundTripNetwork();
+	FTunnelNetworkNode& Node = Network.Nodes.AddDefaulted_GetRef();
+	Node.Id = TEXT("x");
+	Node.ParentTunnel = TEXT("curve");
+
+	TArray<uint8> Graph;
+	FMemoryWriter Writer(Graph);
+	TestTrue(TEXT("Graph is written"), Network.Serialize(Writer));
+
+	{
+		FTunnelNetwork Read;
+		FMemoryReader Reader(Graph);
+		TestTrue(TEXT("Graph is read back"), Read.Serialize(Reader));
+		TestEqual(TEXT("Tunnels read back"), Read.Edges.Num(), Network.Edges.Num());
+		TestTrue(TEXT("Points read back"), Read.Edges.Num() == 2 && Read.Edges[1].Points == Network.Edges[1].Points);
+	}
+	{
+		TArray<uint8> Truncated(Graph.GetData(), Graph.Num() - 7);
+		FTunnelNetwork Read;
+		FMemoryReader Reader(Truncated);
+		TestFalse(TEXT("Truncated graph is refused"), Read.Serialize(Reader));
+	}
+	{
+		// Node count is the first value of the graph
+		TArray<uint8> HugeCount = Graph;
+		*(int32*)HugeCount.GetData() = MAX_int32;
+		FTunnelNetwork Read;
+		FMemoryReader Reader(HugeCount);
+		TestFalse(TEXT("Node count larger than the graph is refused"), Read.Serialize(Reader));
+		TestEqual(TEXT("Nothing is allocated for a refused count"), Read.Nodes.Num(), 0);
+	}
+	{
+		// Intersections on a tunnel that is not in the graph, or on a tunnel that already has one, cannot be generated
+		TArray<TArray<int32>> Levels;
+		FString LevelsError;
+		FTunnelNetwork UnknownParent = Network;
+		UnknownParent.Nodes.Last().ParentTunnel = TEXT("missing");
+		TestFalse(TEXT("Intersection on an unknown tunnel is refused"), UnknownParent.GetGenerationLevels(Levels, LevelsError));
+		TestTrue(TEXT("Unknown tunnel error names the intersection"), LevelsError.Contains(TEXT("'x'")));
+
+		FTunnelNetwork SameParent = Network;
+		FTunnelNetworkNode Second = Node;
+		Second.Id = TEXT("y");
+		SameParent.Nodes.Add(Second);
+		TestFalse(TEXT("Second intersection on one tunnel is refused"), SameParent.GetGenerationLevels(Levels, LevelsError));
+		TestTrue(TEXT("Second intersection error names it"), LevelsError.Contains(TEXT("'y'")));
+	}
+
+	// Chunk table follows the 16 byte header, every entry is id, version, offset and size
+	FTunnelTestWorld Empty(TEXT("TunnelSaveEmpty"));
+	const FString FilePath = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("TunnelCorrupted.ctun"));
+	FString Error;
+	if (!TestTrue(TEXT("Empty world is saved"), FTunnelSaveFile::Save(Empty.World, FilePath, true, Error))) {
+		return false;
+	}
+	TArray<uint8> FileData;
+	FFileHelper::LoadFileToArray(FileData, *FilePath);
+	FTunnelSaveFile File;
+	TestTrue(TEXT("Saved file opens"), File.Open(FilePath, Error));
+	File.Close();
+
+	uint32* FirstChunkVersion = (uint32*)(FileData.GetData() + 16 + sizeof(uint32));
+	*FirstChunkVersion += 1;
+	FFileHelper::SaveArrayToFile(FileData, *FilePath);
+	TestFalse(TEXT("Chunk of an unknown version is refused"), File.Open(FilePath, Error));
+	AddInfo(Error);
+
+	IFileManager::Get().Delete(*FilePath);
+	return true;
+}
+
+#endif
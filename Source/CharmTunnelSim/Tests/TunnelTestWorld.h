@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+// Game world of its own, so a test neither touches an open level nor sees its tunnels
+struct FTunnelTestWorld
+{
+	UWorld* World = nullptr;
+
+	explicit FTunnelTestWorld(const TCHAR* Name)
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, Name);
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+	}
+
+	~FTunnelTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+};
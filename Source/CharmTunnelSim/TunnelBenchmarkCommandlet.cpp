@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelBenchmarkCommandlet.h"
+#include "ProceduralIntersection.h"
+#include "ProceduralTunnel.h"
+#include "TunnelGenerationStats.h"
+#include "TunnelNetwork.h"
+#include "TunnelReferenceCases.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "PhysicsEngine/BodySetup.h"
+
+namespace
+{
+	// Meshes only start an async cook when they are uploaded, so the benchmark cooks the same collision on this
+	// thread the way the component does with async cooking turned off
+	void CookCollision(UProceduralMeshComponent* Mesh)
+	{
+		if (!IsValid(Mesh) || Mesh->GetNumSections() == 0) {
+			return;
+		}
+		TUNNEL_GENERATION_PHASE_SCOPE(CollisionCooking);
+		UBodySetup* BodySetup = NewObject<UBodySetup>(Mesh, NAME_None, RF_Transient);
+		BodySetup->BodySetupGuid = FGuid::NewGuid();
+		BodySetup->bGenerateMirroredCollision = false;
+		BodySetup->bDoubleSidedGeometry = true;
+		BodySetup->CollisionTraceFlag = Mesh->bUseComplexAsSimpleCollision ? CTF_UseComplexAsSimple : CTF_UseDefault;
+		BodySetup->CreatePhysicsMeshes();
+		BodySetup->ClearPhysicsMeshes();
+	}
+
+	void CookCollision(const FTunnelNetworkActors& Actors)
+	{
+		for (AProceduralTunnel* Tunnel : Actors.Tunnels) {
+			for (UProceduralMeshComponent* Mesh : Tunnel->TunnelMeshes) {
+				CookCollision(Mesh);
+			}
+		}
+		for (AProceduralIntersection* Intersection : Actors.Intersections) {
+			CookCollision(Intersection->IntersectionMesh);
+		}
+	}
+}
+
+UTunnelBenchmarkCommandlet::UTunnelBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UTunnelBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Iterations = 5;
+	double Tolerance = FTunnelReferenceCases::DefaultTolerance;
+	FString CaseList;
+	FString TunnelClassPath = FTunnelReferenceCases::DefaultTunnelClass;
+	FString IntersectionClassPath = FTunnelReferenceCases::DefaultIntersectionClass;
+	FString GoldenPath = FTunnelReferenceCases::GetDefaultGoldenPath();
+	FString CsvPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), TEXT("TunnelGeneration.csv"));
+
+	FParse::Value(*Params, TEXT("iterations="), Iterations);
+	FParse::Value(*Params, TEXT("tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("cases="), CaseList, false);
+	FParse::Value(*Params, TEXT("tunnelclass="), TunnelClassPath);
+	FParse::Value(*Params, TEXT("intersectionclass="), IntersectionClassPath);
+	FParse::Value(*Params, TEXT("golden="), GoldenPath);
+	FParse::Value(*Params, TEXT("csv="), CsvPath);
+	const bool bRecord = FParse::Param(*Params, TEXT("record"));
+	const bool bUseCache = FParse::Param(*Params, TEXT("cache"));
+
+	Iterations = FMath::Max(Iterations, 1);
+	Tolerance = FMath::Max(Tolerance, 1e-6);
+
+	// Blueprint classes hold the curves, materials and mesh components the tunnels are made with
+	UClass* TunnelClass = LoadClass<AProceduralTunnel>(nullptr, *TunnelClassPath);
+	UClass* IntersectionClass = LoadClass<AProceduralIntersection>(nullptr, *IntersectionClassPath);
+	if (!TunnelClass || !IntersectionClass) {
+		UE_LOG(LogTemp, Error, TEXT("Could not load tunnel class %s or intersection class %s."), *TunnelClassPath, *IntersectionClassPath);
+		return 1;
+	}
+
+	TArray<FTunnelReferenceCase> Cases = FTunnelReferenceCases::Make();
+	if (!CaseList.IsEmpty()) {
+		TArray<FString> Selected;
+		CaseList.ParseIntoArray(Selected, TEXT(","));
+		Cases.RemoveAll([&Selected](const FTunnelReferenceCase& Case) { return !Selected.Contains(Case.Name); });
+		if (Cases.Num() == 0) {
+			UE_LOG(LogTemp, Error, TEXT("No reference case matches -cases=%s."), *CaseList);
+			return 1;
+		}
+	}
+
+	TMap<FString, FString> Golden = FTunnelReferenceCases::LoadGoldenFile(GoldenPath);
+	if (!bRecord && Golden.Num() == 0) {
+		UE_LOG(LogTemp, Error, TEXT("No golden hashes in %s, run once with -record to create them."), *GoldenPath);
+		return 1;
+	}
+
+	IConsoleVariable* CacheVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("tunnel.Cache.Enable"));
+	const bool bCacheWasEnabled = CacheVariable && CacheVariable->GetBool();
+	if (CacheVariable) {
+		CacheVariable->Set(bUseCache, ECVF_SetByCode);
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("TunnelBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	FTunnelGenerationStats& Stats = FTunnelGenerationStats::Get();
+	const bool bWasCollecting = Stats.IsCollecting();
+
+	UE_LOG(LogTemp, Display, TEXT("Tunnel benchmark: %d cases, %d iterations each (cache %d, %s %s)"),
+		Cases.Num(), Iterations, bUseCache, bRecord ? TEXT("recording") : TEXT("comparing with"), *GoldenPath);
+
+	TArray<FString> CsvLines;
+	FString Header = TEXT("case,iterations,generate_ms_min,generate_ms_avg");
+	for (int32 Phase = 0; Phase < (int32)ETunnelGenerationPhase::Count; Phase++) {
+		Header += FString::Printf(TEXT(",%s_ms"), FTunnelGenerationStats::GetPhaseName((ETunnelGenerationPhase)Phase));
+	}
+	Header += TEXT(",vertices,triangles,hash,result");
+	CsvLines.Add(Header);
+
+	int32 FailedCount = 0;
+	for (const FTunnelReferenceCase& Case : Cases) {
+		// The first run loads assets and warms up the allocators, it is hashed but not timed
+		FTunnelGeometryHash FirstHash;
+		bool bFailed = false;
+		bool bDeterministic = true;
+		double MinSeconds = TNumericLimits<double>::Max();
+		double TotalSeconds = 0.0;
+		for (int32 Iteration = 0; Iteration <= Iterations && !bFailed; Iteration++) {
+			const bool bTimed = Iteration > 0;
+			if (Iteration == 1) {
+				Stats.Reset();
+			}
+			Stats.SetCollecting(bTimed);
+
+			FTunnelNetworkActors Actors;
+			FString Error;
+			const double StartSeconds = FPlatformTime::Seconds();
+			const bool bGenerated = UTunnelNetworkLibrary::GenerateTunnelNetwork(World, Case.Network, TunnelClass, IntersectionClass, Actors, Error);
+			const double Seconds = FPlatformTime::Seconds() - StartSeconds;
+			if (!bGenerated) {
+				UE_LOG(LogTemp, Error, TEXT("%s: %s"), *Case.Name, *Error);
+				bFailed = true;
+			}
+			else {
+				CookCollision(Actors);
+				const FTunnelGeometryHash Hash = FTunnelReferenceCases::HashActors(Actors, Tolerance);
+				if (Iteration == 0) {
+					FirstHash = Hash;
+				}
+				else if (Hash != FirstHash) {
+					// Parallel generation has to make the same tunnel every time
+					UE_LOG(LogTemp, Error, TEXT("%s: iteration %d made %s, the first run made %s."), *Case.Name, Iteration, *Hash.ToString(), *FirstHash.ToString());
+					bDeterministic = false;
+				}
+			}
+			if (bTimed) {
+				MinSeconds = FMath::Min(MinSeconds, Seconds);
+				TotalSeconds += Seconds;
+			}
+			FTunnelReferenceCases::DestroyActors(Actors);
+		}
+		Stats.SetCollecting(false);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+		FString Result;
+		if (bFailed) {
+			Result = TEXT("failed");
+		}
+		else if (!bDeterministic) {
+			Result = TEXT("nondeterministic");
+		}
+		else if (bRecord) {
+			Golden.Add(Case.Name, FirstHash.ToString());
+			Result = TEXT("recorded");
+		}
+		else if (const FString* Expected = Golden.Find(Case.Name)) {
+			Result = *Expected == FirstHash.ToString() ? TEXT("ok") : TEXT("changed");
+			if (*Expected != FirstHash.ToString()) {
+				UE_LOG(LogTemp, Error, TEXT("%s: geometry changed, made %s but the golden file has %s."), *Case.Name, *FirstHash.ToString(), **Expected);
+			}
+		}
+		else {
+			UE_LOG(LogTemp, Error, TEXT("%s: not in the golden file, record it with -record -cases=%s."), *Case.Name, *Case.Name);
+			Result = TEXT("missing");
+		}
+		if (Result != TEXT("ok") && Result != TEXT("recorded")) {
+			FailedCount++;
+		}
+		if (bFailed) {
+			// Timings, counts and hash are left empty
+			CsvLines.Add(FString::Printf(TEXT("%s,%d,%sfailed"), *Case.Name, Iterations, *FString::ChrN(5 + (int32)ETunnelGenerationPhase::Count, TEXT(','))));
+			continue;
+		}
+
+		FString Row = FString::Printf(TEXT("%s,%d,%.3f,%.3f"), *Case.Name, Iterations, MinSeconds * 1000.0, TotalSeconds * 1000.0 / Iterations);
+		for (int32 Phase = 0; Phase < (int32)ETunnelGenerationPhase::Count; Phase++) {
+			Row += FString::Printf(TEXT(",%.3f"), Stats.GetPhase((ETunnelGenerationPhase)Phase).GetMilliseconds() / Iterations);
+		}
+		Row += FString::Printf(TEXT(",%lld,%lld,%016llx,%s"), FirstHash.Vertices, FirstHash.Triangles, FirstHash.Hash, *Result);
+		CsvLines.Add(Row);
+
+		UE_LOG(LogTemp, Display, TEXT("%s: %.3f ms per generation (min %.3f ms), %lld vertices, %lld triangles, %s\n%s"), *Case.Name,
+			TotalSeconds * 1000.0 / Iterations, MinSeconds * 1000.0, FirstHash.Vertices, FirstHash.Triangles, *Result, *Stats.ToString());
+	}
+
+	Stats.Reset();
+	Stats.SetCollecting(bWasCollecting);
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	if (CacheVariable) {
+		CacheVariable->Set(bCacheWasEnabled, ECVF_SetByCode);
+	}
+
+	if (FFileHelper::SaveStringArrayToFile(CsvLines, *CsvPath)) {
+		UE_LOG(LogTemp, Display, TEXT("Wrote %s"), *CsvPath);
+	}
+	else {
+		UE_LOG(LogTemp, Error, TEXT("Could not write %s"), *CsvPath);
+	}
+
+	if (bRecord) {
+		TArray<FString> GoldenLines;
+		GoldenLines.Add(TEXT("# Tunnel generation golden hashes: case, vertices, triangles, hash of positions, normals and triangles"));
+		GoldenLines.Add(FString::Printf(TEXT("# Recorded with -tolerance=%g by -run=TunnelBenchmark -record"), Tolerance));
+		for (const TPair<FString, FString>& Entry : Golden) {
+			GoldenLines.Add(FString::Printf(TEXT("%s %s"), *Entry.Key, *Entry.Value));
+		}
+		if (FFileHelper::SaveStringArrayToFile(GoldenLines, *GoldenPath)) {
+			UE_LOG(LogTemp, Display, TEXT("Wrote %s"), *GoldenPath);
+		}
+		else {
+			UE_LOG(LogTemp, Error, TEXT("Could not write %s"), *GoldenPath);
+			return 1;
+		}
+	}
+
+	if (FailedCount > 0) {
+		UE_LOG(LogTemp, Error, TEXT("%d of %d tunnel cases failed."), FailedCount, Cases.Num());
+		return 1;
+	}
+	return 0;
+}
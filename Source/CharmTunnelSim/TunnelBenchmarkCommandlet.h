@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TunnelBenchmarkCommandlet.generated.h"
+
+/**
+ * Generates a library of reference tunnels without the editor: a straight tunnel, tight curves, a slope and
+ * a tunnel ending in each intersection type. Reports the time of every generation phase (spline sampling,
+ * vertices, triangles, normals, mesh upload and collision cooking) and hashes the generated vertices.
+ * Hashes are compared against a golden file, so optimizations can not change the geometry without noticing.
+ * Returns 1 if a case fails to generate, its output differs from the golden file or between iterations.
+ *
+ * UnrealEditor-Cmd CharmTunnelSim.uproject -run=TunnelBenchmark -nullrhi
+ *     -iterations=5 [-cases=Straight,Slope] [-record] [-golden=Benchmarks/TunnelGolden.txt] [-tolerance=0.01]
+ *     [-tunnelclass=/Game/...] [-intersectionclass=/Game/...] [-cache] [-csv=Saved/Benchmarks/TunnelGeneration.csv]
+ *
+ * -record writes the hashes of the cases that ran to the golden file instead of comparing them. Positions are
+ * rounded to -tolerance (cm) and normals to a thousandth before hashing, so rounding differences between
+ * compilers and platforms do not count as changed geometry.
+ * The geometry cache is turned off unless -cache is given, otherwise only the first iteration would generate.
+ * The cases and golden file are shared with the CharmTunnelSim.Generation.Golden automation test, see FTunnelReferenceCases.
+ */
+UCLASS()
+class CHARMTUNNELSIM_API UTunnelBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTunnelBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,215 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelDeformationField.h"
+#include "Engine/Texture2D.h"
+#include "TextureResource.h"
+#include "UObject/ObjectKey.h"
+#include "Misc/ScopeLock.h"
+#include "Hash/CityHash.h"
+
+namespace
+{
+	FCriticalSection DeformationFieldCacheLock;
+	TMap<FObjectKey, TSharedPtr<const FTunnelDeformationField>> TextureFields;
+	TMap<FIntPoint, TSharedPtr<const FTunnelDeformationField>> ProceduralFields;
+	TMap<FIntPoint, TSharedPtr<const FTunnelDeformationField>> FlatFields;
+
+	// Reads the red channel of one texel in the supported uncompressed formats, returns false for anything else
+	bool DecodeTexels(const uint8* Data, int32 BytesPerPixel, bool bIsBGRA, int32 SizeX, int32 SizeY, TArray<float>& OutValues)
+	{
+		if (!Data) {
+			return false;
+		}
+		OutValues.SetNumUninitialized(SizeX * SizeY);
+		for (int32 Y = 0; Y < SizeY; Y++) {
+			const uint8* Row = Data + (SIZE_T)Y * SizeX * BytesPerPixel;
+			for (int32 X = 0; X < SizeX; X++) {
+				// BGRA stores red in the third byte, single channel formats in the first one
+				const uint8 Red = Row[X * BytesPerPixel + (bIsBGRA ? 2 : 0)];
+				OutValues[X * SizeY + Y] = (float)Red / 255.0f;
+			}
+		}
+		return true;
+	}
+}
+
+bool FTunnelDeformationField::InitFromTexture(UTexture2D* Texture)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelDeformationField::InitFromTexture);
+
+	Width = 0;
+	Height = 0;
+	Values.Reset();
+	if (!Texture) {
+		return false;
+	}
+
+#if WITH_EDITORONLY_DATA
+	// In the editor the source pixels are always available, no matter how the texture is compressed
+	if (Texture->Source.IsValid()) {
+		const ETextureSourceFormat Format = Texture->Source.GetFormat();
+		if (Format == TSF_BGRA8 || Format == TSF_G8) {
+			const int32 SizeX = Texture->Source.GetSizeX();
+			const int32 SizeY = Texture->Source.GetSizeY();
+			const uint8* Data = Texture->Source.LockMipReadOnly(0);
+			const bool bDecoded = DecodeTexels(Data, Format == TSF_BGRA8 ? 4 : 1, Format == TSF_BGRA8, SizeX, SizeY, Values);
+			Texture->Source.UnlockMip(0);
+			if (bDecoded) {
+				Width = SizeX;
+				Height = SizeY;
+				UpdateContentHash();
+				return true;
+			}
+		}
+	}
+#endif
+
+	// Cooked builds need an uncompressed texture that keeps its CPU copy
+	FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+	if (PlatformData && PlatformData->Mips.Num() > 0 && (PlatformData->PixelFormat == PF_B8G8R8A8 || PlatformData->PixelFormat == PF_G8)) {
+		FTexture2DMipMap& Mip = PlatformData->Mips[0];
+		const int32 SizeX = Mip.SizeX;
+		const int32 SizeY = Mip.SizeY;
+		const bool bIsBGRA = PlatformData->PixelFormat == PF_B8G8R8A8;
+		if (Mip.BulkData.GetBulkDataSize() >= (int64)SizeX * SizeY * (bIsBGRA ? 4 : 1)) {
+			const uint8* Data = static_cast<const uint8*>(Mip.BulkData.LockReadOnly());
+			const bool bDecoded = DecodeTexels(Data, bIsBGRA ? 4 : 1, bIsBGRA, SizeX, SizeY, Values);
+			Mip.BulkData.Unlock();
+			if (bDecoded) {
+				Width = SizeX;
+				Height = SizeY;
+				UpdateContentHash();
+				return true;
+			}
+		}
+	}
+
+	Values.Reset();
+	UE_LOG(LogTemp, Warning, TEXT("Deformation texture %s is not readable on the CPU, use BGRA8 or G8 without compression."), *Texture->GetName());
+	return false;
+}
+
+void FTunnelDeformationField::InitFromSampler(int32 InWidth, int32 InHeight, TFunctionRef<float(int32 X, int32 Y)> Sampler)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelDeformationField::InitFromSampler);
+
+	Width = FMath::Max(InWidth, 1);
+	Height = FMath::Max(InHeight, 1);
+	Values.SetNumUninitialized(Width * Height);
+	for (int32 X = 0; X < Width; X++) {
+		for (int32 Y = 0; Y < Height; Y++) {
+			Values[X * Height + Y] = Sampler(X, Y);
+		}
+	}
+	UpdateContentHash();
+}
+
+void FTunnelDeformationField::InitProcedural(int32 InWidth, int32 InHeight, int32 Seed, float Frequency)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelDeformationField::InitProcedural);
+
+	Width = FMath::Max(InWidth, 1);
+	Height = FMath::Max(InHeight, 1);
+	Values.SetNumUninitialized(Width * Height);
+
+	// Seed moves the sample window so different seeds give unrelated patterns
+	const FVector2D Offset((float)(Seed * 131), (float)(Seed * 71));
+	for (int32 X = 0; X < Width; X++) {
+		for (int32 Y = 0; Y < Height; Y++) {
+			// Two octaves, perlin noise is in range -1 - 1 and we want range 0 - 1 like the texture
+			const FVector2D Location = Offset + FVector2D((float)X, (float)Y) * Frequency;
+			const float Noise = FMath::PerlinNoise2D(Location) * 0.7f + FMath::PerlinNoise2D(Location * 2.0f) * 0.3f;
+			Values[X * Height + Y] = FMath::Clamp(Noise * 0.5f + 0.5f, 0.0f, 1.0f);
+		}
+	}
+	UpdateContentHash();
+}
+
+void FTunnelDeformationField::InitFlat(int32 InWidth, int32 InHeight, float Value)
+{
+	Width = FMath::Max(InWidth, 1);
+	Height = FMath::Max(InHeight, 1);
+	Values.Init(Value, Width * Height);
+	UpdateContentHash();
+}
+
+void FTunnelDeformationField::UpdateContentHash()
+{
+	ContentHash = CityHash64WithSeed(reinterpret_cast<const char*>(Values.GetData()), Values.Num() * sizeof(float), ((uint64)Width << 32) | (uint32)Height);
+}
+
+void FTunnelDeformationField::SampleColumn(int32 X, int32 FirstY, int32 Count, float* Out) const
+{
+	X = FMath::Clamp(X, 0, Width - 1);
+	const float* Column = &Values[X * Height];
+
+	// Whole range inside the field is one copy, otherwise clamp per value
+	if (FirstY >= 0 && FirstY + Count <= Height) {
+		FMemory::Memcpy(Out, Column + FirstY, Count * sizeof(float));
+		return;
+	}
+	for (int32 Index = 0; Index < Count; Index++) {
+		Out[Index] = Column[FMath::Clamp(FirstY + Index, 0, Height - 1)];
+	}
+}
+
+TSharedPtr<const FTunnelDeformationField> FTunnelDeformationField::FindOrDecode(UTexture2D* Texture)
+{
+	if (!Texture) {
+		return nullptr;
+	}
+
+	FScopeLock Lock(&DeformationFieldCacheLock);
+	const FObjectKey Key(Texture);
+	if (const TSharedPtr<const FTunnelDeformationField>* Found = TextureFields.Find(Key)) {
+		return *Found;
+	}
+
+	// Failed decodes are cached too so the warning is logged only once per texture
+	TSharedPtr<FTunnelDeformationField> Field = MakeShared<FTunnelDeformationField>();
+	if (!Field->InitFromTexture(Texture)) {
+		Field.Reset();
+	}
+	TextureFields.Add(Key, Field);
+	return Field;
+}
+
+TSharedPtr<const FTunnelDeformationField> FTunnelDeformationField::FindOrCreateProcedural(int32 InWidth, int32 InHeight)
+{
+	FScopeLock Lock(&DeformationFieldCacheLock);
+	const FIntPoint Key(InWidth, InHeight);
+	if (const TSharedPtr<const FTunnelDeformationField>* Found = ProceduralFields.Find(Key)) {
+		return *Found;
+	}
+
+	TSharedPtr<FTunnelDeformationField> Field = MakeShared<FTunnelDeformationField>();
+	Field->InitProcedural(InWidth, InHeight);
+	ProceduralFields.Add(Key, Field);
+	return Field;
+}
+
+TSharedPtr<const FTunnelDeformationField> FTunnelDeformationField::FindOrCreateFlat(int32 InWidth, int32 InHeight)
+{
+	FScopeLock Lock(&DeformationFieldCacheLock);
+	const FIntPoint Key(InWidth, InHeight);
+	if (const TSharedPtr<const FTunnelDeformationField>* Found = FlatFields.Find(Key)) {
+		return *Found;
+	}
+
+	TSharedPtr<FTunnelDeformationField> Field = MakeShared<FTunnelDeformationField>();
+	Field->InitFlat(InWidth, InHeight);
+	FlatFields.Add(Key, Field);
+	return Field;
+}
+
+void FTunnelDeformationField::Evict(UTexture2D* Texture)
+{
+	if (!Texture) {
+		return;
+	}
+
+	// Actors still holding the old field keep it alive until they update theirs
+	FScopeLock Lock(&DeformationFieldCacheLock);
+	TextureFields.Remove(FObjectKey(Texture));
+}
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UTexture2D;
+
+// Surface deformation values in range 0-1 used by tunnels and intersections to push vertices in or out.
+// The field is decoded once (from a noise texture, a baked sampler, procedural noise or a flat value) and then sampled
+// with inlined lookups, so mesh generation no longer calls into Blueprint for every vertex.
+// Texels are stored column major because generation reads one column (one loop around the tunnel) at a time.
+class CHARMTUNNELSIM_API FTunnelDeformationField
+{
+public:
+	// Decodes the first mip of the texture, red channel is used. Returns false if the pixels are not readable on the CPU
+	bool InitFromTexture(UTexture2D* Texture);
+
+	// Bakes any per texel sampler, used to run a Blueprint GetPixelValue override once instead of once per vertex
+	void InitFromSampler(int32 InWidth, int32 InHeight, TFunctionRef<float(int32 X, int32 Y)> Sampler);
+
+	// Fills the field with perlin noise, used when an actor opts in to procedural deformation
+	void InitProcedural(int32 InWidth, int32 InHeight, int32 Seed = 0, float Frequency = 0.05f);
+
+	// Fills the field with one value, 0 is what an unimplemented GetPixelValue returned
+	void InitFlat(int32 InWidth, int32 InHeight, float Value = 0.0f);
+
+	// Shared fields decoded once per texture / size and reused by every actor
+	static TSharedPtr<const FTunnelDeformationField> FindOrDecode(UTexture2D* Texture);
+	static TSharedPtr<const FTunnelDeformationField> FindOrCreateProcedural(int32 InWidth, int32 InHeight);
+	static TSharedPtr<const FTunnelDeformationField> FindOrCreateFlat(int32 InWidth, int32 InHeight);
+
+	// Drops the shared field of the texture so the next FindOrDecode reads the pixels again, e.g. after the texture was edited
+	static void Evict(UTexture2D* Texture);
+
+	bool IsValid() const { return Values.Num() > 0; }
+	int32 GetWidth() const { return Width; }
+	int32 GetHeight() const { return Height; }
+	// Hash of the values, generated geometry is cached by what the field holds instead of where it came from
+	uint64 GetContentHash() const { return ContentHash; }
+
+	// Value of one texel, coordinates outside the field are clamped to the border like the texture lookup
+	FORCEINLINE float Sample(int32 X, int32 Y) const
+	{
+		X = FMath::Clamp(X, 0, Width - 1);
+		Y = FMath::Clamp(Y, 0, Height - 1);
+		return Values[X * Height + Y];
+	}
+
+	// Bilinear value between texel centers at integer coordinates
+	FORCEINLINE float SampleBilinear(float X, float Y) const
+	{
+		X = FMath::Clamp(X, 0.0f, (float)(Width - 1));
+		Y = FMath::Clamp(Y, 0.0f, (float)(Height - 1));
+		const int32 X0 = (int32)X;
+		const int32 Y0 = (int32)Y;
+		const int32 X1 = FMath::Min(X0 + 1, Width - 1);
+		const int32 Y1 = FMath::Min(Y0 + 1, Height - 1);
+		const float FracX = X - (float)X0;
+		const float FracY = Y - (float)Y0;
+		const float* Column0 = &Values[X0 * Height];
+		const float* Column1 = &Values[X1 * Height];
+		const float Top = FMath::Lerp(Column0[Y0], Column1[Y0], FracX);
+		const float Bottom = FMath::Lerp(Column0[Y1], Column1[Y1], FracX);
+		return FMath::Lerp(Top, Bottom, FracY);
+	}
+
+	// Copies Count values of column X starting at FirstY into Out, this is what generation loops use per loop around the tunnel
+	void SampleColumn(int32 X, int32 FirstY, int32 Count, float* Out) const;
+
+private:
+	int32 Width = 0;
+	int32 Height = 0;
+	TArray<float> Values;
+	uint64 ContentHash = 0;
+
+	void UpdateContentHash();
+};
@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelEndpointSubsystem.h"
+#include "ProceduralTunnel.h"
+#include "Components/SplineComponent.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarTunnelEndpointsCellSize(
+	TEXT("tunnel.Endpoints.CellSize"), 1000.0f,
+	TEXT("Size of the endpoint grid cells (cm), should be at least the snapping distance. Applied to tunnels updated afterwards."));
+
+static FAutoConsoleCommandWithWorld CmdTunnelEndpointsStats(
+	TEXT("tunnel.Endpoints.Stats"),
+	TEXT("Prints the number of tunnels in the endpoint grid."),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		if (const UTunnelEndpointSubsystem* Endpoints = World ? World->GetSubsystem<UTunnelEndpointSubsystem>() : nullptr) {
+			UE_LOG(LogTemp, Log, TEXT("Tunnel endpoints: %d tunnels"), Endpoints->GetNumTunnels());
+		}
+	}));
+
+void UTunnelEndpointSubsystem::UpdateTunnel(AProceduralTunnel* Tunnel)
+{
+	if (!IsValid(Tunnel) || !IsValid(Tunnel->SplineComponent)) {
+		return;
+	}
+
+	// Entries of every tunnel are rebuilt when the cell size changes
+	const float NewCellSize = FMath::Max(CVarTunnelEndpointsCellSize.GetValueOnGameThread(), 1.0f);
+	if (NewCellSize != CellSize) {
+		CellSize = NewCellSize;
+		Cells.Reset();
+		for (TPair<const AProceduralTunnel*, FTunnelEntry>& Pair : Tunnels) {
+			for (int32 End = 0; End < 2; End++) {
+				Pair.Value.Cells[End] = GetCell(Pair.Value.Ends[End].Location);
+				AddToCell(Pair.Value.Cells[End], Pair.Key);
+			}
+		}
+	}
+
+	const USplineComponent* Spline = Tunnel->SplineComponent;
+	const int32 LastIndex = Spline->GetNumberOfSplinePoints() - 1;
+	if (LastIndex < 0) {
+		RemoveTunnel(Tunnel);
+		return;
+	}
+
+	FTunnelEntry* Entry = Tunnels.Find(Tunnel);
+	const bool bIsNew = Entry == nullptr;
+	if (bIsNew) {
+		Entry = &Tunnels.Add(Tunnel);
+	}
+	for (int32 End = 0; End < 2; End++) {
+		const int32 PointIndex = End == 0 ? 0 : LastIndex;
+		FTunnelEndpoint& Endpoint = Entry->Ends[End];
+		Endpoint.Tunnel = Tunnel;
+		Endpoint.bIsStart = End == 0;
+		Endpoint.Location = Spline->GetLocationAtSplinePoint(PointIndex, ESplineCoordinateSpace::World);
+		Endpoint.Tangent = Spline->GetTangentAtSplinePoint(PointIndex, ESplineCoordinateSpace::World);
+
+		const FIntVector Cell = GetCell(Endpoint.Location);
+		if (bIsNew || Cell != Entry->Cells[End]) {
+			const FIntVector OldCell = Entry->Cells[End];
+			Entry->Cells[End] = Cell;
+			if (!bIsNew) {
+				RemoveFromCell(OldCell, Tunnel);
+			}
+			AddToCell(Cell, Tunnel);
+		}
+	}
+}
+
+void UTunnelEndpointSubsystem::RemoveTunnel(const AProceduralTunnel* Tunnel)
+{
+	FTunnelEntry Entry;
+	if (Tunnels.RemoveAndCopyValue(Tunnel, Entry)) {
+		RemoveFromCell(Entry.Cells[0], Tunnel);
+		RemoveFromCell(Entry.Cells[1], Tunnel);
+	}
+}
+
+void UTunnelEndpointSubsystem::FindEndpoints(const FVector& Location, float Radius, const AProceduralTunnel* IgnoredTunnel, TArray<FTunnelEndpoint>& OutEndpoints) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelEndpointSubsystem::FindEndpoints);
+
+	OutEndpoints.Reset();
+	const FIntVector MinCell = GetCell(Location - FVector(Radius));
+	const FIntVector MaxCell = GetCell(Location + FVector(Radius));
+	const float RadiusSquared = FMath::Square(Radius);
+
+	// A tunnel is listed once per cell, each of its ends is only reported from the cell it is in
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++) {
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++) {
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++) {
+				const FIntVector Cell(X, Y, Z);
+				const auto* CellTunnels = Cells.Find(Cell);
+				if (!CellTunnels) {
+					continue;
+				}
+				for (const AProceduralTunnel* Tunnel : *CellTunnels) {
+					if (Tunnel == IgnoredTunnel) {
+						continue;
+					}
+					const FTunnelEntry& Entry = Tunnels.FindChecked(Tunnel);
+					for (int32 End = 0; End < 2; End++) {
+						const FTunnelEndpoint& Endpoint = Entry.Ends[End];
+						if (Entry.Cells[End] == Cell && Endpoint.Tunnel.IsValid()
+							&& FVector::DistSquared(Endpoint.Location, Location) <= RadiusSquared) {
+							OutEndpoints.Add(Endpoint);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void UTunnelEndpointSubsystem::Deinitialize()
+{
+	Tunnels.Empty();
+	Cells.Empty();
+	Super::Deinitialize();
+}
+
+FIntVector UTunnelEndpointSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt32(Location.X / CellSize),
+		FMath::FloorToInt32(Location.Y / CellSize),
+		FMath::FloorToInt32(Location.Z / CellSize));
+}
+
+void UTunnelEndpointSubsystem::AddToCell(const FIntVector& Cell, const AProceduralTunnel* Tunnel)
+{
+	Cells.FindOrAdd(Cell).AddUnique(Tunnel);
+}
+
+void UTunnelEndpointSubsystem::RemoveFromCell(const FIntVector& Cell, const AProceduralTunnel* Tunnel)
+{
+	const FTunnelEntry* Entry = Tunnels.Find(Tunnel);
+	// The other end of the tunnel can still be in this cell
+	if (Entry && (Entry->Cells[0] == Cell || Entry->Cells[1] == Cell)) {
+		return;
+	}
+	if (auto* CellTunnels = Cells.Find(Cell)) {
+		CellTunnels->RemoveSingleSwap(Tunnel);
+		if (CellTunnels->Num() == 0) {
+			Cells.Remove(Cell);
+		}
+	}
+}
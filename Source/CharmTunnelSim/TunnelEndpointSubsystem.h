@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TunnelEndpointSubsystem.generated.h"
+
+class AProceduralTunnel;
+
+// Start or end of a tunnel spline in world space
+struct FTunnelEndpoint
+{
+	TWeakObjectPtr<AProceduralTunnel> Tunnel;
+	FVector Location = FVector::ZeroVector;
+	FVector Tangent = FVector::ZeroVector;
+	bool bIsStart = false;
+};
+
+// Uniform grid of tunnel endpoints, so snapping looks at the few tunnels around a point instead of every
+// tunnel in the world. Tunnels update their entries when their spline or transform changes and remove
+// them when destroyed. Cell size is tunnel.Endpoints.CellSize, queries with a radius up to the cell size
+// touch at most eight cells.
+UCLASS()
+class CHARMTUNNELSIM_API UTunnelEndpointSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Reads both ends of the tunnel spline again and moves them to their new cells
+	void UpdateTunnel(AProceduralTunnel* Tunnel);
+	void RemoveTunnel(const AProceduralTunnel* Tunnel);
+
+	// Endpoints of other tunnels within Radius of Location, ignoring the ends of IgnoredTunnel
+	void FindEndpoints(const FVector& Location, float Radius, const AProceduralTunnel* IgnoredTunnel, TArray<FTunnelEndpoint>& OutEndpoints) const;
+
+	int32 GetNumTunnels() const { return Tunnels.Num(); }
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FTunnelEntry
+	{
+		FTunnelEndpoint Ends[2];
+		FIntVector Cells[2];
+	};
+
+	FIntVector GetCell(const FVector& Location) const;
+	void AddToCell(const FIntVector& Cell, const AProceduralTunnel* Tunnel);
+	void RemoveFromCell(const FIntVector& Cell, const AProceduralTunnel* Tunnel);
+
+	TMap<const AProceduralTunnel*, FTunnelEntry> Tunnels;
+	TMap<FIntVector, TArray<const AProceduralTunnel*, TInlineAllocator<4>>> Cells;
+	float CellSize = 1000.0f;
+};
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelGenerationStats.h"
+#include "HAL/IConsoleManager.h"
+
+static FAutoConsoleCommand CmdTunnelGenerationStats(
+	TEXT("tunnel.Generation.Stats"),
+	TEXT("Prints the time spent in each tunnel generation phase. Pass 1 to reset and start collecting, 0 to stop."),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		FTunnelGenerationStats& Stats = FTunnelGenerationStats::Get();
+		if (Args.Num() > 0) {
+			const bool bCollect = Args[0] == TEXT("1");
+			if (bCollect) {
+				Stats.Reset();
+			}
+			Stats.SetCollecting(bCollect);
+			UE_LOG(LogTemp, Log, TEXT("Tunnel generation stats %s."), bCollect ? TEXT("collecting") : TEXT("stopped"));
+			return;
+		}
+		UE_LOG(LogTemp, Log, TEXT("Tunnel generation phases%s:\n%s"), Stats.IsCollecting() ? TEXT("") : TEXT(" (not collecting, start with tunnel.Generation.Stats 1)"), *Stats.ToString());
+	}));
+
+FTunnelGenerationStats& FTunnelGenerationStats::Get()
+{
+	static FTunnelGenerationStats Stats;
+	return Stats;
+}
+
+const TCHAR* FTunnelGenerationStats::GetPhaseName(ETunnelGenerationPhase Phase)
+{
+	switch (Phase) {
+	case ETunnelGenerationPhase::SplineSampling: return TEXT("SplineSampling");
+	case ETunnelGenerationPhase::VertexGeneration: return TEXT("VertexGeneration");
+	case ETunnelGenerationPhase::Triangles: return TEXT("Triangles");
+	case ETunnelGenerationPhase::Normals: return TEXT("Normals");
+	case ETunnelGenerationPhase::MeshUpload: return TEXT("MeshUpload");
+	case ETunnelGenerationPhase::CollisionCooking: return TEXT("CollisionCooking");
+	default: return TEXT("Unknown");
+	}
+}
+
+void FTunnelGenerationStats::Add(ETunnelGenerationPhase Phase, uint64 Cycles)
+{
+	PhaseCycles[(int32)Phase].Add((int64)Cycles);
+	PhaseCalls[(int32)Phase].Increment();
+}
+
+FTunnelGenerationStats::FPhase FTunnelGenerationStats::GetPhase(ETunnelGenerationPhase Phase) const
+{
+	FPhase Result;
+	Result.Cycles = PhaseCycles[(int32)Phase].GetValue();
+	Result.Calls = PhaseCalls[(int32)Phase].GetValue();
+	return Result;
+}
+
+void FTunnelGenerationStats::Reset()
+{
+	for (int32 Phase = 0; Phase < (int32)ETunnelGenerationPhase::Count; Phase++) {
+		PhaseCycles[Phase].Reset();
+		PhaseCalls[Phase].Reset();
+	}
+}
+
+FString FTunnelGenerationStats::ToString() const
+{
+	FString Result;
+	for (int32 Phase = 0; Phase < (int32)ETunnelGenerationPhase::Count; Phase++) {
+		const FPhase Stats = GetPhase((ETunnelGenerationPhase)Phase);
+		Result += FString::Printf(TEXT("  %-18s %10.3f ms in %6lld calls, %.4f ms per call\n"), GetPhaseName((ETunnelGenerationPhase)Phase),
+			Stats.GetMilliseconds(), Stats.Calls, Stats.Calls > 0 ? Stats.GetMilliseconds() / (double)Stats.Calls : 0.0);
+	}
+	return Result;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Templates/Atomic.h"
+
+// Phases of making tunnel and intersection meshes
+enum class ETunnelGenerationPhase : uint8
+{
+	SplineSampling,
+	VertexGeneration,
+	// Triangle indices and UVs
+	Triangles,
+	// Normals and tangents
+	Normals,
+	MeshUpload,
+	CollisionCooking,
+	Count
+};
+
+// Time spent in each generation phase. Every phase is a trace scope named TunnelGeneration::<Phase> that shows up
+// in Unreal Insights, while collecting the time is also summed here. Sections are generated in parallel, so phases
+// are summed over all threads and can add up to more than the time the generation took.
+class CHARMTUNNELSIM_API FTunnelGenerationStats
+{
+public:
+	struct FPhase
+	{
+		int64 Cycles = 0;
+		int64 Calls = 0;
+
+		double GetMilliseconds() const { return FPlatformTime::ToMilliseconds64(Cycles); }
+	};
+
+	static FTunnelGenerationStats& Get();
+	static const TCHAR* GetPhaseName(ETunnelGenerationPhase Phase);
+
+	// Off by default, scopes only read the flag when not collecting
+	bool IsCollecting() const { return bCollecting.Load(EMemoryOrder::Relaxed); }
+	void SetCollecting(bool bInCollecting) { bCollecting.Store(bInCollecting, EMemoryOrder::Relaxed); }
+
+	void Add(ETunnelGenerationPhase Phase, uint64 Cycles);
+	FPhase GetPhase(ETunnelGenerationPhase Phase) const;
+	void Reset();
+
+	// One line per phase with total and average time
+	FString ToString() const;
+
+private:
+	FTunnelGenerationStats() = default;
+
+	TAtomic<bool> bCollecting { false };
+	FThreadSafeCounter64 PhaseCycles[(int32)ETunnelGenerationPhase::Count];
+	FThreadSafeCounter64 PhaseCalls[(int32)ETunnelGenerationPhase::Count];
+};
+
+class FTunnelGenerationPhaseScope
+{
+public:
+	explicit FTunnelGenerationPhaseScope(ETunnelGenerationPhase InPhase)
+		: Phase(InPhase)
+		, StartCycles(FTunnelGenerationStats::Get().IsCollecting() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FTunnelGenerationPhaseScope()
+	{
+		if (StartCycles != 0) {
+			FTunnelGenerationStats::Get().Add(Phase, FPlatformTime::Cycles64() - StartCycles);
+		}
+	}
+
+private:
+	ETunnelGenerationPhase Phase;
+	uint64 StartCycles;
+};
+
+#define TUNNEL_GENERATION_PHASE_SCOPE(Phase) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(TunnelGeneration::Phase); \
+	FTunnelGenerationPhaseScope PREPROCESSOR_JOIN(TunnelGenerationPhaseScope, __LINE__)(ETunnelGenerationPhase::Phase)
@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelGeometryCache.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+
+static TAutoConsoleVariable<bool> CVarTunnelCacheEnable(
+	TEXT("tunnel.Cache.Enable"), true,
+	TEXT("Reuse generated tunnel sections whose inputs hash to a section made before."));
+
+static TAutoConsoleVariable<int32> CVarTunnelCacheMemoryMB(
+	TEXT("tunnel.Cache.MemoryMB"), 256,
+	TEXT("Memory kept for recently used tunnel sections (MB), least recently used sections are dropped first."));
+
+static TAutoConsoleVariable<bool> CVarTunnelCacheDisk(
+	TEXT("tunnel.Cache.Disk"), true,
+	TEXT("Also store generated tunnel sections in Saved/TunnelGeometryCache and look them up there."));
+
+static FAutoConsoleCommand CmdTunnelCacheStats(
+	TEXT("tunnel.Cache.Stats"),
+	TEXT("Prints hit rate and bytes saved of the tunnel geometry cache."),
+	FConsoleCommandDelegate::CreateStatic([]()
+	{
+		const FTunnelGeometryCache::FStats Stats = FTunnelGeometryCache::Get().GetStats();
+		UE_LOG(LogTemp, Log, TEXT("Tunnel geometry cache: %lld lookups, %lld memory hits, %lld disk hits (%.1f%%), %.2f MB saved, %d sections / %.2f MB in memory"),
+			Stats.Lookups, Stats.MemoryHits, Stats.DiskHits, Stats.GetHitRate() * 100.0, Stats.BytesSaved / (1024.0 * 1024.0),
+			Stats.SectionsInMemory, Stats.BytesInMemory / (1024.0 * 1024.0));
+	}));
+
+static FAutoConsoleCommand CmdTunnelCacheClear(
+	TEXT("tunnel.Cache.Clear"),
+	TEXT("Drops cached tunnel sections and resets the counters. Pass 1 to delete the disk cache as well."),
+	FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+	{
+		FTunnelGeometryCache::Get().Clear(Args.Num() > 0 && Args[0] == TEXT("1"));
+		FTunnelGeometryCache::Get().ResetStats();
+	}));
+
+namespace
+{
+	constexpr uint32 CacheFileMagic = 0x43535443; // "CTSC"
+	// 2: deform curves are evaluated from baked tables
+	constexpr uint32 CacheFileVersion = 2;
+	// Upper bound of sections in memory, the byte budget is what normally limits the cache
+	constexpr int32 MaxSectionsInMemory = 1 << 20;
+
+	// Geometry arrays only hold plain values and are written as they are in memory
+	template<typename T>
+	void SerializeRaw(FArchive& Ar, TArray<T>& Values)
+	{
+		int32 Num = Values.Num();
+		Ar << Num;
+		if (Ar.IsLoading()) {
+			if (Num < 0 || (int64)Num * sizeof(T) > Ar.TotalSize() - Ar.Tell()) {
+				Ar.SetError();
+				return;
+			}
+			Values.SetNumUninitialized(Num);
+		}
+		Ar.Serialize(Values.GetData(), (int64)Num * sizeof(T));
+	}
+
+	void SerializeSectionData(FArchive& Ar, FTunnelMeshSectionData& Data)
+	{
+		SerializeRaw(Ar, Data.Vertices);
+		SerializeRaw(Ar, Data.Triangles);
+		SerializeRaw(Ar, Data.Normals);
+		SerializeRaw(Ar, Data.UV);
+		SerializeRaw(Ar, Data.Tangents);
+		Ar << Data.bEnableCollision;
+	}
+
+	void SerializeEnd(FArchive& Ar, FMeshSectionEnd& End)
+	{
+		SerializeRaw(Ar, End.GroundVertives);
+		SerializeRaw(Ar, End.WallVertices);
+		SerializeRaw(Ar, End.GroundUV);
+		SerializeRaw(Ar, End.WallUV);
+	}
+
+	int64 GetSectionDataSize(const FTunnelMeshSectionData& Data)
+	{
+		return Data.Vertices.GetAllocatedSize() + Data.Triangles.GetAllocatedSize() + Data.Normals.GetAllocatedSize()
+			+ Data.UV.GetAllocatedSize() + Data.Tangents.GetAllocatedSize();
+	}
+
+	int64 GetEndSize(const FMeshSectionEnd& End)
+	{
+		return End.GroundVertives.GetAllocatedSize() + End.WallVertices.GetAllocatedSize() + End.GroundUV.GetAllocatedSize() + End.WallUV.GetAllocatedSize();
+	}
+}
+
+FTunnelSectionKeyBuilder::FTunnelSectionKeyBuilder(const FTunnelSectionCacheKey& Seed)
+	: Key(Seed)
+{
+	if (Key.Low == 0 && Key.High == 0) {
+		Key.Low = 0x9E3779B97F4A7C15ull;
+		Key.High = 0xC2B2AE3D27D4EB4Full;
+	}
+}
+
+void FTunnelSectionKeyBuilder::Update(const void* Data, int64 Size)
+{
+	const char* Bytes = static_cast<const char*>(Data);
+	// CityHash takes 32 bit sizes
+	do {
+		const uint32 ChunkSize = (uint32)FMath::Min<int64>(Size, MAX_uint32);
+		Key.Low = CityHash64WithSeed(Bytes, ChunkSize, Key.Low);
+		Key.High = CityHash64WithSeeds(Bytes, ChunkSize, Key.High, Key.Low);
+		Bytes += ChunkSize;
+		Size -= ChunkSize;
+	} while (Size > 0);
+}
+
+int64 FTunnelCachedSection::GetAllocatedSize() const
+{
+	return sizeof(FTunnelCachedSection) + GetSectionDataSize(Ground) + GetSectionDataSize(Wall) + GetEndSize(End) + GetEndSize(TunnelStart);
+}
+
+void FTunnelCachedSection::Serialize(FArchive& Ar)
+{
+	SerializeSectionData(Ar, Ground);
+	SerializeSectionData(Ar, Wall);
+	SerializeEnd(Ar, End);
+	Ar << bHasTunnelStart;
+	if (bHasTunnelStart) {
+		SerializeEnd(Ar, TunnelStart);
+	}
+}
+
+FTunnelGeometryCache& FTunnelGeometryCache::Get()
+{
+	static FTunnelGeometryCache Cache;
+	return Cache;
+}
+
+bool FTunnelGeometryCache::IsEnabled()
+{
+	return CVarTunnelCacheEnable.GetValueOnAnyThread();
+}
+
+FTunnelGeometryCache::FTunnelGeometryCache()
+	: Sections(MaxSectionsInMemory)
+	, Directory(FPaths::ProjectSavedDir() / TEXT("TunnelGeometryCache"))
+{
+}
+
+TSharedPtr<const FTunnelCachedSection> FTunnelGeometryCache::Find(const FTunnelSectionCacheKey& Key)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelGeometryCache::Find);
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		Stats.Lookups++;
+		if (const FEntry* Entry = Sections.FindAndTouch(Key)) {
+			Stats.MemoryHits++;
+			Stats.BytesSaved += Entry->Size;
+			return Entry->Section;
+		}
+	}
+
+	if (!CVarTunnelCacheDisk.GetValueOnAnyThread()) {
+		return nullptr;
+	}
+	TSharedPtr<const FTunnelCachedSection> Section = ReadFromDisk(Key);
+	if (Section.IsValid()) {
+		const int64 Size = Section->GetAllocatedSize();
+		FScopeLock ScopeLock(&Lock);
+		Stats.DiskHits++;
+		Stats.BytesSaved += Size;
+		AddToMemory(Key, Section.ToSharedRef(), Size);
+	}
+	return Section;
+}
+
+void FTunnelGeometryCache::Add(const FTunnelSectionCacheKey& Key, TSharedRef<const FTunnelCachedSection> Section)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelGeometryCache::Add);
+
+	{
+		FScopeLock ScopeLock(&Lock);
+		AddToMemory(Key, Section, Section->GetAllocatedSize());
+	}
+	if (CVarTunnelCacheDisk.GetValueOnAnyThread()) {
+		WriteToDisk(Key, *Section);
+	}
+}
+
+void FTunnelGeometryCache::AddToMemory(const FTunnelSectionCacheKey& Key, const TSharedRef<const FTunnelCachedSection>& Section, int64 Size)
+{
+	if (const FEntry* Existing = Sections.Find(Key)) {
+		Stats.BytesInMemory -= Existing->Size;
+		Sections.Remove(Key);
+	}
+	const int64 Budget = (int64)FMath::Max(CVarTunnelCacheMemoryMB.GetValueOnAnyThread(), 0) * 1024 * 1024;
+	if (Size > Budget) {
+		return;
+	}
+	while (Sections.Num() > 0 && (Stats.BytesInMemory + Size > Budget || Sections.Num() >= Sections.Max())) {
+		Stats.BytesInMemory -= Sections.RemoveLeastRecent().Size;
+	}
+	Sections.Add(Key, FEntry{ Section, Size });
+	Stats.BytesInMemory += Size;
+}
+
+FString FTunnelGeometryCache::GetFilePath(const FTunnelSectionCacheKey& Key) const
+{
+	// Sections are spread over 256 folders so no directory gets too large
+	const FString Name = Key.ToString();
+	return Directory / Name.Left(2) / Name + TEXT(".bin");
+}
+
+TSharedPtr<const FTunnelCachedSection> FTunnelGeometryCache::ReadFromDisk(const FTunnelSectionCacheKey& Key) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelGeometryCache::ReadFromDisk);
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*GetFilePath(Key), FILEREAD_Silent));
+	if (!Reader) {
+		return nullptr;
+	}
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	FTunnelSectionCacheKey FileKey;
+	*Reader << FileMagic << FileVersion << FileKey.Low << FileKey.High;
+	if (FileMagic != CacheFileMagic || FileVersion != CacheFileVersion || FileKey != Key) {
+		return nullptr;
+	}
+	TSharedRef<FTunnelCachedSection> Section = MakeShared<FTunnelCachedSection>();
+	Section->Serialize(*Reader);
+	if (Reader->IsError() || !Reader->Close()) {
+		UE_LOG(LogTemp, Warning, TEXT("Tunnel geometry cache file of %s is damaged and is ignored."), *Key.ToString());
+		return nullptr;
+	}
+	return Section;
+}
+
+void FTunnelGeometryCache::WriteToDisk(const FTunnelSectionCacheKey& Key, const FTunnelCachedSection& Section) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelGeometryCache::WriteToDisk);
+
+	const FString FilePath = GetFilePath(Key);
+	if (IFileManager::Get().FileExists(*FilePath)) {
+		return;
+	}
+	// Written under a unique name and moved in place, readers never see a partly written file
+	const FString TempPath = FPaths::CreateTempFilename(*FPaths::GetPath(FilePath), TEXT("Section"), TEXT(".tmp"));
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath, FILEWRITE_Silent));
+	if (!Writer) {
+		return;
+	}
+	uint32 FileMagic = CacheFileMagic;
+	uint32 FileVersion = CacheFileVersion;
+	FTunnelSectionCacheKey FileKey = Key;
+	*Writer << FileMagic << FileVersion << FileKey.Low << FileKey.High;
+	// Saving only reads the section
+	const_cast<FTunnelCachedSection&>(Section).Serialize(*Writer);
+	const bool bWritten = !Writer->IsError() && Writer->Close();
+	Writer.Reset();
+	if (!bWritten || !IFileManager::Get().Move(*FilePath, *TempPath, true, true, false, true)) {
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+	}
+}
+
+void FTunnelGeometryCache::Clear(bool bDisk)
+{
+	{
+		FScopeLock ScopeLock(&Lock);
+		Sections.Empty(MaxSectionsInMemory);
+		Stats.BytesInMemory = 0;
+	}
+	if (bDisk) {
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	}
+}
+
+FTunnelGeometryCache::FStats FTunnelGeometryCache::GetStats() const
+{
+	FScopeLock ScopeLock(&Lock);
+	FStats Result = Stats;
+	Result.SectionsInMemory = Sections.Num();
+	return Result;
+}
+
+void FTunnelGeometryCache::ResetStats()
+{
+	FScopeLock ScopeLock(&Lock);
+	Stats.Lookups = 0;
+	Stats.MemoryHits = 0;
+	Stats.DiskHits = 0;
+	Stats.BytesSaved = 0;
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+#include "EnumContainer.h"
+#include "TunnelMeshBuilder.h"
+
+// 128 bit content hash of everything a generated tunnel section is made from
+struct FTunnelSectionCacheKey
+{
+	uint64 Low = 0;
+	uint64 High = 0;
+
+	bool operator==(const FTunnelSectionCacheKey& Other) const { return Low == Other.Low && High == Other.High; }
+	bool operator!=(const FTunnelSectionCacheKey& Other) const { return !(*this == Other); }
+	friend uint32 GetTypeHash(const FTunnelSectionCacheKey& Key) { return (uint32)Key.Low; }
+
+	FString ToString() const { return FString::Printf(TEXT("%016llx%016llx"), High, Low); }
+};
+
+// Builds a section key from raw values. Two lanes of CityHash with different seeds are chained over the inputs
+struct CHARMTUNNELSIM_API FTunnelSectionKeyBuilder
+{
+	explicit FTunnelSectionKeyBuilder(const FTunnelSectionCacheKey& Seed = FTunnelSectionCacheKey());
+
+	void Update(const void* Data, int64 Size);
+
+	template<typename T>
+	void Add(const T& Value)
+	{
+		static_assert(TIsTriviallyDestructible<T>::Value, "Only plain values are hashed by their bytes");
+		Update(&Value, sizeof(T));
+	}
+
+	template<typename T>
+	void AddArray(const TArray<T>& Values)
+	{
+		Add(Values.Num());
+		Update(Values.GetData(), Values.Num() * (int64)sizeof(T));
+	}
+
+	void AddString(const FString& Value) { AddArray(Value.GetCharArray()); }
+
+	FTunnelSectionCacheKey Key;
+};
+
+// Generated geometry of one tunnel section together with the loops other sections connect to
+struct CHARMTUNNELSIM_API FTunnelCachedSection
+{
+	FTunnelMeshSectionData Ground;
+	FTunnelMeshSectionData Wall;
+	FMeshSectionEnd End;
+	// Only set for the section that starts the tunnel
+	bool bHasTunnelStart = false;
+	FMeshSectionEnd TunnelStart;
+
+	int64 GetAllocatedSize() const;
+	void Serialize(FArchive& Ar);
+};
+
+// Content addressed cache of generated tunnel sections. Sections are keyed by the hash of their inputs (spline frames,
+// profile, deformation field, curves and the loops they connect to), so reloading a layout or undoing an edit finds
+// the geometry made before instead of generating it again.
+//
+// Recently used sections are kept in memory up to tunnel.Cache.MemoryMB and every added section is also written to
+// Saved/TunnelGeometryCache, which survives restarts. Sections are immutable once added and shared, all functions
+// are safe to call from the worker threads that generate sections.
+class CHARMTUNNELSIM_API FTunnelGeometryCache
+{
+public:
+	struct FStats
+	{
+		int64 Lookups = 0;
+		int64 MemoryHits = 0;
+		int64 DiskHits = 0;
+		// Geometry served from the cache instead of being generated
+		int64 BytesSaved = 0;
+		int64 BytesInMemory = 0;
+		int32 SectionsInMemory = 0;
+
+		double GetHitRate() const { return Lookups > 0 ? (double)(MemoryHits + DiskHits) / (double)Lookups : 0.0; }
+	};
+
+	static FTunnelGeometryCache& Get();
+	static bool IsEnabled();
+
+	TSharedPtr<const FTunnelCachedSection> Find(const FTunnelSectionCacheKey& Key);
+	void Add(const FTunnelSectionCacheKey& Key, TSharedRef<const FTunnelCachedSection> Section);
+
+	// Drops the sections in memory and, if bDisk, the cache directory
+	void Clear(bool bDisk);
+	FStats GetStats() const;
+	void ResetStats();
+
+private:
+	struct FEntry
+	{
+		TSharedPtr<const FTunnelCachedSection> Section;
+		int64 Size = 0;
+	};
+
+	FTunnelGeometryCache();
+
+	void AddToMemory(const FTunnelSectionCacheKey& Key, const TSharedRef<const FTunnelCachedSection>& Section, int64 Size);
+	FString GetFilePath(const FTunnelSectionCacheKey& Key) const;
+	TSharedPtr<const FTunnelCachedSection> ReadFromDisk(const FTunnelSectionCacheKey& Key) const;
+	void WriteToDisk(const FTunnelSectionCacheKey& Key, const FTunnelCachedSection& Section) const;
+
+	mutable FCriticalSection Lock;
+	TLruCache<FTunnelSectionCacheKey, FEntry> Sections;
+	FString Directory;
+	FStats Stats;
+};
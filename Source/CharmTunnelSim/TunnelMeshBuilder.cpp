@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelMeshBuilder.h"
+#include "Async/ParallelFor.h"
+
+void FTunnelMeshBuilder::AppendTriangles(const FTunnelMeshGrid& Grid, TArray<int32>& Triangles)
+{
+	const int32 IndexCount = Grid.NumTriangleIndices();
+	if (IndexCount == 0) {
+		return;
+	}
+
+	const int32 FirstIndex = Triangles.Num();
+	Triangles.AddUninitialized(IndexCount);
+	int32* Indices = Triangles.GetData() + FirstIndex;
+	const int32 QuadsPerRow = Grid.Columns - 1;
+
+	ParallelFor(Grid.Rows - 1, [&Grid, Indices, QuadsPerRow](int32 Row)
+	{
+		int32* Out = Indices + Row * QuadsPerRow * 6;
+		const int32 RowStart = Grid.FirstVertex + Row * Grid.Columns;
+		for (int32 Column = 0; Column < QuadsPerRow; Column++) {
+			// A = this row, B = next column, D = next row, E = next row and column
+			const int32 A = RowStart + Column;
+			const int32 B = A + 1;
+			const int32 D = A + Grid.Columns;
+			const int32 E = D + 1;
+			Out[0] = A;
+			Out[1] = B;
+			Out[2] = D;
+			Out[3] = B;
+			Out[4] = E;
+			Out[5] = D;
+			Out += 6;
+		}
+	}, Grid.Rows < MinRowsForParallel);
+}
+
+void FTunnelMeshBuilder::ComputeNormalsAndTangents(const TArray<FVector>& Vertices, const FTunnelMeshGrid& Grid, TArray<FVector>& Normals, TArray<FProcMeshTangent>& Tangents)
+{
+	ComputeNormalsAndTangents(Vertices, Grid, 0, Grid.Rows - 1, Normals, Tangents);
+}
+
+void FTunnelMeshBuilder::ComputeNormalsAndTangents(const TArray<FVector>& Vertices, const FTunnelMeshGrid& Grid, int32 FirstRow, int32 LastRow, TArray<FVector>& Normals, TArray<FProcMeshTangent>& Tangents)
+{
+	FirstRow = FMath::Max(FirstRow, 0);
+	LastRow = FMath::Min(LastRow, Grid.Rows - 1);
+	if (LastRow < FirstRow) {
+		return;
+	}
+	if (Grid.Rows < 2 || Grid.Columns < 2) {
+		for (int32 Index = Grid.FirstVertex; Index < Grid.FirstVertex + Grid.Num(); Index++) {
+			Normals[Index] = FVector::UpVector;
+			Tangents[Index] = FProcMeshTangent(FVector::ForwardVector, false);
+		}
+		return;
+	}
+
+	const FVector* Points = Vertices.GetData() + Grid.FirstVertex;
+	const int32 QuadRows = Grid.Rows - 1;
+	const int32 QuadColumns = Grid.Columns - 1;
+	const bool bSingleThread = LastRow - FirstRow + 1 < MinRowsForParallel;
+
+	// Unnormalized quad normals of the quad rows touching the rows to build, the cross product length weights each face by its area.
+	// Uses the same face normal convention as the procedural mesh library: (P1 - P2) x (P0 - P2)
+	const int32 FirstQuad = FMath::Max(FirstRow - 1, 0);
+	const int32 LastQuad = FMath::Min(LastRow, QuadRows - 1);
+	TArray<FVector> QuadNormals;
+	QuadNormals.SetNumUninitialized(QuadRows * QuadColumns);
+	ParallelFor(LastQuad - FirstQuad + 1, [&](int32 QuadRow)
+	{
+		const int32 Row = FirstQuad + QuadRow;
+		for (int32 Column = 0; Column < QuadColumns; Column++) {
+			const FVector& A = Points[Row * Grid.Columns + Column];
+			const FVector& B = Points[Row * Grid.Columns + Column + 1];
+			const FVector& D = Points[(Row + 1) * Grid.Columns + Column];
+			const FVector& E = Points[(Row + 1) * Grid.Columns + Column + 1];
+			QuadNormals[Row * QuadColumns + Column] = FVector::CrossProduct(B - D, A - D) + FVector::CrossProduct(E - D, B - D);
+		}
+	}, bSingleThread);
+
+	// Every vertex gathers the up to four quads around it, no writes are shared between rows
+	ParallelFor(LastRow - FirstRow + 1, [&](int32 RowOffset)
+	{
+		const int32 Row = FirstRow + RowOffset;
+		const int32 FirstQuadRow = FMath::Max(Row - 1, 0);
+		const int32 LastQuadRow = FMath::Min(Row, QuadRows - 1);
+		for (int32 Column = 0; Column < Grid.Columns; Column++) {
+			const int32 FirstQuadColumn = FMath::Max(Column - 1, 0);
+			const int32 LastQuadColumn = FMath::Min(Column, QuadColumns - 1);
+
+			FVector Normal = FVector::ZeroVector;
+			for (int32 QuadRow = FirstQuadRow; QuadRow <= LastQuadRow; QuadRow++) {
+				for (int32 QuadColumn = FirstQuadColumn; QuadColumn <= LastQuadColumn; QuadColumn++) {
+					Normal += QuadNormals[QuadRow * QuadColumns + QuadColumn];
+				}
+			}
+			Normal = Normal.GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+
+			// Tangent follows the columns like the U coordinate, central difference where possible
+			const FVector& Next = Points[Row * Grid.Columns + FMath::Min(Column + 1, QuadColumns)];
+			const FVector& Previous = Points[Row * Grid.Columns + FMath::Max(Column - 1, 0)];
+			FVector Tangent = Next - Previous;
+			Tangent -= Normal * FVector::DotProduct(Tangent, Normal);
+			if (!Tangent.Normalize()) {
+				// Collapsed column, fall back to the forward direction of the grid
+				const FVector& Forward = Points[FMath::Min(Row + 1, QuadRows) * Grid.Columns + Column];
+				const FVector& Backward = Points[FMath::Max(Row - 1, 0) * Grid.Columns + Column];
+				Tangent = FVector::CrossProduct(Normal, Forward - Backward).GetSafeNormal(UE_SMALL_NUMBER, FVector::ForwardVector);
+			}
+
+			const int32 Index = Grid.FirstVertex + Row * Grid.Columns + Column;
+			Normals[Index] = Normal;
+			Tangents[Index] = FProcMeshTangent(Tangent, false);
+		}
+	}, bSingleThread);
+}
+
+void FTunnelMeshBuilder::ComputeUVs(const TArray<FVector>& Vertices, const FTunnelMeshGrid& Grid, float TileSize, TArray<FVector2D>& UVs, int32 FirstRow)
+{
+	FirstRow = FMath::Clamp(FirstRow, 0, Grid.Rows);
+	const float InverseTileSize = 1.0f / FMath::Max(TileSize, UE_KINDA_SMALL_NUMBER);
+	const FVector* Points = Vertices.GetData() + Grid.FirstVertex;
+	FVector2D* Out = UVs.GetData() + Grid.FirstVertex;
+	const bool bSingleThread = Grid.Rows - FirstRow < MinRowsForParallel;
+
+	// U runs around the tunnel, each row is independent
+	ParallelFor(Grid.Rows - FirstRow, [&](int32 RowOffset)
+	{
+		const int32 Row = FirstRow + RowOffset;
+		double U = 0.0;
+		Out[Row * Grid.Columns].X = 0.0;
+		for (int32 Column = 1; Column < Grid.Columns; Column++) {
+			const int32 Index = Row * Grid.Columns + Column;
+			U += FVector::Distance(Points[Index], Points[Index - 1]) * InverseTileSize;
+			Out[Index].X = U;
+		}
+	}, bSingleThread);
+
+	// V runs along the tunnel, each column is independent
+	ParallelFor(Grid.Columns, [&](int32 Column)
+	{
+		double V = FirstRow > 0 ? Out[(FirstRow - 1) * Grid.Columns + Column].Y : 0.0;
+		if (FirstRow == 0) {
+			Out[Column].Y = 0.0;
+		}
+		for (int32 Row = FMath::Max(FirstRow, 1); Row < Grid.Rows; Row++) {
+			const int32 Index = Row * Grid.Columns + Column;
+			V += FVector::Distance(Points[Index], Points[Index - Grid.Columns]) * InverseTileSize;
+			Out[Index].Y = V;
+		}
+	}, bSingleThread);
+}
+
+void FTunnelMeshBuilder::Build(const TArray<FVector>& Vertices, TArrayView<const FTunnelMeshGrid> Grids, TArray<int32>& Triangles, TArray<FVector>& Normals, TArray<FProcMeshTangent>& Tangents, TArray<FVector2D>& UVs, float UVTileSize)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelMeshBuilder::Build);
+
+	int32 IndexCount = 0;
+	for (const FTunnelMeshGrid& Grid : Grids) {
+		check(Grid.FirstVertex >= 0 && Grid.FirstVertex + Grid.Num() <= Vertices.Num());
+		IndexCount += Grid.NumTriangleIndices();
+	}
+
+	Triangles.Reset(IndexCount);
+	Normals.SetNumUninitialized(Vertices.Num());
+	Tangents.SetNumUninitialized(Vertices.Num());
+	const bool bBuildUVs = UVs.Num() != Vertices.Num();
+	if (bBuildUVs) {
+		UVs.SetNumUninitialized(Vertices.Num());
+	}
+
+	for (const FTunnelMeshGrid& Grid : Grids) {
+		AppendTriangles(Grid, Triangles);
+		ComputeNormalsAndTangents(Vertices, Grid, Normals, Tangents);
+		if (bBuildUVs) {
+			ComputeUVs(Vertices, Grid, UVTileSize, UVs);
+		}
+	}
+}
+
+void FTunnelMeshBuilder::BuildLod(const FTunnelMeshSectionData& Source, const FTunnelMeshGrid& Grid, int32 Step, FTunnelMeshSectionData& Out)
+{
+	Out.bEnableCollision = Source.bEnableCollision;
+	if (Step <= 1 || Grid.Rows < 2 || Grid.Columns < 2) {
+		Out = Source;
+		return;
+	}
+
+	// Kept rows and columns, the last one is always kept so the level covers the same surface
+	auto KeepEvery = [Step](int32 Count, TArray<int32>& Kept)
+	{
+		for (int32 Index = 0; Index < Count - 1; Index += Step) {
+			Kept.Add(Index);
+		}
+		Kept.Add(Count - 1);
+	};
+	TArray<int32> Rows;
+	KeepEvery(Grid.Rows, Rows);
+	TArray<int32> CoarseColumns;
+	KeepEvery(Grid.Columns, CoarseColumns);
+	TArray<int32> FullColumns;
+	for (int32 Column = 0; Column < Grid.Columns; Column++) {
+		FullColumns.Add(Column);
+	}
+
+	const bool bHasNormals = Source.Normals.Num() == Source.Vertices.Num();
+	const bool bHasTangents = Source.Tangents.Num() == Source.Vertices.Num();
+	const bool bHasUVs = Source.UV.Num() == Source.Vertices.Num();
+	Out.Vertices.Reset();
+	Out.Normals.Reset();
+	Out.Tangents.Reset();
+	Out.UV.Reset();
+	Out.Triangles.Reset();
+
+	TArray<int32, TInlineAllocator<64>> RowFirstVertex;
+	for (int32 RowIndex = 0; RowIndex < Rows.Num(); RowIndex++) {
+		const bool bSeamRow = RowIndex == 0 || RowIndex == Rows.Num() - 1;
+		RowFirstVertex.Add(Out.Vertices.Num());
+		for (int32 Column : bSeamRow ? FullColumns : CoarseColumns) {
+			const int32 Index = Grid.FirstVertex + Rows[RowIndex] * Grid.Columns + Column;
+			Out.Vertices.Add(Source.Vertices[Index]);
+			if (bHasNormals) {
+				Out.Normals.Add(Source.Normals[Index]);
+			}
+			if (bHasTangents) {
+				Out.Tangents.Add(Source.Tangents[Index]);
+			}
+			if (bHasUVs) {
+				Out.UV.Add(Source.UV[Index]);
+			}
+		}
+	}
+
+	for (int32 RowIndex = 0; RowIndex < Rows.Num() - 1; RowIndex++) {
+		const bool bTopSeam = RowIndex == 0;
+		const bool bBottomSeam = RowIndex + 1 == Rows.Num() - 1;
+		AppendStrip(RowFirstVertex[RowIndex], bTopSeam ? FullColumns : CoarseColumns,
+			RowFirstVertex[RowIndex + 1], bBottomSeam ? FullColumns : CoarseColumns, Out.Triangles);
+	}
+}
+
+void FTunnelMeshBuilder::AppendStrip(int32 TopFirstVertex, TArrayView<const int32> TopColumns, int32 BottomFirstVertex, TArrayView<const int32> BottomColumns, TArray<int32>& Triangles)
+{
+	// Zipper along both rows, always step the row whose next column comes first
+	int32 Top = 0;
+	int32 Bottom = 0;
+	const int32 LastTop = TopColumns.Num() - 1;
+	const int32 LastBottom = BottomColumns.Num() - 1;
+	Triangles.Reserve(Triangles.Num() + (LastTop + LastBottom) * 3);
+	while (Top < LastTop || Bottom < LastBottom) {
+		const bool bStepTop = Bottom == LastBottom || (Top < LastTop && TopColumns[Top + 1] <= BottomColumns[Bottom + 1]);
+		if (bStepTop) {
+			Triangles.Add(TopFirstVertex + Top);
+			Triangles.Add(TopFirstVertex + Top + 1);
+			Triangles.Add(BottomFirstVertex + Bottom);
+			Top++;
+		}
+		else {
+			Triangles.Add(TopFirstVertex + Top);
+			Triangles.Add(BottomFirstVertex + Bottom + 1);
+			Triangles.Add(BottomFirstVertex + Bottom);
+			Bottom++;
+		}
+	}
+}
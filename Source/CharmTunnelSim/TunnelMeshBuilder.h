@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+
+// One regular block of vertices inside a vertex array. Rows follow the tunnel forward and
+// columns go around it, vertex (Row, Column) is at FirstVertex + Row * Columns + Column.
+struct FTunnelMeshGrid
+{
+	int32 FirstVertex = 0;
+	int32 Rows = 0;
+	int32 Columns = 0;
+
+	FTunnelMeshGrid() = default;
+	FTunnelMeshGrid(int32 InFirstVertex, int32 InRows, int32 InColumns) : FirstVertex(InFirstVertex), Rows(InRows), Columns(InColumns) {}
+
+	int32 Num() const { return Rows * Columns; }
+	int32 NumTriangleIndices() const { return Rows > 1 && Columns > 1 ? (Rows - 1) * (Columns - 1) * 6 : 0; }
+};
+
+// Geometry of one procedural mesh section
+struct FTunnelMeshSectionData
+{
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UV;
+	TArray<FProcMeshTangent> Tangents;
+	bool bEnableCollision = true;
+};
+
+// Builds index buffers, smooth normals, tangents and UVs of tunnel and intersection grids.
+// Everything is written into arrays sized once up front and rows are processed in parallel,
+// so a section costs a few passes over its vertices instead of Blueprint loops.
+// Triangles face the inside of the tunnel when columns run around the tunnel in the same
+// direction as the generation loop (floor to the right, up the right wall, over the roof, down the left wall).
+struct CHARMTUNNELSIM_API FTunnelMeshBuilder
+{
+	// Grids with fewer rows than this are built on the calling thread
+	static constexpr int32 MinRowsForParallel = 16;
+
+	// Appends the two triangles of every grid quad
+	static void AppendTriangles(const FTunnelMeshGrid& Grid, TArray<int32>& Triangles);
+
+	// Area weighted smooth normals and tangents along the columns. Normals and Tangents must already hold every vertex of the grid
+	static void ComputeNormalsAndTangents(const TArray<FVector>& Vertices, const FTunnelMeshGrid& Grid, TArray<FVector>& Normals, TArray<FProcMeshTangent>& Tangents);
+	// Same for rows FirstRow to LastRow only, the quads around them are still taken from the whole grid
+	static void ComputeNormalsAndTangents(const TArray<FVector>& Vertices, const FTunnelMeshGrid& Grid, int32 FirstRow, int32 LastRow, TArray<FVector>& Normals, TArray<FProcMeshTangent>& Tangents);
+
+	// UVs from the distance travelled along columns (U) and rows (V), one UV unit per TileSize. UVs must already hold every vertex of the grid.
+	// Rows before FirstRow are kept and V continues from them
+	static void ComputeUVs(const TArray<FVector>& Vertices, const FTunnelMeshGrid& Grid, float TileSize, TArray<FVector2D>& UVs, int32 FirstRow = 0);
+
+	// Builds all buffers of a vertex array made of one or more grids. UVs are only rebuilt when they do not match the vertex count
+	static void Build(const TArray<FVector>& Vertices, TArrayView<const FTunnelMeshGrid> Grids, TArray<int32>& Triangles, TArray<FVector>& Normals, TArray<FProcMeshTangent>& Tangents, TArray<FVector2D>& UVs, float UVTileSize = 200.0f);
+
+	// Coarser copy of a built grid keeping every Step:th row and column plus the last ones. First and last row keep
+	// every column, so a section meets its neighbours without cracks whatever level they use. Normals, tangents
+	// and UVs are copied from the full grid so shading matches between levels
+	static void BuildLod(const FTunnelMeshSectionData& Source, const FTunnelMeshGrid& Grid, int32 Step, FTunnelMeshSectionData& Out);
+
+	// Triangulates the band between two rows that keep different columns. Columns are grid columns in increasing
+	// order starting at 0 and ending at the same last column, same columns give the triangles of AppendTriangles
+	static void AppendStrip(int32 TopFirstVertex, TArrayView<const int32> TopColumns, int32 BottomFirstVertex, TArrayView<const int32> BottomColumns, TArray<int32>& Triangles);
+};
@@ -0,0 +1,522 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelMeshExport.h"
+#include "ProceduralTunnel.h"
+#include "ProceduralIntersection.h"
+#include "TunnelStreamingSubsystem.h"
+#include "ProceduralMeshComponent.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "EngineUtils.h"
+
+static TAutoConsoleVariable<int32> CVarTunnelExportBatchMB(
+	TEXT("tunnel.Export.BatchMB"), 64,
+	TEXT("Output formatted in parallel before it is written to the mesh export file (MB)."));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdTunnelExport(
+	TEXT("tunnel.Export"),
+	TEXT("Exports the geometry of every tunnel and intersection. Argument is the file, the extension (obj, ply, gltf, glb) selects the format."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+	{
+		const FString FilePath = Args.Num() > 0 ? Args[0] : FPaths::ProjectSavedDir() / TEXT("TunnelExport.ply");
+		const double StartTime = FPlatformTime::Seconds();
+		FString Error;
+		if (!FTunnelMeshExport::Export(World, FilePath, Error)) {
+			UE_LOG(LogTemp, Error, TEXT("Tunnel export failed: %s"), *Error);
+			return;
+		}
+		UE_LOG(LogTemp, Log, TEXT("Exported tunnels to '%s' (%.2f MB) in %.2f s"), *FilePath,
+			IFileManager::Get().FileSize(*FilePath) / (1024.0 * 1024.0), FPlatformTime::Seconds() - StartTime);
+	}));
+
+namespace
+{
+	// geom::Mesh exports are in meters
+	constexpr double CentimetersToMeters = 0.01;
+
+	// One procedural mesh section to export with where its data goes in the output
+	struct FExportSection
+	{
+		const FProcMeshSection* Section = nullptr;
+		FTransform ToWorld;
+		FString Name;
+		int64 FirstVertex = 0;
+		// glTF only, offset of the section's buffers in the binary buffer and its bounds
+		uint64 BufferOffset = 0;
+		FVector3f Min = FVector3f::ZeroVector;
+		FVector3f Max = FVector3f::ZeroVector;
+
+		int32 NumVertices() const { return Section->ProcVertexBuffer.Num(); }
+		int32 NumIndices() const { return Section->ProcIndexBuffer.Num() / 3 * 3; }
+	};
+
+	void AddSections(UProceduralMeshComponent* Mesh, const FString& Name, TArray<FExportSection>& OutSections)
+	{
+		if (!IsValid(Mesh)) {
+			return;
+		}
+		// Sections 0 and 1 are the ground and walls of level 0, coarser levels are components of their own in lodMeshes
+		static const TCHAR* SurfaceNames[] = { TEXT("ground"), TEXT("wall") };
+		for (int32 Surface = 0; Surface < FMath::Min(Mesh->GetNumSections(), 2); Surface++) {
+			const FProcMeshSection* Section = Mesh->GetProcMeshSection(Surface);
+			if (!Section || Section->ProcVertexBuffer.Num() == 0 || Section->ProcIndexBuffer.Num() < 3) {
+				continue;
+			}
+			FExportSection& Export = OutSections.AddDefaulted_GetRef();
+			Export.Section = Section;
+			Export.ToWorld = Mesh->GetComponentTransform();
+			Export.Name = FString::Printf(TEXT("%s_%s"), *Name, SurfaceNames[Surface]);
+		}
+	}
+
+	TArray<FExportSection> GatherSections(UWorld* World)
+	{
+		// Streamed out sections are loaded back so the whole mine is exported
+		if (UTunnelStreamingSubsystem* Streaming = World->GetSubsystem<UTunnelStreamingSubsystem>()) {
+			Streaming->LoadAllSections();
+		}
+
+		TArray<FExportSection> Sections;
+		for (TActorIterator<AProceduralTunnel> It(World); It; ++It) {
+			AProceduralTunnel* Tunnel = *It;
+			Tunnel->FlushMeshUploads();
+			for (int32 MeshIndex = 0; MeshIndex < Tunnel->TunnelMeshes.Num(); MeshIndex++) {
+				AddSections(Tunnel->TunnelMeshes[MeshIndex], FString::Printf(TEXT("%s_%d"), *Tunnel->GetName(), MeshIndex), Sections);
+			}
+		}
+		for (TActorIterator<AProceduralIntersection> It(World); It; ++It) {
+			AddSections(It->IntersectionMesh, It->GetName(), Sections);
+		}
+
+		int64 FirstVertex = 0;
+		for (FExportSection& Section : Sections) {
+			Section.FirstVertex = FirstVertex;
+			FirstVertex += Section.NumVertices();
+		}
+		return Sections;
+	}
+
+	FVector3f GetPosition(const FExportSection& Section, int32 Vertex)
+	{
+		return FVector3f(Section.ToWorld.TransformPosition(Section.Section->ProcVertexBuffer[Vertex].Position) * CentimetersToMeters);
+	}
+
+	FVector3f GetNormal(const FExportSection& Section, int32 Vertex)
+	{
+		return FVector3f(Section.ToWorld.TransformVectorNoScale(Section.Section->ProcVertexBuffer[Vertex].Normal));
+	}
+
+	// glTF is right handed with Y up. Swapping Y and Z mirrors the mesh, which also turns the clockwise
+	// Unreal faces counterclockwise, so indices are kept in their order
+	FVector3f ToGltfAxes(const FVector3f& Vector)
+	{
+		return FVector3f(Vector.X, Vector.Z, Vector.Y);
+	}
+
+	template<typename FmtType, typename... Types>
+	void AppendText(TArray<uint8>& Out, const FmtType& Format, Types... Args)
+	{
+		ANSICHAR Line[512];
+		const int32 Length = FCStringAnsi::Snprintf(Line, UE_ARRAY_COUNT(Line), Format, Args...);
+		Out.Append(reinterpret_cast<const uint8*>(Line), FMath::Clamp(Length, 0, (int32)UE_ARRAY_COUNT(Line) - 1));
+	}
+
+	template<typename T>
+	void AppendValue(TArray<uint8>& Out, const T& Value)
+	{
+		Out.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+	}
+
+	// Formats batches of sections in parallel and writes each batch in section order before formatting the next
+	template<typename FormatFunction>
+	bool WriteSections(FArchive& Writer, TArrayView<const FExportSection> Sections, int64 BytesPerVertex, int64 BytesPerIndex, FormatFunction&& Format)
+	{
+		const int64 BatchBytes = (int64)FMath::Max(CVarTunnelExportBatchMB.GetValueOnGameThread(), 1) * 1024 * 1024;
+		auto EstimateBytes = [&Sections, BytesPerVertex, BytesPerIndex](int32 Index)
+		{
+			return Sections[Index].NumVertices() * BytesPerVertex + Sections[Index].NumIndices() * BytesPerIndex;
+		};
+
+		TArray<TArray<uint8>> Chunks;
+		for (int32 First = 0; First < Sections.Num();) {
+			int32 Last = First;
+			int64 Bytes = 0;
+			while (Last < Sections.Num() && (Last == First || Bytes + EstimateBytes(Last) <= BatchBytes)) {
+				Bytes += EstimateBytes(Last);
+				Last++;
+			}
+
+			Chunks.SetNum(Last - First);
+			ParallelFor(Chunks.Num(), [&Chunks, &Sections, &Format, &EstimateBytes, First](int32 Index)
+			{
+				Chunks[Index].Reset((int32)FMath::Min<int64>(EstimateBytes(First + Index), MAX_int32));
+				Format(Sections[First + Index], Chunks[Index]);
+			});
+			for (TArray<uint8>& Chunk : Chunks) {
+				Writer.Serialize(Chunk.GetData(), Chunk.Num());
+				Chunk.Empty();
+			}
+			if (Writer.IsError()) {
+				return false;
+			}
+			First = Last;
+		}
+		return true;
+	}
+
+	bool WriteOBJ(FArchive& Writer, TArrayView<const FExportSection> Sections)
+	{
+		TArray<uint8> Header;
+		AppendText(Header, "# Tunnel geometry, meters, Unreal axes\n");
+		Writer.Serialize(Header.GetData(), Header.Num());
+
+		return WriteSections(Writer, Sections, 96, 12, [](const FExportSection& Section, TArray<uint8>& Out)
+		{
+			AppendText(Out, "o %s\n", TCHAR_TO_UTF8(*Section.Name));
+			for (int32 Vertex = 0; Vertex < Section.NumVertices(); Vertex++) {
+				const FVector3f Position = GetPosition(Section, Vertex);
+				AppendText(Out, "v %.5f %.5f %.5f\n", Position.X, Position.Y, Position.Z);
+			}
+			for (int32 Vertex = 0; Vertex < Section.NumVertices(); Vertex++) {
+				const FVector3f Normal = GetNormal(Section, Vertex);
+				AppendText(Out, "vn %.4f %.4f %.4f\n", Normal.X, Normal.Y, Normal.Z);
+			}
+			// OBJ texture coordinates start from the bottom
+			for (const FProcMeshVertex& Vertex : Section.Section->ProcVertexBuffer) {
+				AppendText(Out, "vt %.5f %.5f\n", Vertex.UV0.X, 1.0 - Vertex.UV0.Y);
+			}
+			// Indices are global and start from 1, faces are turned counterclockwise like geom::Mesh
+			const TArray<uint32>& Indices = Section.Section->ProcIndexBuffer;
+			for (int32 Index = 0; Index < Section.NumIndices(); Index += 3) {
+				const int64 A = Section.FirstVertex + Indices[Index] + 1;
+				const int64 B = Section.FirstVertex + Indices[Index + 2] + 1;
+				const int64 C = Section.FirstVertex + Indices[Index + 1] + 1;
+				AppendText(Out, "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n", A, A, A, B, B, B, C, C, C);
+			}
+		});
+	}
+
+	bool WritePLY(FArchive& Writer, TArrayView<const FExportSection> Sections)
+	{
+		int64 NumVertices = 0;
+		int64 NumFaces = 0;
+		for (const FExportSection& Section : Sections) {
+			NumVertices += Section.NumVertices();
+			NumFaces += Section.NumIndices() / 3;
+		}
+		TArray<uint8> Header;
+		AppendText(Header, "ply\nformat binary_little_endian 1.0\ncomment Tunnel geometry, meters, Unreal axes\n");
+		AppendText(Header, "element vertex %lld\nproperty float x\nproperty float y\nproperty float z\n", NumVertices);
+		AppendText(Header, "property float nx\nproperty float ny\nproperty float nz\nproperty float s\nproperty float t\n");
+		AppendText(Header, "element face %lld\nproperty list uchar uint vertex_indices\nend_header\n", NumFaces);
+		Writer.Serialize(Header.GetData(), Header.Num());
+
+		// Every vertex comes before the first face
+		const int64 VertexSize = sizeof(FVector3f) * 2 + sizeof(FVector2f);
+		const int64 FaceSize = sizeof(uint8) + sizeof(uint32) * 3;
+		return WriteSections(Writer, Sections, VertexSize, 0, [](const FExportSection& Section, TArray<uint8>& Out)
+			{
+				for (int32 Vertex = 0; Vertex < Section.NumVertices(); Vertex++) {
+					AppendValue(Out, GetPosition(Section, Vertex));
+					AppendValue(Out, GetNormal(Section, Vertex));
+					AppendValue(Out, FVector2f(Section.Section->ProcVertexBuffer[Vertex].UV0));
+				}
+			})
+			&& WriteSections(Writer, Sections, 0, FaceSize / 3, [](const FExportSection& Section, TArray<uint8>& Out)
+			{
+				const TArray<uint32>& Indices = Section.Section->ProcIndexBuffer;
+				for (int32 Index = 0; Index < Section.NumIndices(); Index += 3) {
+					AppendValue(Out, (uint8)3);
+					AppendValue(Out, (uint32)(Section.FirstVertex + Indices[Index]));
+					AppendValue(Out, (uint32)(Section.FirstVertex + Indices[Index + 2]));
+					AppendValue(Out, (uint32)(Section.FirstVertex + Indices[Index + 1]));
+				}
+			});
+	}
+
+	// Positions, normals, UVs and indices of a section one after another, all sizes are multiples of 4
+	uint64 GetGltfSectionSize(const FExportSection& Section)
+	{
+		return Section.NumVertices() * (sizeof(FVector3f) * 2 + sizeof(FVector2f)) + Section.NumIndices() * sizeof(uint32);
+	}
+
+	// Lays out the binary buffer and finds the bounds glTF needs for positions, returns the buffer size
+	uint64 PrepareGltfSections(TArrayView<FExportSection> Sections)
+	{
+		uint64 Offset = 0;
+		for (FExportSection& Section : Sections) {
+			Section.BufferOffset = Offset;
+			Offset += GetGltfSectionSize(Section);
+		}
+		ParallelFor(Sections.Num(), [&Sections](int32 Index)
+		{
+			FExportSection& Section = Sections[Index];
+			Section.Min = FVector3f(MAX_flt);
+			Section.Max = FVector3f(-MAX_flt);
+			for (int32 Vertex = 0; Vertex < Section.NumVertices(); Vertex++) {
+				const FVector3f Position = ToGltfAxes(GetPosition(Section, Vertex));
+				Section.Min = Section.Min.ComponentMin(Position);
+				Section.Max = Section.Max.ComponentMax(Position);
+			}
+		});
+		return Offset;
+	}
+
+	FString BuildGltfJson(TArrayView<const FExportSection> Sections, uint64 BufferSize, const FString& BufferUri)
+	{
+		enum { ArrayBuffer = 34962, ElementArrayBuffer = 34963, Float = 5126, UnsignedInt = 5125 };
+
+		FString Json;
+		TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+		auto WriteVector = [&Writer](const TCHAR* Name, const FVector3f& Vector)
+		{
+			Writer->WriteArrayStart(Name);
+			Writer->WriteValue(Vector.X);
+			Writer->WriteValue(Vector.Y);
+			Writer->WriteValue(Vector.Z);
+			Writer->WriteArrayEnd();
+		};
+
+		Writer->WriteObjectStart();
+		Writer->WriteObjectStart(TEXT("asset"));
+		Writer->WriteValue(TEXT("version"), FString(TEXT("2.0")));
+		Writer->WriteValue(TEXT("generator"), FString(TEXT("CharmTunnelSim tunnel export")));
+		Writer->WriteObjectEnd();
+		Writer->WriteValue(TEXT("scene"), 0);
+		Writer->WriteArrayStart(TEXT("scenes"));
+		Writer->WriteObjectStart();
+		Writer->WriteArrayStart(TEXT("nodes"));
+		for (int32 Index = 0; Index < Sections.Num(); Index++) {
+			Writer->WriteValue(Index);
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+		Writer->WriteArrayEnd();
+
+		Writer->WriteArrayStart(TEXT("nodes"));
+		for (int32 Index = 0; Index < Sections.Num(); Index++) {
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("name"), Sections[Index].Name);
+			Writer->WriteValue(TEXT("mesh"), Index);
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+
+		// Four accessors and buffer views per section: positions, normals, UVs and indices
+		Writer->WriteArrayStart(TEXT("meshes"));
+		for (int32 Index = 0; Index < Sections.Num(); Index++) {
+			Writer->WriteObjectStart();
+			Writer->WriteArrayStart(TEXT("primitives"));
+			Writer->WriteObjectStart();
+			Writer->WriteObjectStart(TEXT("attributes"));
+			Writer->WriteValue(TEXT("POSITION"), Index * 4);
+			Writer->WriteValue(TEXT("NORMAL"), Index * 4 + 1);
+			Writer->WriteValue(TEXT("TEXCOORD_0"), Index * 4 + 2);
+			Writer->WriteObjectEnd();
+			Writer->WriteValue(TEXT("indices"), Index * 4 + 3);
+			Writer->WriteObjectEnd();
+			Writer->WriteArrayEnd();
+			Writer->WriteObjectEnd();
+		}
+		Writer->WriteArrayEnd();
+
+		Writer->WriteArrayStart(TEXT("buffers"));
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("byteLength"), (int64)BufferSize);
+		if (!BufferUri.IsEmpty()) {
+			Writer->WriteValue(TEXT("uri"), BufferUri);
+		}
+		Writer->WriteObjectEnd();
+		Writer->WriteArrayEnd();
+
+		Writer->WriteArrayStart(TEXT("bufferViews"));
+		for (const FExportSection& Section : Sections) {
+			const int64 Sizes[] = {
+				Section.NumVertices() * (int64)sizeof(FVector3f),
+				Section.NumVertices() * (int64)sizeof(FVector3f),
+				Section.NumVertices() * (int64)sizeof(FVector2f),
+				Section.NumIndices() * (int64)sizeof(uint32) };
+			int64 Offset = (int64)Section.BufferOffset;
+			for (int32 View = 0; View < 4; View++) {
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("buffer"), 0);
+				Writer->WriteValue(TEXT("byteOffset"), Offset);
+				Writer->WriteValue(TEXT("byteLength"), Sizes[View]);
+				Writer->WriteValue(TEXT("target"), View < 3 ? (int32)ArrayBuffer : (int32)ElementArrayBuffer);
+				Writer->WriteObjectEnd();
+				Offset += Sizes[View];
+			}
+		}
+		Writer->WriteArrayEnd();
+
+		Writer->WriteArrayStart(TEXT("accessors"));
+		for (int32 Index = 0; Index < Sections.Num(); Index++) {
+			const FExportSection& Section = Sections[Index];
+			static const TCHAR* Types[] = { TEXT("VEC3"), TEXT("VEC3"), TEXT("VEC2"), TEXT("SCALAR") };
+			for (int32 View = 0; View < 4; View++) {
+				Writer->WriteObjectStart();
+				Writer->WriteValue(TEXT("bufferView"), Index * 4 + View);
+				Writer->WriteValue(TEXT("componentType"), View < 3 ? (int32)Float : (int32)UnsignedInt);
+				Writer->WriteValue(TEXT("count"), View < 3 ? Section.NumVertices() : Section.NumIndices());
+				Writer->WriteValue(TEXT("type"), FString(Types[View]));
+				if (View == 0) {
+					WriteVector(TEXT("min"), Section.Min);
+					WriteVector(TEXT("max"), Section.Max);
+				}
+				Writer->WriteObjectEnd();
+			}
+		}
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+		Writer->Close();
+		return Json;
+	}
+
+	bool WriteGltfBuffer(FArchive& Writer, TArrayView<const FExportSection> Sections)
+	{
+		const int64 VertexSize = sizeof(FVector3f) * 2 + sizeof(FVector2f);
+		return WriteSections(Writer, Sections, VertexSize, sizeof(uint32), [](const FExportSection& Section, TArray<uint8>& Out)
+		{
+			for (int32 Vertex = 0; Vertex < Section.NumVertices(); Vertex++) {
+				AppendValue(Out, ToGltfAxes(GetPosition(Section, Vertex)));
+			}
+			for (int32 Vertex = 0; Vertex < Section.NumVertices(); Vertex++) {
+				AppendValue(Out, ToGltfAxes(GetNormal(Section, Vertex)));
+			}
+			for (const FProcMeshVertex& Vertex : Section.Section->ProcVertexBuffer) {
+				AppendValue(Out, FVector2f(Vertex.UV0));
+			}
+			Out.Append(reinterpret_cast<const uint8*>(Section.Section->ProcIndexBuffer.GetData()), Section.NumIndices() * sizeof(uint32));
+		});
+	}
+
+	TUniquePtr<FArchive> CreateWriter(const FString& FilePath, FString& OutError)
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*FilePath));
+		if (!Writer) {
+			OutError = FString::Printf(TEXT("Could not write '%s'"), *FilePath);
+		}
+		return Writer;
+	}
+
+	bool WriteGLTF(const FString& FilePath, TArrayView<FExportSection> Sections, FString& OutError)
+	{
+		const uint64 BufferSize = PrepareGltfSections(Sections);
+		const FString BufferPath = FPaths::ChangeExtension(FilePath, TEXT("bin"));
+		const FTCHARToUTF8 Json(*BuildGltfJson(Sections, BufferSize, FPaths::GetCleanFilename(BufferPath)));
+
+		TUniquePtr<FArchive> JsonWriter = CreateWriter(FilePath, OutError);
+		if (!JsonWriter) {
+			return false;
+		}
+		JsonWriter->Serialize((void*)Json.Get(), Json.Length());
+		TUniquePtr<FArchive> BufferWriter = CreateWriter(BufferPath, OutError);
+		return BufferWriter && WriteGltfBuffer(*BufferWriter, Sections) && BufferWriter->Close() && JsonWriter->Close();
+	}
+
+	bool WriteGLB(FArchive& Writer, TArrayView<FExportSection> Sections)
+	{
+		const uint64 BufferSize = PrepareGltfSections(Sections);
+		const FTCHARToUTF8 Json(*BuildGltfJson(Sections, BufferSize, FString()));
+		// Chunks are padded to 4 bytes, JSON with spaces
+		const uint32 JsonSize = Align((uint32)Json.Length(), 4);
+		const uint64 TotalSize = 12 + 8 + JsonSize + 8 + BufferSize;
+		if (TotalSize > MAX_uint32) {
+			Writer.SetError();
+			return false;
+		}
+
+		TArray<uint8> Header;
+		AppendValue(Header, (uint32)0x46546C67); // "glTF"
+		AppendValue(Header, (uint32)2);
+		AppendValue(Header, (uint32)TotalSize);
+		AppendValue(Header, JsonSize);
+		AppendValue(Header, (uint32)0x4E4F534A); // "JSON"
+		Header.Append(reinterpret_cast<const uint8*>(Json.Get()), Json.Length());
+		for (uint32 Padding = Json.Length(); Padding < JsonSize; Padding++) {
+			Header.Add(' ');
+		}
+		AppendValue(Header, (uint32)BufferSize);
+		AppendValue(Header, (uint32)0x004E4942); // "BIN"
+		Writer.Serialize(Header.GetData(), Header.Num());
+		return WriteGltfBuffer(Writer, Sections);
+	}
+}
+
+bool FTunnelMeshExport::GetFormat(const FString& FilePath, ETunnelMeshExportFormat& OutFormat)
+{
+	const FString Extension = FPaths::GetExtension(FilePath).ToLower();
+	if (Extension == TEXT("obj")) {
+		OutFormat = ETunnelMeshExportFormat::OBJ;
+	}
+	else if (Extension == TEXT("ply")) {
+		OutFormat = ETunnelMeshExportFormat::PLY;
+	}
+	else if (Extension == TEXT("gltf")) {
+		OutFormat = ETunnelMeshExportFormat::GLTF;
+	}
+	else if (Extension == TEXT("glb")) {
+		OutFormat = ETunnelMeshExportFormat::GLB;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+bool FTunnelMeshExport::Export(UWorld* World, const FString& FilePath, FString& OutError)
+{
+	ETunnelMeshExportFormat Format;
+	if (!GetFormat(FilePath, Format)) {
+		OutError = FString::Printf(TEXT("Unknown mesh export format '%s', use obj, ply, gltf or glb"), *FPaths::GetExtension(FilePath));
+		return false;
+	}
+	return Export(World, FilePath, Format, OutError);
+}
+
+bool FTunnelMeshExport::Export(UWorld* World, const FString& FilePath, ETunnelMeshExportFormat Format, FString& OutError)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelMeshExport::Export);
+
+	if (!World) {
+		OutError = TEXT("No world to export tunnels from");
+		return false;
+	}
+	TArray<FExportSection> Sections = GatherSections(World);
+	if (Sections.Num() == 0) {
+		OutError = TEXT("No generated tunnel geometry to export");
+		return false;
+	}
+
+	bool bWritten = false;
+	if (Format == ETunnelMeshExportFormat::GLTF) {
+		bWritten = WriteGLTF(FilePath, Sections, OutError);
+	}
+	else {
+		TUniquePtr<FArchive> Writer = CreateWriter(FilePath, OutError);
+		if (!Writer) {
+			return false;
+		}
+		switch (Format) {
+		case ETunnelMeshExportFormat::OBJ:
+			bWritten = WriteOBJ(*Writer, Sections);
+			break;
+		case ETunnelMeshExportFormat::PLY:
+			bWritten = WritePLY(*Writer, Sections);
+			break;
+		default:
+			bWritten = WriteGLB(*Writer, Sections);
+			break;
+		}
+		bWritten = Writer->Close() && bWritten;
+	}
+	if (!bWritten && OutError.IsEmpty()) {
+		OutError = FString::Printf(TEXT("Writing '%s' failed, glb files are limited to 4 GB"), *FilePath);
+	}
+	return bWritten;
+}
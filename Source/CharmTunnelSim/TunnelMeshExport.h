@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ETunnelMeshExportFormat : uint8
+{
+	OBJ,
+	PLY,
+	GLTF,
+	GLB,
+};
+
+// Writes the generated geometry of every tunnel and intersection in a world to one mesh file, used as ground truth
+// for offline SLAM evaluation. Positions are in world space and meters like geom::Mesh exports:
+//
+//   .obj     text, Unreal axes, counterclockwise faces, one object per section
+//   .ply     binary little endian, Unreal axes, counterclockwise faces, positions, normals and UVs
+//   .gltf    JSON with a .bin buffer next to it, glTF axes (Y up), one node per section
+//   .glb     same as .gltf in a single binary container
+//
+// Sections are formatted in parallel in batches of about tunnel.Export.BatchMB and written to the file as each
+// batch completes, so memory does not grow with the size of the mine. Only the full detail level is exported.
+class CHARMTUNNELSIM_API FTunnelMeshExport
+{
+public:
+	// Format from the file extension
+	static bool GetFormat(const FString& FilePath, ETunnelMeshExportFormat& OutFormat);
+
+	static bool Export(UWorld* World, const FString& FilePath, FString& OutError);
+	static bool Export(UWorld* World, const FString& FilePath, ETunnelMeshExportFormat Format, FString& OutError);
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelMeshUpload.h"
+#include "TunnelGenerationStats.h"
+
+void FTunnelMeshUpload::UploadSection(UProceduralMeshComponent* Mesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles,
+	const TArray<FVector>& Normals, const TArray<FVector2D>& UV, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelMeshUpload::UploadSection);
+	TUNNEL_GENERATION_PHASE_SCOPE(MeshUpload);
+
+	// Cooking on the game thread is what made long tunnels hitch, the old body setup is used until the async cook finishes
+	Mesh->bUseAsyncCooking = true;
+
+	const FProcMeshSection* Section = SectionIndex < Mesh->GetNumSections() ? Mesh->GetProcMeshSection(SectionIndex) : nullptr;
+	const bool bSameTopology = Section
+		&& Section->ProcVertexBuffer.Num() == Vertices.Num()
+		&& Section->bEnableCollision == bCreateCollision
+		&& Section->ProcIndexBuffer.Num() == Triangles.Num()
+		&& FMemory::Memcmp(Section->ProcIndexBuffer.GetData(), Triangles.GetData(), Triangles.Num() * sizeof(int32)) == 0;
+
+	if (bSameTopology && Vertices.Num() > 0) {
+		// Only vertex attributes are sent to the render thread, collision is updated from the new positions
+		Mesh->UpdateMeshSection(SectionIndex, Vertices, Normals, UV, TArray<FColor>(), Tangents);
+	}
+	else {
+		Mesh->CreateMeshSection(SectionIndex, Vertices, Triangles, Normals, UV, TArray<FColor>(), Tangents, bCreateCollision);
+	}
+}
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "TunnelMeshBuilder.h"
+
+// Uploads tunnel and intersection sections to procedural mesh components without rebuilding more than needed.
+// When the index buffer of a section is unchanged only the vertex buffers are updated in place, so dragging the
+// end of a tunnel does not recreate the render resources of every touched section. Collision is cooked on a
+// background thread and the component keeps its old collision until the new body setup is ready.
+struct CHARMTUNNELSIM_API FTunnelMeshUpload
+{
+	// Updates the section in place if its triangles did not change, otherwise creates the section again
+	static void UploadSection(UProceduralMeshComponent* Mesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles,
+		const TArray<FVector>& Normals, const TArray<FVector2D>& UV, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision = true);
+
+	static void UploadSection(UProceduralMeshComponent* Mesh, int32 SectionIndex, const FTunnelMeshSectionData& Data)
+	{
+		UploadSection(Mesh, SectionIndex, Data.Vertices, Data.Triangles, Data.Normals, Data.UV, Data.Tangents, Data.bEnableCollision);
+	}
+};
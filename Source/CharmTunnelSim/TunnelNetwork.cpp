@@ -0,0 +1,808 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelNetwork.h"
+#include "ProceduralTunnel.h"
+#include "ProceduralIntersection.h"
+#include "Components/SplineComponent.h"
+#include "Components/ChildActorComponent.h"
+#include "Async/ParallelFor.h"
+#include "Serialization/JsonReader.h"
+#include "HAL/FileManager.h"
+#include "Misc/ScopedSlowTask.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+
+namespace
+{
+	// Pull parser over the layout, values are written straight into the network without building a JSON object tree.
+	// Errors are reported with the line and column they were found at
+	template<typename CharType>
+	class TTunnelNetworkParser
+	{
+	public:
+		TTunnelNetworkParser(TSharedRef<TJsonReader<CharType>> InReader, FTunnelNetwork& InNetwork, FArchive* InStream, TFunction<void(float)> InOnProgress)
+			: Reader(InReader)
+			, Network(InNetwork)
+			, Stream(InStream)
+			, OnProgress(MoveTemp(InOnProgress))
+		{
+		}
+
+		bool Parse(FString& OutError)
+		{
+			Network.Nodes.Reset();
+			Network.Edges.Reset();
+
+			EJsonNotation Notation;
+			bool bHasTunnels = false;
+			bool bOk = Next(Notation) && Expect(Notation, EJsonNotation::ObjectStart, TEXT("Tunnel network must be a JSON object"));
+			while (bOk && Next(Notation) && Notation != EJsonNotation::ObjectEnd) {
+				const FString Field = Reader->GetIdentifier();
+				if (Field == TEXT("tunnels")) {
+					bOk = ParseArray(Notation, [this](EJsonNotation Element) { return ParseTunnel(Element); });
+					bHasTunnels = true;
+				}
+				else if (Field == TEXT("intersections")) {
+					bOk = ParseArray(Notation, [this](EJsonNotation Element) { return ParseIntersection(Element); });
+				}
+				else {
+					bOk = Skip(Notation);
+				}
+			}
+			bOk = bOk && Error.IsEmpty() && (bHasTunnels || Fail(TEXT("Tunnel network has no tunnels array")));
+			if (!bOk) {
+				OutError = FString::Printf(TEXT("%s (line %d, column %d)"), Error.IsEmpty() ? *Reader->GetErrorMessage() : *Error,
+					Reader->GetLineNumber(), Reader->GetCharacterNumber());
+			}
+			return bOk;
+		}
+
+	private:
+		bool Fail(const FString& Message)
+		{
+			if (Error.IsEmpty()) {
+				Error = Message;
+			}
+			return false;
+		}
+
+		bool Next(EJsonNotation& Notation)
+		{
+			if (!Reader->ReadNext(Notation) || Notation == EJsonNotation::Error) {
+				return Fail(Reader->GetErrorMessage());
+			}
+			if (Stream && OnProgress && Stream->TotalSize() > 0) {
+				const float Progress = (float)Stream->Tell() / (float)Stream->TotalSize();
+				if (Progress - LastProgress >= 0.01f) {
+					LastProgress = Progress;
+					OnProgress(Progress);
+				}
+			}
+			return true;
+		}
+
+		bool Expect(EJsonNotation Notation, EJsonNotation Expected, const TCHAR* Message)
+		{
+			return Notation == Expected || Fail(Message);
+		}
+
+		// Calls ParseElement for every element of the array that was just opened
+		template<typename ElementParser>
+		bool ParseArray(EJsonNotation Notation, ElementParser&& ParseElement)
+		{
+			if (!Expect(Notation, EJsonNotation::ArrayStart, TEXT("Expected an array"))) {
+				return false;
+			}
+			while (Next(Notation)) {
+				if (Notation == EJsonNotation::ArrayEnd) {
+					return true;
+				}
+				if (!ParseElement(Notation)) {
+					return false;
+				}
+			}
+			return false;
+		}
+
+		// Skips the value that was just read, including nested objects and arrays
+		bool Skip(EJsonNotation Notation)
+		{
+			int32 Depth = (Notation == EJsonNotation::ObjectStart || Notation == EJsonNotation::ArrayStart) ? 1 : 0;
+			while (Depth > 0 && Next(Notation)) {
+				if (Notation == EJsonNotation::ObjectStart || Notation == EJsonNotation::ArrayStart) {
+					Depth++;
+				}
+				else if (Notation == EJsonNotation::ObjectEnd || Notation == EJsonNotation::ArrayEnd) {
+					Depth--;
+				}
+			}
+			return Depth == 0;
+		}
+
+		bool ReadString(EJsonNotation Notation, FString& OutValue)
+		{
+			if (!Expect(Notation, EJsonNotation::String, TEXT("Expected a string"))) {
+				return false;
+			}
+			OutValue = Reader->GetValueAsString();
+			return true;
+		}
+
+		bool ReadNumber(EJsonNotation Notation, double& OutValue)
+		{
+			if (!Expect(Notation, EJsonNotation::Number, TEXT("Expected a number"))) {
+				return false;
+			}
+			OutValue = Reader->GetValueAsNumber();
+			return true;
+		}
+
+		bool ReadInteger(EJsonNotation Notation, int32& OutValue)
+		{
+			double Value = 0.0;
+			if (!ReadNumber(Notation, Value)) {
+				return false;
+			}
+			OutValue = (int32)Value;
+			return true;
+		}
+
+		// Fixed size array of numbers, [x, y] or [x, y, z]
+		bool ReadNumbers(EJsonNotation Notation, double* OutValues, int32 Count)
+		{
+			if (!Expect(Notation, EJsonNotation::ArrayStart, TEXT("Expected an array of numbers"))) {
+				return false;
+			}
+			for (int32 Index = 0; Index < Count; Index++) {
+				if (!Next(Notation) || !ReadNumber(Notation, OutValues[Index])) {
+					return false;
+				}
+			}
+			return Next(Notation) && Expect(Notation, EJsonNotation::ArrayEnd, TEXT("Too many numbers in a vector"));
+		}
+
+		bool ReadVector(EJsonNotation Notation, FVector& OutVector)
+		{
+			double Values[3];
+			if (!ReadNumbers(Notation, Values, 3)) {
+				return false;
+			}
+			OutVector = FVector(Values[0], Values[1], Values[2]);
+			return true;
+		}
+
+		bool ReadVector2D(EJsonNotation Notation, FVector2D& OutVector)
+		{
+			double Values[2];
+			if (!ReadNumbers(Notation, Values, 2)) {
+				return false;
+			}
+			OutVector = FVector2D(Values[0], Values[1]);
+			return true;
+		}
+
+		bool ReadVectors(EJsonNotation Notation, TArray<FVector>& OutVectors)
+		{
+			OutVectors.Reset();
+			return ParseArray(Notation, [this, &OutVectors](EJsonNotation Element) { return ReadVector(Element, OutVectors.AddDefaulted_GetRef()); });
+		}
+
+		bool ParseTunnel(EJsonNotation Notation)
+		{
+			if (!Expect(Notation, EJsonNotation::ObjectStart, TEXT("Tunnel entry is not an object"))) {
+				return false;
+			}
+			FTunnelNetworkEdge& Edge = Network.Edges.AddDefaulted_GetRef();
+			FString Side = TEXT("Straight");
+			bool bOk = true;
+			while (bOk && Next(Notation) && Notation != EJsonNotation::ObjectEnd) {
+				const FString Field = Reader->GetIdentifier();
+				if (Field == TEXT("id")) {
+					bOk = ReadString(Notation, Edge.Id);
+				}
+				else if (Field == TEXT("points")) {
+					bOk = ReadVectors(Notation, Edge.Points);
+				}
+				else if (Field == TEXT("tangents")) {
+					bOk = ReadVectors(Notation, Edge.Tangents);
+				}
+				else if (Field == TEXT("scale")) {
+					bOk = ReadVector2D(Notation, Edge.Scale);
+				}
+				else if (Field == TEXT("surfaceVariation")) {
+					bOk = ReadVector2D(Notation, Edge.SurfaceVariation);
+				}
+				else if (Field == TEXT("horizontalPoints")) {
+					bOk = ReadInteger(Notation, Edge.HorizontalPoints);
+				}
+				else if (Field == TEXT("verticalPoints")) {
+					bOk = ReadInteger(Notation, Edge.VerticalPoints);
+				}
+				else if (Field == TEXT("endTunnel")) {
+					bOk = ReadString(Notation, Edge.EndTunnel);
+				}
+				else if (Field == TEXT("startIntersection")) {
+					bOk = ReadString(Notation, Edge.StartNode);
+				}
+				else if (Field == TEXT("side")) {
+					bOk = ReadString(Notation, Side);
+				}
+				else {
+					bOk = Skip(Notation);
+				}
+			}
+			if (!bOk || !Error.IsEmpty()) {
+				return false;
+			}
+
+			bool bIsIdUsed = false;
+			EdgeIds.Add(Edge.Id, &bIsIdUsed);
+			if (Edge.Id.IsEmpty() || bIsIdUsed) {
+				return Fail(FString::Printf(TEXT("Tunnel %d has no id or its id '%s' is used twice"), Network.Edges.Num() - 1, *Edge.Id));
+			}
+			if (Edge.Points.Num() < 2) {
+				return Fail(FString::Printf(TEXT("Tunnel '%s' needs at least two points"), *Edge.Id));
+			}
+			if (Edge.Tangents.Num() > 0 && Edge.Tangents.Num() != Edge.Points.Num()) {
+				return Fail(FString::Printf(TEXT("Tunnel '%s' needs one tangent per point"), *Edge.Id));
+			}
+			if (!Edge.StartNode.IsEmpty()) {
+				// Side of the intersection this tunnel leaves from
+				if (Side == TEXT("Right")) {
+					Edge.Type = TunnelType::RightTunnel;
+				}
+				else if (Side == TEXT("Left")) {
+					Edge.Type = TunnelType::LeftTunnel;
+				}
+				else if (Side == TEXT("Straight")) {
+					Edge.Type = TunnelType::StraightTunnel;
+				}
+				else {
+					return Fail(FString::Printf(TEXT("Tunnel '%s' has unknown side '%s'"), *Edge.Id, *Side));
+				}
+			}
+			return true;
+		}
+
+		bool ParseIntersection(EJsonNotation Notation)
+		{
+			if (!Expect(Notation, EJsonNotation::ObjectStart, TEXT("Intersection entry is not an object"))) {
+				return false;
+			}
+			FTunnelNetworkNode& Node = Network.Nodes.AddDefaulted_GetRef();
+			FString Type;
+			FVector Location = FVector::ZeroVector;
+			FVector Rotation = FVector::ZeroVector;
+			bool bOk = true;
+			while (bOk && Next(Notation) && Notation != EJsonNotation::ObjectEnd) {
+				const FString Field = Reader->GetIdentifier();
+				if (Field == TEXT("id")) {
+					bOk = ReadString(Notation, Node.Id);
+				}
+				else if (Field == TEXT("parentTunnel")) {
+					bOk = ReadString(Notation, Node.ParentTunnel);
+				}
+				else if (Field == TEXT("type")) {
+					bOk = ReadString(Notation, Type);
+				}
+				else if (Field == TEXT("location")) {
+					bOk = ReadVector(Notation, Location);
+					Node.bHasTransform = true;
+				}
+				else if (Field == TEXT("rotation")) {
+					bOk = ReadVector(Notation, Rotation);
+				}
+				else {
+					bOk = Skip(Notation);
+				}
+			}
+			if (!bOk || !Error.IsEmpty()) {
+				return false;
+			}
+
+			bool bIsIdUsed = false;
+			NodeIds.Add(Node.Id, &bIsIdUsed);
+			if (Node.Id.IsEmpty() || bIsIdUsed) {
+				return Fail(FString::Printf(TEXT("Intersection %d has no id or its id '%s' is used twice"), Network.Nodes.Num() - 1, *Node.Id));
+			}
+			if (Node.ParentTunnel.IsEmpty()) {
+				return Fail(FString::Printf(TEXT("Intersection '%s' has no parent tunnel"), *Node.Id));
+			}
+			if (!Type.IsEmpty()) {
+				const int64 Value = StaticEnum<IntersectionType>()->GetValueByNameString(Type);
+				if (Value == INDEX_NONE) {
+					return Fail(FString::Printf(TEXT("Intersection '%s' has unknown type '%s'"), *Node.Id, *Type));
+				}
+				Node.Type = (IntersectionType)Value;
+			}
+			Node.Transform = FTransform(FRotator(Rotation.X, Rotation.Y, Rotation.Z), Location);
+			return true;
+		}
+
+		TSharedRef<TJsonReader<CharType>> Reader;
+		FTunnelNetwork& Network;
+		FArchive* Stream;
+		TFunction<void(float)> OnProgress;
+		float LastProgress = 0.0f;
+		FString Error;
+		// Set::Add reports an id that is already there, replaces searching the parsed entries
+		TSet<FString> EdgeIds;
+		TSet<FString> NodeIds;
+	};
+}
+
+bool FTunnelNetwork::LoadFromFile(const FString& FilePath, FString& OutError, TFunction<void(float)> OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelNetwork::LoadFromFile);
+
+	TUniquePtr<FArchive> File(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!File) {
+		OutError = FString::Printf(TEXT("Could not read tunnel network file '%s'"), *FilePath);
+		return false;
+	}
+	// UTF-8 is read through the archive as it is, without loading the whole file into a string first.
+	// Characters are taken byte by byte, so ids and names should stay ASCII
+	if (File->TotalSize() >= 3) {
+		uint8 Bom[3];
+		File->Serialize(Bom, 3);
+		if (!(Bom[0] == 0xEF && Bom[1] == 0xBB && Bom[2] == 0xBF)) {
+			File->Seek(0);
+		}
+	}
+	TTunnelNetworkParser<UTF8CHAR> Parser(TJsonReader<UTF8CHAR>::Create(File.Get()), *this, File.Get(), MoveTemp(OnProgress));
+	if (!Parser.Parse(OutError)) {
+		OutError = FString::Printf(TEXT("%s - '%s'"), *OutError, *FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool FTunnelNetwork::LoadFromJson(const FString& Json, FString& OutError)
+{
+	TTunnelNetworkParser<TCHAR> Parser(TJsonReaderFactory<TCHAR>::Create(Json), *this, nullptr, nullptr);
+	return Parser.Parse(OutError);
+}
+
+bool FTunnelNetwork::GetGenerationLevels(TArray<TArray<int32>>& OutLevels, FString& OutError) const
+{
+	OutLevels.Reset();
+
+	// A tunnel ends in at most one intersection, a second one would replace the first when generating
+	TArray<int32> NodeByParent;
+	NodeByParent.Init(INDEX_NONE, Edges.Num());
+	for (int32 NodeIndex = 0; NodeIndex < Nodes.Num(); NodeIndex++) {
+		const FTunnelNetworkNode& Node = Nodes[NodeIndex];
+		const int32 ParentIndex = FindEdge(Node.ParentTunnel);
+		if (ParentIndex == INDEX_NONE) {
+			OutError = FString::Printf(TEXT("Intersection '%s' is on unknown tunnel '%s'"), *Node.Id, *Node.ParentTunnel);
+			return false;
+		}
+		if (NodeByParent[ParentIndex] != INDEX_NONE) {
+			OutError = FString::Printf(TEXT("Intersection '%s' is on tunnel '%s', which already ends in intersection '%s'"),
+				*Node.Id, *Node.ParentTunnel, *Nodes[NodeByParent[ParentIndex]].Id);
+			return false;
+		}
+		NodeByParent[ParentIndex] = NodeIndex;
+	}
+
+	TArray<TArray<int32, TInlineAllocator<2>>> Dependencies;
+	Dependencies.SetNum(Edges.Num());
+	for (int32 EdgeIndex = 0; EdgeIndex < Edges.Num(); EdgeIndex++) {
+		const FTunnelNetworkEdge& Edge = Edges[EdgeIndex];
+		if (!Edge.StartNode.IsEmpty()) {
+			const int32 NodeIndex = FindNode(Edge.StartNode);
+			const int32 ParentIndex = NodeIndex == INDEX_NONE ? INDEX_NONE : FindEdge(Nodes[NodeIndex].ParentTunnel);
+			if (ParentIndex == INDEX_NONE) {
+				OutError = FString::Printf(TEXT("Tunnel '%s' starts from unknown intersection or its parent tunnel is missing"), *Edge.Id);
+				return false;
+			}
+			Dependencies[EdgeIndex].Add(ParentIndex);
+		}
+		if (!Edge.EndTunnel.IsEmpty()) {
+			const int32 EndIndex = FindEdge(Edge.EndTunnel);
+			if (EndIndex == INDEX_NONE) {
+				OutError = FString::Printf(TEXT("Tunnel '%s' ends at unknown tunnel '%s'"), *Edge.Id, *Edge.EndTunnel);
+				return false;
+			}
+			Dependencies[EdgeIndex].Add(EndIndex);
+		}
+	}
+
+	TArray<int32> Levels;
+	Levels.Init(INDEX_NONE, Edges.Num());
+	int32 Remaining = Edges.Num();
+	while (Remaining > 0) {
+		const int32 Level = OutLevels.Num();
+		TArray<int32> Current;
+		for (int32 EdgeIndex = 0; EdgeIndex < Edges.Num(); EdgeIndex++) {
+			if (Levels[EdgeIndex] != INDEX_NONE) {
+				continue;
+			}
+			bool bReady = true;
+			for (int32 Dependency : Dependencies[EdgeIndex]) {
+				bReady &= Levels[Dependency] != INDEX_NONE && Levels[Dependency] < Level;
+			}
+			if (bReady) {
+				Current.Add(EdgeIndex);
+			}
+		}
+		if (Current.Num() == 0) {
+			OutError = TEXT("Tunnel network has a cycle of tunnels depending on each other");
+			return false;
+		}
+		for (int32 EdgeIndex : Current) {
+			Levels[EdgeIndex] = Level;
+		}
+		Remaining -= Current.Num();
+		OutLevels.Add(MoveTemp(Current));
+	}
+	return true;
+}
+
+namespace
+{
+	// Counts in a loaded archive come from the file. Every element takes at least MinElementSize bytes, a count larger
+	// than what is left of the archive can only be corruption and would allocate memory for elements that are not there
+	bool SerializeCount(FArchive& Ar, int32& Num, int64 MinElementSize)
+	{
+		Ar << Num;
+		if (Ar.IsLoading() && !Ar.IsError() && (Num < 0 || Num > (Ar.TotalSize() - Ar.Tell()) / MinElementSize)) {
+			Ar.SetError();
+		}
+		return !Ar.IsError();
+	}
+
+	template<typename ElementType>
+	void SerializeArray(FArchive& Ar, TArray<ElementType>& Array)
+	{
+		int32 Num = Array.Num();
+		if (!SerializeCount(Ar, Num, sizeof(ElementType))) {
+			return;
+		}
+		if (Ar.IsLoading()) {
+			Array.SetNum(Num);
+		}
+		for (ElementType& Element : Array) {
+			Ar << Element;
+		}
+	}
+
+	// Same layout as FString's operator<<, the length is checked before the string is allocated
+	void SerializeString(FArchive& Ar, FString& String)
+	{
+		if (Ar.IsLoading() && !Ar.IsError()) {
+			const int64 Start = Ar.Tell();
+			int32 SaveNum = 0;
+			Ar << SaveNum;
+			// Negative lengths are UTF-16 strings
+			const int64 Bytes = SaveNum < 0 ? -(int64)SaveNum * 2 : (int64)SaveNum;
+			if (Ar.IsError() || Bytes > Ar.TotalSize() - Ar.Tell()) {
+				Ar.SetError();
+				return;
+			}
+			Ar.Seek(Start);
+		}
+		Ar << String;
+	}
+}
+
+bool FTunnelNetwork::Serialize(FArchive& Ar)
+{
+	// Smallest node and edge, every string is at least its length
+	constexpr int64 MinNodeSize = 2 * sizeof(int32) + sizeof(uint8);
+	constexpr int64 MinEdgeSize = 4 * sizeof(int32);
+
+	int32 NumNodes = Nodes.Num();
+	if (!SerializeCount(Ar, NumNodes, MinNodeSize)) {
+		return false;
+	}
+	if (Ar.IsLoading()) {
+		Nodes.SetNum(NumNodes);
+	}
+	for (FTunnelNetworkNode& Node : Nodes) {
+		uint8 Type = (uint8)Node.Type;
+		SerializeString(Ar, Node.Id);
+		SerializeString(Ar, Node.ParentTunnel);
+		Ar << Type << Node.bHasTransform << Node.Transform;
+		Node.Type = (IntersectionType)Type;
+		if (Ar.IsError()) {
+			return false;
+		}
+	}
+
+	int32 NumEdges = Edges.Num();
+	if (!SerializeCount(Ar, NumEdges, MinEdgeSize)) {
+		return false;
+	}
+	if (Ar.IsLoading()) {
+		Edges.SetNum(NumEdges);
+	}
+	for (FTunnelNetworkEdge& Edge : Edges) {
+		uint8 Type = (uint8)Edge.Type;
+		SerializeString(Ar, Edge.Id);
+		SerializeArray(Ar, Edge.Points);
+		SerializeArray(Ar, Edge.Tangents);
+		Ar << Edge.Scale << Edge.SurfaceVariation << Edge.HorizontalPoints << Edge.VerticalPoints;
+		SerializeString(Ar, Edge.StartNode);
+		Ar << Type;
+		SerializeString(Ar, Edge.EndTunnel);
+		Edge.Type = (TunnelType)Type;
+		if (Ar.IsError()) {
+			return false;
+		}
+	}
+	return !Ar.IsError();
+}
+
+FTunnelNetwork FTunnelNetwork::FromWorld(UWorld* World, TArray<AProceduralTunnel*>& OutTunnels)
+{
+	FTunnelNetwork Network;
+	OutTunnels.Reset();
+	for (TActorIterator<AProceduralTunnel> It(World); It; ++It) {
+		AProceduralTunnel* Tunnel = *It;
+		const USplineComponent* Spline = Tunnel->SplineComponent;
+		if (!IsValid(Spline) || Spline->GetNumberOfSplinePoints() < 2) {
+			continue;
+		}
+		FTunnelNetworkEdge& Edge = Network.Edges.AddDefaulted_GetRef();
+		Edge.Id = Tunnel->GetName();
+		for (int32 Index = 0; Index < Spline->GetNumberOfSplinePoints(); Index++) {
+			Edge.Points.Add(Spline->GetLocationAtSplinePoint(Index, ESplineCoordinateSpace::World));
+			Edge.Tangents.Add(Spline->GetTangentAtSplinePoint(Index, ESplineCoordinateSpace::World));
+		}
+		Edge.Scale = Tunnel->localTunnelScale;
+		Edge.SurfaceVariation = Tunnel->surfaceVariation;
+		Edge.HorizontalPoints = Tunnel->numberOfHorizontalPoints;
+		Edge.VerticalPoints = Tunnel->numberOfVerticalPoints;
+		Edge.Type = Tunnel->tunnelType;
+		if (IsValid(Tunnel->parentIntersection)) {
+			Edge.StartNode = Tunnel->parentIntersection->GetName();
+		}
+		if (IsValid(Tunnel->connectedActor) && Tunnel->isEndConnected) {
+			Edge.EndTunnel = Tunnel->connectedActor->GetName();
+		}
+		OutTunnels.Add(Tunnel);
+	}
+	for (TActorIterator<AProceduralIntersection> It(World); It; ++It) {
+		AProceduralIntersection* Intersection = *It;
+		if (!IsValid(Intersection->parentTunnel)) {
+			continue;
+		}
+		FTunnelNetworkNode& Node = Network.Nodes.AddDefaulted_GetRef();
+		Node.Id = Intersection->GetName();
+		Node.ParentTunnel = Intersection->parentTunnel->GetName();
+		Node.Type = Intersection->intersectionType;
+		Node.bHasTransform = true;
+		Node.Transform = Intersection->GetActorTransform();
+	}
+	return Network;
+}
+
+int32 FTunnelNetwork::FindEdge(const FString& Id) const
+{
+	return Edges.IndexOfByPredicate([&Id](const FTunnelNetworkEdge& Edge) { return Edge.Id == Id; });
+}
+
+int32 FTunnelNetwork::FindNode(const FString& Id) const
+{
+	return Nodes.IndexOfByPredicate([&Id](const FTunnelNetworkNode& Node) { return Node.Id == Id; });
+}
+
+FTunnelNetworkActors UTunnelNetworkLibrary::GenerateTunnelNetworkFromFile(UObject* WorldContextObject, FString FilePath, TSubclassOf<AProceduralTunnel> TunnelClass,
+	TSubclassOf<AProceduralIntersection> IntersectionClass, bool& bOutSuccess, FString& OutInfoMessage)
+{
+	FTunnelNetworkActors Actors;
+	FTunnelNetwork Network;
+	UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	const double StartTime = FPlatformTime::Seconds();
+	bool bLoaded = false;
+	{
+		FScopedSlowTask LoadTask(100.0f, FText::FromString(FString::Printf(TEXT("Loading tunnel network '%s'"), *FPaths::GetCleanFilename(FilePath))));
+		LoadTask.MakeDialogDelayed(1.0f);
+		float LoadedPercent = 0.0f;
+		bLoaded = Network.LoadFromFile(FilePath, OutInfoMessage, [&LoadTask, &LoadedPercent](float Progress)
+			{
+				LoadTask.EnterProgressFrame(Progress * 100.0f - LoadedPercent);
+				LoadedPercent = Progress * 100.0f;
+			});
+	}
+	bOutSuccess = bLoaded
+		&& GenerateTunnelNetwork(World, Network, TunnelClass, IntersectionClass, Actors, OutInfoMessage);
+	if (bOutSuccess) {
+		OutInfoMessage = FString::Printf(TEXT("Generated %d tunnels and %d intersections in %.2f s - '%s'"),
+			Actors.Tunnels.Num(), Actors.Intersections.Num(), FPlatformTime::Seconds() - StartTime, *FilePath);
+	}
+	return Actors;
+}
+
+namespace
+{
+	void SetTunnelSpline(AProceduralTunnel* Tunnel, const FTunnelNetworkEdge& Edge)
+	{
+		USplineComponent* Spline = Tunnel->SplineComponent;
+		Spline->ClearSplinePoints(false);
+		for (int32 Index = 0; Index < Edge.Points.Num(); Index++) {
+			Spline->AddSplinePoint(Edge.Points[Index], ESplineCoordinateSpace::World, false);
+			if (Edge.Tangents.Num() > 0) {
+				Spline->SetTangentAtSplinePoint(Index, Edge.Tangents[Index], ESplineCoordinateSpace::World, false);
+			}
+		}
+		Spline->UpdateSpline();
+	}
+
+	void SetTunnelPointCounts(AProceduralTunnel* Tunnel, int32 HorizontalPoints, int32 VerticalPoints)
+	{
+		if (HorizontalPoints > 1 && VerticalPoints > 0) {
+			Tunnel->numberOfHorizontalPoints = HorizontalPoints;
+			Tunnel->numberOfVerticalPoints = VerticalPoints;
+			// Floor, both walls and roof, -1 because the loop around the tunnel starts with index 0
+			Tunnel->loopAroundTunnelLastIndex = 2 * (HorizontalPoints + VerticalPoints) - 1;
+		}
+	}
+
+	AProceduralTunnel* SpawnTunnel(UWorld* World, const FTunnelNetwork& Network, int32 EdgeIndex, TSubclassOf<AProceduralTunnel> TunnelClass,
+		const TArray<AProceduralIntersection*>& Intersections)
+	{
+		const FTunnelNetworkEdge& Edge = Network.Edges[EdgeIndex];
+		const FVector Direction = (Edge.Points[1] - Edge.Points[0]).GetSafeNormal();
+		const FTransform Transform(Direction.Rotation(), Edge.Points[0]);
+
+		AProceduralTunnel* Tunnel = nullptr;
+		if (Edge.StartNode.IsEmpty()) {
+			Tunnel = World->SpawnActor<AProceduralTunnel>(TunnelClass, Transform);
+			if (Tunnel) {
+				SetTunnelPointCounts(Tunnel, Edge.HorizontalPoints, Edge.VerticalPoints);
+			}
+		}
+		else {
+			// Child tunnels are child actors of their intersection, that is how they find it when generating
+			AProceduralIntersection* Intersection = Intersections[Network.FindNode(Edge.StartNode)];
+			UChildActorComponent* Child = NewObject<UChildActorComponent>(Intersection, NAME_None, RF_Transactional);
+			Child->SetChildActorClass(TunnelClass);
+			Child->SetupAttachment(Intersection->GetRootComponent());
+			Child->SetWorldTransform(Transform);
+			Child->RegisterComponent();
+			Intersection->AddInstanceComponent(Child);
+			Tunnel = Cast<AProceduralTunnel>(Child->GetChildActor());
+			if (Tunnel) {
+				Tunnel->tunnelType = Edge.Type;
+				Tunnel->parentIntersection = Intersection;
+				SetTunnelPointCounts(Tunnel, Intersection->numberOfHorizontalPoints, Intersection->numberOfVerticalPoints);
+			}
+		}
+		if (Tunnel) {
+			Tunnel->SetValuesForGeneratingTunnel(0.0f, false, Edge.Scale, Edge.SurfaceVariation, false);
+			SetTunnelSpline(Tunnel, Edge);
+		}
+		return Tunnel;
+	}
+
+	AProceduralIntersection* SpawnIntersection(UWorld* World, const FTunnelNetworkNode& Node, const FTunnelNetworkEdge& ParentEdge,
+		AProceduralTunnel* ParentTunnel, TSubclassOf<AProceduralIntersection> IntersectionClass)
+	{
+		FTransform Transform = Node.Transform;
+		if (!Node.bHasTransform) {
+			const USplineComponent* Spline = ParentTunnel->SplineComponent;
+			const int32 LastIndex = Spline->GetNumberOfSplinePoints() - 1;
+			Transform = FTransform(Spline->GetDirectionAtSplinePoint(LastIndex, ESplineCoordinateSpace::World).Rotation(),
+				Spline->GetLocationAtSplinePoint(LastIndex, ESplineCoordinateSpace::World));
+		}
+		AProceduralIntersection* Intersection = World->SpawnActor<AProceduralIntersection>(IntersectionClass, Transform);
+		if (Intersection) {
+			Intersection->SetValues(ParentEdge.Scale, Node.Type, ParentTunnel, ParentEdge.SurfaceVariation, false);
+			// Continuation tunnels come from the network, not from the Blueprint
+			Intersection->isUpdate = true;
+		}
+		return Intersection;
+	}
+}
+
+bool UTunnelNetworkLibrary::GenerateTunnelNetwork(UWorld* World, const FTunnelNetwork& Network, TSubclassOf<AProceduralTunnel> TunnelClass,
+	TSubclassOf<AProceduralIntersection> IntersectionClass, FTunnelNetworkActors& OutActors, FString& OutError,
+	TFunction<bool(int32 EdgeIndex, AProceduralTunnel* Tunnel)> RestoreTunnel)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelNetworkLibrary::GenerateTunnelNetwork);
+
+	if (!World || !TunnelClass || !IntersectionClass) {
+		OutError = TEXT("Tunnel network needs a world and tunnel and intersection classes");
+		return false;
+	}
+	TArray<TArray<int32>> Levels;
+	if (!Network.GetGenerationLevels(Levels, OutError)) {
+		return false;
+	}
+
+	TArray<AProceduralTunnel*> Tunnels;
+	Tunnels.SetNumZeroed(Network.Edges.Num());
+	TArray<AProceduralIntersection*> Intersections;
+	Intersections.SetNumZeroed(Network.Nodes.Num());
+
+	for (const TArray<int32>& Level : Levels) {
+		for (int32 EdgeIndex : Level) {
+			Tunnels[EdgeIndex] = SpawnTunnel(World, Network, EdgeIndex, TunnelClass, Intersections);
+			if (!Tunnels[EdgeIndex]) {
+				OutError = FString::Printf(TEXT("Could not spawn tunnel '%s'"), *Network.Edges[EdgeIndex].Id);
+				return false;
+			}
+			OutActors.Tunnels.Add(Tunnels[EdgeIndex]);
+		}
+
+		// Tunnel ends are shaped for the intersection made at them, so intersections are spawned before generating
+		TArray<int32> LevelNodes;
+		for (int32 NodeIndex = 0; NodeIndex < Network.Nodes.Num(); NodeIndex++) {
+			const int32 ParentIndex = Network.FindEdge(Network.Nodes[NodeIndex].ParentTunnel);
+			if (ParentIndex == INDEX_NONE || !Level.Contains(ParentIndex)) {
+				continue;
+			}
+			Intersections[NodeIndex] = SpawnIntersection(World, Network.Nodes[NodeIndex], Network.Edges[ParentIndex], Tunnels[ParentIndex], IntersectionClass);
+			if (!Intersections[NodeIndex]) {
+				OutError = FString::Printf(TEXT("Could not spawn intersection '%s'"), *Network.Nodes[NodeIndex].Id);
+				return false;
+			}
+			Tunnels[ParentIndex]->intersection = Intersections[NodeIndex];
+			OutActors.Intersections.Add(Intersections[NodeIndex]);
+			LevelNodes.Add(NodeIndex);
+		}
+
+		// Joined ends, the other tunnel is in an earlier level and already generated
+		for (int32 EdgeIndex : Level) {
+			const FTunnelNetworkEdge& Edge = Network.Edges[EdgeIndex];
+			if (!Edge.EndTunnel.IsEmpty()) {
+				AProceduralTunnel* Other = Tunnels[Network.FindEdge(Edge.EndTunnel)];
+				Tunnels[EdgeIndex]->connectedActor = Other;
+				Tunnels[EdgeIndex]->isEndConnected = true;
+				Other->isEndConnected = true;
+			}
+		}
+
+		// Sections of every tunnel in the level are generated in the same parallel batches
+		TArray<FTunnelGenerationPass> Passes;
+		Passes.SetNum(Level.Num());
+		TArray<bool> Started;
+		Started.Init(false, Level.Num());
+		TArray<TPair<int32, int32>> Work;
+		for (int32 PassIndex = 0; PassIndex < Level.Num(); PassIndex++) {
+			AProceduralTunnel* Tunnel = Tunnels[Level[PassIndex]];
+			if (RestoreTunnel && RestoreTunnel(Level[PassIndex], Tunnel)) {
+				continue;
+			}
+			Tunnel->FinishAsyncGenerationLoop(true);
+			Started[PassIndex] = Tunnel->BeginGenerationPass(Tunnel->CalculateRecreationStartIndex(), 0, false, Passes[PassIndex]);
+			for (int32 SectionIndex = 0; Started[PassIndex] && SectionIndex < Passes[PassIndex].sections.Num(); SectionIndex++) {
+				Work.Emplace(PassIndex, SectionIndex);
+			}
+		}
+		ParallelFor(Work.Num(), [&Work, &Passes, &Tunnels, &Level](int32 WorkIndex)
+		{
+			const int32 PassIndex = Work[WorkIndex].Key;
+			const int32 SectionIndex = Work[WorkIndex].Value;
+			if (SectionIndex < Passes[PassIndex].sections.Num() - 1) {
+				Tunnels[Level[PassIndex]]->GenerateSeam(Passes[PassIndex], SectionIndex);
+			}
+		});
+		for (int32 PassIndex = 0; PassIndex < Level.Num(); PassIndex++) {
+			if (Started[PassIndex]) {
+				Tunnels[Level[PassIndex]]->LinkSeams(Passes[PassIndex]);
+			}
+		}
+		ParallelFor(Work.Num(), [&Work, &Passes, &Tunnels, &Level](int32 WorkIndex)
+		{
+			Tunnels[Level[Work[WorkIndex].Key]]->GenerateSection(Passes[Work[WorkIndex].Key], Work[WorkIndex].Value);
+		});
+
+		// Uploads of the whole level at once, the next level reads the mesh ends of this one
+		for (int32 PassIndex = 0; PassIndex < Level.Num(); PassIndex++) {
+			if (Started[PassIndex]) {
+				Tunnels[Level[PassIndex]]->FinishGenerationPass(Passes[PassIndex]);
+				Tunnels[Level[PassIndex]]->FlushMeshUploads();
+			}
+		}
+
+		for (int32 NodeIndex : LevelNodes) {
+			Intersections[NodeIndex]->IntersectionGenerationLoop();
+		}
+	}
+	return true;
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "EnumContainer.h"
+#include "TunnelNetwork.generated.h"
+
+class AProceduralTunnel;
+class AProceduralIntersection;
+
+// Intersection of the mine, made at the end of its parent tunnel
+struct FTunnelNetworkNode
+{
+	FString Id;
+	// Tunnel that ends at this intersection
+	FString ParentTunnel;
+	IntersectionType Type = IntersectionType::Right;
+	// Placed at the end of the parent tunnel if not given
+	bool bHasTransform = false;
+	FTransform Transform = FTransform::Identity;
+};
+
+// Spline tunnel of the mine with its profile
+struct FTunnelNetworkEdge
+{
+	FString Id;
+	// World space spline points, tangents are optional and computed by the spline when left empty
+	TArray<FVector> Points;
+	TArray<FVector> Tangents;
+	FVector2D Scale = FVector2D(4.0f, 4.0f);
+	FVector2D SurfaceVariation = FVector2D(1.0f, 1.0f);
+	int32 HorizontalPoints = 0;
+	int32 VerticalPoints = 0;
+	// Intersection this tunnel continues from and on which side, start tunnels have none
+	FString StartNode;
+	TunnelType Type = TunnelType::StartTunnel;
+	// Tunnel whose end (or start for start tunnels) this tunnel's end is joined to
+	FString EndTunnel;
+};
+
+// Whole mine as a graph: intersections are nodes and spline tunnels are edges between them.
+// Loaded from a JSON description and generated in one batch instead of replaying the editor clicks:
+//
+// {
+//   "tunnels": [ { "id": "main", "points": [[0,0,0], [5000,0,0]], "scale": [4,4], "surfaceVariation": [1,1] },
+//                { "id": "drift", "startIntersection": "x1", "side": "Right", "points": [...], "endTunnel": "main" } ],
+//   "intersections": [ { "id": "x1", "parentTunnel": "main", "type": "Right", "location": [...], "rotation": [0,90,0] } ]
+// }
+struct CHARMTUNNELSIM_API FTunnelNetwork
+{
+	TArray<FTunnelNetworkNode> Nodes;
+	TArray<FTunnelNetworkEdge> Edges;
+
+	// Layout is parsed as a stream and validated while reading, OnProgress gets the read fraction of the file
+	bool LoadFromFile(const FString& FilePath, FString& OutError, TFunction<void(float)> OnProgress = nullptr);
+	bool LoadFromJson(const FString& Json, FString& OutError);
+
+	// Groups tunnels so every tunnel comes after the tunnel its intersection is on and the tunnel its end is joined to.
+	// Tunnels in one level do not depend on each other. Fails on unknown ids, cycles and a tunnel with two intersections
+	bool GetGenerationLevels(TArray<TArray<int32>>& OutLevels, FString& OutError) const;
+
+	// Binary form used by the tunnel save file. Returns false and leaves the archive in error if the data is truncated
+	// or a count does not fit in what is left of the archive
+	bool Serialize(FArchive& Ar);
+	// Describes the tunnels and intersections placed in a world, ids are actor names
+	static FTunnelNetwork FromWorld(UWorld* World, TArray<AProceduralTunnel*>& OutTunnels);
+
+	int32 FindEdge(const FString& Id) const;
+	int32 FindNode(const FString& Id) const;
+};
+
+// Actors made from a tunnel network
+USTRUCT(BlueprintType)
+struct FTunnelNetworkActors
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TArray<AProceduralTunnel*> Tunnels;
+	UPROPERTY(BlueprintReadOnly)
+	TArray<AProceduralIntersection*> Intersections;
+};
+
+UCLASS()
+class CHARMTUNNELSIM_API UTunnelNetworkLibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+
+public:
+	// Spawns and generates every tunnel and intersection of the description file. Classes are the Blueprint
+	// tunnel and intersection, they hold the curves and materials
+	UFUNCTION(BlueprintCallable, Category = "Tunnel network", meta = (WorldContext = "WorldContextObject"))
+	static FTunnelNetworkActors GenerateTunnelNetworkFromFile(UObject* WorldContextObject, FString FilePath, TSubclassOf<AProceduralTunnel> TunnelClass,
+		TSubclassOf<AProceduralIntersection> IntersectionClass, bool& bOutSuccess, FString& OutInfoMessage);
+
+	// Tunnels of one level are generated together: their sections are made in one parallel batch across all
+	// cores and uploaded afterwards, then the intersections at their ends are made for the next level.
+	// RestoreTunnel can put saved meshes on a spawned tunnel instead, tunnels it returns true for are not generated
+	static bool GenerateTunnelNetwork(UWorld* World, const FTunnelNetwork& Network, TSubclassOf<AProceduralTunnel> TunnelClass,
+		TSubclassOf<AProceduralIntersection> IntersectionClass, FTunnelNetworkActors& OutActors, FString& OutError,
+		TFunction<bool(int32 EdgeIndex, AProceduralTunnel* Tunnel)> RestoreTunnel = nullptr);
+};
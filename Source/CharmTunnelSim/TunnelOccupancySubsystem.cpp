@@ -0,0 +1,601 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelOccupancySubsystem.h"
+#include "ProceduralTunnel.h"
+#include "ProceduralIntersection.h"
+#include "TunnelStreamingSubsystem.h"
+#include "ProceduralMeshComponent.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "EngineUtils.h"
+#include "ROSIntegration/Classes/RI/Topic.h"
+#include "ROSIntegration/Classes/ROSIntegrationGameInstance.h"
+#include "ROSIntegration/Public/nav_msgs/OccupancyGrid.h"
+#include "ROSIntegration/Public/sensor_msgs/PointCloud2.h"
+
+static TAutoConsoleVariable<int32> CVarTunnelOccupancyEnable(
+	TEXT("tunnel.Occupancy.Enable"), 0,
+	TEXT("Keep the ground truth occupancy map up to date while tunnels are generated, otherwise it is updated when used."));
+static TAutoConsoleVariable<float> CVarTunnelOccupancyVoxelSize(
+	TEXT("tunnel.Occupancy.VoxelSize"), 20.0f,
+	TEXT("Edge length of the occupancy map voxels (cm), changing it rebuilds the map."));
+static TAutoConsoleVariable<float> CVarTunnelOccupancyInterval(
+	TEXT("tunnel.Occupancy.UpdateInterval"), 0.5f,
+	TEXT("Seconds between occupancy map updates when tunnel.Occupancy.Enable is set."));
+static TAutoConsoleVariable<float> CVarTunnelOccupancySliceThickness(
+	TEXT("tunnel.Occupancy.SliceThickness"), 40.0f,
+	TEXT("Height range around the slice height that marks an occupancy grid cell occupied (cm)."));
+static TAutoConsoleVariable<float> CVarTunnelOccupancySliceClearance(
+	TEXT("tunnel.Occupancy.SliceClearance"), 1000.0f,
+	TEXT("Cells of an occupancy slice are free when there is ground and roof within this distance below and above (cm)."));
+static TAutoConsoleVariable<FString> CVarTunnelOccupancySliceTopic(
+	TEXT("tunnel.Occupancy.SliceTopic"), TEXT("/tunnel/occupancy_grid"),
+	TEXT("Topic occupancy slices are published on."));
+static TAutoConsoleVariable<FString> CVarTunnelOccupancyVoxelTopic(
+	TEXT("tunnel.Occupancy.VoxelTopic"), TEXT("/tunnel/occupancy_voxels"),
+	TEXT("Topic the occupied voxels are published on."));
+static TAutoConsoleVariable<FString> CVarTunnelOccupancyFrameId(
+	TEXT("tunnel.Occupancy.FrameId"), TEXT("map"),
+	TEXT("Frame of the published occupancy maps."));
+
+namespace
+{
+	constexpr double CentimetersToMeters = 0.01;
+	constexpr int32 TrianglesPerJob = 4096;
+	// Dense occupancy slices larger than this are refused
+	constexpr int64 MaxSliceCells = 256 * 1024 * 1024;
+
+	// Voxel coordinates are packed into 21 bits per axis, enough for 200 km either way at 20 cm voxels
+	constexpr int32 KeyBits = 21;
+	constexpr int64 KeyBias = 1 << (KeyBits - 1);
+	constexpr uint64 KeyMask = (1ull << KeyBits) - 1;
+
+	uint64 MakeVoxelKey(int32 X, int32 Y, int32 Z)
+	{
+		return ((uint64)(X + KeyBias) & KeyMask) << (2 * KeyBits) | ((uint64)(Y + KeyBias) & KeyMask) << KeyBits | ((uint64)(Z + KeyBias) & KeyMask);
+	}
+
+	FIntVector GetVoxelFromKey(uint64 Key)
+	{
+		return FIntVector(
+			(int32)((int64)((Key >> (2 * KeyBits)) & KeyMask) - KeyBias),
+			(int32)((int64)((Key >> KeyBits) & KeyMask) - KeyBias),
+			(int32)((int64)(Key & KeyMask) - KeyBias));
+	}
+
+	// Separating axis test of a triangle against the unit voxel around the origin (Akenine-Moller). The voxel
+	// axes are not tested, the caller only visits voxels within the bounds of the triangle
+	bool TriangleOverlapsVoxel(const FVector& V0, const FVector& V1, const FVector& V2)
+	{
+		const double HalfSize = 0.5;
+		const FVector Edges[3] = { V1 - V0, V2 - V1, V0 - V2 };
+		for (const FVector& Edge : Edges) {
+			const FVector Axes[3] = { FVector(0.0, -Edge.Z, Edge.Y), FVector(Edge.Z, 0.0, -Edge.X), FVector(-Edge.Y, Edge.X, 0.0) };
+			for (const FVector& Axis : Axes) {
+				const double P0 = Axis | V0;
+				const double P1 = Axis | V1;
+				const double P2 = Axis | V2;
+				const double Radius = HalfSize * (FMath::Abs(Axis.X) + FMath::Abs(Axis.Y) + FMath::Abs(Axis.Z));
+				if (FMath::Min3(P0, P1, P2) > Radius || FMath::Max3(P0, P1, P2) < -Radius) {
+					return false;
+				}
+			}
+		}
+		const FVector Normal = Edges[0] ^ Edges[1];
+		const double Radius = HalfSize * (FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z));
+		return FMath::Abs(Normal | V0) <= Radius;
+	}
+
+	// Adds the keys of the voxels a triangle in voxel units touches
+	void RasterizeTriangle(const FVector& A, const FVector& B, const FVector& C, TArray<uint64>& OutVoxels)
+	{
+		const FIntVector Min(FMath::FloorToInt(FMath::Min3(A.X, B.X, C.X)), FMath::FloorToInt(FMath::Min3(A.Y, B.Y, C.Y)), FMath::FloorToInt(FMath::Min3(A.Z, B.Z, C.Z)));
+		const FIntVector Max(FMath::FloorToInt(FMath::Max3(A.X, B.X, C.X)), FMath::FloorToInt(FMath::Max3(A.Y, B.Y, C.Y)), FMath::FloorToInt(FMath::Max3(A.Z, B.Z, C.Z)));
+		// Small triangles are the common case and need no test
+		if (Min == Max) {
+			OutVoxels.Add(MakeVoxelKey(Min.X, Min.Y, Min.Z));
+			return;
+		}
+		for (int32 X = Min.X; X <= Max.X; X++) {
+			for (int32 Y = Min.Y; Y <= Max.Y; Y++) {
+				for (int32 Z = Min.Z; Z <= Max.Z; Z++) {
+					const FVector Center(X + 0.5, Y + 0.5, Z + 0.5);
+					if (TriangleOverlapsVoxel(A - Center, B - Center, C - Center)) {
+						OutVoxels.Add(MakeVoxelKey(X, Y, Z));
+					}
+				}
+			}
+		}
+	}
+
+	void AddMesh(UProceduralMeshComponent* Mesh, TSet<TWeakObjectPtr<UProceduralMeshComponent>>& OutMeshes)
+	{
+		if (IsValid(Mesh)) {
+			OutMeshes.Add(Mesh);
+		}
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs TunnelOccupancyStatsCommand(
+	TEXT("tunnel.Occupancy.Stats"),
+	TEXT("Updates the ground truth occupancy map and prints its size."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UTunnelOccupancySubsystem* Occupancy = World ? World->GetSubsystem<UTunnelOccupancySubsystem>() : nullptr;
+		if (!Occupancy) {
+			UE_LOG(LogTemp, Display, TEXT("Tunnel occupancy map is not available in this world."));
+			return;
+		}
+		Occupancy->UpdateMap();
+		UE_LOG(LogTemp, Display, TEXT("Tunnel occupancy: %lld occupied voxels of %.1f cm in %d bricks from %d meshes, %.2f MB"),
+			Occupancy->GetNumOccupiedVoxels(), Occupancy->GetVoxelSize(), Occupancy->GetNumBricks(), Occupancy->GetNumMeshes(),
+			Occupancy->GetAllocatedSize() / (1024.0 * 1024.0));
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs TunnelOccupancyRebuildCommand(
+	TEXT("tunnel.Occupancy.Rebuild"),
+	TEXT("Voxelizes every tunnel and intersection into the ground truth occupancy map again."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (UTunnelOccupancySubsystem* Occupancy = World ? World->GetSubsystem<UTunnelOccupancySubsystem>() : nullptr) {
+			Occupancy->RebuildMap();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs TunnelOccupancyPublishSliceCommand(
+	TEXT("tunnel.Occupancy.PublishSlice"),
+	TEXT("Publishes a horizontal slice of the ground truth occupancy map. Argument is the height of the slice (cm), default 150."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UTunnelOccupancySubsystem* Occupancy = World ? World->GetSubsystem<UTunnelOccupancySubsystem>() : nullptr;
+		if (!Occupancy) {
+			UE_LOG(LogTemp, Display, TEXT("Tunnel occupancy map is not available in this world."));
+			return;
+		}
+		const float Height = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 150.0f;
+		FString Message;
+		const bool bPublished = Occupancy->PublishSlice(Height, Message);
+		UE_LOG(LogTemp, Display, TEXT("%s%s"), bPublished ? TEXT("") : TEXT("Occupancy slice not published: "), *Message);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs TunnelOccupancyPublishVoxelsCommand(
+	TEXT("tunnel.Occupancy.PublishVoxels"),
+	TEXT("Publishes the centers of all occupied voxels of the ground truth occupancy map."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UTunnelOccupancySubsystem* Occupancy = World ? World->GetSubsystem<UTunnelOccupancySubsystem>() : nullptr;
+		if (!Occupancy) {
+			UE_LOG(LogTemp, Display, TEXT("Tunnel occupancy map is not available in this world."));
+			return;
+		}
+		FString Message;
+		const bool bPublished = Occupancy->PublishVoxels(Message);
+		UE_LOG(LogTemp, Display, TEXT("%s%s"), bPublished ? TEXT("") : TEXT("Occupied voxels not published: "), *Message);
+	}));
+
+void UTunnelOccupancySubsystem::MarkMeshDirty(UProceduralMeshComponent* Mesh)
+{
+	if (Mesh) {
+		DirtyMeshes.Add(Mesh);
+	}
+}
+
+void UTunnelOccupancySubsystem::RebuildMap()
+{
+	bNeedsRebuild = true;
+	UpdateMap();
+}
+
+void UTunnelOccupancySubsystem::UpdateMap()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelOccupancySubsystem::UpdateMap);
+
+	UWorld* World = GetWorld();
+	const float NewVoxelSize = FMath::Max(CVarTunnelOccupancyVoxelSize.GetValueOnGameThread(), 1.0f);
+	if (bNeedsRebuild || NewVoxelSize != VoxelSize) {
+		bNeedsRebuild = false;
+		VoxelSize = NewVoxelSize;
+		Meshes.Empty();
+		Bricks.Empty();
+		NumOccupiedVoxels = 0;
+		DirtyMeshes.Empty();
+
+		// Streamed out sections have no geometry to voxelize
+		if (UTunnelStreamingSubsystem* Streaming = World->GetSubsystem<UTunnelStreamingSubsystem>()) {
+			Streaming->LoadAllSections();
+		}
+		for (TActorIterator<AProceduralTunnel> It(World); It; ++It) {
+			It->FlushMeshUploads();
+			for (UProceduralMeshComponent* Mesh : It->TunnelMeshes) {
+				AddMesh(Mesh, DirtyMeshes);
+			}
+		}
+		for (TActorIterator<AProceduralIntersection> It(World); It; ++It) {
+			AddMesh(It->IntersectionMesh, DirtyMeshes);
+		}
+	}
+
+	// Meshes destroyed since the last update
+	for (const TPair<TWeakObjectPtr<UProceduralMeshComponent>, TArray<uint64>>& Pair : Meshes) {
+		if (!Pair.Key.IsValid()) {
+			DirtyMeshes.Add(Pair.Key);
+		}
+	}
+	if (DirtyMeshes.Num() == 0) {
+		return;
+	}
+
+	TArray<FMeshToVoxelize> MeshesToVoxelize;
+	MeshesToVoxelize.Reserve(DirtyMeshes.Num());
+	for (const TWeakObjectPtr<UProceduralMeshComponent>& WeakMesh : DirtyMeshes) {
+		UProceduralMeshComponent* Mesh = WeakMesh.Get();
+		if (!Mesh) {
+			SetMeshVoxels(WeakMesh, TArray<uint64>());
+			continue;
+		}
+		// Sections 0 and 1 are the ground and walls of level 0, coarser levels are components of their own in lodMeshes
+		FMeshToVoxelize& ToVoxelize = MeshesToVoxelize.AddDefaulted_GetRef();
+		ToVoxelize.Mesh = WeakMesh;
+		ToVoxelize.ToWorld = Mesh->GetComponentTransform();
+		for (int32 Surface = 0; Surface < FMath::Min(Mesh->GetNumSections(), 2); Surface++) {
+			const FProcMeshSection* Section = Mesh->GetProcMeshSection(Surface);
+			if (Section && Section->ProcVertexBuffer.Num() > 0 && Section->ProcIndexBuffer.Num() >= 3) {
+				ToVoxelize.Sections.Add(Section);
+			}
+		}
+		// A streamed out section keeps the voxels it had
+		if (ToVoxelize.Sections.Num() == 0) {
+			MeshesToVoxelize.Pop(false);
+		}
+	}
+	DirtyMeshes.Empty();
+
+	VoxelizeMeshes(MeshesToVoxelize);
+	for (FMeshToVoxelize& Voxelized : MeshesToVoxelize) {
+		SetMeshVoxels(Voxelized.Mesh, MoveTemp(Voxelized.Voxels));
+	}
+}
+
+void UTunnelOccupancySubsystem::VoxelizeMeshes(TArray<FMeshToVoxelize>& MeshesToVoxelize) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelOccupancySubsystem::VoxelizeMeshes);
+
+	// Long sections are split so the work spreads evenly over the worker threads
+	struct FJob
+	{
+		int32 MeshIndex;
+		const FProcMeshSection* Section;
+		int32 FirstTriangle;
+		int32 NumTriangles;
+	};
+	TArray<FJob> Jobs;
+	TArray<TArray<int32, TInlineAllocator<8>>> JobsByMesh;
+	JobsByMesh.SetNum(MeshesToVoxelize.Num());
+	for (int32 MeshIndex = 0; MeshIndex < MeshesToVoxelize.Num(); MeshIndex++) {
+		for (const FProcMeshSection* Section : MeshesToVoxelize[MeshIndex].Sections) {
+			const int32 NumTriangles = Section->ProcIndexBuffer.Num() / 3;
+			for (int32 FirstTriangle = 0; FirstTriangle < NumTriangles; FirstTriangle += TrianglesPerJob) {
+				JobsByMesh[MeshIndex].Add(Jobs.Num());
+				Jobs.Add({ MeshIndex, Section, FirstTriangle, FMath::Min(TrianglesPerJob, NumTriangles - FirstTriangle) });
+			}
+		}
+	}
+
+	const double VoxelsPerUnit = 1.0 / VoxelSize;
+	TArray<TArray<uint64>> JobVoxels;
+	JobVoxels.SetNum(Jobs.Num());
+	ParallelFor(Jobs.Num(), [&](int32 JobIndex)
+	{
+		const FJob& Job = Jobs[JobIndex];
+		const FTransform& ToWorld = MeshesToVoxelize[Job.MeshIndex].ToWorld;
+		const TArray<FProcMeshVertex>& Vertices = Job.Section->ProcVertexBuffer;
+		const TArray<uint32>& Indices = Job.Section->ProcIndexBuffer;
+		TArray<uint64>& Voxels = JobVoxels[JobIndex];
+		Voxels.Reserve(Job.NumTriangles * 2);
+		for (int32 Triangle = Job.FirstTriangle; Triangle < Job.FirstTriangle + Job.NumTriangles; Triangle++) {
+			FVector Corners[3];
+			bool bValid = true;
+			for (int32 Corner = 0; Corner < 3; Corner++) {
+				const uint32 Index = Indices[Triangle * 3 + Corner];
+				bValid &= Vertices.IsValidIndex(Index);
+				Corners[Corner] = bValid ? ToWorld.TransformPosition(Vertices[Index].Position) * VoxelsPerUnit : FVector::ZeroVector;
+			}
+			if (bValid) {
+				RasterizeTriangle(Corners[0], Corners[1], Corners[2], Voxels);
+			}
+		}
+	});
+
+	// Each mesh counts once per voxel however many of its triangles touch it
+	ParallelFor(MeshesToVoxelize.Num(), [&](int32 MeshIndex)
+	{
+		TArray<uint64>& Voxels = MeshesToVoxelize[MeshIndex].Voxels;
+		int32 NumVoxels = 0;
+		for (int32 JobIndex : JobsByMesh[MeshIndex]) {
+			NumVoxels += JobVoxels[JobIndex].Num();
+		}
+		Voxels.Reserve(NumVoxels);
+		for (int32 JobIndex : JobsByMesh[MeshIndex]) {
+			Voxels.Append(JobVoxels[JobIndex]);
+		}
+		Voxels.Sort();
+		int32 NumUnique = 0;
+		for (int32 Index = 0; Index < Voxels.Num(); Index++) {
+			if (NumUnique == 0 || Voxels[NumUnique - 1] != Voxels[Index]) {
+				Voxels[NumUnique++] = Voxels[Index];
+			}
+		}
+		Voxels.SetNum(NumUnique, false);
+	});
+}
+
+// Only the voxels the mesh gained or lost change, both key lists are sorted
+void UTunnelOccupancySubsystem::SetMeshVoxels(const TWeakObjectPtr<UProceduralMeshComponent>& Mesh, TArray<uint64>&& Voxels)
+{
+	TArray<uint64> OldVoxels;
+	Meshes.RemoveAndCopyValue(Mesh, OldVoxels);
+
+	int32 OldIndex = 0;
+	int32 NewIndex = 0;
+	while (OldIndex < OldVoxels.Num() || NewIndex < Voxels.Num()) {
+		if (NewIndex == Voxels.Num() || (OldIndex < OldVoxels.Num() && OldVoxels[OldIndex] < Voxels[NewIndex])) {
+			RemoveVoxel(OldVoxels[OldIndex++]);
+		}
+		else if (OldIndex == OldVoxels.Num() || Voxels[NewIndex] < OldVoxels[OldIndex]) {
+			AddVoxel(Voxels[NewIndex++]);
+		}
+		else {
+			OldIndex++;
+			NewIndex++;
+		}
+	}
+
+	if (Voxels.Num() > 0 && Mesh.IsValid()) {
+		Meshes.Add(Mesh, MoveTemp(Voxels));
+	}
+}
+
+void UTunnelOccupancySubsystem::AddVoxel(uint64 Key)
+{
+	const FIntVector Voxel = GetVoxelFromKey(Key);
+	FBrick& Brick = Bricks.FindOrAdd(FIntVector(Voxel.X >> BrickShift, Voxel.Y >> BrickShift, Voxel.Z >> BrickShift));
+	if (Brick.Counts.Num() == 0) {
+		Brick.Counts.SetNumZeroed(BrickVoxels);
+	}
+	const int32 Index = (Voxel.X & (BrickSize - 1)) | (Voxel.Y & (BrickSize - 1)) << BrickShift | (Voxel.Z & (BrickSize - 1)) << (2 * BrickShift);
+	if (Brick.Counts[Index]++ == 0) {
+		Brick.NumOccupied++;
+		NumOccupiedVoxels++;
+	}
+}
+
+void UTunnelOccupancySubsystem::RemoveVoxel(uint64 Key)
+{
+	const FIntVector Voxel = GetVoxelFromKey(Key);
+	const FIntVector BrickCoordinates(Voxel.X >> BrickShift, Voxel.Y >> BrickShift, Voxel.Z >> BrickShift);
+	FBrick* Brick = Bricks.Find(BrickCoordinates);
+	const int32 Index = (Voxel.X & (BrickSize - 1)) | (Voxel.Y & (BrickSize - 1)) << BrickShift | (Voxel.Z & (BrickSize - 1)) << (2 * BrickShift);
+	if (!Brick || Brick->Counts[Index] == 0) {
+		return;
+	}
+	if (--Brick->Counts[Index] == 0) {
+		NumOccupiedVoxels--;
+		if (--Brick->NumOccupied == 0) {
+			Bricks.Remove(BrickCoordinates);
+		}
+	}
+}
+
+bool UTunnelOccupancySubsystem::IsOccupied(FVector Location)
+{
+	UpdateMap();
+	const FVector Voxel = Location / VoxelSize;
+	const FIntVector Coordinates(FMath::FloorToInt(Voxel.X), FMath::FloorToInt(Voxel.Y), FMath::FloorToInt(Voxel.Z));
+	const FBrick* Brick = Bricks.Find(FIntVector(Coordinates.X >> BrickShift, Coordinates.Y >> BrickShift, Coordinates.Z >> BrickShift));
+	const int32 Index = (Coordinates.X & (BrickSize - 1)) | (Coordinates.Y & (BrickSize - 1)) << BrickShift | (Coordinates.Z & (BrickSize - 1)) << (2 * BrickShift);
+	return Brick && Brick->Counts[Index] > 0;
+}
+
+void UTunnelOccupancySubsystem::GetOccupiedVoxels(TArray<FVector3f>& OutCenters)
+{
+	UpdateMap();
+	OutCenters.Reset((int32)NumOccupiedVoxels);
+	for (const TPair<FIntVector, FBrick>& Pair : Bricks) {
+		const FIntVector Origin = Pair.Key * BrickSize;
+		for (int32 Index = 0; Index < BrickVoxels; Index++) {
+			if (Pair.Value.Counts[Index] > 0) {
+				const FIntVector Voxel = Origin + FIntVector(Index & (BrickSize - 1), (Index >> BrickShift) & (BrickSize - 1), Index >> (2 * BrickShift));
+				OutCenters.Add(FVector3f((Voxel.X + 0.5f) * VoxelSize, (Voxel.Y + 0.5f) * VoxelSize, (Voxel.Z + 0.5f) * VoxelSize));
+			}
+		}
+	}
+}
+
+bool UTunnelOccupancySubsystem::GetVoxelBounds(FIntVector& OutMin, FIntVector& OutMax) const
+{
+	if (Bricks.Num() == 0) {
+		return false;
+	}
+	OutMin = FIntVector(MAX_int32);
+	OutMax = FIntVector(MIN_int32);
+	for (const TPair<FIntVector, FBrick>& Pair : Bricks) {
+		OutMin = FIntVector(FMath::Min(OutMin.X, Pair.Key.X), FMath::Min(OutMin.Y, Pair.Key.Y), FMath::Min(OutMin.Z, Pair.Key.Z));
+		OutMax = FIntVector(FMath::Max(OutMax.X, Pair.Key.X), FMath::Max(OutMax.Y, Pair.Key.Y), FMath::Max(OutMax.Z, Pair.Key.Z));
+	}
+	OutMin = OutMin * BrickSize;
+	OutMax = OutMax * BrickSize + FIntVector(BrickSize - 1);
+	return true;
+}
+
+UTopic* UTunnelOccupancySubsystem::GetTopic(UTopic*& Topic, const FString& Name, const TCHAR* MessageType)
+{
+	UROSIntegrationGameInstance* rosInstance = Cast<UROSIntegrationGameInstance>(GetWorld()->GetGameInstance());
+	if (!rosInstance || !rosInstance->bIsConnected) {
+		return nullptr;
+	}
+	if (!IsValid(Topic)) {
+		Topic = NewObject<UTopic>(UTopic::StaticClass());
+		Topic->Init(rosInstance->ROSIntegrationCore, Name, MessageType, 0);
+		Topic->Advertise();
+	}
+	return Topic;
+}
+
+bool UTunnelOccupancySubsystem::PublishSlice(float Height, FString& OutInfoMessage)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelOccupancySubsystem::PublishSlice);
+
+	UTopic* Topic = GetTopic(SliceTopic, CVarTunnelOccupancySliceTopic.GetValueOnGameThread(), TEXT("nav_msgs/OccupancyGrid"));
+	if (!Topic) {
+		OutInfoMessage = TEXT("ROS is not connected");
+		return false;
+	}
+	UpdateMap();
+	FIntVector Min, Max;
+	if (!GetVoxelBounds(Min, Max)) {
+		OutInfoMessage = TEXT("The occupancy map is empty");
+		return false;
+	}
+	const int64 Width = Max.X - Min.X + 1;
+	const int64 Depth = Max.Y - Min.Y + 1;
+	if (Width * Depth > MaxSliceCells) {
+		OutInfoMessage = FString::Printf(TEXT("A slice of %lld x %lld cells is too large, increase tunnel.Occupancy.VoxelSize"), Width, Depth);
+		return false;
+	}
+
+	// Voxels in the slice are walls, cells with ground below and roof above within the clearance are inside the tunnel
+	const float HalfThickness = CVarTunnelOccupancySliceThickness.GetValueOnGameThread() * 0.5f;
+	const int32 Clearance = FMath::CeilToInt(CVarTunnelOccupancySliceClearance.GetValueOnGameThread() / VoxelSize);
+	const int32 SliceBottom = FMath::FloorToInt((Height - HalfThickness) / VoxelSize);
+	const int32 SliceTop = FMath::FloorToInt((Height + HalfThickness) / VoxelSize);
+	enum : uint8 { Wall = 1, Ground = 2, Roof = 4 };
+	TArray<uint8> Cells;
+	Cells.SetNumZeroed(Width * Depth);
+	for (const TPair<FIntVector, FBrick>& Pair : Bricks) {
+		const FIntVector Origin = Pair.Key * BrickSize;
+		if (Origin.Z > SliceTop + Clearance || Origin.Z + BrickSize <= SliceBottom - Clearance) {
+			continue;
+		}
+		for (int32 Index = 0; Index < BrickVoxels; Index++) {
+			if (Pair.Value.Counts[Index] == 0) {
+				continue;
+			}
+			const FIntVector Voxel = Origin + FIntVector(Index & (BrickSize - 1), (Index >> BrickShift) & (BrickSize - 1), Index >> (2 * BrickShift));
+			uint8& Cell = Cells[(Voxel.X - Min.X) + (Voxel.Y - Min.Y) * Width];
+			if (Voxel.Z < SliceBottom) {
+				Cell |= Voxel.Z >= SliceBottom - Clearance ? Ground : 0;
+			}
+			else if (Voxel.Z > SliceTop) {
+				Cell |= Voxel.Z <= SliceTop + Clearance ? Roof : 0;
+			}
+			else {
+				Cell |= Wall;
+			}
+		}
+	}
+
+	TSharedPtr<ROSMessages::nav_msgs::OccupancyGrid> Grid = MakeShareable(new ROSMessages::nav_msgs::OccupancyGrid);
+	Grid->header.seq = 1;
+	Grid->header.time = FROSTime::Now();
+	Grid->header.frame_id = CVarTunnelOccupancyFrameId.GetValueOnGameThread();
+	ROSMessages::geometry_msgs::Pose Origin;
+	Origin.position = ROSMessages::geometry_msgs::Point(FVector(Min.X, Min.Y, 0.0) * VoxelSize * CentimetersToMeters + FVector(0.0, 0.0, Height * CentimetersToMeters));
+	Origin.orientation = ROSMessages::geometry_msgs::Quaternion(FQuat::Identity);
+	Grid->info = ROSMessages::nav_msgs::MapMetaData(Grid->header.time, VoxelSize * CentimetersToMeters, (uint32)Width, (uint32)Depth, Origin);
+	Grid->data.SetNumUninitialized(Cells.Num());
+	ParallelFor(Cells.Num(), [&](int32 Index)
+	{
+		const uint8 Cell = Cells[Index];
+		Grid->data[Index] = (Cell & Wall) ? 100 : ((Cell & (Ground | Roof)) == (Ground | Roof) ? 0 : -1);
+	}, Cells.Num() < 65536);
+
+	Topic->Publish(Grid);
+	OutInfoMessage = FString::Printf(TEXT("Published a %lld x %lld occupancy slice at %.0f cm"), Width, Depth, Height);
+	return true;
+}
+
+bool UTunnelOccupancySubsystem::PublishVoxels(FString& OutInfoMessage)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelOccupancySubsystem::PublishVoxels);
+
+	UTopic* Topic = GetTopic(VoxelTopic, CVarTunnelOccupancyVoxelTopic.GetValueOnGameThread(), TEXT("sensor_msgs/PointCloud2"));
+	if (!Topic) {
+		OutInfoMessage = TEXT("ROS is not connected");
+		return false;
+	}
+	GetOccupiedVoxels(PublishedPoints);
+	if (PublishedPoints.Num() == 0) {
+		OutInfoMessage = TEXT("The occupancy map is empty");
+		return false;
+	}
+	for (FVector3f& Point : PublishedPoints) {
+		Point *= CentimetersToMeters;
+	}
+
+	TSharedPtr<ROSMessages::sensor_msgs::PointCloud2> Cloud = MakeShareable(new ROSMessages::sensor_msgs::PointCloud2);
+	static const TCHAR* FieldNames[] = { TEXT("x"), TEXT("y"), TEXT("z") };
+	Cloud->fields.SetNum(3);
+	for (int32 Field = 0; Field < 3; Field++) {
+		Cloud->fields[Field].name = FieldNames[Field];
+		Cloud->fields[Field].offset = Field * sizeof(float);
+		Cloud->fields[Field].datatype = ROSMessages::sensor_msgs::PointCloud2::PointField::EType::FLOAT32;
+		Cloud->fields[Field].count = 1;
+	}
+	Cloud->header.seq = 1;
+	Cloud->header.time = FROSTime::Now();
+	Cloud->header.frame_id = CVarTunnelOccupancyFrameId.GetValueOnGameThread();
+	Cloud->height = 1;
+	Cloud->width = PublishedPoints.Num();
+	Cloud->is_dense = true;
+	Cloud->is_bigendian = false;
+	Cloud->point_step = sizeof(FVector3f);
+	Cloud->row_step = Cloud->width * Cloud->point_step;
+	Cloud->data_ptr = reinterpret_cast<const uint8*>(PublishedPoints.GetData());
+
+	Topic->Publish(Cloud);
+	OutInfoMessage = FString::Printf(TEXT("Published %d occupied voxels of %.1f cm"), PublishedPoints.Num(), VoxelSize);
+	return true;
+}
+
+int64 UTunnelOccupancySubsystem::GetAllocatedSize() const
+{
+	int64 Size = Bricks.GetAllocatedSize() + Meshes.GetAllocatedSize() + DirtyMeshes.GetAllocatedSize() + PublishedPoints.GetAllocatedSize();
+	for (const TPair<FIntVector, FBrick>& Pair : Bricks) {
+		Size += Pair.Value.Counts.GetAllocatedSize();
+	}
+	for (const TPair<TWeakObjectPtr<UProceduralMeshComponent>, TArray<uint64>>& Pair : Meshes) {
+		Size += Pair.Value.GetAllocatedSize();
+	}
+	return Size;
+}
+
+bool UTunnelOccupancySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE || WorldType == EWorldType::Editor;
+}
+
+void UTunnelOccupancySubsystem::Deinitialize()
+{
+	Meshes.Empty();
+	DirtyMeshes.Empty();
+	Bricks.Empty();
+	PublishedPoints.Empty();
+	NumOccupiedVoxels = 0;
+	Super::Deinitialize();
+}
+
+TStatId UTunnelOccupancySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTunnelOccupancySubsystem, STATGROUP_Tickables);
+}
+
+void UTunnelOccupancySubsystem::Tick(float DeltaTime)
+{
+	TimeSinceUpdate += DeltaTime;
+	if (CVarTunnelOccupancyEnable.GetValueOnGameThread() == 0 || TimeSinceUpdate < CVarTunnelOccupancyInterval.GetValueOnGameThread()) {
+		return;
+	}
+	TimeSinceUpdate = 0.0f;
+	UpdateMap();
+}
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TunnelOccupancySubsystem.generated.h"
+
+class UProceduralMeshComponent;
+class UTopic;
+struct FProcMeshSection;
+
+// Ground truth occupancy map of the generated mine for benchmarking planners. The full detail ground and wall
+// sections of every tunnel and intersection are rasterized into voxels of tunnel.Occupancy.VoxelSize on worker
+// threads and kept in a sparse hash of 16^3 voxel bricks, so memory follows the tunnel surface and not the volume
+// of the mine. Each voxel counts the meshes touching it: when a section is regenerated only the voxels it gained
+// or lost are changed, and sections that are streamed out keep their voxels.
+//
+// With tunnel.Occupancy.Enable the map follows every edit, otherwise it is brought up to date when queried or
+// published. Maps are published in meters and Unreal axes:
+//
+//   tunnel.Occupancy.PublishSlice   nav_msgs/OccupancyGrid of a horizontal slice, 100 for walls, 0 for the
+//                                   tunnel floor area and -1 for rock
+//   tunnel.Occupancy.PublishVoxels  sensor_msgs/PointCloud2 with the centers of all occupied voxels
+UCLASS()
+class CHARMTUNNELSIM_API UTunnelOccupancySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Called when the geometry of a tunnel or intersection mesh changed
+	void MarkMeshDirty(UProceduralMeshComponent* Mesh);
+
+	// Voxelizes the meshes changed since the last update and drops the voxels of destroyed ones
+	UFUNCTION(BlueprintCallable, Category = "Tunnel occupancy")
+	void UpdateMap();
+	// Voxelizes every tunnel and intersection again, also done when the voxel size changes
+	UFUNCTION(BlueprintCallable, Category = "Tunnel occupancy")
+	void RebuildMap();
+
+	UFUNCTION(BlueprintCallable, Category = "Tunnel occupancy")
+	bool IsOccupied(FVector Location);
+
+	// Slice through the map at a height (cm), cells are occupied if a voxel within half of
+	// tunnel.Occupancy.SliceThickness of the height is
+	UFUNCTION(BlueprintCallable, Category = "Tunnel occupancy")
+	bool PublishSlice(float Height, FString& OutInfoMessage);
+	UFUNCTION(BlueprintCallable, Category = "Tunnel occupancy")
+	bool PublishVoxels(FString& OutInfoMessage);
+
+	// Centers of the occupied voxels in world space (cm)
+	void GetOccupiedVoxels(TArray<FVector3f>& OutCenters);
+
+	float GetVoxelSize() const { return VoxelSize; }
+	int64 GetNumOccupiedVoxels() const { return NumOccupiedVoxels; }
+	int32 GetNumBricks() const { return Bricks.Num(); }
+	int32 GetNumMeshes() const { return Meshes.Num(); }
+	int64 GetAllocatedSize() const;
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static constexpr int32 BrickShift = 4;
+	static constexpr int32 BrickSize = 1 << BrickShift;
+	static constexpr int32 BrickVoxels = BrickSize * BrickSize * BrickSize;
+
+	// Number of voxelized meshes touching each voxel of a brick
+	struct FBrick
+	{
+		TArray<uint16> Counts;
+		int32 NumOccupied = 0;
+	};
+
+	struct FMeshToVoxelize
+	{
+		TWeakObjectPtr<UProceduralMeshComponent> Mesh;
+		FTransform ToWorld;
+		TArray<const FProcMeshSection*, TInlineAllocator<2>> Sections;
+		TArray<uint64> Voxels;
+	};
+
+	void VoxelizeMeshes(TArray<FMeshToVoxelize>& MeshesToVoxelize) const;
+	void SetMeshVoxels(const TWeakObjectPtr<UProceduralMeshComponent>& Mesh, TArray<uint64>&& Voxels);
+	void AddVoxel(uint64 Key);
+	void RemoveVoxel(uint64 Key);
+	bool GetVoxelBounds(FIntVector& OutMin, FIntVector& OutMax) const;
+	UTopic* GetTopic(UTopic*& Topic, const FString& Name, const TCHAR* MessageType);
+
+	// Sorted keys of the voxels each mesh touches, what is removed again when the mesh changes
+	TMap<TWeakObjectPtr<UProceduralMeshComponent>, TArray<uint64>> Meshes;
+	TSet<TWeakObjectPtr<UProceduralMeshComponent>> DirtyMeshes;
+	TMap<FIntVector, FBrick> Bricks;
+	int64 NumOccupiedVoxels = 0;
+	float VoxelSize = 0.0f;
+	bool bNeedsRebuild = true;
+	float TimeSinceUpdate = 0.0f;
+
+	UPROPERTY()
+	UTopic* SliceTopic = nullptr;
+	UPROPERTY()
+	UTopic* VoxelTopic = nullptr;
+	// Points of the last published cloud, the message refers to them until it is sent
+	TArray<FVector3f> PublishedPoints;
+};
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelReferenceCases.h"
+#include "ProceduralIntersection.h"
+#include "ProceduralTunnel.h"
+#include "Hash/CityHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+const TCHAR* FTunnelReferenceCases::DefaultTunnelClass = TEXT("/Game/Charm/Blueprints/TunnelGenerator/BP_ProceduralTunnel.BP_ProceduralTunnel_C");
+const TCHAR* FTunnelReferenceCases::DefaultIntersectionClass = TEXT("/Game/Charm/Blueprints/TunnelGenerator/BP_ProceduralIntersection.BP_ProceduralIntersection_C");
+
+namespace
+{
+	constexpr double NormalTolerance = 0.001;
+
+	FTunnelNetworkEdge MakeEdge(const FString& Id, const TArray<FVector>& Points)
+	{
+		FTunnelNetworkEdge Edge;
+		Edge.Id = Id;
+		Edge.Points = Points;
+		return Edge;
+	}
+
+	FTunnelReferenceCase MakeTunnelCase(const FString& Name, const TArray<FVector>& Points)
+	{
+		FTunnelReferenceCase Case;
+		Case.Name = Name;
+		Case.Network.Edges.Add(MakeEdge(TEXT("main"), Points));
+		return Case;
+	}
+
+	FTunnelReferenceCase MakeIntersectionCase(IntersectionType Type)
+	{
+		FTunnelReferenceCase Case = MakeTunnelCase(TEXT("Intersection") + StaticEnum<IntersectionType>()->GetNameStringByValue(Type),
+			{ FVector(0.0f, 0.0f, 0.0f), FVector(2000.0f, 0.0f, 0.0f), FVector(4000.0f, 0.0f, 0.0f) });
+		FTunnelNetworkNode& Node = Case.Network.Nodes.AddDefaulted_GetRef();
+		Node.Id = TEXT("x");
+		Node.ParentTunnel = TEXT("main");
+		Node.Type = Type;
+		return Case;
+	}
+
+	int64 Quantize(double Value, double Tolerance)
+	{
+		return (int64)FMath::RoundToDouble(Value / Tolerance);
+	}
+
+	// Positions, normals and triangles of every section of the component. Collision is cooked from the same sections
+	// and lower levels of detail are components of their own, neither is hashed
+	void HashMesh(UProceduralMeshComponent* Mesh, double Tolerance, FTunnelGeometryHash& Out)
+	{
+		if (!IsValid(Mesh)) {
+			return;
+		}
+		TArray<int64> Quantized;
+		for (int32 SectionIndex = 0; SectionIndex < Mesh->GetNumSections(); SectionIndex++) {
+			const FProcMeshSection* Section = Mesh->GetProcMeshSection(SectionIndex);
+			Quantized.Reset(Section->ProcVertexBuffer.Num() * 6);
+			for (const FProcMeshVertex& Vertex : Section->ProcVertexBuffer) {
+				Quantized.Add(Quantize(Vertex.Position.X, Tolerance));
+				Quantized.Add(Quantize(Vertex.Position.Y, Tolerance));
+				Quantized.Add(Quantize(Vertex.Position.Z, Tolerance));
+				Quantized.Add(Quantize(Vertex.Normal.X, NormalTolerance));
+				Quantized.Add(Quantize(Vertex.Normal.Y, NormalTolerance));
+				Quantized.Add(Quantize(Vertex.Normal.Z, NormalTolerance));
+			}
+			Out.Hash = CityHash64WithSeed((const char*)Quantized.GetData(), (uint32)(Quantized.Num() * sizeof(int64)), Out.Hash);
+			Out.Hash = CityHash64WithSeed((const char*)Section->ProcIndexBuffer.GetData(), (uint32)(Section->ProcIndexBuffer.Num() * sizeof(uint32)), Out.Hash);
+			Out.Vertices += Section->ProcVertexBuffer.Num();
+			Out.Triangles += Section->ProcIndexBuffer.Num() / 3;
+		}
+	}
+}
+
+// Splines the generator has had problems with before: long straight runs, curves tighter than the tunnel is wide,
+// ramps and every kind of intersection at the end of a tunnel
+TArray<FTunnelReferenceCase> FTunnelReferenceCases::Make()
+{
+	TArray<FTunnelReferenceCase> Cases;
+	Cases.Add(MakeTunnelCase(TEXT("Straight"),
+		{ FVector(0.0f, 0.0f, 0.0f), FVector(2000.0f, 0.0f, 0.0f), FVector(4000.0f, 0.0f, 0.0f), FVector(6000.0f, 0.0f, 0.0f), FVector(8000.0f, 0.0f, 0.0f) }));
+	Cases.Add(MakeTunnelCase(TEXT("TightCurve"),
+		{ FVector(0.0f, 0.0f, 0.0f), FVector(1200.0f, 0.0f, 0.0f), FVector(2000.0f, 350.0f, 0.0f), FVector(2400.0f, 1200.0f, 0.0f), FVector(2400.0f, 2400.0f, 0.0f) }));
+	Cases.Add(MakeTunnelCase(TEXT("SCurve"),
+		{ FVector(0.0f, 0.0f, 0.0f), FVector(1500.0f, 0.0f, 0.0f), FVector(2500.0f, 900.0f, 0.0f), FVector(3500.0f, 0.0f, 0.0f), FVector(4500.0f, -900.0f, 0.0f), FVector(6000.0f, -900.0f, 0.0f) }));
+	Cases.Add(MakeTunnelCase(TEXT("Slope"),
+		{ FVector(0.0f, 0.0f, 0.0f), FVector(2000.0f, 0.0f, -250.0f), FVector(4000.0f, 0.0f, -750.0f), FVector(6000.0f, 0.0f, -1250.0f), FVector(8000.0f, 0.0f, -1500.0f) }));
+	Cases.Add(MakeTunnelCase(TEXT("CurvedSlope"),
+		{ FVector(0.0f, 0.0f, 0.0f), FVector(1500.0f, 0.0f, -200.0f), FVector(2600.0f, 800.0f, -500.0f), FVector(2800.0f, 2200.0f, -800.0f), FVector(2000.0f, 3400.0f, -1100.0f) }));
+	for (IntersectionType Type : { IntersectionType::Right, IntersectionType::Left, IntersectionType::All, IntersectionType::RightLeft }) {
+		Cases.Add(MakeIntersectionCase(Type));
+	}
+	return Cases;
+}
+
+FTunnelGeometryHash FTunnelReferenceCases::HashActors(const FTunnelNetworkActors& Actors, double Tolerance)
+{
+	FTunnelGeometryHash Result;
+	for (AProceduralTunnel* Tunnel : Actors.Tunnels) {
+		for (UProceduralMeshComponent* Mesh : Tunnel->TunnelMeshes) {
+			HashMesh(Mesh, Tolerance, Result);
+		}
+	}
+	for (AProceduralIntersection* Intersection : Actors.Intersections) {
+		HashMesh(Intersection->IntersectionMesh, Tolerance, Result);
+	}
+	return Result;
+}
+
+void FTunnelReferenceCases::DestroyActors(const FTunnelNetworkActors& Actors)
+{
+	for (AProceduralIntersection* Intersection : Actors.Intersections) {
+		Intersection->Destroy();
+	}
+	for (AProceduralTunnel* Tunnel : Actors.Tunnels) {
+		Tunnel->Destroy();
+	}
+}
+
+FString FTunnelReferenceCases::GetDefaultGoldenPath()
+{
+	return FPaths::Combine(FPaths::ProjectDir(), TEXT("Benchmarks"), TEXT("TunnelGolden.txt"));
+}
+
+TMap<FString, FString> FTunnelReferenceCases::LoadGoldenFile(const FString& Path)
+{
+	TMap<FString, FString> Golden;
+	TArray<FString> Lines;
+	FFileHelper::LoadFileToStringArray(Lines, *Path);
+	for (const FString& Line : Lines) {
+		TArray<FString> Fields;
+		if (Line.StartsWith(TEXT("#")) || Line.ParseIntoArrayWS(Fields) != 4) {
+			continue;
+		}
+		Golden.Add(Fields[0], FString::Printf(TEXT("%s %s %s"), *Fields[1], *Fields[2], *Fields[3]));
+	}
+	return Golden;
+}
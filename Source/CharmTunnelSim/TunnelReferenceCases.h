@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TunnelNetwork.h"
+
+class UProceduralMeshComponent;
+
+// One network of the reference library
+struct FTunnelReferenceCase
+{
+	FString Name;
+	FTunnelNetwork Network;
+};
+
+// Geometry of a generated case, what the golden file stores
+struct FTunnelGeometryHash
+{
+	int64 Vertices = 0;
+	int64 Triangles = 0;
+	uint64 Hash = 0;
+
+	FString ToString() const { return FString::Printf(TEXT("%lld %lld %016llx"), Vertices, Triangles, Hash); }
+	bool operator==(const FTunnelGeometryHash& Other) const { return Vertices == Other.Vertices && Triangles == Other.Triangles && Hash == Other.Hash; }
+	bool operator!=(const FTunnelGeometryHash& Other) const { return !(*this == Other); }
+};
+
+// Reference splines the generator is timed and checked with, shared by -run=TunnelBenchmark and the
+// CharmTunnelSim.Generation.Golden automation test. The golden file has one line per case: name, vertex count,
+// triangle count and hash. Lines starting with # are comments. -run=TunnelBenchmark -record writes it.
+struct CHARMTUNNELSIM_API FTunnelReferenceCases
+{
+	static const TCHAR* DefaultTunnelClass;
+	static const TCHAR* DefaultIntersectionClass;
+	// Positions are rounded to this (cm) and normals to a thousandth before hashing
+	static constexpr double DefaultTolerance = 0.01;
+
+	// Straight, tight curves, slopes and a tunnel ending in each intersection type
+	static TArray<FTunnelReferenceCase> Make();
+
+	// Positions, normals and triangles of every mesh of the actors
+	static FTunnelGeometryHash HashActors(const FTunnelNetworkActors& Actors, double Tolerance);
+	static void DestroyActors(const FTunnelNetworkActors& Actors);
+
+	// Benchmarks/TunnelGolden.txt in the project
+	static FString GetDefaultGoldenPath();
+	// Case name to "vertices triangles hash", empty if the file is missing
+	static TMap<FString, FString> LoadGoldenFile(const FString& Path);
+};
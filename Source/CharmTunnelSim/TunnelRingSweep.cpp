@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelRingSweep.h"
+#include "Components/SplineComponent.h"
+
+FTunnelRingFrame FTunnelRingFrame::FromSpline(const USplineComponent* Spline, float InputKey)
+{
+	FTunnelRingFrame Frame;
+	Frame.Location = Spline->GetLocationAtSplineInputKey(InputKey, ESplineCoordinateSpace::Local);
+	Frame.Forward = Spline->GetDirectionAtSplineInputKey(InputKey, ESplineCoordinateSpace::Local);
+	Frame.Right = FVector::CrossProduct(Frame.Forward, FVector::UpVector).GetSafeNormal();
+	Frame.Up = FVector::CrossProduct(Frame.Forward, Frame.Right).GetSafeNormal();
+	return Frame;
+}
+
+void FTunnelRingSweep::SweepRing(const FTunnelRingProfile& Profile, const FTunnelRingFrame& Frame, FVector* OutPositions, FVector* OutNormals, int32 Stride)
+{
+	// Each point is two multiply adds of the frame vectors, done on all three components at once
+	const VectorRegister4Double Location = VectorLoadFloat3(&Frame.Location.X);
+	const VectorRegister4Double Right = VectorLoadFloat3(&Frame.Right.X);
+	const VectorRegister4Double Up = VectorLoadFloat3(&Frame.Up.X);
+	const FVector2D* Offsets = Profile.Offsets.GetData();
+	const FVector2D* Normals = Profile.Normals.GetData();
+
+	for (int32 Point = 0; Point < Profile.Num(); Point++) {
+		VectorRegister4Double Position = VectorMultiplyAdd(Right, VectorSetFloat1(Offsets[Point].X), Location);
+		Position = VectorMultiplyAdd(Up, VectorSetFloat1(Offsets[Point].Y), Position);
+		VectorStoreFloat3(Position, &OutPositions[Point * Stride].X);
+
+		const VectorRegister4Double Normal = VectorMultiplyAdd(Up, VectorSetFloat1(Normals[Point].Y), VectorMultiply(Right, VectorSetFloat1(Normals[Point].X)));
+		VectorStoreFloat3(Normal, &OutNormals[Point * Stride].X);
+	}
+}
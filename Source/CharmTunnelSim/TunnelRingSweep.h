@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USplineComponent;
+
+// Cross section of a tunnel. Every point is an offset along the right and up vectors of a frame, with its
+// normal in the same basis, so sin and cos are evaluated once when the profile is built and not per vertex.
+struct FTunnelRingProfile
+{
+	TArray<FVector2D> Offsets;
+	TArray<FVector2D> Normals;
+	// Texture coordinate around the profile
+	TArray<float> U;
+
+	int32 Num() const { return Offsets.Num(); }
+
+	void Reset(int32 ExpectedPoints)
+	{
+		Offsets.Reset(ExpectedPoints);
+		Normals.Reset(ExpectedPoints);
+		U.Reset(ExpectedPoints);
+	}
+
+	void AddPoint(const FVector2D& Offset, const FVector2D& Normal, float InU)
+	{
+		Offsets.Add(Offset);
+		Normals.Add(Normal);
+		U.Add(InU);
+	}
+};
+
+// Orthonormal frame a ring is swept to, in spline local space
+struct FTunnelRingFrame
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Forward = FVector::ForwardVector;
+	FVector Right = FVector::RightVector;
+	FVector Up = FVector::UpVector;
+
+	// Right is level with the ground and up is perpendicular to forward and right
+	static FTunnelRingFrame FromSpline(const USplineComponent* Spline, float InputKey);
+
+	bool operator==(const FTunnelRingFrame& Other) const
+	{
+		return Location == Other.Location && Forward == Other.Forward && Right == Other.Right && Up == Other.Up;
+	}
+	bool operator!=(const FTunnelRingFrame& Other) const { return !(*this == Other); }
+};
+
+struct CHARMTUNNELSIM_API FTunnelRingSweep
+{
+	// Places every point of the profile at the frame. Outputs are written to every Stride-th element,
+	// so rings can be interleaved in one vertex array
+	static void SweepRing(const FTunnelRingProfile& Profile, const FTunnelRingFrame& Frame, FVector* OutPositions, FVector* OutNormals, int32 Stride = 1);
+};
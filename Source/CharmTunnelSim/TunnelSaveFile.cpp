@@ -0,0 +1,542 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelSaveFile.h"
+#include "ProceduralTunnel.h"
+#include "ProceduralIntersection.h"
+#include "TunnelStreamingSubsystem.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 MakeChunkId(char A, char B, char C, char D)
+	{
+		return (uint32)A | ((uint32)B << 8) | ((uint32)C << 16) | ((uint32)D << 24);
+	}
+
+	constexpr uint32 ChunkGraph = MakeChunkId('G', 'R', 'P', 'H');
+	constexpr uint32 ChunkEnds = MakeChunkId('E', 'N', 'D', 'S');
+	constexpr uint32 ChunkMesh = MakeChunkId('M', 'E', 'S', 'H');
+	constexpr uint32 ChunkTransforms = MakeChunkId('X', 'F', 'R', 'M');
+	// Every chunk this reader knows is at version 1, a chunk written by a newer layout is refused instead of misread
+	constexpr uint32 ChunkVersion = 1;
+	constexpr uint64 ChunkAlignment = 16;
+
+	struct FFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 NumChunks;
+		uint32 Reserved;
+	};
+
+	struct FChunkEntry
+	{
+		uint32 Id;
+		uint32 Version;
+		uint64 Offset;
+		uint64 Size;
+	};
+
+	enum ESectionFlags : uint32
+	{
+		SectionCollision = 1 << 0,
+	};
+
+	// Buffer offsets are from the start of the mesh chunk
+	struct FSectionRecord
+	{
+		int32 Tunnel;
+		int32 MeshIndex;
+		int32 Surface;
+		int32 Rows;
+		uint32 Flags;
+		uint32 NumVertices;
+		uint32 NumIndices;
+		uint32 Reserved;
+		uint64 Positions;
+		uint64 Normals;
+		uint64 Tangents;
+		uint64 UVs;
+		uint64 Indices;
+	};
+
+	static_assert(sizeof(FFileHeader) == 16 && sizeof(FChunkEntry) == 24 && sizeof(FSectionRecord) == 72, "Tunnel save file layout changed");
+
+	uint64 AlignOffset(uint64 Offset)
+	{
+		return Align(Offset, ChunkAlignment);
+	}
+
+	void SerializeEnd(FArchive& Ar, FMeshSectionEnd& End)
+	{
+		Ar << End.GroundVertives << End.WallVertices << End.GroundUV << End.WallUV;
+	}
+
+	void TransformEnd(const FTransform& Transform, FMeshSectionEnd& End)
+	{
+		for (FVector& Vertex : End.GroundVertives) {
+			Vertex = Transform.TransformPosition(Vertex);
+		}
+		for (FVector& Vertex : End.WallVertices) {
+			Vertex = Transform.TransformPosition(Vertex);
+		}
+	}
+
+	// Fails if the range is not inside the chunk
+	bool IsInChunk(uint64 Offset, uint64 Count, uint64 ElementSize, uint64 ChunkSize)
+	{
+		return Offset <= ChunkSize && Count <= (ChunkSize - Offset) / ElementSize;
+	}
+
+	TArray64<uint8> BuildMeshChunk(const TArray<AProceduralTunnel*>& Tunnels)
+	{
+		TArray<FSectionRecord> Records;
+		TArray<const FProcMeshSection*> Sources;
+		for (int32 TunnelIndex = 0; TunnelIndex < Tunnels.Num(); TunnelIndex++) {
+			AProceduralTunnel* Tunnel = Tunnels[TunnelIndex];
+			Tunnel->FlushMeshUploads();
+			for (int32 MeshIndex = 0; MeshIndex < Tunnel->TunnelMeshes.Num(); MeshIndex++) {
+				UProceduralMeshComponent* Mesh = Tunnel->TunnelMeshes[MeshIndex];
+				if (!IsValid(Mesh) || Mesh->GetNumSections() < 2) {
+					continue;
+				}
+				// Only the full detail level is saved, other levels are built again when uploading
+				for (int32 Surface = 0; Surface < 2; Surface++) {
+					const FProcMeshSection* Section = Mesh->GetProcMeshSection(Surface);
+					FSectionRecord& Record = Records.AddZeroed_GetRef();
+					Record.Tunnel = TunnelIndex;
+					Record.MeshIndex = MeshIndex;
+					Record.Surface = Surface;
+					Record.Rows = Tunnel->meshRows.IsValidIndex(MeshIndex) ? Tunnel->meshRows[MeshIndex] : 0;
+					Record.Flags = Section->bEnableCollision ? SectionCollision : 0;
+					Record.NumVertices = Section->ProcVertexBuffer.Num();
+					Record.NumIndices = Section->ProcIndexBuffer.Num();
+					Sources.Add(Section);
+				}
+			}
+		}
+
+		uint64 Offset = AlignOffset(sizeof(uint32) * 2 + Records.Num() * sizeof(FSectionRecord));
+		for (FSectionRecord& Record : Records) {
+			Record.Positions = Offset;
+			Offset = AlignOffset(Offset + Record.NumVertices * sizeof(FVector3f));
+			Record.Normals = Offset;
+			Offset = AlignOffset(Offset + Record.NumVertices * sizeof(FVector3f));
+			Record.Tangents = Offset;
+			Offset = AlignOffset(Offset + Record.NumVertices * sizeof(FVector4f));
+			Record.UVs = Offset;
+			Offset = AlignOffset(Offset + Record.NumVertices * sizeof(FVector2f));
+			Record.Indices = Offset;
+			Offset = AlignOffset(Offset + Record.NumIndices * sizeof(uint32));
+		}
+
+		TArray64<uint8> Chunk;
+		Chunk.SetNumZeroed(Offset);
+		uint8* Data = Chunk.GetData();
+		*(uint32*)Data = Records.Num();
+		FMemory::Memcpy(Data + sizeof(uint32) * 2, Records.GetData(), Records.Num() * sizeof(FSectionRecord));
+		for (int32 Index = 0; Index < Records.Num(); Index++) {
+			const FSectionRecord& Record = Records[Index];
+			const TArray<FProcMeshVertex>& Vertices = Sources[Index]->ProcVertexBuffer;
+			FVector3f* Positions = (FVector3f*)(Data + Record.Positions);
+			FVector3f* Normals = (FVector3f*)(Data + Record.Normals);
+			FVector4f* Tangents = (FVector4f*)(Data + Record.Tangents);
+			FVector2f* UVs = (FVector2f*)(Data + Record.UVs);
+			for (int32 Vertex = 0; Vertex < Vertices.Num(); Vertex++) {
+				Positions[Vertex] = FVector3f(Vertices[Vertex].Position);
+				Normals[Vertex] = FVector3f(Vertices[Vertex].Normal);
+				Tangents[Vertex] = FVector4f(FVector3f(Vertices[Vertex].Tangent.TangentX), Vertices[Vertex].Tangent.bFlipTangentY ? -1.0f : 1.0f);
+				UVs[Vertex] = FVector2f(Vertices[Vertex].UV0);
+			}
+			FMemory::Memcpy(Data + Record.Indices, Sources[Index]->ProcIndexBuffer.GetData(), Record.NumIndices * sizeof(uint32));
+		}
+		return Chunk;
+	}
+}
+
+FTunnelSaveFile::FTunnelSaveFile() = default;
+
+FTunnelSaveFile::~FTunnelSaveFile()
+{
+	Close();
+}
+
+bool FTunnelSaveFile::Save(UWorld* World, const FString& FilePath, bool bIncludeMeshes, FString& OutError)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelSaveFile::Save);
+
+	if (!World) {
+		OutError = TEXT("No world to save tunnels from");
+		return false;
+	}
+	// Streamed out sections are loaded back so every mesh is saved
+	if (UTunnelStreamingSubsystem* Streaming = World->GetSubsystem<UTunnelStreamingSubsystem>()) {
+		Streaming->LoadAllSections();
+	}
+
+	TArray<AProceduralTunnel*> Tunnels;
+	FTunnelNetwork Network = FTunnelNetwork::FromWorld(World, Tunnels);
+
+	TArray<TPair<uint32, TArray64<uint8>>> Chunks;
+	{
+		TArray<uint8> Graph;
+		FMemoryWriter Writer(Graph);
+		Network.Serialize(Writer);
+		Chunks.Emplace(ChunkGraph, TArray64<uint8>(Graph));
+	}
+	{
+		TArray<uint8> EndsData;
+		FMemoryWriter Writer(EndsData);
+		int32 NumTunnels = Tunnels.Num();
+		Writer << NumTunnels;
+		for (AProceduralTunnel* Tunnel : Tunnels) {
+			SerializeEnd(Writer, Tunnel->tunnelStartMeshData);
+			int32 NumEnds = Tunnel->meshEnds.Num();
+			Writer << NumEnds;
+			for (FMeshSectionEnd& End : Tunnel->meshEnds) {
+				SerializeEnd(Writer, End);
+			}
+		}
+		Chunks.Emplace(ChunkEnds, TArray64<uint8>(EndsData));
+	}
+	{
+		// Meshes and ends are in the space of their tunnel, the tunnel is spawned again wherever its spline starts
+		TArray<uint8> TransformData;
+		FMemoryWriter Writer(TransformData);
+		int32 NumTunnels = Tunnels.Num();
+		Writer << NumTunnels;
+		for (AProceduralTunnel* Tunnel : Tunnels) {
+			FTransform Transform = Tunnel->GetActorTransform();
+			Writer << Transform;
+		}
+		Chunks.Emplace(ChunkTransforms, TArray64<uint8>(TransformData));
+	}
+	if (bIncludeMeshes) {
+		Chunks.Emplace(ChunkMesh, BuildMeshChunk(Tunnels));
+	}
+
+	FFileHeader Header = { Magic, FileVersion, (uint32)Chunks.Num(), 0 };
+	TArray<FChunkEntry> Entries;
+	uint64 Offset = AlignOffset(sizeof(FFileHeader) + Chunks.Num() * sizeof(FChunkEntry));
+	for (const TPair<uint32, TArray64<uint8>>& Chunk : Chunks) {
+		Entries.Add({ Chunk.Key, ChunkVersion, Offset, (uint64)Chunk.Value.Num() });
+		Offset = AlignOffset(Offset + Chunk.Value.Num());
+	}
+
+	TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FilePath));
+	if (!File) {
+		OutError = FString::Printf(TEXT("Could not open '%s' for writing"), *FilePath);
+		return false;
+	}
+	static const uint8 Padding[ChunkAlignment] = {};
+	bool bWritten = File->Write((const uint8*)&Header, sizeof(Header))
+		&& File->Write((const uint8*)Entries.GetData(), Entries.Num() * sizeof(FChunkEntry));
+	for (int32 Index = 0; bWritten && Index < Chunks.Num(); Index++) {
+		bWritten = File->Write(Padding, Entries[Index].Offset - File->Tell())
+			&& File->Write(Chunks[Index].Value.GetData(), Chunks[Index].Value.Num());
+	}
+	if (!bWritten) {
+		OutError = FString::Printf(TEXT("Writing '%s' failed"), *FilePath);
+		return false;
+	}
+	return true;
+}
+
+bool FTunnelSaveFile::Open(const FString& FilePath, FString& OutError)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelSaveFile::Open);
+
+	Close();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile.Reset(PlatformFile.OpenMapped(*FilePath));
+	if (MappedFile && MappedFile->GetFileSize() > 0) {
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+	if (MappedRegion) {
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(FileData, *FilePath)) {
+		// Platforms without mapping read the file once, views then point into this copy
+		Data = FileData.GetData();
+		Size = FileData.Num();
+	}
+	else {
+		OutError = FString::Printf(TEXT("Could not open '%s'"), *FilePath);
+		return false;
+	}
+
+	if (!Parse(OutError)) {
+		OutError = FString::Printf(TEXT("%s - '%s'"), *OutError, *FilePath);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FTunnelSaveFile::Close()
+{
+	Sections.Reset();
+	SectionsByTunnel.Reset();
+	Ends.Reset();
+	Transforms.Reset();
+	Network = FTunnelNetwork();
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	FileData.Empty();
+	Data = nullptr;
+	Size = 0;
+}
+
+bool FTunnelSaveFile::Parse(FString& OutError)
+{
+	if (Size < (int64)sizeof(FFileHeader)) {
+		OutError = TEXT("File is too small to be a tunnel save");
+		return false;
+	}
+	const FFileHeader& Header = *(const FFileHeader*)Data;
+	if (Header.Magic != Magic) {
+		OutError = TEXT("File is not a tunnel save");
+		return false;
+	}
+	if (Header.Version > FileVersion) {
+		OutError = FString::Printf(TEXT("Tunnel save version %u is newer than supported version %u"), Header.Version, FileVersion);
+		return false;
+	}
+	if (Header.Version < FileVersion) {
+		OutError = FString::Printf(TEXT("Tunnel save version %u has no tunnel transforms, save it again"), Header.Version);
+		return false;
+	}
+	if (!IsInChunk(sizeof(FFileHeader), Header.NumChunks, sizeof(FChunkEntry), Size)) {
+		OutError = TEXT("Chunk table is truncated");
+		return false;
+	}
+
+	const FChunkEntry* Entries = (const FChunkEntry*)(Data + sizeof(FFileHeader));
+	bool bHasGraph = false;
+	for (uint32 Index = 0; Index < Header.NumChunks; Index++) {
+		const FChunkEntry& Entry = Entries[Index];
+		if (Entry.Offset % ChunkAlignment != 0 || !IsInChunk(Entry.Offset, Entry.Size, 1, Size)) {
+			OutError = TEXT("Chunk is outside of the file");
+			return false;
+		}
+		const uint8* Chunk = Data + Entry.Offset;
+		const bool bKnownChunk = Entry.Id == ChunkGraph || Entry.Id == ChunkEnds || Entry.Id == ChunkTransforms || Entry.Id == ChunkMesh;
+		if (bKnownChunk && Entry.Version != ChunkVersion) {
+			const ANSICHAR Id[5] = { (ANSICHAR)(Entry.Id & 0xff), (ANSICHAR)((Entry.Id >> 8) & 0xff), (ANSICHAR)((Entry.Id >> 16) & 0xff), (ANSICHAR)(Entry.Id >> 24), 0 };
+			OutError = FString::Printf(TEXT("Chunk %hs version %u is not supported, expected version %u"), Id, Entry.Version, ChunkVersion);
+			return false;
+		}
+		if (Entry.Id == ChunkGraph || Entry.Id == ChunkEnds || Entry.Id == ChunkTransforms) {
+			if (Entry.Size > MAX_int32) {
+				OutError = TEXT("Chunk is too large");
+				return false;
+			}
+			FMemoryReaderView Reader(TArrayView<const uint8>(Chunk, (int32)Entry.Size));
+			if (Entry.Id == ChunkGraph) {
+				bHasGraph = Network.Serialize(Reader);
+			}
+			else if (Entry.Id == ChunkTransforms) {
+				int32 NumTunnels = 0;
+				Reader << NumTunnels;
+				if (NumTunnels < 0 || NumTunnels > Reader.TotalSize()) {
+					Reader.SetError();
+				}
+				Transforms.SetNum(Reader.IsError() ? 0 : NumTunnels);
+				for (FTransform& Transform : Transforms) {
+					Reader << Transform;
+				}
+			}
+			else {
+				int32 NumTunnels = 0;
+				Reader << NumTunnels;
+				if (NumTunnels < 0 || NumTunnels > Reader.TotalSize()) {
+					Reader.SetError();
+				}
+				Ends.SetNum(Reader.IsError() ? 0 : NumTunnels);
+				for (FTunnelEnds& TunnelEnds : Ends) {
+					SerializeEnd(Reader, TunnelEnds.Start);
+					int32 NumEnds = 0;
+					Reader << NumEnds;
+					if (NumEnds < 0 || NumEnds > Reader.TotalSize() || Reader.IsError()) {
+						Reader.SetError();
+						break;
+					}
+					TunnelEnds.MeshEnds.SetNum(NumEnds);
+					for (FMeshSectionEnd& End : TunnelEnds.MeshEnds) {
+						SerializeEnd(Reader, End);
+					}
+				}
+			}
+			if (Reader.IsError()) {
+				OutError = TEXT("Tunnel graph, mesh ends or transforms are corrupted");
+				return false;
+			}
+		}
+		else if (Entry.Id == ChunkMesh) {
+			if (!ParseMeshChunk(Chunk, Entry.Size, OutError)) {
+				return false;
+			}
+		}
+	}
+
+	if (!bHasGraph || Ends.Num() != Network.Edges.Num()) {
+		OutError = TEXT("Tunnel graph is missing or does not match the mesh ends");
+		return false;
+	}
+	if (Transforms.Num() != Network.Edges.Num()) {
+		OutError = TEXT("Tunnel transforms are missing or do not match the tunnel graph");
+		return false;
+	}
+	for (const FTunnelSaveSectionView& Section : Sections) {
+		if (Section.Tunnel >= Network.Edges.Num()) {
+			OutError = TEXT("Section belongs to a tunnel that is not in the graph");
+			return false;
+		}
+	}
+	SectionsByTunnel.SetNum(Network.Edges.Num());
+	for (int32 Index = 0; Index < Sections.Num(); Index++) {
+		SectionsByTunnel[Sections[Index].Tunnel].Add(Index);
+	}
+	return true;
+}
+
+bool FTunnelSaveFile::ParseMeshChunk(const uint8* Chunk, uint64 ChunkSize, FString& OutError)
+{
+	OutError = TEXT("Mesh chunk is corrupted");
+	if (ChunkSize < sizeof(uint32) * 2) {
+		return false;
+	}
+	const uint32 NumRecords = *(const uint32*)Chunk;
+	if (!IsInChunk(sizeof(uint32) * 2, NumRecords, sizeof(FSectionRecord), ChunkSize)) {
+		return false;
+	}
+	const FSectionRecord* Records = (const FSectionRecord*)(Chunk + sizeof(uint32) * 2);
+	Sections.SetNum(NumRecords);
+	for (uint32 Index = 0; Index < NumRecords; Index++) {
+		const FSectionRecord& Record = Records[Index];
+		if (Record.Tunnel < 0 || Record.MeshIndex < 0 || (Record.Surface != 0 && Record.Surface != 1)
+			|| !IsInChunk(Record.Positions, Record.NumVertices, sizeof(FVector3f), ChunkSize)
+			|| !IsInChunk(Record.Normals, Record.NumVertices, sizeof(FVector3f), ChunkSize)
+			|| !IsInChunk(Record.Tangents, Record.NumVertices, sizeof(FVector4f), ChunkSize)
+			|| !IsInChunk(Record.UVs, Record.NumVertices, sizeof(FVector2f), ChunkSize)
+			|| !IsInChunk(Record.Indices, Record.NumIndices, sizeof(uint32), ChunkSize)
+			|| Record.NumVertices > MAX_int32 || Record.NumIndices > MAX_int32 || Record.NumIndices % 3 != 0) {
+			return false;
+		}
+
+		FTunnelSaveSectionView& View = Sections[Index];
+		View.Tunnel = Record.Tunnel;
+		View.MeshIndex = Record.MeshIndex;
+		View.Surface = Record.Surface;
+		View.Rows = Record.Rows;
+		View.bEnableCollision = (Record.Flags & SectionCollision) != 0;
+		View.Positions = TArrayView<const FVector3f>((const FVector3f*)(Chunk + Record.Positions), Record.NumVertices);
+		View.Normals = TArrayView<const FVector3f>((const FVector3f*)(Chunk + Record.Normals), Record.NumVertices);
+		View.Tangents = TArrayView<const FVector4f>((const FVector4f*)(Chunk + Record.Tangents), Record.NumVertices);
+		View.UVs = TArrayView<const FVector2f>((const FVector2f*)(Chunk + Record.UVs), Record.NumVertices);
+		View.Indices = TArrayView<const uint32>((const uint32*)(Chunk + Record.Indices), Record.NumIndices);
+
+		// Indices go to the render thread as they are, one out of range would read past the vertex buffer
+		for (uint32 VertexIndex : View.Indices) {
+			if (VertexIndex >= Record.NumVertices) {
+				return false;
+			}
+		}
+	}
+	OutError.Reset();
+	return true;
+}
+
+TArrayView<const int32> FTunnelSaveFile::GetTunnelSections(int32 Tunnel) const
+{
+	return SectionsByTunnel.IsValidIndex(Tunnel) ? TArrayView<const int32>(SectionsByTunnel[Tunnel]) : TArrayView<const int32>();
+}
+
+void FTunnelSaveFile::ToSectionData(const FTunnelSaveSectionView& View, FTunnelMeshSectionData& OutData)
+{
+	ToSectionData(View, FTransform::Identity, OutData);
+}
+
+void FTunnelSaveFile::ToSectionData(const FTunnelSaveSectionView& View, const FTransform& Transform, FTunnelMeshSectionData& OutData)
+{
+	const int32 NumVertices = View.Positions.Num();
+	OutData.Vertices.SetNumUninitialized(NumVertices);
+	OutData.Normals.SetNumUninitialized(NumVertices);
+	OutData.Tangents.SetNumUninitialized(NumVertices);
+	OutData.UV.SetNumUninitialized(NumVertices);
+	for (int32 Index = 0; Index < NumVertices; Index++) {
+		OutData.Vertices[Index] = FVector(View.Positions[Index]);
+		OutData.Normals[Index] = FVector(View.Normals[Index]);
+		const FVector4f& Tangent = View.Tangents[Index];
+		OutData.Tangents[Index] = FProcMeshTangent(FVector(Tangent.X, Tangent.Y, Tangent.Z), Tangent.W < 0.0f);
+		OutData.UV[Index] = FVector2D(View.UVs[Index]);
+	}
+	// Only a tunnel that was spawned somewhere else than it was saved at has to be moved
+	if (!Transform.Equals(FTransform::Identity)) {
+		for (int32 Index = 0; Index < NumVertices; Index++) {
+			OutData.Vertices[Index] = Transform.TransformPosition(OutData.Vertices[Index]);
+			OutData.Normals[Index] = Transform.TransformVectorNoScale(OutData.Normals[Index]);
+			OutData.Tangents[Index].TangentX = Transform.TransformVectorNoScale(OutData.Tangents[Index].TangentX);
+		}
+	}
+	OutData.Triangles.SetNumUninitialized(View.Indices.Num());
+	FMemory::Memcpy(OutData.Triangles.GetData(), View.Indices.GetData(), View.Indices.Num() * sizeof(uint32));
+	OutData.bEnableCollision = View.bEnableCollision;
+}
+
+bool FTunnelSaveFile::Spawn(UWorld* World, TSubclassOf<AProceduralTunnel> TunnelClass, TSubclassOf<AProceduralIntersection> IntersectionClass,
+	FTunnelNetworkActors& OutActors, FString& OutError) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FTunnelSaveFile::Spawn);
+
+	return UTunnelNetworkLibrary::GenerateTunnelNetwork(World, Network, TunnelClass, IntersectionClass, OutActors, OutError,
+		[this](int32 EdgeIndex, AProceduralTunnel* Tunnel) { return RestoreTunnel(EdgeIndex, Tunnel); });
+}
+
+bool FTunnelSaveFile::RestoreTunnel(int32 EdgeIndex, AProceduralTunnel* Tunnel) const
+{
+	TArrayView<const int32> TunnelSections = GetTunnelSections(EdgeIndex);
+	if (TunnelSections.Num() == 0) {
+		return false;
+	}
+
+	// Saved geometry is in the space of the tunnel when it was saved, the spawned tunnel can be placed and turned
+	// differently (its first spline point and direction), so everything is moved through world space into its space
+	const FTransform SavedToSpawned = Transforms[EdgeIndex].GetRelativeTransform(Tunnel->GetActorTransform());
+
+	// Point sizes are set up the same way as before generating, so the loaded tunnel can be edited
+	Tunnel->CalculateRecreationStartIndex();
+	Tunnel->tunnelStartMeshData = Ends[EdgeIndex].Start;
+	Tunnel->meshEnds = Ends[EdgeIndex].MeshEnds;
+	if (!SavedToSpawned.Equals(FTransform::Identity)) {
+		TransformEnd(SavedToSpawned, Tunnel->tunnelStartMeshData);
+		for (FMeshSectionEnd& End : Tunnel->meshEnds) {
+			TransformEnd(SavedToSpawned, End);
+		}
+	}
+
+	// Ground and wall of a mesh are saved one after another
+	for (int32 Index = 0; Index + 1 < TunnelSections.Num(); Index += 2) {
+		const FTunnelSaveSectionView& Ground = Sections[TunnelSections[Index]];
+		const FTunnelSaveSectionView& Wall = Sections[TunnelSections[Index + 1]];
+		if (Ground.MeshIndex != Wall.MeshIndex || Ground.Surface != 0 || Wall.Surface != 1) {
+			continue;
+		}
+		FTunnelMeshSectionData GroundData;
+		FTunnelMeshSectionData WallData;
+		ToSectionData(Ground, SavedToSpawned, GroundData);
+		ToSectionData(Wall, SavedToSpawned, WallData);
+		const FMeshSectionEnd End = Tunnel->meshEnds.IsValidIndex(Ground.MeshIndex) ? Tunnel->meshEnds[Ground.MeshIndex] : FMeshSectionEnd();
+		Tunnel->RestoreMesh(Ground.MeshIndex, Ground.Rows, End, MoveTemp(GroundData), MoveTemp(WallData));
+	}
+	Tunnel->FlushMeshUploads();
+	// The spline was set after spawning and no generation pass runs, which is what updates the ends otherwise
+	Tunnel->UpdateEndpoints();
+	return true;
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnumContainer.h"
+#include "TunnelNetwork.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class AProceduralTunnel;
+class AProceduralIntersection;
+
+// Geometry of one saved mesh section, pointing straight into the loaded file
+struct FTunnelSaveSectionView
+{
+	int32 Tunnel = 0;
+	// Mesh of the tunnel counted from its start, surface 0 is ground and 1 wall
+	int32 MeshIndex = 0;
+	int32 Surface = 0;
+	int32 Rows = 0;
+	bool bEnableCollision = true;
+	TArrayView<const FVector3f> Positions;
+	TArrayView<const FVector3f> Normals;
+	// Tangent x, y, z and -1 in w if the binormal is flipped
+	TArrayView<const FVector4f> Tangents;
+	TArrayView<const FVector2f> UVs;
+	TArrayView<const uint32> Indices;
+};
+
+// Binary, versioned tunnel save file:
+//
+//   header    magic 'CTUN', file version, chunk count
+//   chunks    id, chunk version, offset and size of each chunk, chunks are 16 byte aligned
+//   GRPH      tunnel network (FTunnelNetwork::Serialize)
+//   ENDS      start loop and mesh end loops of every tunnel, needed to edit or attach to a loaded tunnel
+//   XFRM      actor transform of every tunnel, meshes and ends are stored in the space of their tunnel
+//   MESH      section table followed by raw float position, normal, tangent, UV and index buffers (optional)
+//
+// Files are memory mapped when the platform supports it and section buffers are read through views into
+// the mapping, nothing is parsed or copied until the sections are uploaded. Collision is not stored,
+// procedural mesh components cook it themselves on a worker thread from the uploaded vertices. Data is
+// little endian. Unknown chunks are skipped, so new chunks can be added without breaking older readers. Known chunks
+// with a version this reader does not know are refused.
+class CHARMTUNNELSIM_API FTunnelSaveFile
+{
+public:
+	static constexpr uint32 Magic = 0x4E555443; // "CTUN"
+	// Version 2 added the tunnel transforms
+	static constexpr uint32 FileVersion = 2;
+
+	FTunnelSaveFile();
+	~FTunnelSaveFile();
+
+	// Writes every tunnel and intersection of the world, with their generated meshes if bIncludeMeshes
+	static bool Save(UWorld* World, const FString& FilePath, bool bIncludeMeshes, FString& OutError);
+
+	bool Open(const FString& FilePath, FString& OutError);
+	void Close();
+	bool IsMemoryMapped() const { return MappedRegion.IsValid(); }
+
+	const FTunnelNetwork& GetNetwork() const { return Network; }
+	TArrayView<const FTunnelSaveSectionView> GetSections() const { return Sections; }
+	// Sections of one tunnel in the order they were saved
+	TArrayView<const int32> GetTunnelSections(int32 Tunnel) const;
+
+	// Spawns the saved tunnels and intersections. Tunnels with saved meshes get them uploaded without
+	// generating, tunnels saved without meshes are generated from their splines
+	bool Spawn(UWorld* World, TSubclassOf<AProceduralTunnel> TunnelClass, TSubclassOf<AProceduralIntersection> IntersectionClass,
+		FTunnelNetworkActors& OutActors, FString& OutError) const;
+
+	// Copies a section view into the arrays procedural mesh components take, optionally moved by Transform
+	static void ToSectionData(const FTunnelSaveSectionView& View, FTunnelMeshSectionData& OutData);
+	static void ToSectionData(const FTunnelSaveSectionView& View, const FTransform& Transform, FTunnelMeshSectionData& OutData);
+	// Actor transform of a tunnel when it was saved
+	const FTransform& GetTunnelTransform(int32 Tunnel) const { return Transforms[Tunnel]; }
+
+private:
+	struct FTunnelEnds
+	{
+		FMeshSectionEnd Start;
+		TArray<FMeshSectionEnd> MeshEnds;
+	};
+
+	bool Parse(FString& OutError);
+	bool ParseMeshChunk(const uint8* Chunk, uint64 ChunkSize, FString& OutError);
+	bool RestoreTunnel(int32 EdgeIndex, AProceduralTunnel* Tunnel) const;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	// Whole file when it could not be mapped
+	TArray64<uint8> FileData;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	FTunnelNetwork Network;
+	TArray<FTunnelEnds> Ends;
+	TArray<FTransform> Transforms;
+	TArray<FTunnelSaveSectionView> Sections;
+	TArray<TArray<int32>> SectionsByTunnel;
+};
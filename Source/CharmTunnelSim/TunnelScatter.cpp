@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelScatter.h"
+#include "Engine/StaticMesh.h"
+#include "Math/RandomStream.h"
+
+int32 FTunnelScatter::GetSectionSeed(int32 TunnelSeed, int32 MeshIndex, int32 RuleIndex)
+{
+	// Sections are counted from the start of the tunnel, so extending the tunnel keeps the placement of existing sections
+	return (int32)HashCombine(HashCombine(GetTypeHash(TunnelSeed), GetTypeHash(MeshIndex)), GetTypeHash(RuleIndex));
+}
+
+void FTunnelScatter::PlaceInstances(const FTunnelScatterSection& Section, const FTunnelScatterRule& Rule, int32 Seed, TArray<FTransform>& OutTransforms)
+{
+	OutTransforms.Reset();
+	const bool bOnGround = Rule.Surface == ETunnelScatterSurface::Ground;
+	const TArrayView<const FProcMeshVertex> Vertices = bOnGround ? Section.Ground : Section.Wall;
+	if (!Rule.Mesh || Section.Rows < 2 || Vertices.Num() % Section.Rows != 0 || Section.Forward.Num() < Section.Rows || Section.Up.Num() < Section.Rows) {
+		return;
+	}
+
+	// Columns of the surface inside its grid
+	const int32 Columns = Vertices.Num() / Section.Rows;
+	int32 FirstColumn = 0;
+	int32 LastColumn = Columns - 1;
+	switch (Rule.Surface) {
+	case ETunnelScatterSurface::RightWall:
+		LastColumn = Section.RightWallColumns - 1;
+		break;
+	case ETunnelScatterSurface::Roof:
+		FirstColumn = Section.RightWallColumns;
+		LastColumn = Section.RightWallColumns + Section.RoofColumns - 1;
+		break;
+	case ETunnelScatterSurface::LeftWall:
+		FirstColumn = Section.RightWallColumns + Section.RoofColumns;
+		break;
+	default:
+		break;
+	}
+	LastColumn = FMath::Min(LastColumn, Columns - 1);
+	if (LastColumn - FirstColumn < 1) {
+		return;
+	}
+
+	// Every attempt draws the same random numbers whether it places an instance or not, so changing
+	// the probability or the scale of a rule does not move the other instances
+	FRandomStream Random(Seed);
+	const float Attempts = Section.Length / FMath::Max(Rule.Spacing, 1.0f);
+	const int32 AttemptCount = FMath::FloorToInt(Attempts + Random.FRand());
+	const float CoverageMin = FMath::Clamp((float)FMath::Min(Rule.Coverage.X, Rule.Coverage.Y), 0.0f, 1.0f);
+	const float CoverageMax = FMath::Clamp((float)FMath::Max(Rule.Coverage.X, Rule.Coverage.Y), 0.0f, 1.0f);
+	OutTransforms.Reserve(AttemptCount);
+	for (int32 Attempt = 0; Attempt < AttemptCount; Attempt++) {
+		const float Along = (Attempt + 0.5f + Rule.Jitter * (Random.FRand() - 0.5f)) / AttemptCount;
+		const float Across = FMath::Lerp(CoverageMin, CoverageMax, Random.FRand());
+		const float Scale = (float)FMath::Lerp(Rule.ScaleRange.X, Rule.ScaleRange.Y, (double)Random.FRand());
+		const float Yaw = Random.FRand() * 2.0f * PI;
+		if (Random.FRand() >= Rule.Probability) {
+			continue;
+		}
+
+		// Bilinear position and normal on the grid quad the attempt falls on
+		const float Row = FMath::Clamp(Along, 0.0f, 1.0f) * (Section.Rows - 1);
+		const float Column = FirstColumn + Across * (LastColumn - FirstColumn);
+		const int32 Row0 = FMath::Min(FMath::FloorToInt(Row), Section.Rows - 2);
+		const int32 Column0 = FMath::Min(FMath::FloorToInt(Column), LastColumn - 1);
+		const float RowAlpha = Row - Row0;
+		const float ColumnAlpha = Column - Column0;
+		const FProcMeshVertex& V00 = Vertices[Row0 * Columns + Column0];
+		const FProcMeshVertex& V01 = Vertices[Row0 * Columns + Column0 + 1];
+		const FProcMeshVertex& V10 = Vertices[(Row0 + 1) * Columns + Column0];
+		const FProcMeshVertex& V11 = Vertices[(Row0 + 1) * Columns + Column0 + 1];
+		const FVector Position = FMath::BiLerp(V00.Position, V01.Position, V10.Position, V11.Position, ColumnAlpha, RowAlpha);
+		const FVector Normal = FMath::BiLerp(V00.Normal, V01.Normal, V10.Normal, V11.Normal, ColumnAlpha, RowAlpha).GetSafeNormal();
+		const FVector Forward = FMath::Lerp(Section.Forward[Row0], Section.Forward[Row0 + 1], RowAlpha);
+		const FVector TunnelUp = FMath::Lerp(Section.Up[Row0], Section.Up[Row0 + 1], RowAlpha);
+
+		const FVector Up = Rule.AlignToSurface && !Normal.IsNearlyZero() ? Normal : TunnelUp.GetSafeNormal();
+		FQuat Rotation = FRotationMatrix::MakeFromZX(Up, Forward).ToQuat();
+		if (Rule.RandomYaw) {
+			Rotation = FQuat(Up, Yaw) * Rotation;
+		}
+		OutTransforms.Emplace(Rotation, Position + Normal * Rule.SurfaceOffset, FVector(Scale));
+	}
+}
+
+uint32 FTunnelScatter::GetRulesHash(TArrayView<const FTunnelScatterRule> Rules, int32 TunnelSeed)
+{
+	uint32 Hash = GetTypeHash(TunnelSeed);
+	Hash = HashCombine(Hash, GetTypeHash(Rules.Num()));
+	for (const FTunnelScatterRule& Rule : Rules) {
+		Hash = HashCombine(Hash, PointerHash(Rule.Mesh));
+		Hash = HashCombine(Hash, GetTypeHash((uint8)Rule.Surface));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.Spacing));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.Probability));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.Jitter));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.Coverage));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.ScaleRange));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.SurfaceOffset));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.AlignToSurface));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.RandomYaw));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.CullStartDistance));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.CullEndDistance));
+		Hash = HashCombine(Hash, GetTypeHash(Rule.EnableCollision));
+	}
+	return Hash;
+}
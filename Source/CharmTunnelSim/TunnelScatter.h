@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProceduralMeshComponent.h"
+#include "TunnelScatter.generated.h"
+
+class UStaticMesh;
+
+// Surface of the tunnel loop, same order as AProceduralTunnel::GetSurfaceIndex
+UENUM(BlueprintType)
+enum class ETunnelScatterSurface : uint8
+{
+	Ground,
+	RightWall,
+	Roof,
+	LeftWall,
+};
+
+// One kind of mesh scattered along a tunnel, for example floor debris, rock bolts, pipes or lights
+USTRUCT(BlueprintType)
+struct FTunnelScatterRule
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UStaticMesh* Mesh = nullptr;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ETunnelScatterSurface Surface = ETunnelScatterSurface::Ground;
+	// Distance along the tunnel between placement attempts (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "1"))
+	float Spacing = 300.0f;
+	// Chance of an attempt placing an instance
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "1"))
+	float Probability = 1.0f;
+	// Moves attempts along the tunnel by up to this part of the spacing, 0 places them in a regular row
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0", ClampMax = "1"))
+	float Jitter = 1.0f;
+	// Part of the surface across the tunnel instances are placed on, 0 is where the surface starts going around the tunnel
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector2D Coverage = FVector2D(0.0f, 1.0f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector2D ScaleRange = FVector2D(1.0f, 1.0f);
+	// Moves instances along the surface normal (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SurfaceOffset = 0.0f;
+	// Instances point up along the surface normal, otherwise along the tunnel's up vector
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool AlignToSurface = true;
+	// Random rotation around the up axis, otherwise instances face along the tunnel
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool RandomYaw = true;
+	// Instances fade out between these distances from the camera, 0 never culls
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 CullStartDistance = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 CullEndDistance = 0;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool EnableCollision = false;
+};
+
+// Full detail surface grids of one generated tunnel section and the tunnel frame at each of its loops, in actor space
+struct FTunnelScatterSection
+{
+	TArrayView<const FProcMeshVertex> Ground;
+	TArrayView<const FProcMeshVertex> Wall;
+	// Loops along the section
+	int32 Rows = 0;
+	// Columns of the right wall and the roof at the start of the wall grid, the left wall takes the rest
+	int32 RightWallColumns = 0;
+	int32 RoofColumns = 0;
+	float Length = 0.0f;
+	TArray<FVector> Forward;
+	TArray<FVector> Up;
+};
+
+// Places scatter instances on a tunnel section. Placement only depends on the section geometry, the rule and the
+// seed, so every section can be placed on its own thread and comes out the same each time it is placed again.
+struct CHARMTUNNELSIM_API FTunnelScatter
+{
+	static int32 GetSectionSeed(int32 TunnelSeed, int32 MeshIndex, int32 RuleIndex);
+
+	static void PlaceInstances(const FTunnelScatterSection& Section, const FTunnelScatterRule& Rule, int32 Seed, TArray<FTransform>& OutTransforms);
+
+	// Hash of everything placement depends on besides the sections
+	static uint32 GetRulesHash(TArrayView<const FTunnelScatterRule> Rules, int32 TunnelSeed);
+};
@@ -0,0 +1,481 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TunnelStreamingSubsystem.h"
+#include "ProceduralTunnel.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+static TAutoConsoleVariable<int32> CVarTunnelStreamingEnable(
+	TEXT("tunnel.Streaming.Enable"), 1,
+	TEXT("Stream tunnel sections in and out around vehicles and sensors."));
+static TAutoConsoleVariable<float> CVarTunnelStreamingLoadRadius(
+	TEXT("tunnel.Streaming.LoadRadius"), 20000.0f,
+	TEXT("Sections closer than this to a streaming source are loaded (cm)."));
+static TAutoConsoleVariable<float> CVarTunnelStreamingUnloadRadius(
+	TEXT("tunnel.Streaming.UnloadRadius"), 30000.0f,
+	TEXT("Sections further than this from every streaming source are streamed out (cm)."));
+static TAutoConsoleVariable<float> CVarTunnelStreamingLookAhead(
+	TEXT("tunnel.Streaming.LookAheadSeconds"), 2.0f,
+	TEXT("Sources also load sections around where their current velocity takes them in this time."));
+static TAutoConsoleVariable<float> CVarTunnelStreamingCacheBudget(
+	TEXT("tunnel.Streaming.CacheBudgetMB"), 256.0f,
+	TEXT("Packed sections above this size are dropped and regenerated from the spline when needed."));
+static TAutoConsoleVariable<float> CVarTunnelStreamingUploadBudget(
+	TEXT("tunnel.Streaming.UploadBudgetMs"), 2.0f,
+	TEXT("Time per frame spent uploading loaded sections, at least one section is uploaded per frame."));
+static TAutoConsoleVariable<float> CVarTunnelStreamingInterval(
+	TEXT("tunnel.Streaming.UpdateInterval"), 0.25f,
+	TEXT("Seconds between checking section distances."));
+
+void UTunnelStreamingSubsystem::AddStreamingSource(AActor* Source)
+{
+	if (IsValid(Source)) {
+		Sources.AddUnique(Source);
+	}
+}
+
+void UTunnelStreamingSubsystem::RemoveStreamingSource(AActor* Source)
+{
+	Sources.Remove(Source);
+}
+
+void UTunnelStreamingSubsystem::LoadAllSections()
+{
+	// Sections of destroyed tunnels leave the table before anything is streamed in
+	GatherSections();
+	for (FStreamedSection& Section : Sections) {
+		if (Section.bResident || Section.bRegenerating || Section.Loading.IsValid()) {
+			continue;
+		}
+		// A tunnel runs one pass at a time, the previous one is finished so this section can start
+		AProceduralTunnel* Tunnel = Section.Tunnel.Get();
+		if (Section.Packed.Num() == 0 && Tunnel) {
+			Tunnel->FinishAsyncGenerationLoop(true);
+		}
+		StreamIn(Section);
+	}
+	for (FStreamedSection& Section : Sections) {
+		AProceduralTunnel* Tunnel = Section.Tunnel.Get();
+		if (Section.bRegenerating && Tunnel) {
+			Tunnel->FinishAsyncGenerationLoop(true);
+			Tunnel->FlushMeshUploads();
+		}
+	}
+	FinishRegenerations();
+	FinishLoads(TNumericLimits<double>::Max());
+}
+
+int32 UTunnelStreamingSubsystem::GetNumResidentSections() const
+{
+	int32 Count = 0;
+	for (const FStreamedSection& Section : Sections) {
+		Count += Section.bResident ? 1 : 0;
+	}
+	return Count;
+}
+
+bool UTunnelStreamingSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	// The editor keeps the whole tunnel so it can be edited and saved
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UTunnelStreamingSubsystem::Deinitialize()
+{
+	for (FStreamedSection& Section : Sections) {
+		if (Section.Loading.IsValid()) {
+			Section.Loading.Wait();
+		}
+	}
+	Sections.Empty();
+	SectionIndexByMesh.Empty();
+	CacheSize = 0;
+	Super::Deinitialize();
+}
+
+TStatId UTunnelStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTunnelStreamingSubsystem, STATGROUP_Tickables);
+}
+
+void UTunnelStreamingSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelStreamingSubsystem::Tick);
+
+	FinishRegenerations();
+	FinishLoads(CVarTunnelStreamingUploadBudget.GetValueOnGameThread() / 1000.0);
+
+	TimeSinceUpdate += DeltaTime;
+	if (CVarTunnelStreamingEnable.GetValueOnGameThread() == 0 || TimeSinceUpdate < CVarTunnelStreamingInterval.GetValueOnGameThread()) {
+		return;
+	}
+	TimeSinceUpdate = 0.0f;
+
+	UpdateSources();
+	GatherSections();
+	if (SourceLocations.Num() == 0) {
+		return;
+	}
+
+	const float LoadRadius = CVarTunnelStreamingLoadRadius.GetValueOnGameThread();
+	const float UnloadRadius = FMath::Max(CVarTunnelStreamingUnloadRadius.GetValueOnGameThread(), LoadRadius);
+	const double Now = FPlatformTime::Seconds();
+	for (FStreamedSection& Section : Sections) {
+		const float DistanceSquared = GetDistanceSquaredToSources(Section.Bounds);
+		if (DistanceSquared <= FMath::Square(LoadRadius)) {
+			Section.LastUsedTime = Now;
+			if (!Section.bResident && !Section.bRegenerating && !Section.Loading.IsValid()) {
+				StreamIn(Section);
+			}
+		}
+		else if (DistanceSquared > FMath::Square(UnloadRadius) && Section.bResident) {
+			StreamOut(Section);
+		}
+	}
+
+	TrimCache((int64)(CVarTunnelStreamingCacheBudget.GetValueOnGameThread() * 1024.0f * 1024.0f));
+}
+
+// Current location of every source and where it will be after the look ahead time
+void UTunnelStreamingSubsystem::UpdateSources()
+{
+	Sources.RemoveAll([](const TWeakObjectPtr<AActor>& Source) { return !Source.IsValid(); });
+
+	const float LookAhead = CVarTunnelStreamingLookAhead.GetValueOnGameThread();
+	SourceLocations.Reset();
+	auto AddSource = [this, LookAhead](const AActor* Actor)
+	{
+		SourceLocations.Add(Actor->GetActorLocation());
+		const FVector Velocity = Actor->GetVelocity();
+		if (!Velocity.IsNearlyZero()) {
+			SourceLocations.Add(Actor->GetActorLocation() + Velocity * LookAhead);
+		}
+	};
+
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It) {
+		if (It->GetController()) {
+			AddSource(*It);
+		}
+	}
+	for (const TWeakObjectPtr<AActor>& Source : Sources) {
+		AddSource(Source.Get());
+	}
+}
+
+float UTunnelStreamingSubsystem::GetDistanceSquaredToSources(const FBoxSphereBounds& Bounds) const
+{
+	float Closest = TNumericLimits<float>::Max();
+	for (const FVector& Location : SourceLocations) {
+		Closest = FMath::Min(Closest, (float)Bounds.ComputeSquaredDistanceFromBoxToPoint(Location));
+	}
+	return Closest;
+}
+
+// Picks up new tunnel meshes and forgets destroyed ones
+void UTunnelStreamingSubsystem::GatherSections()
+{
+	// Destroyed meshes (undo, reset) leave the table, pending loads are simply discarded
+	const int32 OldNum = Sections.Num();
+	Sections.RemoveAll([this](const FStreamedSection& Section)
+	{
+		if (Section.Mesh.IsValid() && Section.Tunnel.IsValid()) {
+			return false;
+		}
+		for (const FPackedSection& Packed : Section.Packed) {
+			CacheSize -= Packed.Data.Num();
+		}
+		return true;
+	});
+	if (Sections.Num() != OldNum) {
+		SectionIndexByMesh.Reset();
+		for (int32 Index = 0; Index < Sections.Num(); Index++) {
+			SectionIndexByMesh.Add(Sections[Index].Mesh, Index);
+		}
+	}
+
+	for (TActorIterator<AProceduralTunnel> It(GetWorld()); It; ++It) {
+		AProceduralTunnel* Tunnel = *It;
+		for (int32 MeshIndex = 0; MeshIndex < Tunnel->TunnelMeshes.Num(); MeshIndex++) {
+			UProceduralMeshComponent* Mesh = Tunnel->TunnelMeshes[MeshIndex];
+			if (!IsValid(Mesh)) {
+				continue;
+			}
+
+			const int32* Found = SectionIndexByMesh.Find(Mesh);
+			FStreamedSection* Section = Found ? &Sections[*Found] : nullptr;
+			if (!Section) {
+				SectionIndexByMesh.Add(Mesh, Sections.Num());
+				Section = &Sections.AddDefaulted_GetRef();
+				Section->Tunnel = Tunnel;
+				Section->Mesh = Mesh;
+			}
+			Section->MeshIndex = MeshIndex;
+
+			const bool bHasGeometry = Mesh->GetNumSections() > 0 && Mesh->GetProcMeshSection(0)->ProcVertexBuffer.Num() > 0;
+			if (!Section->bResident && bHasGeometry && !Section->Loading.IsValid() && !Section->bRegenerating && !Tunnel->IsMeshUploadPending(Mesh)) {
+				// The tunnel rebuilt a streamed out section, the packed copy is stale
+				for (const FPackedSection& Packed : Section->Packed) {
+					CacheSize -= Packed.Data.Num();
+				}
+				Section->Packed.Empty();
+				Section->bResident = true;
+			}
+			if (Section->bResident && bHasGeometry) {
+				Section->Bounds = Mesh->Bounds;
+			}
+		}
+	}
+}
+
+void UTunnelStreamingSubsystem::StreamOut(FStreamedSection& Section)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UTunnelStreamingSubsystem::StreamOut);
+
+	UProceduralMeshComponent* Mesh = Section.Mesh.Get();
+	AProceduralTunnel* Tunnel = Section.Tunnel.Get();
+	for (const FPackedSection& Packed : Section.Packed) {
+		CacheSize -= Packed.Data.Num();
+	}
+	Section.Packed.Reset();
+
+	// Geometry waiting in the tunnel upload queue is newer than the component, packing the component would keep a
+	// stale copy. The queued upload is dropped and the section is regenerated when it streams in again
+	if (Tunnel && Tunnel->CancelMeshUpload(Mesh)) {
+		Mesh->ClearAllMeshSections();
+		Tunnel->ClearMeshLods(Section.MeshIndex);
+		Tunnel->ClearScatter(Section.MeshIndex);
+		Section.bResident = false;
+		return;
+	}
+	// Nothing uploaded, nothing to stream out
+	if (Mesh->GetNumSections() == 0) {
+		return;
+	}
+	// Ground and wall at full resolution, the tunnel makes the coarse levels again from them
+	for (int32 Index = 0; Index < FMath::Min(Mesh->GetNumSections(), 2); Index++) {
+		FPackedSection& Packed = Section.Packed.Add_GetRef(Pack(*Mesh->GetProcMeshSection(Index)));
+		CacheSize += Packed.Data.Num();
+	}
+
+	// Releases render data and collision, materials stay on the component. Scattered instances are placed again on stream in
+	Mesh->ClearAllMeshSections();
+	if (Tunnel) {
+		Tunnel->ClearMeshLods(Section.MeshIndex);
+		Tunnel->ClearScatter(Section.MeshIndex);
+	}
+	Section.bResident = false;
+}
+
+void UTunnelStreamingSubsystem::StreamIn(FStreamedSection& Section)
+{
+	if (Section.Packed.Num() == 0) {
+		// Dropped from the cache, regenerate it from the spline like an edit of the section would. The tunnel
+		// generates it on a worker thread, FinishRegenerations marks it resident once the mesh is uploaded.
+		// A tunnel runs one pass at a time, if it is busy the section is tried again on the next update
+		AProceduralTunnel* Tunnel = Section.Tunnel.Get();
+		if (!Tunnel) {
+			return;
+		}
+		const int32 IndexFromEnd = Tunnel->SplineComponent->GetNumberOfSplinePoints() - 2 - Section.MeshIndex;
+		if (IndexFromEnd < 0) {
+			Section.bResident = true;
+		}
+		else if (Tunnel->BeginAsyncGenerationLoop(IndexFromEnd, IndexFromEnd, true)) {
+			Section.bRegenerating = true;
+		}
+		return;
+	}
+
+	// Packed data moves to the worker, the section is packed again when it streams out next time
+	for (const FPackedSection& Packed : Section.Packed) {
+		CacheSize -= Packed.Data.Num();
+	}
+	Section.Loading = Async(EAsyncExecution::ThreadPool, [Packed = MoveTemp(Section.Packed)]()
+	{
+		TArray<FTunnelMeshSectionData> Result;
+		for (const FPackedSection& Part : Packed) {
+			Result.Add(Unpack(Part));
+		}
+		return Result;
+	});
+	Section.Packed.Reset();
+}
+
+// Regenerated sections become resident once their tunnel finished the pass and uploaded the mesh
+void UTunnelStreamingSubsystem::FinishRegenerations()
+{
+	for (FStreamedSection& Section : Sections) {
+		AProceduralTunnel* Tunnel = Section.Tunnel.Get();
+		UProceduralMeshComponent* Mesh = Section.Mesh.Get();
+		if (!Section.bRegenerating || !Tunnel || !Mesh || Tunnel->IsAsyncGenerationRunning() || Tunnel->IsMeshUploadPending(Mesh)) {
+			continue;
+		}
+		Section.bRegenerating = false;
+		Section.bResident = true;
+		if (Mesh->GetNumSections() > 0) {
+			Section.Bounds = Mesh->Bounds;
+		}
+	}
+}
+
+void UTunnelStreamingSubsystem::FinishLoads(double BudgetSeconds)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	for (FStreamedSection& Section : Sections) {
+		if (!Section.Loading.IsValid() || (!Section.Loading.IsReady() && BudgetSeconds != TNumericLimits<double>::Max())) {
+			continue;
+		}
+
+		TArray<FTunnelMeshSectionData> Parts = Section.Loading.Get();
+		Section.Loading.Reset();
+		// Coarse levels and collision are made again by the tunnel, it also places the scattered instances again
+		AProceduralTunnel* Tunnel = Section.Tunnel.Get();
+		if (Section.Mesh.IsValid() && Tunnel && Parts.Num() >= 2) {
+			Tunnel->UploadStreamedMesh(Section.MeshIndex, MoveTemp(Parts[0]), MoveTemp(Parts[1]));
+			Section.bResident = true;
+		}
+
+		if (FPlatformTime::Seconds() - StartTime >= BudgetSeconds) {
+			break;
+		}
+	}
+}
+
+// Drops packed sections that were used least recently until the cache fits the budget
+void UTunnelStreamingSubsystem::TrimCache(int64 BudgetBytes)
+{
+	if (CacheSize <= BudgetBytes) {
+		return;
+	}
+
+	TArray<FStreamedSection*> Packed;
+	for (FStreamedSection& Section : Sections) {
+		if (Section.Packed.Num() > 0) {
+			Packed.Add(&Section);
+		}
+	}
+	Packed.Sort([](const FStreamedSection& A, const FStreamedSection& B) { return A.LastUsedTime < B.LastUsedTime; });
+
+	for (FStreamedSection* Section : Packed) {
+		if (CacheSize <= BudgetBytes) {
+			break;
+		}
+		for (const FPackedSection& Part : Section->Packed) {
+			CacheSize -= Part.Data.Num();
+		}
+		Section->Packed.Empty();
+	}
+}
+
+UTunnelStreamingSubsystem::FPackedSection UTunnelStreamingSubsystem::Pack(const FProcMeshSection& Section)
+{
+	TArray<uint8> Raw;
+	FMemoryWriter Writer(Raw);
+	int32 VertexCount = Section.ProcVertexBuffer.Num();
+	int32 IndexCount = Section.ProcIndexBuffer.Num();
+	bool bEnableCollision = Section.bEnableCollision;
+	Writer << VertexCount << IndexCount << bEnableCollision;
+
+	// Attribute streams one after another compress better than interleaved vertices
+	for (const FProcMeshVertex& Vertex : Section.ProcVertexBuffer) {
+		FVector3f Position(Vertex.Position);
+		Writer << Position;
+	}
+	for (const FProcMeshVertex& Vertex : Section.ProcVertexBuffer) {
+		FVector3f Normal(Vertex.Normal);
+		Writer << Normal;
+	}
+	for (const FProcMeshVertex& Vertex : Section.ProcVertexBuffer) {
+		FVector3f Tangent(Vertex.Tangent.TangentX);
+		uint8 bFlip = Vertex.Tangent.bFlipTangentY;
+		Writer << Tangent << bFlip;
+	}
+	for (const FProcMeshVertex& Vertex : Section.ProcVertexBuffer) {
+		FVector2f UV(Vertex.UV0);
+		Writer << UV;
+	}
+	Writer.Serialize((void*)Section.ProcIndexBuffer.GetData(), IndexCount * sizeof(uint32));
+
+	FPackedSection Packed;
+	Packed.UncompressedSize = Raw.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, Raw.Num());
+	Packed.Data.SetNumUninitialized(CompressedSize);
+	Packed.bCompressed = FCompression::CompressMemory(NAME_Oodle, Packed.Data.GetData(), CompressedSize, Raw.GetData(), Raw.Num());
+	if (Packed.bCompressed) {
+		Packed.Data.SetNum(CompressedSize);
+	}
+	else {
+		Packed.Data = MoveTemp(Raw);
+	}
+	Packed.Data.Shrink();
+	return Packed;
+}
+
+FTunnelMeshSectionData UTunnelStreamingSubsystem::Unpack(const FPackedSection& Packed)
+{
+	TArray<uint8> Raw;
+	if (!Packed.bCompressed) {
+		Raw = Packed.Data;
+	}
+	else {
+		Raw.SetNumUninitialized(Packed.UncompressedSize);
+		if (!FCompression::UncompressMemory(NAME_Oodle, Raw.GetData(), Raw.Num(), Packed.Data.GetData(), Packed.Data.Num())) {
+			UE_LOG(LogTemp, Error, TEXT("Could not decompress a streamed tunnel section."));
+			return FTunnelMeshSectionData();
+		}
+	}
+
+	FMemoryReader Reader(Raw);
+	int32 VertexCount = 0;
+	int32 IndexCount = 0;
+	FTunnelMeshSectionData Data;
+	Reader << VertexCount << IndexCount << Data.bEnableCollision;
+
+	Data.Vertices.SetNumUninitialized(VertexCount);
+	Data.Normals.SetNumUninitialized(VertexCount);
+	Data.Tangents.SetNumUninitialized(VertexCount);
+	Data.UV.SetNumUninitialized(VertexCount);
+	for (FVector& Vertex : Data.Vertices) {
+		FVector3f Position;
+		Reader << Position;
+		Vertex = FVector(Position);
+	}
+	for (FVector& Normal : Data.Normals) {
+		FVector3f Value;
+		Reader << Value;
+		Normal = FVector(Value);
+	}
+	for (FProcMeshTangent& Tangent : Data.Tangents) {
+		FVector3f Value;
+		uint8 bFlip = 0;
+		Reader << Value << bFlip;
+		Tangent = FProcMeshTangent(FVector(Value), bFlip != 0);
+	}
+	for (FVector2D& UV : Data.UV) {
+		FVector2f Value;
+		Reader << Value;
+		UV = FVector2D(Value);
+	}
+	Data.Triangles.SetNumUninitialized(IndexCount);
+	Reader.Serialize(Data.Triangles.GetData(), IndexCount * sizeof(int32));
+	return Data;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs TunnelStreamingStatsCommand(
+	TEXT("tunnel.Streaming.Stats"),
+	TEXT("Prints resident tunnel sections and the size of the packed section cache."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const UTunnelStreamingSubsystem* Streaming = World ? World->GetSubsystem<UTunnelStreamingSubsystem>() : nullptr;
+		if (!Streaming) {
+			UE_LOG(LogTemp, Display, TEXT("Tunnel streaming is not running in this world."));
+			return;
+		}
+		UE_LOG(LogTemp, Display, TEXT("Tunnel streaming: %d resident sections, packed cache %.2f MB"),
+			Streaming->GetNumResidentSections(), Streaming->GetCacheSize() / (1024.0 * 1024.0));
+	}));
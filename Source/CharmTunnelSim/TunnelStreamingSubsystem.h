@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Async/Async.h"
+#include "TunnelMeshUpload.h"
+#include "TunnelStreamingSubsystem.generated.h"
+
+class AProceduralTunnel;
+
+// Keeps only tunnel sections near vehicles and sensors on their mesh components. Sections further than the
+// unload radius are packed into a compressed cache and their render data and collision are released, sections
+// entering the load radius (measured from where the sources will be after the look ahead time) are unpacked on
+// a worker thread and uploaded a few per frame. When the cache grows past its budget the least recently used
+// packed sections are dropped and regenerated from the tunnel spline on a worker thread when needed again.
+// A section only counts as resident once its geometry is on the mesh component.
+// Controlled with the tunnel.Streaming.* console variables.
+UCLASS()
+class CHARMTUNNELSIM_API UTunnelStreamingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Pawns with a controller are always sources, sensors or other actors can be added here
+	UFUNCTION(BlueprintCallable, Category = "Tunnel streaming")
+	void AddStreamingSource(AActor* Source);
+	UFUNCTION(BlueprintCallable, Category = "Tunnel streaming")
+	void RemoveStreamingSource(AActor* Source);
+
+	// Loads every streamed out section back, used before saving or exporting the whole tunnel
+	UFUNCTION(BlueprintCallable, Category = "Tunnel streaming")
+	void LoadAllSections();
+
+	int32 GetNumResidentSections() const;
+	int64 GetCacheSize() const { return CacheSize; }
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	// Section geometry in compact form: float positions, normals, tangents and UVs plus indices and the collision flag, compressed
+	struct FPackedSection
+	{
+		TArray<uint8> Data;
+		int32 UncompressedSize = 0;
+		bool bCompressed = false;
+	};
+
+	struct FStreamedSection
+	{
+		TWeakObjectPtr<AProceduralTunnel> Tunnel;
+		TWeakObjectPtr<UProceduralMeshComponent> Mesh;
+		int32 MeshIndex = 0;
+		FBoxSphereBounds Bounds;
+		bool bResident = true;
+		double LastUsedTime = 0.0;
+		// Ground and wall sections, empty once dropped from the cache
+		TArray<FPackedSection, TInlineAllocator<2>> Packed;
+		// Sections being unpacked on a worker thread
+		TFuture<TArray<FTunnelMeshSectionData>> Loading;
+		// Dropped section generated again by its tunnel, waiting for the pass and the upload of its mesh
+		bool bRegenerating = false;
+	};
+
+	void UpdateSources();
+	float GetDistanceSquaredToSources(const FBoxSphereBounds& Bounds) const;
+	void GatherSections();
+	void StreamOut(FStreamedSection& Section);
+	void StreamIn(FStreamedSection& Section);
+	void FinishRegenerations();
+	void FinishLoads(double BudgetSeconds);
+	void TrimCache(int64 BudgetBytes);
+
+	static FPackedSection Pack(const FProcMeshSection& Section);
+	static FTunnelMeshSectionData Unpack(const FPackedSection& Packed);
+
+	TArray<TWeakObjectPtr<AActor>> Sources;
+	TArray<FStreamedSection> Sections;
+	TMap<TWeakObjectPtr<UProceduralMeshComponent>, int32> SectionIndexByMesh;
+	TArray<FVector> SourceLocations;
+	int64 CacheSize = 0;
+	float TimeSinceUpdate = 0.0f;
+};